@@ -0,0 +1,81 @@
+﻿#include "stdafx.h"
+#include "kalloc.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace kson;
+
+//============================================================
+//  KsonAlloc
+//============================================================
+
+namespace {
+	std::atomic<size_t> g_count(0);
+	std::atomic<size_t> g_bytes(0);
+	std::atomic<size_t> g_live(0);
+	std::atomic<size_t> g_peak(0);
+
+	// 每块内存前面保留一个头部记录大小，保证返回地址的对齐
+	const size_t HEADER_SIZE = alignof(std::max_align_t) > sizeof(size_t) ? alignof(std::max_align_t) : sizeof(size_t);
+
+	void* allocate(size_t size) {
+		void* p = std::malloc(size + HEADER_SIZE);
+		if (!p) return nullptr;
+		*static_cast<size_t*>(p) = size;
+
+		g_count.fetch_add(1, std::memory_order_relaxed);
+		g_bytes.fetch_add(size, std::memory_order_relaxed);
+		size_t live = g_live.fetch_add(size, std::memory_order_relaxed) + size;
+		size_t peak = g_peak.load(std::memory_order_relaxed);
+		while (live > peak && !g_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+		return static_cast<char*>(p) + HEADER_SIZE;
+	}
+
+	void deallocate(void* ptr) {
+		if (!ptr) return;
+		void* p = static_cast<char*>(ptr) - HEADER_SIZE;
+		g_live.fetch_sub(*static_cast<size_t*>(p), std::memory_order_relaxed);
+		std::free(p);
+	}
+}
+
+// reset
+void KsonAlloc::reset() {
+	g_count = 0;
+	g_bytes = 0;
+	g_peak = g_live.load();
+}
+
+// stat
+KsonAllocStat KsonAlloc::stat() {
+	return { g_count.load(), g_bytes.load(), g_live.load(), g_peak.load() };
+}
+
+
+//============================================================
+//  全局 operator new/delete
+//============================================================
+
+void* operator new(size_t size) {
+	void* p = allocate(size);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) {
+	void* p = allocate(size);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+
+void operator delete(void* ptr) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { deallocate(ptr); }
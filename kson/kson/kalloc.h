@@ -0,0 +1,32 @@
+﻿#ifndef __K_ALLOC_H__
+#define __K_ALLOC_H__
+
+#include <cstddef>
+
+//============================================================
+//  KsonAlloc: 全局内存分配统计（测试类/性能测试类使用）
+//============================================================
+
+// kalloc.cpp 替换了全局的 operator new/delete，链接后所有堆分配都会被统计
+
+namespace kson {
+
+	struct KsonAllocStat {
+		size_t m_count;   // 分配次数
+		size_t m_bytes;   // 累计分配字节数
+		size_t m_live;    // 当前未释放的字节数
+		size_t m_peak;    // 未释放字节数的峰值
+	};
+
+	class KsonAlloc {
+	public:
+
+		// 清零分配次数和累计字节数，峰值从当前未释放字节数重新开始统计
+		static void reset();
+
+		// 获取统计信息
+		static KsonAllocStat stat();
+	};
+}
+
+#endif
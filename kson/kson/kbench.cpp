@@ -0,0 +1,1795 @@
+﻿#include "stdafx.h"
+#include "kbench.h"
+#include "kalloc.h"
+#include "kdoc.h"
+#include "ksimd.h"
+#include "kwriter.h"
+#include "kbin.h"
+#include "ktape.h"
+#include "kindex.h"
+#include "kparallel.h"
+#include "kstream.h"
+#include "kbind.h"
+#include "kpath.h"
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <cmath>
+#include <cstdlib>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include <random>
+#include <thread>
+
+using namespace kson;
+
+namespace {
+
+	// 旧的 KsonValue 布局：六种类型的值同时存在于每个节点中
+	struct KsonValueLegacy {
+		std::map<std::string, KsonValue> m_object;
+		KsonArray       m_array;
+		KsonStr         m_str;
+		KsonNum         m_num;
+		KsonBool        m_bool;
+		KsonNull        m_null;
+		KsonType        m_type;
+	};
+
+	// 旧的数值转换：整数部分按 unsigned 累加，小数部分逐位除以 10，指数逐位乘以 10（不支持负指数）
+	double legacyToDouble(const std::string& intPart, const std::string& fracPart, const std::string& expPart) {
+		unsigned intNum = 0;
+		for (char c : intPart) intNum = intNum * 10 + (c - '0');
+		unsigned tail = 0;
+		for (char c : fracPart) tail = tail * 10 + (c - '0');
+		double doubleTail = static_cast<int>(tail);
+		for (size_t i = 0; i < fracPart.size(); ++i) doubleTail /= 10;
+		double doubleNum = static_cast<int>(intNum) + doubleTail;
+		unsigned exp = 0;
+		for (char c : expPart) if (c != '-' && c != '+') exp = exp * 10 + (c - '0');
+		for (int i = static_cast<int>(exp); i > 0; --i) doubleNum *= 10;
+		return doubleNum;
+	}
+
+	// 累加所有的数值
+	class KsonNumSumHandler : public KsonHandler {
+	public:
+		bool integer(KsonInt value) override { m_sum += static_cast<double>(value); return true; }
+		bool floating(double value) override { m_sum += value; return true; }
+
+		double m_sum = 0;
+	};
+
+	// 累加所有名为 id 的整数
+	class KsonSumHandler : public KsonHandler {
+	public:
+		bool key(const char* str, size_t len) override {
+			m_isId = (len == 2 && str[0] == 'i' && str[1] == 'd');
+			return true;
+		}
+		bool integer(KsonInt value) override {
+			if (m_isId) m_sum += value;
+			return true;
+		}
+
+		bool m_isId = false;
+		long long m_sum = 0;
+	};
+
+	// 基于 ostringstream 的输出：逐字符转义，double 使用 operator<<（默认 6 位有效数字，不能往返）
+	void naiveWrite(const KsonValue& val, std::ostringstream& os);
+
+	void naiveWrite(const KsonObject& obj, std::ostringstream& os) {
+		os << '{';
+		bool first = true;
+		for (const auto& member : obj) {
+			if (!first) os << ',';
+			first = false;
+			os << member.first << ':';
+			naiveWrite(member.second, os);
+		}
+		os << '}';
+	}
+
+	void naiveWrite(const KsonValue& val, std::ostringstream& os) {
+		switch (val.getType()) {
+		case KsonType::OBJECT:
+			naiveWrite(val.objectRef(), os);
+			break;
+		case KsonType::ARRAY: {
+			os << '[';
+			bool first = true;
+			for (const auto& elem : val.arrayRef()) {
+				if (!first) os << ',';
+				first = false;
+				naiveWrite(elem, os);
+			}
+			os << ']';
+			break;
+		}
+		case KsonType::STRING:
+			os << '"';
+			for (char c : val.strRef()) {
+				if (c == '"' || c == '\\') os << '\\' << c;
+				else if (c == '\n') os << "\\n";
+				else if (c == '\t') os << "\\t";
+				else os << c;
+			}
+			os << '"';
+			break;
+		case KsonType::NUMBER:
+			if (val.isInt()) os << val.getInt();
+			else os << val.getDouble();
+			break;
+		case KsonType::BOOL:
+			os << (val.getBool() ? "true" : "false");
+			break;
+		default:
+			os << "null";
+		}
+	}
+
+	// 执行 count 次 func，返回每次的平均耗时（纳秒）
+	template<typename Func>
+	double timeIt(int count, Func&& func) {
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; ++i) {
+			func();
+		}
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count() / count;
+	}
+
+	// benchBind 使用的服务配置
+	struct BenchListen {
+		std::string host;
+		uint16_t port = 0;
+		int backlog = 0;
+	};
+
+	struct BenchLimits {
+		int qps = 0;
+		std::optional<int> burst;
+	};
+
+	struct BenchServer {
+		std::string name;
+		std::string address;
+		int weight = 0;
+		bool enable = false;
+		std::vector<std::string> tags;
+		std::optional<BenchLimits> limits;
+	};
+
+	struct BenchConfig {
+		std::string service;
+		int64_t version = 0;
+		BenchListen listen;
+		std::vector<BenchServer> servers;
+		std::map<std::string, bool> features;
+		std::map<std::string, double> timeouts;
+		std::optional<std::string> log;
+	};
+
+	KSON_BIND(BenchListen, KSON_FIELD(host), KSON_FIELD(port), KSON_FIELD(backlog))
+	KSON_BIND(BenchLimits, KSON_FIELD(qps), KSON_FIELD(burst))
+	KSON_BIND(BenchServer, KSON_FIELD(name), KSON_FIELD(address), KSON_FIELD(weight), KSON_FIELD(enable), KSON_FIELD(tags), KSON_FIELD(limits))
+	KSON_BIND(BenchConfig, KSON_FIELD(service), KSON_FIELD(version), KSON_FIELD(listen), KSON_FIELD(servers),
+		KSON_FIELD(features), KSON_FIELD(timeouts), KSON_FIELD(log))
+
+	// 解析为 KsonObject 后逐个复制（手写的读取代码）
+	bool copyConfig(const KsonObject& obj, BenchConfig& config) {
+		try {
+			config.service = obj.at("service").strRef();
+			config.version = obj.at("version").getInt();
+			const KsonValue& listen = obj.at("listen");
+			config.listen.host = listen.at("host").strRef();
+			config.listen.port = static_cast<uint16_t>(listen.at("port").getInt());
+			config.listen.backlog = static_cast<int>(listen.at("backlog").getInt());
+
+			const KsonArray& servers = obj.at("servers").arrayRef();
+			config.servers.clear();
+			config.servers.reserve(servers.size());
+			for (const KsonValue& val : servers) {
+				config.servers.emplace_back();
+				BenchServer& server = config.servers.back();
+				server.name = val.at("name").strRef();
+				server.address = val.at("address").strRef();
+				server.weight = static_cast<int>(val.at("weight").getInt());
+				server.enable = val.at("enable").getBool();
+				for (const KsonValue& tag : val.at("tags").arrayRef()) {
+					server.tags.push_back(tag.strRef());
+				}
+				const KsonValue* limits = val.find("limits");
+				if (limits && limits->getType() == KsonType::OBJECT) {
+					server.limits.emplace();
+					server.limits->qps = static_cast<int>(limits->at("qps").getInt());
+					const KsonValue* burst = limits->find("burst");
+					if (burst && burst->getType() == KsonType::NUMBER) server.limits->burst = static_cast<int>(burst->getInt());
+				}
+			}
+
+			config.features.clear();
+			for (const auto& item : obj.at("features").objectRef()) {
+				config.features[item.first] = item.second.getBool();
+			}
+			config.timeouts.clear();
+			for (const auto& item : obj.at("timeouts").objectRef()) {
+				config.timeouts[item.first] = item.second.getDouble();
+			}
+			auto log = obj.find("log");
+			if (log != obj.end() && log->second.getType() == KsonType::STRING) config.log = log->second.strRef();
+			return true;
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+
+	// 进程的最大常驻内存（KB），不支持的平台为 0
+	size_t getMaxRssKB() {
+#ifdef _WIN32
+		return 0;
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+		return static_cast<size_t>(usage.ru_maxrss) / 1024;
+#else
+		return static_cast<size_t>(usage.ru_maxrss);
+#endif
+#endif
+	}
+}
+
+//============================================================
+//  ksonBench: Kson解析器的性能测试类
+//============================================================
+
+// runAllBench
+void KsonBench::runAllBench() {
+	benchMemory();
+	benchAccessor();
+	benchLexer();
+	benchLoad();
+	benchSax();
+	benchDocument();
+	benchInSitu();
+	benchObject();
+	benchInternKeys();
+	benchNumber();
+	benchSimd();
+	benchWriter();
+	benchBinary();
+	benchLazy();
+	benchIndex();
+	benchParallel();
+	benchStream();
+	benchIterative();
+	benchReject();
+	benchBind();
+	benchPath();
+	benchBuilder();
+	print("\n");
+}
+
+// runSuite
+void KsonBench::runSuite(const KsonSuiteOptions& options) {
+	std::vector<KsonCorpusType> types = options.m_types.empty() ? KsonCorpus::allTypes() : options.m_types;
+	int rounds = std::max(options.m_rounds, 1);
+	KsonCorpus corpus(options.m_seed);
+
+	if (options.m_csv) {
+		print("corpus,op,seed,docs,bytes,mb_per_s,docs_per_s,allocs_per_doc,peak_heap_bytes,max_rss_kb,errors\n");
+	}
+
+	for (KsonCorpusType type : types) {
+		std::vector<std::string> docs = corpus.generate(type, options.m_docSize, options.m_corpusSize);
+
+		// 序列化的输入：预先解析好的 KsonObject
+		std::vector<KsonObject> objects;
+		for (const auto& doc : docs) {
+			objects.push_back(Kson(doc, false).parse().second);
+		}
+
+		// func 处理第 i 个文档，返回处理的字节数（失败时为 0）
+		// 吞吐量取最快的一轮，内存分配次数和堆内存峰值（相对于开始时未释放的字节数）取最后一轮
+		auto measure = [&](const char* op, const std::function<size_t(size_t)>& func) {
+			double best = 0.0;
+			size_t bytes = 0;
+			size_t errors = 0;
+			KsonAllocStat stat = KsonAlloc::stat();
+			size_t base = 0;
+			for (int round = 0; round < rounds; ++round) {
+				bytes = 0;
+				errors = 0;
+				KsonAlloc::reset();
+				base = KsonAlloc::stat().m_live;
+				auto start = std::chrono::steady_clock::now();
+				for (size_t i = 0; i < docs.size(); ++i) {
+					size_t size = func(i);
+					bytes += size;
+					errors += size == 0;
+				}
+				auto end = std::chrono::steady_clock::now();
+				stat = KsonAlloc::stat();
+				double time = std::chrono::duration<double>(end - start).count();
+				if (round == 0 || time < best) best = time;
+			}
+
+			double mbps = static_cast<double>(bytes) / (1024 * 1024) / best;
+			double docsps = static_cast<double>(docs.size()) / best;
+			double allocs = static_cast<double>(stat.m_count) / docs.size();
+			size_t peak = stat.m_peak - base;
+
+			std::ostringstream os;
+			if (options.m_csv) {
+				os << KsonCorpus::getName(type) << "," << op << "," << options.m_seed << "," << docs.size() << "," << bytes
+					<< "," << mbps << "," << docsps << "," << allocs << "," << peak << "," << getMaxRssKB() << "," << errors << "\n";
+			}
+			else {
+				os << "{\"corpus\":\"" << KsonCorpus::getName(type) << "\",\"op\":\"" << op << "\",\"seed\":" << options.m_seed
+					<< ",\"docs\":" << docs.size() << ",\"bytes\":" << bytes << ",\"mb_per_s\":" << mbps << ",\"docs_per_s\":" << docsps
+					<< ",\"allocs_per_doc\":" << allocs << ",\"peak_heap_bytes\":" << peak << ",\"max_rss_kb\":" << getMaxRssKB()
+					<< ",\"errors\":" << errors << "}\n";
+			}
+			print(os.str());
+		};
+
+		// parse: 构建 KsonObject
+		KsonBuffer buf;
+		measure("parse", [&](size_t i) -> size_t {
+			buf.borrow(docs[i].data(), docs[i].size());
+			Kson kson(std::move(buf));
+			return kson.parse().first ? docs[i].size() : 0;
+		});
+
+		// parse_sax: 空 handler，只有格式检查和事件
+		KsonHandler empty;
+		measure("parse_sax", [&](size_t i) -> size_t {
+			buf.borrow(docs[i].data(), docs[i].size());
+			Kson kson(std::move(buf));
+			return kson.parse(empty) ? docs[i].size() : 0;
+		});
+
+		// serialize: 紧凑格式输出，字节数为输出的文本
+		KsonWriter writer;
+		measure("serialize", [&](size_t i) -> size_t {
+			writer.reset();
+			return writer.write(objects[i]) ? writer.str().size() : 0;
+		});
+	}
+}
+
+// benchMemory
+void KsonBench::benchMemory() {
+	print("\n==== bench: memory ====\n");
+	print("sizeof(KsonValue): before " + std::to_string(sizeof(KsonValueLegacy))
+		+ ", after " + std::to_string(sizeof(KsonValue)) + "\n");
+
+	benchMemory("test_all2.kson", readFile("test_case/test_all2.kson"));
+	benchMemory("records(20000)", genRecords(20000));
+}
+
+// benchMemory: 统计解析结果在堆上占用的字节数，旧布局的字节数由节点统计推算
+void KsonBench::benchMemory(const std::string& name, const std::string& ksonStr) {
+	KsonAlloc::reset();
+	size_t base = KsonAlloc::stat().m_live;
+
+	std::pair<bool, KsonObject> ret;
+	{
+		Kson kson(ksonStr, false);
+		ret = kson.parse();
+	}
+	size_t heap = KsonAlloc::stat().m_live - base;
+
+	if (!ret.first) {
+		print(name + ": parse failed!\n");
+		return;
+	}
+
+	NodeStat stat;
+	countNodes(ret.second, stat);
+
+	// 旧布局：没有外置存储，但容器中每个位置都是完整的 KsonValueLegacy
+	size_t after = heap + sizeof(KsonObject);
+	size_t before = after - stat.m_boxBytes + stat.m_slots * (sizeof(KsonValueLegacy) - sizeof(KsonValue));
+
+	std::ostringstream os;
+	os << name << ": nodes " << stat.m_nodes
+		<< ", bytes/node before " << double(before) / stat.m_nodes
+		<< ", after " << double(after) / stat.m_nodes << "\n";
+	print(os.str());
+}
+
+// benchAccessor: 从深度为 8 的文档中读取最内层的 leaf
+void KsonBench::benchAccessor() {
+	print("\n==== bench: accessor ====\n");
+
+	const int depth = 8;
+	Kson kson(genDeep(depth), false);
+	auto ret = kson.parse();
+	if (!ret.first) {
+		print("parse failed!\n");
+		return;
+	}
+
+	KsonValue root;
+	root.setObject(std::move(ret.second));
+
+	// 按值返回：每一层都会拷贝整棵子树
+	long long sum = 0;
+	double byValue = timeIt(2000, [&]() {
+		KsonObject cur = root.getObject();
+		for (int i = 0; i < depth; ++i) {
+			cur = cur.at("next").getObject();
+		}
+		sum += cur.at("leaf").getInt();
+	});
+
+	// 按引用返回
+	double byRef = timeIt(1000000, [&]() {
+		const KsonObject* cur = &root.objectRef();
+		for (int i = 0; i < depth; ++i) {
+			cur = &cur->at("next").objectRef();
+		}
+		sum += cur->at("leaf").getInt();
+	});
+
+	// 链式查找
+	double chained = timeIt(1000000, [&]() {
+		const KsonValue* cur = &root;
+		for (int i = 0; i < depth; ++i) {
+			cur = &cur->at("next");
+		}
+		sum += cur->at("leaf").getInt();
+	});
+
+	std::ostringstream os;
+	os << "depth " << depth << " lookup: by value " << byValue << " ns"
+		<< ", by ref " << byRef << " ns"
+		<< ", at() " << chained << " ns"
+		<< " (checksum " << sum << ")\n";
+	print(os.str());
+}
+
+// benchLexer
+void KsonBench::benchLexer() {
+	print("\n==== bench: lexer ====\n");
+
+	std::ostringstream os;
+	os << "records(20000): " << parseSpeed(genRecords(20000)) << " MB/s\n";
+	os << "pretty(20000): " << parseSpeed(genPretty(20000)) << " MB/s\n";
+	print(os.str());
+}
+
+// benchLoad
+void KsonBench::benchLoad() {
+	print("\n==== bench: load ====\n");
+
+	std::string file = "bench_load.kson";
+	std::string ksonStr = genRecords(200000);
+	std::ofstream(file, std::ios::binary) << ksonStr;
+	double mb = ksonStr.size() / (1024.0 * 1024.0);
+
+	// 原来的读取方式：逐字符读入并 push_back
+	size_t oldSize = 0;
+	double oldTime = timeIt(3, [&]() {
+		std::string str;
+		std::ifstream in(file);
+		in >> std::noskipws;
+		char ic;
+		while (in >> ic) {
+			str.push_back(ic);
+		}
+		str.push_back('\0');
+		oldSize = str.size();
+	});
+
+	// KsonBuffer：只读取，以及读取后遍历一遍（mmap 的页在访问时才真正读入）
+	std::string error;
+	double newTime = timeIt(3, [&]() {
+		KsonBuffer buf;
+		buf.load(file, error);
+	});
+	long long sum = 0;
+	double touchTime = timeIt(3, [&]() {
+		KsonBuffer buf;
+		buf.load(file, error);
+		for (size_t i = 0; i < buf.size(); i += 64) {
+			sum += buf.data()[i];
+		}
+	});
+	std::remove(file.c_str());
+
+	std::ostringstream os;
+	os << "file " << mb << " MB (" << oldSize - 1 << " bytes)\n";
+	os << "ifstream >> char: " << oldTime / 1e6 << " ms, " << mb / (oldTime / 1e9) << " MB/s\n";
+	os << "KsonBuffer::load: " << newTime / 1e6 << " ms, " << mb / (newTime / 1e9) << " MB/s\n";
+	os << "KsonBuffer::load + touch: " << touchTime / 1e6 << " ms, " << mb / (touchTime / 1e9) << " MB/s"
+		<< " (checksum " << sum << ")\n";
+	print(os.str());
+}
+
+// benchSax
+void KsonBench::benchSax() {
+	print("\n==== bench: sax ====\n");
+
+	std::string ksonStr = genRecords(50000);
+	KsonHandler empty;
+	KsonSumHandler sum;
+
+	std::ostringstream os;
+	os << "records(50000) " << ksonStr.size() / (1024 * 1024.0) << " MB\n";
+	os << "DOM (parse): " << parseSpeed(ksonStr) << " MB/s\n";
+	os << "SAX (empty handler): " << parseSpeed(ksonStr, empty) << " MB/s\n";
+	os << "SAX (sum of id): " << parseSpeed(ksonStr, sum) << " MB/s (checksum " << sum.m_sum << ")\n";
+	print(os.str());
+}
+
+// benchDocument: 堆内存峰值由 KsonAlloc 统计（同一进程中无法分别得到两种方式的峰值 RSS）
+void KsonBench::benchDocument() {
+	print("\n==== bench: document ====\n");
+
+	std::string ksonStr = genRecords(50000);
+	std::ostringstream os;
+	os << "records(50000) " << ksonStr.size() / (1024 * 1024.0) << " MB\n";
+
+	// 峰值从开始时未释放的字节数算起，重复使用的文档包含它保留的内存池
+	size_t base = KsonAlloc::stat().m_live;
+	auto report = [&](const std::string& name, const std::function<void()>& func) {
+		func();  // 预热
+		KsonAlloc::reset();
+		double time = timeIt(5, func);
+		KsonAllocStat stat = KsonAlloc::stat();
+		os << name << ": " << time / 1e6 << " ms"
+			<< ", peak heap " << (stat.m_peak - base) / (1024 * 1024.0) << " MB"
+			<< ", allocs/parse " << stat.m_count / 5 << "\n";
+	};
+
+	// KsonObject：解析后析构整棵树
+	report("KsonObject parse + destroy", [&]() {
+		Kson kson(ksonStr, false);
+		kson.parse();
+	});
+
+	// 每次新建 KsonDocument
+	report("KsonDocument parse + destroy", [&]() {
+		KsonDocument doc;
+		doc.parse(ksonStr);
+	});
+
+	// 重复使用同一个 KsonDocument
+	KsonDocument doc;
+	report("KsonDocument parse + reset (reused)", [&]() {
+		doc.parse(ksonStr);
+		doc.reset();
+	});
+
+	print(os.str());
+}
+
+// benchInSitu
+void KsonBench::benchInSitu() {
+	print("\n==== bench: in-situ ====\n");
+
+	std::string file = "bench_strings.kson";
+	std::string ksonStr = genStrings(50000);
+	std::ofstream(file, std::ios::binary) << ksonStr;
+
+	std::ostringstream os;
+	os << "strings(50000) " << ksonStr.size() / (1024 * 1024.0) << " MB\n";
+
+	auto report = [&](const std::string& name, const std::function<void()>& func) {
+		func();  // 预热
+		KsonAlloc::reset();
+		double time = timeIt(5, func);
+		os << name << ": " << time / 1e6 << " ms"
+			<< ", allocated " << KsonAlloc::stat().m_bytes / 5 / (1024 * 1024.0) << " MB/parse\n";
+	};
+
+	report("KsonObject", [&]() {
+		Kson kson(file);
+		kson.parse();
+	});
+
+	KsonDocument doc;
+	report("KsonDocument (copy)", [&]() {
+		doc.load(file, false);
+	});
+	size_t copyUsed = doc.arena().used();
+
+	report("KsonDocument (in-situ)", [&]() {
+		doc.load(file, true);
+	});
+	size_t inSituUsed = doc.arena().used();
+	std::remove(file.c_str());
+
+	os << "arena used: copy " << copyUsed / (1024 * 1024.0) << " MB"
+		<< ", in-situ " << inSituUsed / (1024 * 1024.0) << " MB\n";
+	print(os.str());
+}
+
+// benchObject
+void KsonBench::benchObject() {
+	print("\n==== bench: object ====\n");
+	for (int size : { 3, 10, 30, 100 }) {
+		benchObject(size);
+	}
+}
+
+// benchObject: 成员个数为 size 的 object，key 按打乱的顺序给出
+void KsonBench::benchObject(int size) {
+	std::vector<std::string> keys;
+	for (int i = 0; i < size; ++i) {
+		keys.push_back("field_" + std::to_string((i * 7919) % size));
+	}
+	const int count = std::max(1, 200000 / size);
+
+	// 构建
+	std::map<std::string, KsonValue> map;
+	double mapBuild = timeIt(count, [&]() {
+		std::map<std::string, KsonValue> m;
+		for (int i = 0; i < size; ++i) {
+			m[keys[i]].setNum(KsonNum(true, i, 0.0));
+		}
+		map.swap(m);
+	}) / size;
+
+	KsonObject obj;
+	double flatBuild = timeIt(count, [&]() {
+		KsonObject::container_type items;
+		items.reserve(size);
+		for (int i = 0; i < size; ++i) {
+			items.emplace_back(keys[i], KsonValue());
+			items.back().second.setNum(KsonNum(true, i, 0.0));
+		}
+		obj = KsonObject(std::move(items));
+	}) / size;
+
+	// 查找
+	long long sum = 0;
+	double mapFind = timeIt(count, [&]() {
+		for (const auto& key : keys) {
+			sum += map.find(key)->second.getInt();
+		}
+	}) / size;
+	double flatFind = timeIt(count, [&]() {
+		for (const auto& key : keys) {
+			sum += obj.find(key)->second.getInt();
+		}
+	}) / size;
+
+	// 遍历
+	double mapIter = timeIt(count, [&]() {
+		for (const auto& p : map) {
+			sum += p.second.getInt();
+		}
+	}) / size;
+	double flatIter = timeIt(count, [&]() {
+		for (const auto& p : obj) {
+			sum += p.second.getInt();
+		}
+	}) / size;
+
+	std::ostringstream os;
+	os << "size " << size << " (ns/member, std::map / KsonObject): "
+		<< "build " << mapBuild << " / " << flatBuild
+		<< ", find " << mapFind << " / " << flatFind
+		<< ", iterate " << mapIter << " / " << flatIter
+		<< " (checksum " << sum << ")\n";
+	print(os.str());
+}
+
+// parseSpeed: 至少解析 3 次、累计 0.5 秒，取平均吞吐量
+double KsonBench::parseSpeed(const std::string& ksonStr) {
+	int count = 0;
+	double total = 0;
+	while (count < 3 || total < 0.5e9) {
+		total += timeIt(1, [&]() {
+			Kson kson(ksonStr, false);
+			kson.parse();
+		});
+		++count;
+	}
+	return ksonStr.size() / (total / count / 1e9) / (1024 * 1024);
+}
+
+// parseSpeed: handler
+double KsonBench::parseSpeed(const std::string& ksonStr, KsonHandler& handler) {
+	int count = 0;
+	double total = 0;
+	while (count < 3 || total < 0.5e9) {
+		total += timeIt(1, [&]() {
+			Kson kson(ksonStr, false);
+			kson.parse(handler);
+		});
+		++count;
+	}
+	return ksonStr.size() / (total / count / 1e9) / (1024 * 1024);
+}
+
+// countNodes: object
+void KsonBench::countNodes(const KsonObject& obj, NodeStat& stat) {
+	++stat.m_nodes;
+	stat.m_slots += obj.size();
+	for (const auto& p : obj) {
+		countNodes(p.second, stat);
+	}
+}
+
+// countNodes: value
+void KsonBench::countNodes(const KsonValue& val, NodeStat& stat) {
+	switch (val.getType()) {
+	case KsonType::OBJECT:
+		if (!val.objectRef().empty()) stat.m_boxBytes += sizeof(KsonObject);
+		countNodes(val.objectRef(), stat);
+		break;
+
+	case KsonType::ARRAY:
+		++stat.m_nodes;
+		if (!val.arrayRef().empty()) stat.m_boxBytes += sizeof(KsonArray);
+		stat.m_slots += val.arrayRef().capacity();
+		for (const auto& v : val.arrayRef()) {
+			countNodes(v, stat);
+		}
+		break;
+
+	case KsonType::STRING:
+		++stat.m_nodes;
+		if (!val.strRef().empty()) stat.m_boxBytes += sizeof(KsonStr);
+		break;
+
+	default:
+		++stat.m_nodes;
+		break;
+	}
+}
+
+// readFile
+std::string KsonBench::readFile(const std::string& file) {
+	std::ifstream in(file);
+	std::ostringstream os;
+	os << in.rdbuf();
+	return os.str();
+}
+
+// benchInternKeys
+void KsonBench::benchInternKeys() {
+	print("\n==== bench: intern keys ====\n");
+
+	const int count = 100000;
+	std::string ksonStr = genRecords(count);
+	std::ostringstream os;
+	os << "records(" << count << ") " << ksonStr.size() / (1024 * 1024.0) << " MB\n";
+
+	size_t used[2] = { 0, 0 };
+	for (bool intern : { false, true }) {
+		KsonDocument doc;
+		doc.setInternKeys(intern);
+		double time = timeIt(3, [&]() { doc.parse(ksonStr); });
+		used[intern] = doc.arena().used();
+
+		// 按 key 读取每个 record 的 id 和 limit.qps
+		const KsonNode& records = doc.root().at("records");
+		long long sum = 0;
+		double byName = timeIt(5, [&]() {
+			for (size_t i = 0; i < records.size(); ++i) {
+				const KsonNode& record = records.at(i);
+				sum += record.at("id").getInt() + record.at("limit").at("qps").getInt();
+			}
+		});
+		KsonKey id = doc.key("id"), limit = doc.key("limit"), qps = doc.key("qps");
+		double byKey = timeIt(5, [&]() {
+			for (size_t i = 0; i < records.size(); ++i) {
+				const KsonNode& record = records.at(i);
+				sum += record.at(id).getInt() + record.at(limit).at(qps).getInt();
+			}
+		});
+
+		os << (intern ? "intern keys" : "copy keys  ") << ": parse " << time / 1e6 << " ms"
+			<< ", arena used " << used[intern] / (1024 * 1024.0) << " MB"
+			<< ", lookup ns/record by name " << byName / count << ", by KsonKey " << byKey / count
+			<< " (checksum " << sum << ")\n";
+	}
+	os << "saved " << (used[0] - used[1]) / (1024 * 1024.0) << " MB ("
+		<< 100.0 * (used[0] - used[1]) / used[0] << "%)\n";
+	print(os.str());
+}
+
+// benchNumber
+void KsonBench::benchNumber() {
+	print("\n==== bench: number ====\n");
+
+	const int count = 300000;
+	std::string ksonStr = genNumbers(count);
+	std::ostringstream os;
+	os << "numbers(" << count << ") " << ksonStr.size() / (1024 * 1024.0) << " MB\n";
+	os << "DOM (parse): " << parseSpeed(ksonStr) << " MB/s\n";
+	KsonNumSumHandler handler;
+	os << "SAX (sum): " << parseSpeed(ksonStr, handler) << " MB/s\n";
+
+	// 拆出每个数值的文本和整数 / 小数 / 指数部分
+	struct Parts {
+		std::string m_text, m_int, m_frac, m_exp;
+	};
+	std::vector<Parts> nums;
+	size_t pos = ksonStr.find('[') + 1;
+	while ((pos = ksonStr.find_first_of("-0123456789", pos)) != std::string::npos) {
+		size_t end = ksonStr.find_first_of(",\n ]", pos);
+		Parts parts;
+		parts.m_text = ksonStr.substr(pos, end - pos);
+		size_t start = parts.m_text[0] == '-' ? 1 : 0;
+		size_t dot = parts.m_text.find('.'), e = parts.m_text.find('e');
+		size_t intEnd = std::min(std::min(dot, e), parts.m_text.size());
+		parts.m_int = parts.m_text.substr(start, intEnd - start);
+		if (dot != std::string::npos) parts.m_frac = parts.m_text.substr(dot + 1, std::min(e, parts.m_text.size()) - dot - 1);
+		if (e != std::string::npos) parts.m_exp = parts.m_text.substr(e + 1);
+		nums.push_back(std::move(parts));
+		pos = end;
+	}
+
+	double sum = 0;
+	double legacy = timeIt(5, [&]() {
+		for (const auto& num : nums) sum += legacyToDouble(num.m_int, num.m_frac, num.m_exp);
+	});
+	double engine = timeIt(5, [&]() {
+		for (const auto& num : nums) {
+			auto ret = toKsonNum(num.m_text[0] == '-', num.m_frac.empty(),
+				num.m_int.data(), num.m_int.size(), num.m_frac.data(), num.m_frac.size(), num.m_exp.data(), num.m_exp.size());
+			sum += ret.second.getDouble();
+		}
+	});
+	double strtod = timeIt(5, [&]() {
+		for (const auto& num : nums) sum += std::strtod(num.m_text.c_str(), nullptr);
+	});
+
+	// 与 strtod 的结果不同的个数
+	int legacyWrong = 0, engineWrong = 0;
+	for (const auto& num : nums) {
+		double expect = std::abs(std::strtod(num.m_text.c_str(), nullptr));
+		auto ret = toKsonNum(false, num.m_frac.empty(),
+			num.m_int.data(), num.m_int.size(), num.m_frac.data(), num.m_frac.size(), num.m_exp.data(), num.m_exp.size());
+		legacyWrong += legacyToDouble(num.m_int, num.m_frac, num.m_exp) != expect;
+		engineWrong += ret.second.getDouble() != expect;
+	}
+
+	os << "ns/number: legacy " << legacy / nums.size() << ", toKsonNum " << engine / nums.size()
+		<< ", strtod " << strtod / nums.size() << " (checksum " << sum << ")\n";
+	os << "differs from strtod: legacy " << legacyWrong << ", toKsonNum " << engineWrong << " of " << nums.size() << "\n";
+	print(os.str());
+}
+
+// benchSimd
+void KsonBench::benchSimd() {
+	print("\n==== bench: simd ====\n");
+
+	// 每个扫描函数扫过 1MB 的内容，结尾为停止的字符
+	const size_t size = 1024 * 1024;
+	std::string spaces(size, ' ');
+	for (size_t i = 0; i < size; i += 64) spaces[i] = '\n';
+	std::string comment(size, 'c');
+	for (size_t i = 0; i < size; i += 61) comment[i] = '*';
+	std::string str(size, 's');
+	spaces += 'x';
+	comment += "\n*/";
+	str += '"';
+
+	std::vector<std::pair<const char*, KsonSimd>> simds = {
+		{ "scalar", KsonSimd::SCALAR }, { "sse2", KsonSimd::SSE2 }, { "avx2", KsonSimd::AVX2 }
+	};
+
+	std::ostringstream os;
+	os << "kernel throughput (GB/s):\n";
+	size_t checksum = 0;
+	for (const auto& simd : simds) {
+		const KsonScanner* scanner = getKsonScanner(simd.second);
+		if (!scanner) {
+			os << "  " << simd.first << ": not supported\n";
+			continue;
+		}
+
+		auto speed = [&](const std::function<const char*()>& func) {
+			double time = timeIt(20, [&]() { checksum += reinterpret_cast<uintptr_t>(func()) & 1; });
+			return size / time;
+		};
+		int lines = 0;
+		os << "  " << simd.first
+			<< ": skipSpace " << speed([&]() { return scanner->skipSpace(spaces.data(), spaces.data() + spaces.size(), lines); })
+			<< ", findLineEnd " << speed([&]() { return scanner->findLineEnd(comment.data(), comment.data() + comment.size()); })
+			<< ", findBlockEnd " << speed([&]() { return scanner->findBlockEnd(comment.data(), comment.data() + comment.size()); })
+			<< ", findStrSpecial " << speed([&]() { return scanner->findStrSpecial(str.data(), str.data() + str.size()); })
+			<< "\n";
+	}
+
+	// 解析吞吐量：test_space.kson（重复拼接成一个大文档）和带缩进、注释的文档
+	std::string space = readFile("test_case/test_space.kson");
+	size_t open = space.find('{'), close = space.rfind('}');
+	std::string body = space.substr(open + 1, close - open - 1);
+	std::string spaceBig = "{\n    items: [\n";
+	for (int i = 0; i < 2000; ++i) {
+		spaceBig += "        {" + body + "},\n";
+	}
+	spaceBig += "    ]\n}\n";
+	std::string pretty = genPretty(20000);
+
+	KsonSimd saved = getKsonSimd();
+	os << "parse throughput (MB/s):\n";
+	for (const auto& simd : simds) {
+		if (!setKsonSimd(simd.second)) continue;
+		os << "  " << simd.first << ": test_space x2000 " << parseSpeed(spaceBig)
+			<< ", pretty(20000) " << parseSpeed(pretty) << "\n";
+	}
+	setKsonSimd(saved);
+	os << "(checksum " << checksum << ")\n";
+	print(os.str());
+}
+
+// genRecords: {records:[{id:0,name:"record_0",...}, ...]}
+std::string KsonBench::genRecords(int count) {
+	std::string str = "{\n    records: [\n";
+	for (int i = 0; i < count; ++i) {
+		str += "        { id: " + std::to_string(i)
+			+ ", name: \"record_" + std::to_string(i) + "\""
+			+ ", enable: " + (i % 2 ? "true" : "false")
+			+ ", weight: " + std::to_string(i % 100) + ".5"
+			+ ", parent: null"
+			+ ", tags: [\"a\", \"b\", " + std::to_string(i % 7) + "]"
+			+ ", limit: { qps: " + std::to_string(i % 1000) + ", burst: 0xff } }";
+		str += (i + 1 < count ? ",\n" : "\n");
+	}
+	str += "    ]\n}\n";
+	return str;
+}
+
+// genNumbers
+std::string KsonBench::genNumbers(int count) {
+	std::string str = "{\n    numbers: [\n";
+	unsigned seed = 12345;
+	auto next = [&]() { seed = seed * 1103515245u + 12345u; return seed >> 8; };
+	char buf[64];
+	for (int i = 0; i < count; ++i) {
+		switch (i % 3) {
+		case 0:
+			std::snprintf(buf, sizeof(buf), "%d", static_cast<int>(next() % 2000000) - 1000000);
+			break;
+		case 1:
+			std::snprintf(buf, sizeof(buf), "%u.%02u", next() % 10000, next() % 100);
+			break;
+		default:
+			std::snprintf(buf, sizeof(buf), "%.17g", (next() % 1000000 + 1) * std::pow(10.0, static_cast<int>(next() % 40) - 26));
+			break;
+		}
+		str += "        ";
+		str += buf;
+		str += (i + 1 < count ? ",\n" : "\n");
+	}
+	str += "    ]\n}\n";
+	return str;
+}
+
+// genPretty: 每层缩进 4 个空格，带行注释、块注释和较长的字符串
+std::string KsonBench::genPretty(int count) {
+	std::string str = "// generated by KsonBench::genPretty\n{\n    records : [\n";
+	for (int i = 0; i < count; ++i) {
+		str += "        {\n";
+		str += "            /* record " + std::to_string(i) + " */\n";
+		str += "            record_name    : \"The quick brown fox jumps over the lazy dog, record " + std::to_string(i) + "\",\n";
+		str += "            description    : \"Lorem ipsum dolor sit amet, consectetur adipiscing elit \\t\\n\",\n";
+		str += "            enable_feature : true,   // line comment\n";
+		str += "            nested_values  : [\n                1,\n                2,\n                3\n            ]\n";
+		str += (i + 1 < count ? "        },\n" : "        }\n");
+	}
+	str += "    ]\n}\n";
+	return str;
+}
+
+// genStrings: {users:[{user_name:"...",email:"...",bio:"...",city:"..."}, ...]}
+std::string KsonBench::genStrings(int count) {
+	std::string str = "{\n    users: [\n";
+	for (int i = 0; i < count; ++i) {
+		std::string id = std::to_string(i);
+		str += "        { user_name: \"user_" + id + "\""
+			+ ", email: \"user_" + id + "@example.com\""
+			+ ", bio: \"" + (i % 20 == 0 ? "Says \\\"hello\\\"\\tand waves, " : "Enjoys long walks and reading, ")
+			+ "member since " + std::to_string(2000 + i % 20) + "\""
+			+ ", city: \"Springfield\", country: \"Neverland\" }";
+		str += (i + 1 < count ? ",\n" : "\n");
+	}
+	str += "    ]\n}\n";
+	return str;
+}
+
+// genDeep: {next:{next:{... leaf:1 ...}}}，每层附带若干兄弟节点
+std::string KsonBench::genDeep(int depth) {
+	std::string str;
+	for (int i = 0; i < depth; ++i) {
+		str += "{ id: " + std::to_string(i) + ", name: \"level_" + std::to_string(i) + "\", enable: true, ratio: 0.5, ";
+		str += "items: [";
+		for (int j = 0; j < 20; ++j) {
+			str += std::to_string(j) + (j + 1 < 20 ? ", " : "");
+		}
+		str += "], next: ";
+	}
+	str += "{ leaf: 1 }";
+	for (int i = 0; i < depth; ++i) {
+		str += " }";
+	}
+	return str;
+}
+
+// print
+void KsonBench::print(const std::string& info) {
+	std::cout << info;
+}
+
+// benchWriter
+void KsonBench::benchWriter() {
+	print("\n==== bench: writer ====\n");
+
+	std::ostringstream os;
+	size_t checksum = 0;
+	std::vector<std::pair<const char*, std::string>> docs = {
+		{ "records(50000)", genRecords(50000) },
+		{ "strings(50000)", genStrings(50000) },
+	};
+	for (const auto& item : docs) {
+		auto obj = Kson(item.second, false).parse().second;
+		KsonDocument doc;
+		doc.parse(item.second);
+
+		size_t compactSize = toKsonStr(obj).size();
+		size_t prettySize = toKsonStr(obj, true).size();
+		const int count = 10;
+		auto mbps = [&](size_t bytes, double ns) { return bytes / (ns / 1e9) / (1024 * 1024); };
+
+		double naive = timeIt(count, [&]() {
+			std::ostringstream out;
+			naiveWrite(obj, out);
+			checksum += out.str().size();
+		});
+		double compact = timeIt(count, [&]() { checksum += toKsonStr(obj).size(); });
+		double pretty = timeIt(count, [&]() { checksum += toKsonStr(obj, true).size(); });
+		double fromDoc = timeIt(count, [&]() {
+			KsonWriter writer;
+			doc.root().accept(writer);
+			checksum += writer.str().size();
+		});
+		double toSink = timeIt(count, [&]() {
+			size_t total = 0;
+			KsonWriter writer([&](const char*, size_t size) { total += size; });
+			writer.write(obj);
+			writer.flush();
+			checksum += total;
+		});
+
+		os << item.first << " (" << compactSize / 1024 << " KB compact, " << prettySize / 1024 << " KB pretty), MB/s:\n"
+			<< "  ostringstream: " << mbps(compactSize, naive) << "\n"
+			<< "  KsonWriter compact: " << mbps(compactSize, compact) << ", pretty: " << mbps(prettySize, pretty)
+			<< ", from KsonDocument: " << mbps(compactSize, fromDoc) << ", to sink: " << mbps(compactSize, toSink) << "\n";
+	}
+	os << "(checksum " << checksum << ")\n";
+	print(os.str());
+}
+
+// benchBinary: 从文件加载，堆内存峰值由 KsonAlloc 统计（mmap 的文件不计入）
+void KsonBench::benchBinary() {
+	print("\n==== bench: binary ====\n");
+
+	std::string textFile = "bench_binary.kson";
+	std::string binFile = "bench_binary.ksb";
+	std::string ksonStr = genRecords(200000);
+	auto obj = Kson(ksonStr, false).parse().second;
+	std::string bin = encodeKsonBin(obj);
+	std::ofstream(textFile, std::ios::binary) << ksonStr;
+	std::ofstream(binFile, std::ios::binary) << bin;
+
+	std::ostringstream os;
+	os << "records(200000): text " << ksonStr.size() / (1024 * 1024.0) << " MB, binary " << bin.size() / (1024 * 1024.0) << " MB\n";
+	os << "encode: " << timeIt(3, [&]() { encodeKsonBin(obj); }) / 1e6 << " ms\n";
+
+	size_t base = KsonAlloc::stat().m_live;
+	long long checksum = 0;
+	auto report = [&](const std::string& name, const std::function<void()>& func) {
+		func();  // 预热
+		KsonAlloc::reset();
+		double time = timeIt(3, func);
+		KsonAllocStat stat = KsonAlloc::stat();
+		os << name << ": " << time / 1e6 << " ms"
+			<< ", peak heap " << (stat.m_peak - base) / (1024 * 1024.0) << " MB\n";
+	};
+
+	report("text -> KsonObject", [&]() {
+		Kson kson(textFile);
+		checksum += kson.parse().second.size();
+	});
+	report("text -> KsonDocument", [&]() {
+		KsonDocument doc;
+		doc.load(textFile);
+		checksum += doc.root().size();
+	});
+	report("binary -> KsonObject (decode)", [&]() {
+		KsonBinDocument doc;
+		doc.load(binFile);
+		checksum += doc.decode().second.size();
+	});
+
+	// 直接读取：打开后取一个值，以及遍历所有 record 累加 id
+	report("binary direct: open + one lookup", [&]() {
+		KsonBinDocument doc;
+		doc.load(binFile);
+		checksum += doc.root().at("records").first().at("id").getInt();
+	});
+	report("binary direct: open + sum of all ids", [&]() {
+		KsonBinDocument doc;
+		doc.load(binFile);
+		for (KsonBinView record = doc.root().at("records").first(); record.isValid(); record = record.next()) {
+			checksum += record.find("id").getInt();
+		}
+	});
+	report("text KsonDocument: load + sum of all ids", [&]() {
+		KsonDocument doc;
+		doc.load(textFile);
+		const KsonNode& records = doc.root().at("records");
+		for (size_t i = 0; i < records.size(); ++i) {
+			checksum += records.at(i).at("id").getInt();
+		}
+	});
+	os << "(checksum " << checksum << ")\n";
+
+	std::remove(textFile.c_str());
+	std::remove(binFile.c_str());
+	print(os.str());
+}
+
+// benchLazy
+void KsonBench::benchLazy() {
+	print("\n==== bench: lazy ====\n");
+
+	std::string ksonStr = genRecords(100000);
+	std::ostringstream os;
+	os << "records(100000) " << ksonStr.size() / (1024 * 1024.0) << " MB, ms per run:\n";
+	long long checksum = 0;
+
+	// 文档都从 ksonStr 的拷贝开始，三种方式的拷贝开销相同
+	auto report = [&](const std::string& name, const std::function<void()>& eager, const std::function<void()>& document, const std::function<void()>& lazy) {
+		os << "  " << name << ": KsonObject " << timeIt(5, eager) / 1e6
+			<< ", KsonDocument " << timeIt(5, document) / 1e6
+			<< ", KsonLazyDocument " << timeIt(5, lazy) / 1e6 << "\n";
+	};
+
+	// 只读取一个字段
+	report("read one field",
+		[&]() {
+			Kson kson(ksonStr, false);
+			checksum += kson.parse().second.at("records").at(99999).at("limit").at("qps").getInt();
+		},
+		[&]() {
+			KsonDocument doc;
+			doc.parseInSitu(ksonStr);
+			checksum += doc.root().at("records").at(99999).at("limit").at("qps").getInt();
+		},
+		[&]() {
+			KsonLazyDocument doc;
+			doc.parse(ksonStr);
+			checksum += doc.root().at("records").at(99999).at("limit").at("qps").getInt();
+		});
+
+	// 读取每个 record 的 id、name、weight
+	report("read all records",
+		[&]() {
+			Kson kson(ksonStr, false);
+			auto obj = kson.parse().second;
+			for (const auto& record : obj.at("records").arrayRef()) {
+				checksum += record.at("id").getInt() + record.at("name").strRef().size() + static_cast<long long>(record.at("weight").getDouble());
+			}
+		},
+		[&]() {
+			KsonDocument doc;
+			doc.parseInSitu(ksonStr);
+			const KsonNode& records = doc.root().at("records");
+			for (size_t i = 0; i < records.size(); ++i) {
+				const KsonNode& record = records.at(i);
+				checksum += record.at("id").getInt() + record.at("name").strView().size() + static_cast<long long>(record.at("weight").getDouble());
+			}
+		},
+		[&]() {
+			KsonLazyDocument doc;
+			doc.parse(ksonStr);
+			for (KsonLazyNode record = doc.root().at("records").first(); record.isValid(); record = record.next()) {
+				checksum += record.at("id").getInt() + record.at("name").rawStr().size() + static_cast<long long>(record.at("weight").getDouble());
+			}
+		});
+
+	// 转换为完整的 KsonObject
+	report("full KsonObject",
+		[&]() {
+			Kson kson(ksonStr, false);
+			checksum += kson.parse().second.size();
+		},
+		[&]() {
+			KsonDocument doc;
+			doc.parseInSitu(ksonStr);
+			KsonDomHandler dom;
+			doc.root().accept(dom);
+			checksum += dom.release().size();
+		},
+		[&]() {
+			KsonLazyDocument doc;
+			doc.parse(ksonStr);
+			checksum += doc.toObject().size();
+		});
+
+	// 只做格式检查、构建 tape
+	KsonLazyDocument doc;
+	double lazyParse = timeIt(5, [&]() { doc.parse(ksonStr); });
+	os << "  lazy parse only: " << lazyParse / 1e6 << " ms (" << ksonStr.size() / (lazyParse / 1e9) / (1024 * 1024) << " MB/s), tape "
+		<< doc.tapeSize() << " entries (" << doc.tapeSize() * sizeof(KsonTapeEntry) / (1024 * 1024.0) << " MB)\n";
+	os << "(checksum " << checksum << ")\n";
+	print(os.str());
+}
+
+// benchIndex
+void KsonBench::benchIndex() {
+	print("\n==== bench: index ====\n");
+
+	std::vector<std::pair<std::string, std::string>> docs = {
+		{ "records(100000)", genRecords(100000) },
+		{ "strings(100000)", genStrings(100000) },
+		{ "pretty(20000)", genPretty(20000) },
+	};
+	std::vector<std::pair<const char*, KsonSimd>> simds = {
+		{ "scalar", KsonSimd::SCALAR }, { "sse2", KsonSimd::SSE2 }, { "avx2", KsonSimd::AVX2 }
+	};
+
+	// 吞吐量（GB/s）：字节数 / 纳秒
+	std::ostringstream os;
+	os << "throughput (GB/s): stage 1 index / stage 2 walk (empty handler, tape, KsonObject) / Kson (empty handler, KsonObject)\n";
+	size_t checksum = 0;
+	KsonSimd saved = getKsonSimd();
+	for (const auto& doc : docs) {
+		const std::string& ksonStr = doc.second;
+		double size = static_cast<double>(ksonStr.size());
+		os << doc.first << " " << size / (1024 * 1024) << " MB:\n";
+
+		for (const auto& simd : simds) {
+			if (!setKsonSimd(simd.second)) continue;
+
+			KsonIndexParser parser;
+			double index = timeIt(10, [&]() { parser.index(ksonStr.data(), ksonStr.size()); });
+
+			KsonHandler empty;
+			double walkEmpty = timeIt(10, [&]() { checksum += parser.walk(empty); });
+			std::vector<KsonTapeEntry> tape;
+			KsonTapeBuilder builder(tape);
+			builder.setSource(ksonStr.data());
+			double walkTape = timeIt(5, [&]() { tape.clear(); checksum += parser.walk(builder) + tape.size(); });
+			double walkDom = timeIt(3, [&]() { KsonDomHandler dom; checksum += parser.walk(dom) + dom.release().size(); });
+
+			KsonBuffer buf;
+			double ksonEmpty = timeIt(5, [&]() { buf.borrow(ksonStr.data(), ksonStr.size()); checksum += Kson(std::move(buf)).parse(empty); });
+			double ksonDom = timeIt(3, [&]() { buf.borrow(ksonStr.data(), ksonStr.size()); checksum += Kson(std::move(buf)).parse().second.size(); });
+
+			os << "  " << simd.first << ": " << size / index
+				<< " / " << size / walkEmpty << ", " << size / walkTape << ", " << size / walkDom
+				<< " / " << size / ksonEmpty << ", " << size / ksonDom
+				<< " (index " << parser.indexSize() << " entries, " << parser.indexSize() * 1000.0 / size << " per KB)\n";
+		}
+	}
+	setKsonSimd(saved);
+	os << "(checksum " << checksum << ")\n";
+	print(os.str());
+}
+
+// benchParallel
+void KsonBench::benchParallel() {
+	print("\n==== bench: parallel ====\n");
+
+	size_t mb = 256;
+	if (const char* env = std::getenv("KSON_BENCH_PARALLEL_MB")) {
+		mb = std::max<size_t>(std::strtoul(env, nullptr, 10), 1);
+	}
+
+	// 重复写入同一批 record 的元素部分，不在内存中拼出整个文件
+	std::string file = "bench_parallel.kson";
+	std::string body = genRecords(10000);
+	body = body.substr(body.find('[') + 1);
+	body = body.substr(0, body.rfind(']'));
+	{
+		std::ofstream out(file, std::ios::binary);
+		out << "{\n    records: [";
+		for (size_t written = 0; written < mb * 1024 * 1024; written += body.size() + 1) {
+			if (written) out << ',';
+			out << body;
+		}
+		out << "]\n}\n";
+	}
+
+	KsonBuffer buf;
+	std::string error;
+	buf.load(file, error);
+	double size = static_cast<double>(buf.size());
+
+	// 吞吐量（MB/s）：两次中较快的一次（第一次包括新线程的堆向系统申请内存的缺页），结果的销毁不计入
+	std::ostringstream os;
+	os << "records " << size / (1024 * 1024) << " MB, " << std::thread::hardware_concurrency() << " hardware threads, throughput (MB/s):\n";
+	size_t checksum = 0;
+	auto speed = [&](const std::function<std::pair<bool, KsonObject>()>& parse) {
+		double best = 0;
+		for (int round = 0; round < 2; ++round) {
+			std::pair<bool, KsonObject> ret;
+			double time = timeIt(1, [&]() { ret = parse(); });
+			checksum += ret.first + ret.second.at("records").arrayRef().size();
+			best = round == 0 ? time : std::min(best, time);
+		}
+		return size / (1024 * 1024) / (best / 1e9);
+	};
+
+	double sequential = speed([&]() {
+		KsonBuffer view;
+		view.borrow(buf.data(), buf.size());
+		return Kson(std::move(view)).parse();
+	});
+	os << "  Kson: " << sequential << "\n";
+
+	size_t maxThreads = std::max<size_t>(std::thread::hardware_concurrency(), 4);
+	for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+		KsonParallelParser parser(threads);
+		double parallel = speed([&]() { return parser.parse(buf.data(), buf.size()); });
+		os << "  " << threads << " threads: " << parallel << " (" << parallel / sequential << "x Kson, " << parser.chunkCount() << " chunks)\n";
+	}
+
+	buf.clear();
+	std::remove(file.c_str());
+	os << "(checksum " << checksum << ")\n";
+	print(os.str());
+}
+
+// benchStream
+void KsonBench::benchStream() {
+	print("\n==== bench: stream ====\n");
+
+	// 每行一条 record，约 1% 的行有错误
+	std::string file = "bench_stream.kson";
+	std::string body = genRecords(10000);
+	body = body.substr(body.find('[') + 1);
+	body = body.substr(0, body.rfind(']'));
+	std::string stream;
+	size_t count = 0;
+	for (int copy = 0; copy < 20; ++copy) {
+		size_t pos = 0;
+		while ((pos = body.find('{', pos)) != std::string::npos) {
+			size_t end = body.find('\n', pos);
+			std::string record = body.substr(pos, (end == std::string::npos ? body.size() : end) - pos);
+			if (record.back() == ',') record.pop_back();
+			if (count % 100 == 99) record.replace(record.find("id:"), 3, "id");
+			stream += record + "\n";
+			++count;
+			pos += record.size();
+		}
+	}
+	std::ofstream(file, std::ios::binary) << stream;
+	double mb = stream.size() / (1024.0 * 1024.0);
+
+	// 吞吐量：每秒的记录数（以及 MB/s）
+	std::ostringstream os;
+	os << count << " records, " << mb << " MB, " << std::thread::hardware_concurrency() << " hardware threads, records/s (MB/s):\n";
+	size_t checksum = 0;
+	auto report = [&](const std::string& name, double time) {
+		os << "  " << name << ": " << count / (time / 1e9) << " (" << mb / (time / 1e9) << ")\n";
+	};
+
+	// 原来的方式：逐行读入，每行构建一个 Kson
+	std::streambuf* out = std::cout.rdbuf(nullptr);
+	report("Kson per line", timeIt(1, [&]() {
+		std::ifstream in(file, std::ios::binary);
+		std::string line;
+		while (std::getline(in, line)) {
+			checksum += Kson(line, false).parse().first;
+		}
+	}));
+
+	size_t maxThreads = std::max<size_t>(std::thread::hardware_concurrency(), 4);
+	for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+		for (bool ordered : { true, false }) {
+			KsonStreamReader reader(threads);
+			reader.setOrdered(ordered);
+			double time = timeIt(1, [&]() {
+				reader.open(file);
+				reader.readAll([&](KsonRecord& record) { checksum += record.m_ok + record.m_index; });
+			});
+			report(std::to_string(threads) + " threads " + (ordered ? "ordered" : "unordered"), time);
+		}
+	}
+	std::cout.rdbuf(out);
+
+	std::remove(file.c_str());
+	os << "(checksum " << checksum << ")\n";
+	print(os.str());
+}
+
+// benchIterative
+void KsonBench::benchIterative() {
+	print("\n==== bench: iterative ====\n");
+
+	std::vector<std::pair<std::string, std::string>> docs = {
+		{ "records(100000)", genRecords(100000) },
+		{ "pretty(20000)", genPretty(20000) },
+		{ "deep(2000)", genDeep(2000) },
+	};
+
+	// 吞吐量（MB/s）
+	std::ostringstream os;
+	os << "throughput (MB/s): recursive (empty handler, KsonObject) / iterative (empty handler, KsonObject)\n";
+	size_t checksum = 0;
+	for (const auto& doc : docs) {
+		const std::string& ksonStr = doc.second;
+		double size = static_cast<double>(ksonStr.size()) / (1024 * 1024);
+		os << doc.first << " " << size << " MB: ";
+
+		for (bool iterative : { false, true }) {
+			KsonHandler empty;
+			KsonBuffer buf;
+			double emptyTime = timeIt(5, [&]() {
+				buf.borrow(ksonStr.data(), ksonStr.size());
+				Kson kson(std::move(buf));
+				kson.setIterative(iterative);
+				checksum += kson.parse(empty);
+			});
+			double domTime = timeIt(3, [&]() {
+				buf.borrow(ksonStr.data(), ksonStr.size());
+				Kson kson(std::move(buf));
+				kson.setIterative(iterative);
+				checksum += kson.parse().second.size();
+			});
+			os << size / (emptyTime / 1e9) << ", " << size / (domTime / 1e9) << (iterative ? "\n" : " / ");
+		}
+	}
+	os << "(checksum " << checksum << ")\n";
+	print(os.str());
+}
+
+// benchReject
+void KsonBench::benchReject() {
+	print("\n==== bench: reject ====\n");
+
+	// 约 1KB 的 payload，每个随机改坏一处：替换为不支持的字符或错误的结构字符，或者截断
+	std::string payload = genRecords(8);
+	std::mt19937 rand(20241101);
+	const char replaces[] = { '\x01', ':', '}', ']', '"', ',', 'x' };
+	std::vector<std::string> docs;
+	for (int i = 0; i < 2000; ++i) {
+		std::string doc = payload;
+		size_t pos = 1 + rand() % (doc.size() - 1);
+		size_t kind = rand() % (sizeof(replaces) + 1);
+		if (kind == sizeof(replaces)) {
+			doc.resize(pos);
+		}
+		else {
+			doc[pos] = replaces[kind];
+		}
+		docs.push_back(doc);
+	}
+
+	// 错误文本的解析输出到 std::cout，这里关闭输出
+	size_t rejected = 0;
+	auto run = [&](bool noexceptPath, bool dom) {
+		size_t failed = 0;
+		KsonHandler empty;
+		KsonError error;
+		KsonObject obj;
+		KsonBuffer buf;
+		std::streambuf* out = std::cout.rdbuf(nullptr);
+		double time = timeIt(5, [&]() {
+			failed = 0;
+			for (const auto& doc : docs) {
+				buf.borrow(doc.data(), doc.size());
+				Kson kson(std::move(buf));
+				bool ret = false;
+				if (noexceptPath) ret = dom ? kson.parse(obj, error) : kson.parse(empty, error);
+				else ret = dom ? kson.parse().first : kson.parse(empty);
+				failed += !ret;
+			}
+		});
+		std::cout.rdbuf(out);
+		rejected = failed;
+		return docs.size() / (time / 1e9);
+	};
+
+	std::ostringstream os;
+	os << "rejection throughput (docs/s), " << docs.size() << " corrupted payloads of " << payload.size() << " bytes:\n";
+	os << "  error text (empty handler, KsonObject): " << run(false, false) << ", " << run(false, true) << "\n";
+	os << "  error code (empty handler, KsonObject): " << run(true, false) << ", " << run(true, true) << "\n";
+	os << "  (rejected " << rejected << ")\n";
+	print(os.str());
+}
+
+// benchBind
+void KsonBench::benchBind() {
+	print("\n==== bench: bind ====\n");
+
+	// 服务配置：servers 个 server，约三分之一没有 limits，每个 server 有一个未声明的 key（被跳过）
+	auto genConfig = [](int servers) {
+		std::ostringstream os;
+		os << "// service config\n{\n    service: \"gateway\", version: 42,\n"
+			<< "    listen: { host: \"0.0.0.0\", port: 8443, backlog: 512 },\n    servers: [\n";
+		for (int i = 0; i < servers; ++i) {
+			os << "        { name: \"backend-" << i << "\", address: \"10.0." << i / 256 << "." << i % 256 << ":8080\", weight: " << i % 10
+				<< ", enable: " << (i % 7 ? "true" : "false") << ", tags: [\"zone-" << i % 3 << "\", \"tier-" << i % 2 << "\"]";
+			if (i % 3) os << ", limits: { qps: " << 1000 + i << (i % 2 ? ", burst: 50" : "") << " }";
+			os << ", note: { owner: \"team-" << i % 5 << "\", since: [2020, " << i % 12 + 1 << "] } }" << (i + 1 < servers ? ",\n" : "\n");
+		}
+		os << "    ],\n    features: { http2: true, gzip: true, tracing: false, retry: true, canary: false },\n"
+			<< "    timeouts: { connect: 0.5, read: 3, write: 3, idle: 60.25 },\n    log: \"/var/log/gateway.log\"\n}\n";
+		return os.str();
+	};
+
+	std::ostringstream os;
+	for (int servers : { 8, 100, 2000 }) {
+		std::string ksonStr = genConfig(servers);
+		int count = static_cast<int>(std::max<size_t>(20, 20 * 1024 * 1024 / ksonStr.size()));
+		count = std::min(count, 5000);
+
+		// 两种方式的结果相同
+		BenchConfig copied, bound;
+		bool isSame = copyConfig(Kson(ksonStr, false).parse().second, copied);
+		KsonBinder binder;
+		isSame = binder.parse(ksonStr, bound) && isSame;
+		isSame = isSame && copied.servers.size() == bound.servers.size() && copied.features == bound.features
+			&& copied.timeouts == bound.timeouts && copied.listen.port == bound.listen.port && copied.log == bound.log;
+		for (size_t i = 0; isSame && i < copied.servers.size(); ++i) {
+			const BenchServer& a = copied.servers[i];
+			const BenchServer& b = bound.servers[i];
+			isSame = a.name == b.name && a.address == b.address && a.weight == b.weight && a.enable == b.enable && a.tags == b.tags
+				&& a.limits.has_value() == b.limits.has_value() && (!a.limits || (a.limits->qps == b.limits->qps && a.limits->burst == b.limits->burst));
+		}
+
+		// 每次填充新的结构体，包括其中的分配
+		KsonBuffer buf;
+		size_t allocs[2] = { 0, 0 };
+		double times[2];
+		for (int way = 0; way < 2; ++way) {
+			KsonAlloc::reset();
+			times[way] = timeIt(count, [&]() {
+				BenchConfig config;
+				if (way == 0) {
+					buf.borrow(ksonStr.data(), ksonStr.size());
+					Kson kson(std::move(buf));
+					copyConfig(kson.parse().second, config);
+				}
+				else {
+					binder.parse(ksonStr, config);
+				}
+			});
+			allocs[way] = KsonAlloc::stat().m_count / count;
+		}
+
+		os << servers << " servers (" << ksonStr.size() << " bytes" << (isSame ? "" : ", MISMATCH") << "):\n";
+		os << "  parse + copy: " << times[0] / 1000 << " us, " << ksonStr.size() / times[0] * 1e3 << " MB/s, " << allocs[0] << " allocs\n";
+		os << "  bind:         " << times[1] / 1000 << " us, " << ksonStr.size() / times[1] * 1e3 << " MB/s, " << allocs[1] << " allocs"
+			<< " (x" << times[0] / times[1] << ")\n";
+	}
+	print(os.str());
+}
+
+// benchPath
+void KsonBench::benchPath() {
+	print("\n==== bench: path ====\n");
+
+	// 1000 个 server，每个有 limits 和 tags，以及一些查询时不关心的成员
+	std::ostringstream text;
+	text << "{\n    service: \"gateway\", listen: { host: \"0.0.0.0\", port: 8443 },\n    servers: [\n";
+	for (int i = 0; i < 1000; ++i) {
+		text << "        { name: \"backend-" << i << "\", port: " << 8000 + i << ", weight: " << i % 10 << ", enable: true"
+			<< ", limits: { qps: " << 1000 + i << ", burst: " << i % 50 << " }, tags: [\"zone-" << i % 3 << "\", \"tier-" << i % 2 << "\"]"
+			<< ", owner: { team: \"t" << i % 7 << "\", oncall: \"p" << i % 11 << "\" } }" << (i + 1 < 1000 ? ",\n" : "\n");
+	}
+	text << "    ],\n    timeouts: { connect: 0.5, read: 3, write: 3 }\n}\n";
+	KsonObject obj = Kson(text.str(), false).parse().second;
+
+	std::string error;
+	std::ostringstream os;
+	os << "per query (ns), allocations per query in ():\n";
+	auto report = [&os](const char* name, double time, size_t allocs, int count, size_t queries) {
+		os << "  " << name << time / queries << " (" << static_cast<double>(allocs) / count / queries << ")\n";
+	};
+
+	// 同一个深层路径
+	const int count = 1000000;
+	KsonPath qps;
+	qps.compile("servers[3].limits.qps", error);
+	KsonInt sum = 0;
+	KsonAlloc::reset();
+	double chained = timeIt(count, [&]() { sum += obj.at("servers").at(3).at("limits").at("qps").getInt(); });
+	size_t chainedAllocs = KsonAlloc::stat().m_count;
+	KsonAlloc::reset();
+	double compiled = timeIt(count, [&]() { sum += qps.first(obj)->getInt(); });
+	size_t compiledAllocs = KsonAlloc::stat().m_count;
+	os << "servers[3].limits.qps:\n";
+	report("chained at():  ", chained, chainedAllocs, count, 1);
+	report("KsonPath:      ", compiled, compiledAllocs, count, 1);
+
+	// 通配符：所有 server 的 limits.qps 之和
+	KsonPath allQps;
+	allQps.compile("/servers/*/limits/qps", error);
+	const int wildCount = 2000;
+	KsonAlloc::reset();
+	chained = timeIt(wildCount, [&]() {
+		for (const KsonValue& server : obj.at("servers").arrayRef()) {
+			sum += server.at("limits").at("qps").getInt();
+		}
+	});
+	chainedAllocs = KsonAlloc::stat().m_count;
+	KsonAlloc::reset();
+	compiled = timeIt(wildCount, [&]() {
+		allQps.forEach(obj, [&sum](const KsonValue& val) { sum += val.getInt(); return true; });
+	});
+	compiledAllocs = KsonAlloc::stat().m_count;
+	os << "servers[*].limits.qps (1000 matches):\n";
+	report("chained at():  ", chained, chainedAllocs, wildCount, 1000);
+	report("KsonPath:      ", compiled, compiledAllocs, wildCount, 1000);
+
+	// 同一个 array 上的 4 个通配符路径：逐个查询遍历 4 次，KsonPathSet 遍历 1 次
+	const char* wildStrs[] = { "/servers/*/port", "/servers/*/limits/qps", "/servers/*/limits/burst", "/servers/*/owner/team" };
+	std::vector<KsonPath> wildPaths(4);
+	KsonPathSet wildSet;
+	for (int i = 0; i < 4; ++i) {
+		wildPaths[i].compile(wildStrs[i], error);
+		wildSet.add(wildStrs[i], error);
+	}
+	wildSet.build();
+	size_t matches = 0;
+	KsonAlloc::reset();
+	compiled = timeIt(wildCount, [&]() {
+		for (const KsonPath& path : wildPaths) {
+			matches += path.count(obj);
+		}
+	});
+	compiledAllocs = KsonAlloc::stat().m_count;
+	KsonAlloc::reset();
+	double batch = timeIt(wildCount, [&]() {
+		wildSet.forEach(obj, [&matches](size_t, const KsonValue&) { ++matches; });
+	});
+	size_t batchAllocs = KsonAlloc::stat().m_count;
+	os << "4 wildcard paths over servers (4000 matches):\n";
+	report("KsonPath:      ", compiled, compiledAllocs, wildCount, 4000);
+	report("KsonPathSet:   ", batch, batchAllocs, wildCount, 4000);
+
+	// 一组 16 个路径，前缀大多相同
+	std::vector<std::string> strs;
+	for (int i : { 0, 3, 17, 256, 511, 999 }) {
+		strs.push_back("/servers/" + std::to_string(i) + "/limits/qps");
+		strs.push_back("/servers/" + std::to_string(i) + "/owner/team");
+	}
+	strs.push_back("/listen/port");
+	strs.push_back("/listen/host");
+	strs.push_back("/timeouts/read");
+	strs.push_back("/service");
+	std::vector<KsonPath> paths(strs.size());
+	KsonPathSet pathSet;
+	for (size_t i = 0; i < strs.size(); ++i) {
+		paths[i].compile(strs[i], error);
+		pathSet.add(strs[i], error);
+	}
+	pathSet.build();
+	std::vector<const KsonValue*> results;
+	const int batchCount = 100000;
+	size_t found = 0;
+	KsonAlloc::reset();
+	chained = timeIt(batchCount, [&]() {
+		for (int i : { 0, 3, 17, 256, 511, 999 }) {
+			const KsonValue& server = obj.at("servers").at(i);
+			found += server.at("limits").at("qps").getType() == KsonType::NUMBER;
+			found += server.at("owner").at("team").getType() == KsonType::STRING;
+		}
+		found += obj.at("listen").at("port").getType() == KsonType::NUMBER;
+		found += obj.at("listen").at("host").getType() == KsonType::STRING;
+		found += obj.at("timeouts").at("read").getType() == KsonType::NUMBER;
+		found += obj.at("service").getType() == KsonType::STRING;
+	});
+	chainedAllocs = KsonAlloc::stat().m_count;
+	KsonAlloc::reset();
+	compiled = timeIt(batchCount, [&]() {
+		for (const KsonPath& path : paths) {
+			found += path.first(obj) != nullptr;
+		}
+	});
+	compiledAllocs = KsonAlloc::stat().m_count;
+	pathSet.first(obj, results);
+	KsonAlloc::reset();
+	batch = timeIt(batchCount, [&]() {
+		pathSet.first(obj, results);
+		for (const KsonValue* val : results) {
+			found += val != nullptr;
+		}
+	});
+	batchAllocs = KsonAlloc::stat().m_count;
+	os << strs.size() << " paths (per path):\n";
+	report("chained at():  ", chained, chainedAllocs, batchCount, strs.size());
+	report("KsonPath:      ", compiled, compiledAllocs, batchCount, strs.size());
+	report("KsonPathSet:   ", batch, batchAllocs, batchCount, strs.size());
+	os << "(checksum " << sum << ", " << found << ", " << matches << ")\n";
+	print(os.str());
+}
+
+// benchBuilder
+void KsonBench::benchBuilder() {
+	print("\n==== bench: builder ====\n");
+
+	// 每个 record 8 个节点：object、id、name、score、active、tags 和其中的两个字符串
+	const int records = 125000;
+	const char* zones[] = { "zone-a", "zone-b", "zone-c" };
+	const int rounds = 3;
+	size_t nodes[2] = { 0, 0 };
+	size_t allocs[2] = { 0, 0 };
+	double times[2] = { 0, 0 };
+	std::string outputs[2];
+
+	for (int way = 0; way < 2; ++way) {
+		double best = 0;
+		for (int round = 0; round < rounds; ++round) {
+			KsonAlloc::reset();
+			auto start = std::chrono::steady_clock::now();
+			KsonObject root;
+
+			// 七个参数的构造函数：每个值都要传入其它类型的空容器，object / array 先单独构建再移入
+			if (way == 0) {
+				KsonArray items;
+				for (int i = 0; i < records; ++i) {
+					KsonArray tags;
+					tags.push_back(KsonValue(KsonType::STRING, KsonObject(), KsonArray(), KsonStr(zones[i % 3]), KsonNum(true, 0, 0.0), false, nullptr));
+					tags.push_back(KsonValue(KsonType::STRING, KsonObject(), KsonArray(), KsonStr("tier-1"), KsonNum(true, 0, 0.0), false, nullptr));
+					KsonObject record;
+					record["id"] = KsonValue(KsonType::NUMBER, KsonObject(), KsonArray(), KsonStr(), KsonNum(true, i, 0.0), false, nullptr);
+					record["name"] = KsonValue(KsonType::STRING, KsonObject(), KsonArray(), KsonStr("user-" + std::to_string(i)), KsonNum(true, 0, 0.0), false, nullptr);
+					record["score"] = KsonValue(KsonType::NUMBER, KsonObject(), KsonArray(), KsonStr(), KsonNum(false, 0, i * 0.5), false, nullptr);
+					record["active"] = KsonValue(KsonType::BOOL, KsonObject(), KsonArray(), KsonStr(), KsonNum(true, 0, 0.0), i % 2 == 0, nullptr);
+					record["tags"] = KsonValue(KsonType::ARRAY, KsonObject(), std::move(tags), KsonStr(), KsonNum(true, 0, 0.0), false, nullptr);
+					items.push_back(KsonValue(KsonType::OBJECT, std::move(record), KsonArray(), KsonStr(), KsonNum(true, 0, 0.0), false, nullptr));
+				}
+				root["items"] = KsonValue(KsonType::ARRAY, KsonObject(), std::move(items), KsonStr(), KsonNum(true, 0, 0.0), false, nullptr);
+			}
+
+			// 构建接口：预留空间，在容器中直接构建，按 key 的顺序添加
+			else {
+				KsonValue& items = root["items"];
+				items = KsonValue::makeArray();
+				items.reserve(records);
+				for (int i = 0; i < records; ++i) {
+					KsonValue& record = items.emplace_back();
+					record.reserve(5);
+					record.set("active", KsonValue::makeBool(i % 2 == 0));
+					record.set("id", KsonValue::makeInt(i));
+					record.set("name", KsonValue::makeStr("user-" + std::to_string(i)));
+					record.set("score", KsonValue::makeDouble(i * 0.5));
+					KsonValue& tags = record.set("tags", KsonValue::makeArray());
+					tags.reserve(2);
+					tags.push_back(KsonValue::makeStr(zones[i % 3]));
+					tags.push_back(KsonValue::makeStr("tier-1"));
+				}
+			}
+
+			double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (round == 0 || time < best) best = time;
+			allocs[way] = KsonAlloc::stat().m_count;
+			if (round == 0) {
+				NodeStat stat;
+				countNodes(root, stat);
+				nodes[way] = stat.m_nodes;
+				outputs[way] = toKsonStr(root);
+			}
+		}
+		times[way] = best;
+	}
+
+	std::ostringstream os;
+	os << "build " << nodes[1] << " nodes (" << records << " records" << (outputs[0] == outputs[1] ? "" : ", MISMATCH") << "), fastest of " << rounds << ":\n";
+	os << "  7-arg constructor: " << times[0] << " ms, " << allocs[0] << " allocs\n";
+	os << "  builder:           " << times[1] << " ms, " << allocs[1] << " allocs (x" << times[0] / times[1] << ")\n";
+	print(os.str());
+}
@@ -0,0 +1,140 @@
+﻿#ifndef __K_BENCH_H__
+#define __K_BENCH_H__
+
+#include "kson.h"
+#include "kcorpus.h"
+
+//============================================================
+//  ksonBench: Kson解析器的性能测试类
+//============================================================
+
+namespace kson {
+
+	// 基准测试套件的选项（kbenchmain.cpp 由命令行参数设置）
+	struct KsonSuiteOptions {
+		uint32_t                     m_seed = 1;                       // 语料的种子
+		size_t                       m_docSize = 64 * 1024;            // 每个文档约多少字节
+		size_t                       m_corpusSize = 16 * 1024 * 1024;  // 每种语料总计约多少字节
+		int                          m_rounds = 3;                     // 重复次数，吞吐量取最快的一次
+		std::vector<KsonCorpusType>  m_types;                          // 语料，空为全部
+		bool                         m_csv = false;                    // 输出 CSV，默认每行一个 JSON object
+	};
+
+	class KsonBench {
+	public:
+
+		void runAllBench();
+
+		// 基准测试套件：每种语料、每种操作（parse / parse_sax / serialize）输出一行机器可读的结果，
+		// 包括 MB/s、每秒文档数、每个文档的内存分配次数、堆内存峰值和进程的最大常驻内存，用于对比不同的版本
+		void runSuite(const KsonSuiteOptions& options);
+
+	private:
+
+		// 内存占用：每个节点平均占用的字节数（新旧 KsonValue 布局对比）
+		void benchMemory();
+		void benchMemory(const std::string& name, const std::string& ksonStr);
+
+		// 访问接口：按值返回与按引用/链式查找的对比
+		void benchAccessor();
+
+		// 词法分析：空白、注释、字符串、key 较多的文档的解析吞吐量（MB/s）
+		void benchLexer();
+
+		// 文件读取：逐字符读入与 KsonBuffer（mmap/整块读入）的对比
+		void benchLoad();
+
+		// 事件接口：只统计部分字段时与构建 KsonObject 的吞吐量对比
+		void benchSax();
+
+		// 内存池文档：解析并销毁的耗时、堆内存峰值、分配次数，与 KsonObject 对比
+		void benchDocument();
+
+		// in-situ 模式：字符串较多的文档，拷贝与引用 kson 文本的耗时和分配字节数对比
+		void benchInSitu();
+
+		// object 容器：KsonObject（有序扁平容器）与 std::map 的构建、查找、遍历耗时对比
+		void benchObject();
+		void benchObject(int size);
+
+		// key 的符号表：同样结构的 record 组成的大数组，开启 / 关闭符号表的内存池用量、解析耗时、查找耗时对比
+		void benchInternKeys();
+
+		// 数值：整数、短小数、17 位有效数字的 double 混合的文档，解析吞吐量，以及每个数值的转换耗时（旧的逐位乘除 / 新的实现 / strtod）
+		void benchNumber();
+
+		// 批量扫描：每个扫描函数在各个实现下的吞吐量，以及缩进较深的文档的解析吞吐量
+		void benchSimd();
+
+		// 输出：KsonObject 和文档输出为紧凑 / 缩进格式的吞吐量，与基于 ostringstream 逐字符输出的实现对比
+		void benchWriter();
+
+		// 二进制编码：文本解析、二进制解码、二进制直接读取的加载耗时和堆内存峰值，以及文件大小
+		void benchBinary();
+
+		// 延迟解码：读取一个字段、读取所有 record 的字段、转换为 KsonObject，与 KsonObject 和 KsonDocument 的解析对比
+		void benchLazy();
+
+		// 结构索引：第一阶段（建立索引）和第二阶段（按索引发送事件）分别的吞吐量，与 Kson 对比（各个 SIMD 实现）
+		void benchIndex();
+
+		// 多线程解析：由 record 组成的大数组的文件（默认 256MB，环境变量 KSON_BENCH_PARALLEL_MB 指定大小），1~N 个线程的吞吐量，与 Kson 对比
+		void benchParallel();
+
+		// 记录流：每行一条 record 的文件，逐行构建 Kson 与 KsonStreamReader（1~N 个线程，按输入顺序 / 完成顺序交付）每秒解析的记录数
+		void benchStream();
+
+		// 非递归解析：宽文档（records、pretty）和深度嵌套的文档上，与递归的解析的吞吐量对比（空 handler、KsonObject）
+		void benchIterative();
+
+		// 拒绝错误的输入：约 1KB 的随机改坏的 payload，生成错误文本的解析与不抛出异常、只返回错误码的解析每秒拒绝的文档数
+		void benchReject();
+
+		// 绑定到结构体：服务配置（监听地址、上百个 server、开关和超时的 map），解析为 KsonObject 后逐个复制与 KsonBinder 的耗时和分配次数对比
+		void benchBind();
+
+		// 路径查询：同一个深层路径、通配符路径、一组 16 个路径，与链式 at() 的每次查询耗时和分配次数对比
+		void benchPath();
+
+		// 构建文档：约 100 万个节点的 record 数组，七个参数的构造函数（先构建 KsonObject / KsonArray 再移入）与 set / emplace_back / reserve 的耗时和分配次数对比
+		void benchBuilder();
+
+		// 解析 ksonStr 若干次，返回吞吐量（MB/s）
+		double parseSpeed(const std::string& ksonStr);
+		double parseSpeed(const std::string& ksonStr, KsonHandler& handler);
+
+		// 节点统计
+		struct NodeStat {
+			size_t m_nodes = 0;      // 节点个数（含根节点）
+			size_t m_boxBytes = 0;   // object/array/string 外置存储占用的字节数
+			size_t m_slots = 0;      // 容器中存放 KsonValue 的位置个数（map 节点数 + vector 容量）
+		};
+		void countNodes(const KsonObject& obj, NodeStat& stat);
+		void countNodes(const KsonValue& val, NodeStat& stat);
+
+		// 工具函数
+	private:
+
+		// 读取文件内容
+		std::string readFile(const std::string& file);
+
+		// 生成由 count 条记录组成的大文档
+		std::string genRecords(int count);
+
+		// 生成带缩进、注释和长字符串的文档，共 count 条记录
+		std::string genPretty(int count);
+
+		// 生成以字符串为主的文档，共 count 条记录，其中约 5% 的字符串含有转义字符
+		std::string genStrings(int count);
+
+		// 生成以数值为主的文档：count 个数值组成的数组，整数、两位小数、17 位有效数字的 double（含负指数）各占三分之一
+		std::string genNumbers(int count);
+
+		// 生成深度为 depth 的嵌套文档，每层的下一层为 next，最内层有 leaf
+		std::string genDeep(int depth);
+
+		void print(const std::string& info);
+	};
+}
+
+#endif
@@ -0,0 +1,120 @@
+﻿#include "stdafx.h"
+#include "kbench.h"
+#include "kcorpus.h"
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+//============================================================
+//  kson_bench: 性能测试的入口（CMakeLists.txt 中的 kson_bench）
+//============================================================
+
+// 默认运行基准测试套件，每种语料、每种操作输出一行 JSON：
+//
+//     kson_bench --seed 7 --corpus records,deep --corpus-mb 32 > run.jsonl
+//
+// --classic 运行 KsonBench::runAllBench() 中的各项对比测试（可读的文本）
+
+using namespace kson;
+
+namespace {
+
+	// usage
+	void usage(const char* name) {
+		std::cerr
+			<< "usage: " << name << " [options]\n"
+			<< "  --seed N         corpus seed (default 1)\n"
+			<< "  --doc-kb N       size of each document in KB (default 64)\n"
+			<< "  --corpus-mb N    total size of each corpus in MB (default 16)\n"
+			<< "  --rounds N       rounds per measurement, the fastest is reported (default 3)\n"
+			<< "  --corpus LIST    comma separated: deep,wide,records,strings,numbers,comments,spaces (default all)\n"
+			<< "  --csv            print CSV instead of one JSON object per line\n"
+			<< "  --classic        run the human readable comparison benchmarks instead\n";
+	}
+
+	// 正整数参数，格式错误时返回 false
+	bool toSize(const char* str, size_t& value) {
+		char* end = nullptr;
+		unsigned long long v = std::strtoull(str, &end, 10);
+		if (end == str || *end != '\0' || v == 0) return false;
+		value = static_cast<size_t>(v);
+		return true;
+	}
+}
+
+// main
+int main(int argc, char** argv)
+{
+	KsonSuiteOptions options;
+	bool classic = false;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--csv") {
+			options.m_csv = true;
+			continue;
+		}
+		if (arg == "--classic") {
+			classic = true;
+			continue;
+		}
+		if (arg == "--help" || arg == "-h") {
+			usage(argv[0]);
+			return 0;
+		}
+
+		// 其余选项都带有一个值
+		if (i + 1 >= argc) {
+			usage(argv[0]);
+			return 2;
+		}
+		const char* value = argv[++i];
+		size_t n = 0;
+		bool ok = true;
+		if (arg == "--seed") {
+			char* end = nullptr;
+			options.m_seed = static_cast<uint32_t>(std::strtoul(value, &end, 10));
+			ok = end != value && *end == '\0';
+		}
+		else if (arg == "--doc-kb") {
+			ok = toSize(value, n);
+			options.m_docSize = n * 1024;
+		}
+		else if (arg == "--corpus-mb") {
+			ok = toSize(value, n);
+			options.m_corpusSize = n * 1024 * 1024;
+		}
+		else if (arg == "--rounds") {
+			ok = toSize(value, n);
+			options.m_rounds = static_cast<int>(n);
+		}
+		else if (arg == "--corpus") {
+			std::istringstream names(value);
+			std::string name;
+			while (ok && std::getline(names, name, ',')) {
+				KsonCorpusType type;
+				ok = KsonCorpus::findType(name, type);
+				options.m_types.push_back(type);
+			}
+		}
+		else {
+			ok = false;
+		}
+
+		if (!ok) {
+			std::cerr << "invalid option: " << arg << " " << value << "\n";
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	KsonBench bench;
+	if (classic) {
+		bench.runAllBench();
+	}
+	else {
+		bench.runSuite(options);
+	}
+	return 0;
+}
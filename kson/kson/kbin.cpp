@@ -0,0 +1,510 @@
+﻿#include "stdafx.h"
+#include "kbin.h"
+#include <cstring>
+#include <stdexcept>
+
+using namespace kson;
+
+namespace {
+
+	// accept() 的最大嵌套深度，避免损坏的编码导致栈溢出
+	const int KSON_BIN_MAX_DEPTH = 4096;
+
+	// varint 的字节数
+	size_t varintSize(uint64_t value) {
+		size_t size = 1;
+		while (value >= 0x80) {
+			value >>= 7;
+			++size;
+		}
+		return size;
+	}
+
+	char* writeVarint(char* p, uint64_t value) {
+		while (value >= 0x80) {
+			*p++ = static_cast<char>((value & 0x7f) | 0x80);
+			value >>= 7;
+		}
+		*p++ = static_cast<char>(value);
+		return p;
+	}
+
+	// 读取 varint，超出 end 或超过 10 字节时返回 false
+	bool readVarint(const char*& p, const char* end, uint64_t& value) {
+		value = 0;
+		for (int shift = 0; shift < 64 && p < end; shift += 7) {
+			unsigned char c = static_cast<unsigned char>(*p++);
+			value |= static_cast<uint64_t>(c & 0x7f) << shift;
+			if (c < 0x80) return true;
+		}
+		return false;
+	}
+
+	// 小端序写入 / 读取 size 字节
+	char* writeLE(char* p, uint64_t value, size_t size) {
+		for (size_t i = 0; i < size; ++i) {
+			*p++ = static_cast<char>(value >> (i * 8));
+		}
+		return p;
+	}
+
+	uint64_t readLE(const char* p, size_t size) {
+		uint64_t value = 0;
+		for (size_t i = 0; i < size; ++i) {
+			value |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (i * 8);
+		}
+		return value;
+	}
+
+	// 整数的编码宽度和对应的 tag
+	KsonBinTag intTag(KsonInt value, size_t& width) {
+		if (value >= INT8_MIN && value <= INT8_MAX) { width = 1; return KsonBinTag::INT8; }
+		if (value >= INT16_MIN && value <= INT16_MAX) { width = 2; return KsonBinTag::INT16; }
+		if (value >= INT32_MIN && value <= INT32_MAX) { width = 4; return KsonBinTag::INT32; }
+		width = 8;
+		return KsonBinTag::INT64;
+	}
+
+	// 定长 tag 的内容字节数，不是定长 tag 时返回 -1
+	int fixedSize(KsonBinTag tag) {
+		switch (tag) {
+		case KsonBinTag::NUL:
+		case KsonBinTag::BOOL_FALSE:
+		case KsonBinTag::BOOL_TRUE:  return 0;
+		case KsonBinTag::INT8:       return 1;
+		case KsonBinTag::INT16:      return 2;
+		case KsonBinTag::INT32:      return 4;
+		case KsonBinTag::INT64:
+		case KsonBinTag::DOUBLE:     return 8;
+		default:                     return -1;
+		}
+	}
+
+	// 读取 p 处的 value：内容的起始位置、长度（定长类型为字节数，其它为 varint 给出的字节数），以及下一个 value 的位置
+	bool readValue(const char* p, const char* end, KsonBinTag& tag, const char*& content, uint64_t& len, const char*& next) {
+		if (p >= end || static_cast<unsigned char>(*p) > static_cast<unsigned char>(KsonBinTag::OBJECT)) return false;
+		tag = static_cast<KsonBinTag>(*p++);
+
+		int size = fixedSize(tag);
+		if (size >= 0) {
+			len = static_cast<uint64_t>(size);
+		}
+		else if (!readVarint(p, end, len)) {
+			return false;
+		}
+		if (len > static_cast<uint64_t>(end - p)) return false;
+		content = p;
+		next = p + len;
+		return true;
+	}
+
+	// 两遍编码：第一遍计算每个 object/array 的 body 字节数（按先序保存），第二遍直接写入预先分配好的缓冲区
+	class KsonBinEncoder {
+	public:
+		std::string encode(const KsonObject& obj) {
+			m_bodySizes.clear();
+			size_t size = KSON_BIN_HEADER_SIZE + objectSize(obj);
+
+			std::string bin(size, '\0');
+			char* p = &bin[0];
+			std::memcpy(p, KSON_BIN_MAGIC, 3);
+			p[3] = static_cast<char>(KSON_BIN_VERSION);
+			m_next = 0;
+			writeObject(p + KSON_BIN_HEADER_SIZE, obj);
+			return bin;
+		}
+
+	private:
+
+		// 编码后的字节数（含 tag）
+		size_t objectSize(const KsonObject& obj) {
+			size_t index = m_bodySizes.size();
+			m_bodySizes.push_back(0);
+			size_t body = varintSize(obj.size());
+			for (const auto& member : obj) {
+				body += varintSize(member.first.size()) + member.first.size() + valueSize(member.second);
+			}
+			m_bodySizes[index] = body;
+			return 1 + varintSize(body) + body;
+		}
+
+		size_t arraySize(const KsonArray& arr) {
+			size_t index = m_bodySizes.size();
+			m_bodySizes.push_back(0);
+			size_t body = varintSize(arr.size());
+			for (const auto& elem : arr) {
+				body += valueSize(elem);
+			}
+			m_bodySizes[index] = body;
+			return 1 + varintSize(body) + body;
+		}
+
+		size_t valueSize(const KsonValue& val) {
+			switch (val.getType()) {
+			case KsonType::OBJECT: return objectSize(val.objectRef());
+			case KsonType::ARRAY:  return arraySize(val.arrayRef());
+			case KsonType::STRING: return 1 + varintSize(val.strRef().size()) + val.strRef().size();
+			case KsonType::NUMBER: {
+				size_t width = 8;
+				if (val.isInt()) intTag(val.getInt(), width);
+				return 1 + width;
+			}
+			default:               return 1;
+			}
+		}
+
+		char* writeObject(char* p, const KsonObject& obj) {
+			*p++ = static_cast<char>(KsonBinTag::OBJECT);
+			p = writeVarint(p, m_bodySizes[m_next++]);
+			p = writeVarint(p, obj.size());
+			for (const auto& member : obj) {
+				p = writeVarint(p, member.first.size());
+				std::memcpy(p, member.first.data(), member.first.size());
+				p = writeValue(p + member.first.size(), member.second);
+			}
+			return p;
+		}
+
+		char* writeArray(char* p, const KsonArray& arr) {
+			*p++ = static_cast<char>(KsonBinTag::ARRAY);
+			p = writeVarint(p, m_bodySizes[m_next++]);
+			p = writeVarint(p, arr.size());
+			for (const auto& elem : arr) {
+				p = writeValue(p, elem);
+			}
+			return p;
+		}
+
+		char* writeValue(char* p, const KsonValue& val) {
+			switch (val.getType()) {
+			case KsonType::OBJECT:
+				return writeObject(p, val.objectRef());
+
+			case KsonType::ARRAY:
+				return writeArray(p, val.arrayRef());
+
+			case KsonType::STRING: {
+				const KsonStr& str = val.strRef();
+				*p++ = static_cast<char>(KsonBinTag::STRING);
+				p = writeVarint(p, str.size());
+				std::memcpy(p, str.data(), str.size());
+				return p + str.size();
+			}
+
+			case KsonType::NUMBER: {
+				if (val.isInt()) {
+					size_t width;
+					*p++ = static_cast<char>(intTag(val.getInt(), width));
+					return writeLE(p, static_cast<uint64_t>(val.getInt()), width);
+				}
+				double value = val.getDouble();
+				uint64_t bits;
+				std::memcpy(&bits, &value, sizeof(bits));
+				*p++ = static_cast<char>(KsonBinTag::DOUBLE);
+				return writeLE(p, bits, 8);
+			}
+
+			case KsonType::BOOL:
+				*p++ = static_cast<char>(val.getBool() ? KsonBinTag::BOOL_TRUE : KsonBinTag::BOOL_FALSE);
+				return p;
+
+			default:
+				*p++ = static_cast<char>(KsonBinTag::NUL);
+				return p;
+			}
+		}
+
+	private:
+		std::vector<size_t> m_bodySizes;   // 每个 object/array 的 body 字节数（先序）
+		size_t              m_next = 0;    // 第二遍中下一个 object/array 的序号
+	};
+}
+
+//============================================================
+//  ksonBinary: 编码
+//============================================================
+
+// encodeKsonBin
+std::string kson::encodeKsonBin(const KsonObject& obj) {
+	KsonBinEncoder encoder;
+	return encoder.encode(obj);
+}
+
+//============================================================
+//  ksonBinView: 直接读取
+//============================================================
+
+// getType
+KsonType KsonBinView::getType() const {
+	switch (tag()) {
+	case KsonBinTag::BOOL_FALSE:
+	case KsonBinTag::BOOL_TRUE:  return KsonType::BOOL;
+	case KsonBinTag::INT8:
+	case KsonBinTag::INT16:
+	case KsonBinTag::INT32:
+	case KsonBinTag::INT64:
+	case KsonBinTag::DOUBLE:     return KsonType::NUMBER;
+	case KsonBinTag::STRING:     return KsonType::STRING;
+	case KsonBinTag::ARRAY:      return KsonType::ARRAY;
+	case KsonBinTag::OBJECT:     return KsonType::OBJECT;
+	default:                     return KsonType::NUL;
+	}
+}
+
+// getInt: 从 view 创建时已经检查过定长内容的边界
+KsonInt KsonBinView::getInt() const {
+	switch (tag()) {
+	case KsonBinTag::INT8:       return static_cast<int8_t>(readLE(m_p + 1, 1));
+	case KsonBinTag::INT16:      return static_cast<int16_t>(readLE(m_p + 1, 2));
+	case KsonBinTag::INT32:      return static_cast<int32_t>(readLE(m_p + 1, 4));
+	case KsonBinTag::INT64:      return static_cast<KsonInt>(readLE(m_p + 1, 8));
+	case KsonBinTag::DOUBLE:     return toKsonInt(getDouble());
+	default:                     return 0;
+	}
+}
+
+// getDouble
+KsonDouble KsonBinView::getDouble() const {
+	if (tag() == KsonBinTag::DOUBLE) {
+		uint64_t bits = readLE(m_p + 1, 8);
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+	return isInt() ? static_cast<KsonDouble>(getInt()) : 0.0;
+}
+
+// isInt
+bool KsonBinView::isInt() const {
+	KsonBinTag t = tag();
+	return t == KsonBinTag::INT8 || t == KsonBinTag::INT16 || t == KsonBinTag::INT32 || t == KsonBinTag::INT64;
+}
+
+// strView
+std::string_view KsonBinView::strView() const {
+	KsonBinTag t;
+	const char* content;
+	const char* next;
+	uint64_t len;
+	if (tag() != KsonBinTag::STRING || !readValue(m_p, m_end, t, content, len, next)) return std::string_view();
+	return std::string_view(content, static_cast<size_t>(len));
+}
+
+// size
+size_t KsonBinView::size() const {
+	if (tag() == KsonBinTag::STRING) return strView().size();
+
+	const char* body;
+	const char* bodyEnd;
+	uint64_t count;
+	return readBody(body, bodyEnd, count) ? static_cast<size_t>(count) : 0;
+}
+
+// first
+KsonBinView KsonBinView::first() const {
+	const char* body;
+	const char* bodyEnd;
+	uint64_t count;
+	if (!readBody(body, bodyEnd, count) || count == 0) return KsonBinView();
+	return child(body, bodyEnd, tag() == KsonBinTag::OBJECT);
+}
+
+// next: 所在容器的 body 结束时返回无效的 view（成员个数由 body 的长度决定，与 varint 中的个数一致时由 accept() 检查）
+KsonBinView KsonBinView::next() const {
+	KsonBinTag t;
+	const char* content;
+	const char* next;
+	uint64_t len;
+	if (!m_p || !readValue(m_p, m_end, t, content, len, next) || next == m_end) return KsonBinView();
+	return child(next, m_end, m_key != nullptr);
+}
+
+// find
+KsonBinView KsonBinView::find(std::string_view key) const {
+	if (tag() != KsonBinTag::OBJECT) return KsonBinView();
+	for (KsonBinView member = first(); member.isValid(); member = member.next()) {
+		if (member.key() == key) return member;
+	}
+	return KsonBinView();
+}
+
+// at: key
+KsonBinView KsonBinView::at(std::string_view key) const {
+	KsonBinView member = find(key);
+	if (!member.isValid()) {
+		throw std::out_of_range("KsonBinView::at: key '" + std::string(key) + "' not found");
+	}
+	return member;
+}
+
+// at: index
+KsonBinView KsonBinView::at(size_t index) const {
+	if (tag() == KsonBinTag::ARRAY) {
+		KsonBinView elem = first();
+		for (size_t i = 0; i < index && elem.isValid(); ++i) {
+			elem = elem.next();
+		}
+		if (elem.isValid()) return elem;
+	}
+	throw std::out_of_range("KsonBinView::at: index " + std::to_string(index) + " out of range");
+}
+
+// accept
+bool KsonBinView::accept(KsonHandler& handler) const {
+	return m_p && acceptValue(handler, 0);
+}
+
+// readBody
+bool KsonBinView::readBody(const char*& body, const char*& bodyEnd, uint64_t& count) const {
+	KsonBinTag t = tag();
+	if (t != KsonBinTag::OBJECT && t != KsonBinTag::ARRAY) return false;
+
+	uint64_t len;
+	if (!readValue(m_p, m_end, t, body, len, bodyEnd)) return false;
+	return readVarint(body, bodyEnd, count);
+}
+
+// child: object 的成员先读取 key
+KsonBinView KsonBinView::child(const char* p, const char* end, bool isObject) const {
+	const char* key = nullptr;
+	uint64_t keyLen = 0;
+	if (isObject) {
+		if (!readVarint(p, end, keyLen) || keyLen > static_cast<uint64_t>(end - p) || keyLen > UINT32_MAX) return KsonBinView();
+		key = p;
+		p += keyLen;
+	}
+
+	// 定长类型在这里检查边界，之后读取时不再检查
+	KsonBinTag t;
+	const char* content;
+	const char* next;
+	uint64_t len;
+	if (!readValue(p, end, t, content, len, next)) return KsonBinView();
+	return KsonBinView(p, end, key, static_cast<uint32_t>(keyLen));
+}
+
+// acceptValue
+bool KsonBinView::acceptValue(KsonHandler& handler, int depth) const {
+	switch (tag()) {
+	case KsonBinTag::NUL:
+		return handler.null();
+
+	case KsonBinTag::BOOL_FALSE:
+	case KsonBinTag::BOOL_TRUE:
+		return handler.boolean(getBool());
+
+	case KsonBinTag::INT8:
+	case KsonBinTag::INT16:
+	case KsonBinTag::INT32:
+	case KsonBinTag::INT64:
+		return handler.integer(getInt());
+
+	case KsonBinTag::DOUBLE:
+		return handler.floating(getDouble());
+
+	case KsonBinTag::STRING: {
+		std::string_view str = strView();
+		return handler.string(str.data(), str.size());
+	}
+
+	default:
+		break;
+	}
+
+	// object / array：元素必须恰好填满 body
+	const char* body;
+	const char* bodyEnd;
+	uint64_t count;
+	if (depth >= KSON_BIN_MAX_DEPTH || !readBody(body, bodyEnd, count)) return false;
+
+	bool isObject = tag() == KsonBinTag::OBJECT;
+	if (!(isObject ? handler.startObject() : handler.startArray())) return false;
+
+	const char* p = body;
+	for (uint64_t i = 0; i < count; ++i) {
+		KsonBinView elem = child(p, bodyEnd, isObject);
+		if (!elem.isValid()) return false;
+		if (isObject && !handler.key(elem.m_key, elem.m_keyLen)) return false;
+		if (!elem.acceptValue(handler, depth + 1)) return false;
+
+		KsonBinTag t;
+		const char* content;
+		uint64_t len;
+		readValue(elem.m_p, bodyEnd, t, content, len, p);
+	}
+	if (p != bodyEnd) return false;
+
+	return isObject ? handler.endObject() : handler.endArray();
+}
+
+//============================================================
+//  ksonBinDocument
+//============================================================
+
+// load
+bool KsonBinDocument::load(const std::string& file) {
+	m_error.clear();
+	m_copy.clear();
+	m_root = KsonBinView();
+	if (!m_buf.load(file, m_error)) return false;
+	return openRoot(m_buf.data(), m_buf.size());
+}
+
+// open
+bool KsonBinDocument::open(const char* data, size_t size) {
+	m_error.clear();
+	m_buf.clear();
+	m_copy.clear();
+	return openRoot(data, size);
+}
+
+// open: 保存 bin
+bool KsonBinDocument::open(std::string&& bin) {
+	m_error.clear();
+	m_buf.clear();
+	m_copy = std::move(bin);
+	return openRoot(m_copy.data(), m_copy.size());
+}
+
+// decode
+std::pair<bool, KsonObject> KsonBinDocument::decode() {
+	KsonDomHandler handler;
+	if (!m_root.accept(handler)) {
+		if (m_error.empty()) m_error += "kson binary is corrupted.\n";
+		return { false, KsonObject() };
+	}
+	return { true, handler.release() };
+}
+
+// openRoot: 检查文件头和根 object 的长度
+bool KsonBinDocument::openRoot(const char* data, size_t size) {
+	m_root = KsonBinView();
+	if (size < KSON_BIN_HEADER_SIZE || std::memcmp(data, KSON_BIN_MAGIC, 3) != 0) {
+		m_error += "not a kson binary.\n";
+		return false;
+	}
+	if (static_cast<unsigned char>(data[3]) != KSON_BIN_VERSION) {
+		m_error += "unsupported kson binary version: " + std::to_string(static_cast<unsigned char>(data[3])) + ".\n";
+		return false;
+	}
+
+	const char* end = data + size;
+	KsonBinView root(data + KSON_BIN_HEADER_SIZE, end, nullptr, 0);
+	KsonBinTag tag;
+	const char* content;
+	const char* next;
+	uint64_t len;
+	if (!readValue(root.m_p, end, tag, content, len, next) || tag != KsonBinTag::OBJECT || next != end) {
+		m_error += "kson binary is corrupted: root must be an object filling the whole buffer.\n";
+		return false;
+	}
+	m_root = root;
+	return true;
+}
+
+// decodeKsonBin
+std::pair<bool, KsonObject> kson::decodeKsonBin(const char* data, size_t size) {
+	KsonBinDocument doc;
+	if (!doc.open(data, size)) return { false, KsonObject() };
+	return doc.decode();
+}
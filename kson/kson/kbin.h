@@ -0,0 +1,163 @@
+﻿#ifndef __K_BIN_H__
+#define __K_BIN_H__
+
+#include "kson.h"
+#include <cstdint>
+#include <string_view>
+
+//============================================================
+//  ksonBinary: kson 数据的二进制编码
+//============================================================
+
+// 重复加载同一份大文档时，保存为二进制编码可以省去词法分析和数值转换，并且可以不解码直接读取
+//
+// 格式（所有整数为小端序，varint 为 LEB128 无符号变长整数）：
+//
+//     文件     = "KSB" 版本号(1 字节, 当前为 1)  value(根 object)
+//     value    = tag(1 字节)  内容
+//     NUL / BOOL_FALSE / BOOL_TRUE         没有内容
+//     INT8 / INT16 / INT32 / INT64         1 / 2 / 4 / 8 字节有符号整数（编码时选择能容纳的最短宽度）
+//     DOUBLE                               8 字节 IEEE 754
+//     STRING                               varint(字节数)  字节
+//     ARRAY                                varint(body 字节数)  body = varint(元素个数)  value...
+//     OBJECT                               varint(body 字节数)  body = varint(成员个数)  (varint(key 字节数) key value)...
+//
+// object 的成员按 key 排序（与 KsonObject 的遍历顺序相同）；object 和 array 带有 body 的字节数，读取时可以直接跳过整个子树
+//
+//     std::string bin = encodeKsonBin(obj);          // 编码
+//     auto dom = decodeKsonBin(bin.data(), bin.size()); // 解码为 KsonObject
+//
+//     KsonBinDocument doc;                           // 直接读取（文件只做映射，不解码）
+//     if (doc.load("config.ksb")) use(doc.root().at("server").at("port").getInt());
+
+namespace kson {
+
+	enum class KsonBinTag : unsigned char {
+		NUL,
+		BOOL_FALSE,
+		BOOL_TRUE,
+		INT8,
+		INT16,
+		INT32,
+		INT64,
+		DOUBLE,
+		STRING,
+		ARRAY,
+		OBJECT
+	};
+
+	const char KSON_BIN_MAGIC[] = "KSB";
+	const unsigned char KSON_BIN_VERSION = 1;
+	const size_t KSON_BIN_HEADER_SIZE = 4;
+
+	// 编码为二进制
+	std::string encodeKsonBin(const KsonObject& obj);
+
+	// 直接读取二进制编码中的一个值，不拷贝
+	// 读取接口与 KsonNode 相同；object 按 key 查找和 array 按 index 访问需要逐个跳过之前的元素（每个 O(1)）
+	// 每次读取都检查边界，编码损坏时返回无效的 view（isValid() 为 false，读取为空值），不会越界
+	class KsonBinView {
+	public:
+		KsonBinView() = default;
+
+		bool         isValid()   const { return m_p != nullptr; }
+
+		// 获取 KsonType，无效时为 NUL
+		KsonType     getType()   const;
+
+		// 获取值（类型不符时返回空值）
+		KsonStr      getStr()    const { std::string_view str = strView(); return KsonStr(str.data(), str.size()); }
+		KsonInt      getInt()    const;
+		KsonDouble   getDouble() const;
+		KsonBool     getBool()   const { return tag() == KsonBinTag::BOOL_TRUE; }
+		KsonNull     getNull()   const { return nullptr; }
+		bool         isInt()     const;
+
+		// 字符串，不复制；类型不符时为空字符串
+		std::string_view strView() const;
+
+		// 字符串长度，或 object/array 的元素个数
+		size_t       size()      const;
+
+		// object 的成员：所在 object 中的 key；其它情况为空字符串
+		std::string_view key()   const { return std::string_view(m_key, m_keyLen); }
+
+		// 遍历：第一个元素（或成员），下一个元素（或成员），没有时返回无效的 view
+		//
+		//     for (KsonBinView member = obj.first(); member.isValid(); member = member.next()) use(member.key(), member);
+		KsonBinView  first()     const;
+		KsonBinView  next()      const;
+
+		// object: 按 key 查找，不存在或类型不符时返回无效的 view
+		KsonBinView  find(std::string_view key) const;
+
+		// 按 key / index 访问，不存在或类型不符时抛出 std::out_of_range
+		KsonBinView  at(std::string_view key) const;
+		KsonBinView  at(size_t index) const;
+
+		// 按遍历顺序向 handler 发送事件，编码损坏时返回 false
+		bool accept(KsonHandler& handler) const;
+
+	private:
+		friend class KsonBinDocument;
+
+		KsonBinView(const char* p, const char* end, const char* key, uint32_t keyLen)
+			: m_p(p), m_end(end), m_key(key), m_keyLen(keyLen) {}
+
+		KsonBinTag tag() const { return m_p ? static_cast<KsonBinTag>(*m_p) : KsonBinTag::NUL; }
+
+		// 读取 object/array 的 body：[body, bodyEnd) 中第一个元素的位置和元素个数
+		bool readBody(const char*& body, const char*& bodyEnd, uint64_t& count) const;
+
+		// 位于 [p, end) 的第一个元素（或成员）
+		KsonBinView child(const char* p, const char* end, bool isObject) const;
+
+		bool acceptValue(KsonHandler& handler, int depth) const;
+
+	private:
+		const char*  m_p = nullptr;       // tag 的位置
+		const char*  m_end = nullptr;     // 所在容器 body 的结束位置
+		const char*  m_key = nullptr;     // 所在 object 中的 key（不是 object 成员时为 nullptr）
+		uint32_t     m_keyLen = 0;
+	};
+
+	// 二进制编码的文档：文件只做映射（或读入），不解码
+	class KsonBinDocument {
+	public:
+		KsonBinDocument() = default;
+		KsonBinDocument(const KsonBinDocument&) = delete;
+		KsonBinDocument& operator=(const KsonBinDocument&) = delete;
+
+		// 读入二进制文件
+		bool load(const std::string& file);
+
+		// 使用 data，不拷贝，调用者保证 data 在使用期间有效
+		bool open(const char* data, size_t size);
+
+		// 保存 bin
+		bool open(std::string&& bin);
+
+		// 根 object，打开失败时为无效的 view
+		KsonBinView root() const { return m_root; }
+
+		// 解码为 KsonObject
+		std::pair<bool, KsonObject> decode();
+
+		// 获取读取过程中的错误信息
+		std::string getErrorInfo() const { return m_error; }
+
+	private:
+		bool openRoot(const char* data, size_t size);
+
+	private:
+		KsonBuffer    m_buf;        // load() 读入的文件
+		std::string   m_copy;       // open(std::string&&) 保存的编码
+		KsonBinView   m_root;
+		std::string   m_error;
+	};
+
+	// 解码为 KsonObject，编码损坏时返回 false
+	std::pair<bool, KsonObject> decodeKsonBin(const char* data, size_t size);
+}
+
+#endif
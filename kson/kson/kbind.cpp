@@ -0,0 +1,213 @@
+﻿#include "stdafx.h"
+#include "kbind.h"
+
+using namespace kson;
+
+//============================================================
+//  ksonBindHandler
+//============================================================
+
+// reset
+void KsonBindHandler::reset(void* root, const KsonBindOps* ops) {
+	m_root = root;
+	m_rootOps = ops;
+	m_depth = 0;
+	m_skip = 0;
+	m_error.clear();
+}
+
+// startObject
+bool KsonBindHandler::startObject() {
+	return startContainer(true);
+}
+
+// key
+bool KsonBindHandler::key(const char* str, size_t len) {
+	if (m_skip > 0) return true;
+
+	// struct 中未声明的 key 得到 nullptr，它的 value 被跳过
+	Frame& frame = m_stack[m_depth - 1];
+	frame.m_key.assign(str, len);
+	frame.m_value = frame.m_ops->m_child(frame.m_obj, str, len, frame.m_valueOps);
+	return true;
+}
+
+// endObject
+bool KsonBindHandler::endObject() {
+	return endContainer();
+}
+
+// startArray
+bool KsonBindHandler::startArray() {
+	return startContainer(false);
+}
+
+// endArray
+bool KsonBindHandler::endArray() {
+	return endContainer();
+}
+
+// string
+bool KsonBindHandler::string(const char* str, size_t len) {
+	if (m_skip > 0) return true;
+	const KsonBindOps* ops = nullptr;
+	void* value = target(ops, false);
+	if (!value) return true;
+	if (!ops->m_string) return mismatch(ops, "string");
+	return ops->m_string(value, str, len);
+}
+
+// integer
+bool KsonBindHandler::integer(KsonInt num) {
+	if (m_skip > 0) return true;
+	const KsonBindOps* ops = nullptr;
+	void* value = target(ops, false);
+	if (!value) return true;
+	if (!ops->m_integer) return mismatch(ops, "integer");
+	if (!ops->m_integer(value, num)) return fail("integer " + std::to_string(num) + " out of range");
+	return true;
+}
+
+// floating
+bool KsonBindHandler::floating(double num) {
+	if (m_skip > 0) return true;
+	const KsonBindOps* ops = nullptr;
+	void* value = target(ops, false);
+	if (!value) return true;
+	if (!ops->m_floating) return mismatch(ops, "number");
+	return ops->m_floating(value, num);
+}
+
+// boolean
+bool KsonBindHandler::boolean(bool b) {
+	if (m_skip > 0) return true;
+	const KsonBindOps* ops = nullptr;
+	void* value = target(ops, false);
+	if (!value) return true;
+	if (!ops->m_boolean) return mismatch(ops, "bool");
+	return ops->m_boolean(value, b);
+}
+
+// null: 只能填充 optional（置空）
+bool KsonBindHandler::null() {
+	if (m_skip > 0) return true;
+	const KsonBindOps* ops = nullptr;
+	void* value = target(ops, true);
+	if (!value) return true;
+	if (ops->m_kind != KsonBindKind::OPTIONAL) return mismatch(ops, "null");
+	ops->m_clear(value);
+	return true;
+}
+
+// target
+void* KsonBindHandler::target(const KsonBindOps*& ops, bool isNull) {
+	void* value = nullptr;
+	if (m_depth == 0) {
+		value = m_root;
+		ops = m_rootOps;
+	}
+	else {
+		Frame& frame = m_stack[m_depth - 1];
+		if (frame.m_ops->m_kind == KsonBindKind::ARRAY) {
+			++frame.m_count;
+			value = frame.m_ops->m_child(frame.m_obj, nullptr, 0, ops);
+		}
+		else {
+			value = frame.m_value;
+			ops = frame.m_valueOps;
+		}
+	}
+
+	// optional 中构造值，由值的类型接收
+	if (!isNull) {
+		while (value && ops->m_kind == KsonBindKind::OPTIONAL) {
+			value = ops->m_child(value, nullptr, 0, ops);
+		}
+	}
+	return value;
+}
+
+// startContainer
+bool KsonBindHandler::startContainer(bool isObject) {
+	if (m_skip > 0) {
+		++m_skip;
+		return true;
+	}
+
+	const KsonBindOps* ops = nullptr;
+	void* value = target(ops, false);
+	if (!value) {
+		m_skip = 1;
+		return true;
+	}
+
+	bool isMatched = isObject
+		? ops->m_kind == KsonBindKind::STRUCT || ops->m_kind == KsonBindKind::MAP
+		: ops->m_kind == KsonBindKind::ARRAY;
+	if (!isMatched) return mismatch(ops, isObject ? "object" : "array");
+	if (ops->m_clear) ops->m_clear(value);
+
+	if (m_depth == m_stack.size()) m_stack.emplace_back();
+	Frame& frame = m_stack[m_depth++];
+	frame.m_obj = value;
+	frame.m_ops = ops;
+	frame.m_value = nullptr;
+	frame.m_valueOps = nullptr;
+	frame.m_count = 0;
+	frame.m_key.clear();
+	return true;
+}
+
+// endContainer
+bool KsonBindHandler::endContainer() {
+	if (m_skip > 0) {
+		--m_skip;
+	}
+	else {
+		--m_depth;
+	}
+	return true;
+}
+
+// mismatch
+bool KsonBindHandler::mismatch(const KsonBindOps* ops, const char* got) {
+	return fail(std::string("expect ") + ops->m_name + ", got " + got);
+}
+
+// fail: 位置形如 servers[2].limits.qps
+bool KsonBindHandler::fail(const std::string& reason) {
+	std::string path;
+	for (size_t i = 0; i < m_depth; ++i) {
+		const Frame& frame = m_stack[i];
+		if (frame.m_ops->m_kind == KsonBindKind::ARRAY) {
+			path += "[" + std::to_string(frame.m_count - 1) + "]";
+		}
+		else if (!frame.m_key.empty()) {
+			if (!path.empty()) path += '.';
+			path += frame.m_key;
+		}
+	}
+	m_error = (path.empty() ? std::string("root") : path) + ": " + reason;
+	return false;
+}
+
+//============================================================
+//  ksonBinder
+//============================================================
+
+// parse
+bool KsonBinder::parse(KsonBuffer&& buf, void* root, const KsonBindOps* ops) {
+	m_error.clear();
+	m_handler.reset(root, ops);
+
+	Kson kson(std::move(buf));
+	KsonError error;
+	if (kson.parse(m_handler, error)) return true;
+
+	// 类型不符时先给出原因，再给出解析器停止的位置
+	if (!m_handler.getErrorInfo().empty()) {
+		m_error = m_handler.getErrorInfo() + "\n";
+	}
+	m_error += kson.getErrorInfo();
+	return false;
+}
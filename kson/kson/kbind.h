@@ -0,0 +1,317 @@
+﻿#ifndef __K_BIND_H__
+#define __K_BIND_H__
+
+#include "kson.h"
+#include <cstring>
+#include <limits>
+#include <map>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+//============================================================
+//  ksonBinder: 解析时直接填充 C++ 结构体
+//============================================================
+
+// 用 KSON_BIND 声明结构体的成员和对应的 key，与结构体写在同一个命名空间中（由 ADL 查找）：
+//
+//     struct Limits { int qps = 0; std::optional<int> burst; };
+//     struct Server { std::string host; int port = 0; std::vector<std::string> tags; std::optional<Limits> limits; };
+//     KSON_BIND(Limits, KSON_FIELD(qps), KSON_FIELD(burst))
+//     KSON_BIND(Server, KSON_FIELD(host), KSON_FIELD_AS(port, "listen_port"), KSON_FIELD(tags), KSON_FIELD(limits))
+//
+//     Server server;
+//     KsonBinder binder;
+//     if (!binder.parse(ksonStr, server)) std::cout << binder.getErrorInfo();
+//
+// 解析器的事件直接写入成员，不构建 KsonObject；key 与成员的匹配在编译期展开为按长度和内容的逐个比较
+// 支持的类型：bool、整数（检查范围）、浮点数、std::string、已绑定的结构体、std::vector、std::optional、
+// key 为 std::string 的 std::map / std::unordered_map
+// 没有出现的成员保持原值；未声明的 key 连同它的 value（包括其中的 object/array）一起跳过；类型不符或整数超出范围时解析失败
+
+// 声明 Type 的成员，参数为 KSON_FIELD / KSON_FIELD_AS
+#define KSON_BIND(Type, ...) \
+	inline constexpr auto ksonBindFields(Type*) { \
+		using KsonBoundType = Type; \
+		return std::make_tuple(__VA_ARGS__); \
+	}
+
+// 成员名即 key
+#define KSON_FIELD(member) ::kson::makeKsonField(#member, &KsonBoundType::member)
+
+// 指定 key
+#define KSON_FIELD_AS(member, key) ::kson::makeKsonField(key, &KsonBoundType::member)
+
+namespace kson {
+
+	enum class KsonBindKind : unsigned char {
+		SCALAR,     // bool / 整数 / 浮点数 / 字符串
+		STRUCT,     // 已绑定的结构体
+		ARRAY,      // std::vector
+		MAP,        // std::map / std::unordered_map
+		OPTIONAL    // std::optional
+	};
+
+	// 一种类型的绑定操作，每种类型一份静态的表
+	struct KsonBindOps {
+		KsonBindKind  m_kind;
+		const char*   m_name;   // 错误信息中的类型名
+
+		// 标量：超出范围时返回 false；为 nullptr 表示不接受这种值
+		bool (*m_integer)(void* obj, KsonInt value);
+		bool (*m_floating)(void* obj, double value);
+		bool (*m_boolean)(void* obj, bool value);
+		bool (*m_string)(void* obj, const char* str, size_t len);
+
+		// STRUCT: 按 key 查找成员，没有时返回 nullptr；MAP: 插入 key 对应的值；ARRAY: 追加一个元素；OPTIONAL: 构造值
+		// 返回值的位置，ops 设为值的类型
+		void* (*m_child)(void* obj, const char* key, size_t len, const KsonBindOps*& ops);
+
+		// ARRAY / MAP: 开始填充前清空；OPTIONAL: 遇到 null 时置空
+		void (*m_clear)(void* obj);
+	};
+
+	// 结构体的一个成员
+	template<typename T, typename M>
+	struct KsonField {
+		using member_type = M;
+
+		const char*  m_key;
+		size_t       m_len;
+		M T::*       m_member;
+	};
+
+	template<typename T, typename M, size_t N>
+	constexpr KsonField<T, M> makeKsonField(const char (&key)[N], M T::* member) {
+		return KsonField<T, M>{ key, N - 1, member };
+	}
+
+	// 类型 T 的绑定操作，不支持的类型在编译时报错
+	template<typename T, typename = void>
+	struct KsonBindTraits {
+		static_assert(sizeof(T) == 0, "kson: type is not bindable, declare it with KSON_BIND");
+	};
+
+	// 已绑定的结构体的成员列表（编译期常量）
+	template<typename T>
+	inline constexpr auto s_ksonFields = ksonBindFields(static_cast<T*>(nullptr));
+
+	// 按 key 查找成员：展开为每个成员一次长度比较和内容比较
+	template<typename T, size_t... I>
+	void* findKsonField(T& obj, const char* key, size_t len, const KsonBindOps*& ops, std::index_sequence<I...>) {
+		void* found = nullptr;
+		(void)((std::get<I>(s_ksonFields<T>).m_len == len
+			&& std::memcmp(std::get<I>(s_ksonFields<T>).m_key, key, len) == 0
+			&& (found = &(obj.*(std::get<I>(s_ksonFields<T>).m_member)),
+				ops = KsonBindTraits<typename std::tuple_element_t<I, std::decay_t<decltype(s_ksonFields<T>)>>::member_type>::ops(),
+				true)) || ...);
+		return found;
+	}
+
+	// bool
+	template<>
+	struct KsonBindTraits<bool> {
+		static bool boolean(void* obj, bool value) {
+			*static_cast<bool*>(obj) = value;
+			return true;
+		}
+		static constexpr KsonBindOps s_ops = { KsonBindKind::SCALAR, "bool", nullptr, nullptr, &boolean, nullptr, nullptr, nullptr };
+		static const KsonBindOps* ops() { return &s_ops; }
+	};
+
+	// 整数：超出 T 的范围时失败
+	template<typename T>
+	struct KsonBindTraits<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>> {
+		static bool integer(void* obj, KsonInt value) {
+			if constexpr (std::is_signed<T>::value) {
+				if (value < static_cast<KsonInt>(std::numeric_limits<T>::min()) || value > static_cast<KsonInt>(std::numeric_limits<T>::max())) return false;
+			}
+			else {
+				if (value < 0 || static_cast<uint64_t>(value) > static_cast<uint64_t>(std::numeric_limits<T>::max())) return false;
+			}
+			*static_cast<T*>(obj) = static_cast<T>(value);
+			return true;
+		}
+		static constexpr KsonBindOps s_ops = { KsonBindKind::SCALAR, "integer", &integer, nullptr, nullptr, nullptr, nullptr, nullptr };
+		static const KsonBindOps* ops() { return &s_ops; }
+	};
+
+	// 浮点数：也接受整数
+	template<typename T>
+	struct KsonBindTraits<T, std::enable_if_t<std::is_floating_point<T>::value>> {
+		static bool integer(void* obj, KsonInt value) {
+			*static_cast<T*>(obj) = static_cast<T>(value);
+			return true;
+		}
+		static bool floating(void* obj, double value) {
+			*static_cast<T*>(obj) = static_cast<T>(value);
+			return true;
+		}
+		static constexpr KsonBindOps s_ops = { KsonBindKind::SCALAR, "number", &integer, &floating, nullptr, nullptr, nullptr, nullptr };
+		static const KsonBindOps* ops() { return &s_ops; }
+	};
+
+	// std::string
+	template<>
+	struct KsonBindTraits<std::string> {
+		static bool string(void* obj, const char* str, size_t len) {
+			static_cast<std::string*>(obj)->assign(str, len);
+			return true;
+		}
+		static constexpr KsonBindOps s_ops = { KsonBindKind::SCALAR, "string", nullptr, nullptr, nullptr, &string, nullptr, nullptr };
+		static const KsonBindOps* ops() { return &s_ops; }
+	};
+
+	// 已绑定的结构体
+	template<typename T>
+	struct KsonBindTraits<T, std::void_t<decltype(ksonBindFields(static_cast<T*>(nullptr)))>> {
+		static void* child(void* obj, const char* key, size_t len, const KsonBindOps*& ops) {
+			constexpr size_t count = std::tuple_size<std::decay_t<decltype(s_ksonFields<T>)>>::value;
+			return findKsonField(*static_cast<T*>(obj), key, len, ops, std::make_index_sequence<count>());
+		}
+		static constexpr KsonBindOps s_ops = { KsonBindKind::STRUCT, "object", nullptr, nullptr, nullptr, nullptr, &child, nullptr };
+		static const KsonBindOps* ops() { return &s_ops; }
+	};
+
+	// std::vector
+	template<typename T, typename A>
+	struct KsonBindTraits<std::vector<T, A>> {
+		static void* child(void* obj, const char* key, size_t len, const KsonBindOps*& ops) {
+			auto& vec = *static_cast<std::vector<T, A>*>(obj);
+			vec.emplace_back();
+			ops = KsonBindTraits<T>::ops();
+			return &vec.back();
+		}
+		static void clear(void* obj) { static_cast<std::vector<T, A>*>(obj)->clear(); }
+		static constexpr KsonBindOps s_ops = { KsonBindKind::ARRAY, "array", nullptr, nullptr, nullptr, nullptr, &child, &clear };
+		static const KsonBindOps* ops() { return &s_ops; }
+	};
+
+	// std::optional
+	template<typename T>
+	struct KsonBindTraits<std::optional<T>> {
+		static void* child(void* obj, const char* key, size_t len, const KsonBindOps*& ops) {
+			auto& opt = *static_cast<std::optional<T>*>(obj);
+			opt.emplace();
+			ops = KsonBindTraits<T>::ops();
+			return &*opt;
+		}
+		static void clear(void* obj) { static_cast<std::optional<T>*>(obj)->reset(); }
+		static constexpr KsonBindOps s_ops = { KsonBindKind::OPTIONAL, "optional", nullptr, nullptr, nullptr, nullptr, &child, &clear };
+		static const KsonBindOps* ops() { return &s_ops; }
+	};
+
+	// std::map / std::unordered_map：重复的 key 取最后一个（与 KsonObject 相同）
+	template<typename Map>
+	struct KsonBindMapTraits {
+		static void* child(void* obj, const char* key, size_t len, const KsonBindOps*& ops) {
+			auto& value = (*static_cast<Map*>(obj))[std::string(key, len)];
+			value = typename Map::mapped_type();
+			ops = KsonBindTraits<typename Map::mapped_type>::ops();
+			return &value;
+		}
+		static void clear(void* obj) { static_cast<Map*>(obj)->clear(); }
+		static constexpr KsonBindOps s_ops = { KsonBindKind::MAP, "object", nullptr, nullptr, nullptr, nullptr, &child, &clear };
+		static const KsonBindOps* ops() { return &s_ops; }
+	};
+
+	template<typename T, typename C, typename A>
+	struct KsonBindTraits<std::map<std::string, T, C, A>> : KsonBindMapTraits<std::map<std::string, T, C, A>> {};
+
+	template<typename T, typename H, typename E, typename A>
+	struct KsonBindTraits<std::unordered_map<std::string, T, H, E, A>> : KsonBindMapTraits<std::unordered_map<std::string, T, H, E, A>> {};
+
+	// 由事件填充绑定的对象（KsonBinder 使用）
+	class KsonBindHandler : public KsonHandler {
+	public:
+
+		// 根 object 填充到 root
+		void reset(void* root, const KsonBindOps* ops);
+
+		bool startObject() override;
+		bool key(const char* str, size_t len) override;
+		bool endObject() override;
+		bool startArray() override;
+		bool endArray() override;
+		bool string(const char* str, size_t len) override;
+		bool integer(KsonInt value) override;
+		bool floating(double value) override;
+		bool boolean(bool value) override;
+		bool null() override;
+
+		// 类型不符或超出范围的位置和原因，例如 "servers[2].port: expect integer, got string"（array 中为元素的下标）
+		const std::string& getErrorInfo() const { return m_error; }
+
+	private:
+
+		// 正在填充的 object / array
+		struct Frame {
+			void*               m_obj;
+			const KsonBindOps*  m_ops;
+			void*               m_value;      // object: 最近的 key 对应的值，未声明的 key 为 nullptr
+			const KsonBindOps*  m_valueOps;
+			size_t              m_count;      // array: 已有的元素个数
+			std::string         m_key;        // object: 最近的 key（错误信息使用）
+		};
+
+		// 下一个 value 的位置（isNull 为 false 时构造 optional 中的值），需要跳过时返回 nullptr
+		void* target(const KsonBindOps*& ops, bool isNull);
+
+		bool startContainer(bool isObject);
+		bool endContainer();
+
+		// 记录错误（加上当前位置），返回 false
+		bool mismatch(const KsonBindOps* ops, const char* got);
+		bool fail(const std::string& reason);
+
+	private:
+		std::vector<Frame>   m_stack;         // 弹出时不释放，m_stack[0, m_depth) 为正在填充的层，各层的 m_key 重复使用
+		size_t               m_depth = 0;
+		void*                m_root = nullptr;
+		const KsonBindOps*   m_rootOps = nullptr;
+		size_t               m_skip = 0;      // 正在跳过的 object / array 层数（未声明的 key 的 value）
+		std::string          m_error;
+	};
+
+	class KsonBinder {
+	public:
+
+		// 解析 kson 字符串，直接填充 out（根 object 对应结构体或 map）
+		template<typename T>
+		bool parse(const std::string& ksonStr, T& out) {
+			static_assert(KsonBindTraits<T>::s_ops.m_kind == KsonBindKind::STRUCT || KsonBindTraits<T>::s_ops.m_kind == KsonBindKind::MAP,
+				"kson: the root of a document is an object");
+			KsonBuffer buf;
+			buf.borrow(ksonStr.data(), ksonStr.size());
+			return parse(std::move(buf), &out, KsonBindTraits<T>::ops());
+		}
+
+		// 解析 kson 文件
+		template<typename T>
+		bool load(const std::string& file, T& out) {
+			static_assert(KsonBindTraits<T>::s_ops.m_kind == KsonBindKind::STRUCT || KsonBindTraits<T>::s_ops.m_kind == KsonBindKind::MAP,
+				"kson: the root of a document is an object");
+			m_error.clear();
+			KsonBuffer buf;
+			if (!buf.load(file, m_error)) {
+				m_error += "\n";
+				return false;
+			}
+			return parse(std::move(buf), &out, KsonBindTraits<T>::ops());
+		}
+
+		// 获取解析过程中的错误信息：类型不符的位置和原因，以及解析器的错误信息
+		std::string getErrorInfo() const { return m_error; }
+
+	private:
+		bool parse(KsonBuffer&& buf, void* root, const KsonBindOps* ops);
+
+	private:
+		KsonBindHandler  m_handler;
+		std::string      m_error;
+	};
+}
+
+#endif
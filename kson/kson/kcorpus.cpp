@@ -0,0 +1,320 @@
+﻿#include "stdafx.h"
+#include "kcorpus.h"
+
+using namespace kson;
+
+//============================================================
+//  ksonCorpus
+//============================================================
+
+// generate
+std::string KsonCorpus::generate(KsonCorpusType type, size_t size) {
+	std::string out;
+	out.reserve(size + 256);
+	switch (type) {
+	case KsonCorpusType::DEEP:      genDeep(out, size); break;
+	case KsonCorpusType::WIDE:      genWide(out, size); break;
+	case KsonCorpusType::RECORDS:   genRecords(out, size); break;
+	case KsonCorpusType::STRINGS:   genStrings(out, size); break;
+	case KsonCorpusType::NUMBERS:   genNumbers(out, size); break;
+	case KsonCorpusType::COMMENTS:  genComments(out, size); break;
+	default:                        genSpaces(out, size); break;
+	}
+	return out;
+}
+
+// generate: 多个文档
+std::vector<std::string> KsonCorpus::generate(KsonCorpusType type, size_t docSize, size_t totalSize) {
+	std::vector<std::string> docs;
+	size_t total = 0;
+	do {
+		docs.push_back(generate(type, docSize));
+		total += docs.back().size();
+	} while (total < totalSize);
+	return docs;
+}
+
+// getName
+const char* KsonCorpus::getName(KsonCorpusType type) {
+	switch (type) {
+	case KsonCorpusType::DEEP:      return "deep";
+	case KsonCorpusType::WIDE:      return "wide";
+	case KsonCorpusType::RECORDS:   return "records";
+	case KsonCorpusType::STRINGS:   return "strings";
+	case KsonCorpusType::NUMBERS:   return "numbers";
+	case KsonCorpusType::COMMENTS:  return "comments";
+	default:                        return "spaces";
+	}
+}
+
+// findType
+bool KsonCorpus::findType(const std::string& name, KsonCorpusType& type) {
+	for (KsonCorpusType t : allTypes()) {
+		if (name == getName(t)) {
+			type = t;
+			return true;
+		}
+	}
+	return false;
+}
+
+// allTypes
+std::vector<KsonCorpusType> KsonCorpus::allTypes() {
+	return {
+		KsonCorpusType::DEEP, KsonCorpusType::WIDE, KsonCorpusType::RECORDS, KsonCorpusType::STRINGS,
+		KsonCorpusType::NUMBERS, KsonCorpusType::COMMENTS, KsonCorpusType::SPACES
+	};
+}
+
+// genDeep: { chains: [ { s: 1, n: [ "x", { s: true, n: ... } ] }, ... ] }
+void KsonCorpus::genDeep(std::string& out, size_t size) {
+	out += "{ chains: [";
+	std::vector<char> closes;
+	do {
+		out += out.back() == '[' ? "\n" : ",\n";
+		int depth = 64 + next(192);
+		for (int i = 0; i < depth; ++i) {
+			if (i % 2 == 0) {
+				out += "{ s: ";
+				addScalar(out);
+				out += ", n: ";
+				closes.push_back('}');
+			}
+			else {
+				out += "[ ";
+				addScalar(out);
+				out += ", ";
+				closes.push_back(']');
+			}
+		}
+		addScalar(out);
+		while (!closes.empty()) {
+			out += ' ';
+			out += closes.back();
+			closes.pop_back();
+		}
+	} while (out.size() < size);
+	out += "\n] }\n";
+}
+
+// genWide: { o0: { k..: v, ... 上千个成员 }, o1: { ... } }
+void KsonCorpus::genWide(std::string& out, size_t size) {
+	out += "{";
+	int objects = 0;
+	do {
+		out += objects == 0 ? "\n" : ",\n";
+		out += "    o" + std::to_string(objects++) + ": {";
+		int members = 1000 + next(1000);
+		for (int i = 0; i < members && out.size() < size; ++i) {
+			out += i == 0 ? " " : ", ";
+			addKey(out);
+			out += "_" + std::to_string(i) + ": ";
+			addScalar(out);
+		}
+		out += " }";
+	} while (out.size() < size);
+	out += "\n}\n";
+}
+
+// genRecords: { records: [ { id: 0, name: "...", ... }, ... ] }
+void KsonCorpus::genRecords(std::string& out, size_t size) {
+	out += "{\n    records: [\n";
+	for (int i = 0; ; ++i) {
+		out += "        { id: " + std::to_string(i) + ", name: \"";
+		addStr(out, 8 + next(16), false);
+		out += "\", enable: ";
+		out += next(2) ? "true" : "false";
+		out += ", weight: ";
+		addNum(out);
+		out += ", parent: null, tags: [\"";
+		addStr(out, 1 + next(6), false);
+		out += "\", \"";
+		addStr(out, 1 + next(6), false);
+		out += "\", " + std::to_string(next(100));
+		out += "], limit: { qps: " + std::to_string(next(100000)) + ", burst: 0x";
+		out += "0123456789abcdef"[next(16)];
+		out += "f } }";
+		if (out.size() >= size) break;
+		out += ",\n";
+	}
+	out += "\n    ]\n}\n";
+}
+
+// genStrings: { users: [ { user_name: "...", bio: "...", ... }, ... ] }
+void KsonCorpus::genStrings(std::string& out, size_t size) {
+	out += "{\n    users: [\n";
+	while (true) {
+		out += "        { user_name: \"";
+		addStr(out, 6 + next(10), false);
+		out += "\", email: \"";
+		addStr(out, 6 + next(10), false);
+		out += "@example.com\", bio: \"";
+		bool isEscaped = next(20) == 0;
+		addStr(out, 40 + next(200), isEscaped);
+		out += "\", city: \"";
+		addStr(out, 4 + next(12), false);
+		out += "\" }";
+		if (out.size() >= size) break;
+		out += ",\n";
+	}
+	out += "\n    ]\n}\n";
+}
+
+// genNumbers: { numbers: [ ... ] }，每行 8 个数值
+void KsonCorpus::genNumbers(std::string& out, size_t size) {
+	out += "{\n    numbers: [\n        ";
+	for (int i = 1; ; ++i) {
+		addNum(out);
+		if (out.size() >= size) break;
+		out += i % 8 ? ", " : ",\n        ";
+	}
+	out += "\n    ]\n}\n";
+}
+
+// genComments: 成员之前有行注释或块注释，部分 value 之后也有
+void KsonCorpus::genComments(std::string& out, size_t size) {
+	out += "// generated by KsonCorpus\n{\n    /* items */\n    items: [\n";
+	while (true) {
+		out += "        {\n";
+		for (int i = 0, members = 3 + next(5); i < members; ++i) {
+			if (next(2)) {
+				out += "            // ";
+				addStr(out, 10 + next(50), false);
+				out += "\n";
+			}
+			else {
+				out += "            /* ";
+				addStr(out, 10 + next(50), false);
+				out += next(3) ? " */\n" : "\n               * continued\n               */\n";
+			}
+			out += "            ";
+			addKey(out);
+			out += ": ";
+			addScalar(out);
+			out += i + 1 < members ? "," : "";
+			out += next(3) == 0 ? "   /* trailing */\n" : "\n";
+		}
+		out += "        }";
+		if (out.size() >= size) break;
+		out += ",\n";
+	}
+	out += "\n    ]\n}\n";
+}
+
+// genSpaces: 记号之间是随机长度的空格、制表符和空行
+void KsonCorpus::genSpaces(std::string& out, size_t size) {
+	out += "{";
+	addSpace(out, 64);
+	out += "rows";
+	addSpace(out, 16);
+	out += ":";
+	addSpace(out, 16);
+	out += "[";
+	while (true) {
+		addSpace(out, 64);
+		out += "{";
+		for (int i = 0, members = 2 + next(4); i < members; ++i) {
+			addSpace(out, 48);
+			addKey(out);
+			addSpace(out, 16);
+			out += ":";
+			addSpace(out, 16);
+			addScalar(out);
+			addSpace(out, 48);
+			if (i + 1 < members) out += ",";
+		}
+		out += "}";
+		if (out.size() >= size) break;
+		addSpace(out, 32);
+		out += ",";
+	}
+	addSpace(out, 64);
+	out += "]";
+	addSpace(out, 64);
+	out += "}\n";
+}
+
+// addKey
+void KsonCorpus::addKey(std::string& out) {
+	static const char* const words[] = {
+		"id", "name", "value", "count", "enable", "user", "limit", "type", "level", "ratio", "path", "host", "port", "flags"
+	};
+	out += words[next(sizeof(words) / sizeof(words[0]))];
+	if (next(2)) {
+		out += '_';
+		out += static_cast<char>('a' + next(26));
+	}
+}
+
+// addStr: 字母、数字、空格和标点，isEscaped 为 true 时插入若干 \" \\ \n \t
+void KsonCorpus::addStr(std::string& out, size_t len, bool isEscaped) {
+	static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789     ,.-_";
+	static const char* const escapes[] = { "\\\"", "\\\\", "\\n", "\\t" };
+	for (size_t i = 0; i < len; ++i) {
+		if (isEscaped && next(16) == 0) {
+			out += escapes[next(4)];
+		}
+		else {
+			out += chars[next(sizeof(chars) - 1)];
+		}
+	}
+}
+
+// addNum: 整数、两位小数、带指数的小数、负数、十六进制
+void KsonCorpus::addNum(std::string& out) {
+	switch (next(5)) {
+	case 0:
+		out += std::to_string(next(1000000));
+		break;
+	case 1:
+		out += "-" + std::to_string(1 + next(1000000000));
+		break;
+	case 2:
+		out += std::to_string(next(100000));
+		out += "." + std::to_string(10 + next(90));
+		break;
+	case 3:
+		out += std::to_string(1 + next(9));
+		out += "." + std::to_string(next(100000000));
+		out += "e" + std::to_string(static_cast<int>(next(61)) - 30);
+		break;
+	default: {
+		static const char hex[] = "0123456789abcdef";
+		out += "0x";
+		for (int i = 0, len = 1 + next(8); i < len; ++i) {
+			out += hex[next(16)];
+		}
+		break;
+	}
+	}
+}
+
+// addScalar
+void KsonCorpus::addScalar(std::string& out) {
+	switch (next(6)) {
+	case 0:
+	case 1:
+		out += '"';
+		addStr(out, 1 + next(24), false);
+		out += '"';
+		break;
+	case 2:
+	case 3:
+		addNum(out);
+		break;
+	case 4:
+		out += next(2) ? "true" : "false";
+		break;
+	default:
+		out += "null";
+		break;
+	}
+}
+
+// addSpace
+void KsonCorpus::addSpace(std::string& out, size_t maxLen) {
+	static const char spaces[] = "        \t\n\r\n";
+	for (size_t i = 0, len = 1 + next(static_cast<uint32_t>(maxLen)); i < len; ++i) {
+		out += spaces[next(sizeof(spaces) - 1)];
+	}
+}
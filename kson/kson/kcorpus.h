@@ -0,0 +1,73 @@
+﻿#ifndef __K_CORPUS_H__
+#define __K_CORPUS_H__
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+//============================================================
+//  ksonCorpus: 由种子生成的 kson 测试语料
+//============================================================
+
+// 每种语料突出一类解析开销，同一个种子、同样的调用顺序在任何平台上生成相同的文本（只使用 std::mt19937 的输出，不使用分布类；每个表达式中最多取一次随机数，与求值顺序无关）
+//
+//     KsonCorpus corpus(42);
+//     std::vector<std::string> docs = corpus.generate(KsonCorpusType::RECORDS, 64 * 1024, 16 * 1024 * 1024);
+
+namespace kson {
+
+	enum class KsonCorpusType : unsigned char {
+		DEEP,       // 深度嵌套：每条链 64~255 层 object/array 交替
+		WIDE,       // 宽 object：每个 object 有上千个成员
+		RECORDS,    // 由 record 组成的数组
+		STRINGS,    // 以长字符串为主，约 5% 含有转义字符
+		NUMBERS,    // 以数值为主：整数、小数、指数、十六进制
+		COMMENTS,   // 成员之间有行注释和块注释
+		SPACES      // 记号之间有大段的空白（与 test_space.kson 类似）
+	};
+
+	class KsonCorpus {
+	public:
+		explicit KsonCorpus(uint32_t seed = 1) : m_rand(seed) {}
+
+		// 生成一个约 size 字节的文档（根 object）
+		std::string generate(KsonCorpusType type, size_t size);
+
+		// 生成总计约 totalSize 字节的文档，每个约 docSize 字节（至少一个）
+		std::vector<std::string> generate(KsonCorpusType type, size_t docSize, size_t totalSize);
+
+		// 语料的名称（小写，例如 "records"），以及由名称查找
+		static const char* getName(KsonCorpusType type);
+		static bool findType(const std::string& name, KsonCorpusType& type);
+
+		// 全部语料
+		static std::vector<KsonCorpusType> allTypes();
+
+	private:
+		void genDeep(std::string& out, size_t size);
+		void genWide(std::string& out, size_t size);
+		void genRecords(std::string& out, size_t size);
+		void genStrings(std::string& out, size_t size);
+		void genNumbers(std::string& out, size_t size);
+		void genComments(std::string& out, size_t size);
+		void genSpaces(std::string& out, size_t size);
+
+		// [0, n) 中的随机数
+		uint32_t next(uint32_t n) { return static_cast<uint32_t>(m_rand() % n); }
+
+		// 随机的 key（标识符）、字符串内容、数值文本、标量 value
+		void addKey(std::string& out);
+		void addStr(std::string& out, size_t len, bool isEscaped);
+		void addNum(std::string& out);
+		void addScalar(std::string& out);
+
+		// 一段随机的空白（至少一个字符）
+		void addSpace(std::string& out, size_t maxLen);
+
+	private:
+		std::mt19937 m_rand;
+	};
+}
+
+#endif
@@ -0,0 +1,484 @@
+﻿#include "stdafx.h"
+#include "kdoc.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <stdexcept>
+
+using namespace kson;
+
+namespace {
+
+	// key 的比较，与 std::string 的比较结果相同（使用符号表时相同的 key 地址相同）
+	int compareKey(const KsonMember& member1, const KsonMember& member2) {
+		if (member1.m_key == member2.m_key && member1.m_keyLen == member2.m_keyLen) return 0;
+		return member1.key().compare(member2.key());
+	}
+
+	// 成员不超过该个数时按 KsonKey 顺序比较指针
+	const uint32_t LINEAR_FIND_MAX = 16;
+}
+
+//============================================================
+//  ksonArena
+//============================================================
+
+// allocate
+void* KsonArena::allocate(size_t size, size_t align) {
+	size_t pad = m_ptr ? (align - reinterpret_cast<uintptr_t>(m_ptr) % align) % align : 0;
+	if (!m_ptr || size_t(m_end - m_ptr) < pad + size) {
+		nextBlock(size, align);
+		pad = 0;
+	}
+
+	char* p = m_ptr + pad;
+	m_ptr = p + size;
+	m_used += size;
+	return p;
+}
+
+// copyStr
+const char* KsonArena::copyStr(const char* str, size_t len) {
+	char* p = static_cast<char*>(allocate(len + 1, 1));
+	std::memcpy(p, str, len);
+	p[len] = '\0';
+	return p;
+}
+
+// reset
+void KsonArena::reset() {
+	m_current = 0;
+	m_used = 0;
+	if (m_blocks.empty()) {
+		m_ptr = m_end = nullptr;
+	}
+	else {
+		m_ptr = m_blocks[0].m_data;
+		m_end = m_ptr + m_blocks[0].m_size;
+	}
+}
+
+// release
+void KsonArena::release() {
+	for (auto& block : m_blocks) {
+		delete[] block.m_data;
+	}
+	m_blocks.clear();
+	m_capacity = 0;
+	reset();
+}
+
+// nextBlock: 新块的起始地址按 operator new 的方式对齐（不小于 alignof(std::max_align_t)）
+void KsonArena::nextBlock(size_t size, size_t align) {
+	size_t need = size + (align > alignof(std::max_align_t) ? align : 0);
+
+	// reset() 之后依次使用已有的块，放不下的块跳过
+	size_t idx = m_ptr ? m_current + 1 : 0;
+	while (idx < m_blocks.size() && m_blocks[idx].m_size < need) {
+		++idx;
+	}
+
+	if (idx == m_blocks.size()) {
+		size_t blockSize = m_blockSize;
+		for (size_t i = 0; i < m_blocks.size() && blockSize < 1024 * 1024; ++i) {
+			blockSize *= 2;
+		}
+		blockSize = std::max(blockSize, need);
+		m_blocks.push_back({ new char[blockSize], blockSize });
+		m_capacity += blockSize;
+	}
+
+	m_current = idx;
+	m_ptr = m_blocks[idx].m_data;
+	m_end = m_ptr + m_blocks[idx].m_size;
+
+	size_t pad = (align - reinterpret_cast<uintptr_t>(m_ptr) % align) % align;
+	m_ptr += pad;
+}
+
+
+//============================================================
+//  ksonKeyTable
+//============================================================
+
+// find
+const char* KsonKeyTable::find(const char* str, size_t len) const {
+	if (m_entries.empty()) return nullptr;
+	return m_entries[probe(str, len, hash(str, len))].m_str;
+}
+
+// intern
+const char* KsonKeyTable::intern(const char* str, size_t len, bool copy) {
+	if ((m_size + 1) * 2 > m_entries.size()) {
+		grow();
+	}
+
+	uint32_t h = hash(str, len);
+	Entry& entry = m_entries[probe(str, len, h)];
+	if (!entry.m_str) {
+		entry = { copy ? m_arena.copyStr(str, len) : str, static_cast<uint32_t>(len), h };
+		++m_size;
+	}
+	return entry.m_str;
+}
+
+// clear
+void KsonKeyTable::clear() {
+	if (m_size == 0) return;
+	std::fill(m_entries.begin(), m_entries.end(), Entry{ nullptr, 0, 0 });
+	m_size = 0;
+}
+
+// hash: FNV-1a
+uint32_t KsonKeyTable::hash(const char* str, size_t len) {
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < len; ++i) {
+		h = (h ^ static_cast<unsigned char>(str[i])) * 16777619u;
+	}
+	return h;
+}
+
+// probe: 线性探测
+size_t KsonKeyTable::probe(const char* str, size_t len, uint32_t hash) const {
+	size_t mask = m_entries.size() - 1;
+	size_t idx = hash & mask;
+	while (m_entries[idx].m_str) {
+		const Entry& entry = m_entries[idx];
+		if (entry.m_hash == hash && entry.m_len == len && std::memcmp(entry.m_str, str, len) == 0) break;
+		idx = (idx + 1) & mask;
+	}
+	return idx;
+}
+
+// grow: 负载不超过 1/2
+void KsonKeyTable::grow() {
+	std::vector<Entry> entries(m_entries.empty() ? 64 : m_entries.size() * 2, Entry{ nullptr, 0, 0 });
+	entries.swap(m_entries);
+	for (const Entry& entry : entries) {
+		if (!entry.m_str) continue;
+		size_t mask = m_entries.size() - 1;
+		size_t idx = entry.m_hash & mask;
+		while (m_entries[idx].m_str) {
+			idx = (idx + 1) & mask;
+		}
+		m_entries[idx] = entry;
+	}
+}
+
+
+//============================================================
+//  ksonNode
+//============================================================
+
+// find: 成员按 key 排序，二分查找
+const KsonNode* KsonNode::find(std::string_view key) const {
+	if (m_type != KsonType::OBJECT) return nullptr;
+
+	const KsonMember* begin = m_members;
+	const KsonMember* end = m_members + m_size;
+	auto iter = std::lower_bound(begin, end, key, [](const KsonMember& member, std::string_view key) {
+		return member.key() < key;
+	});
+	if (iter != end && iter->key() == key) {
+		return &iter->m_value;
+	}
+	return nullptr;
+}
+
+// find: KsonKey，成员较多时仍然二分查找
+const KsonNode* KsonNode::find(const KsonKey& key) const {
+	if (!key.m_id || m_size > LINEAR_FIND_MAX) return find(key.m_name);
+	if (m_type != KsonType::OBJECT) return nullptr;
+
+	for (uint32_t i = 0; i < m_size; ++i) {
+		if (m_members[i].m_key == key.m_id) return &m_members[i].m_value;
+	}
+	return nullptr;
+}
+
+// at: key
+const KsonNode& KsonNode::at(std::string_view key) const {
+	const KsonNode* node = find(key);
+	if (!node) throw std::out_of_range("KsonNode::at: key '" + std::string(key) + "' not found");
+	return *node;
+}
+
+// at: KsonKey
+const KsonNode& KsonNode::at(const KsonKey& key) const {
+	const KsonNode* node = find(key);
+	if (!node) throw std::out_of_range("KsonNode::at: key '" + std::string(key.m_name) + "' not found");
+	return *node;
+}
+
+// at: index
+const KsonNode& KsonNode::at(size_t index) const {
+	if (m_type != KsonType::ARRAY || index >= m_size) {
+		throw std::out_of_range("KsonNode::at: index " + std::to_string(index) + " out of range");
+	}
+	return m_elems[index];
+}
+
+// accept
+bool KsonNode::accept(KsonHandler& handler) const {
+	switch (m_type) {
+	case KsonType::OBJECT:
+		if (!handler.startObject()) return false;
+		for (uint32_t i = 0; i < m_size; ++i) {
+			if (!handler.key(m_members[i].m_key, m_members[i].m_keyLen)) return false;
+			if (!m_members[i].m_value.accept(handler)) return false;
+		}
+		return handler.endObject();
+
+	case KsonType::ARRAY:
+		if (!handler.startArray()) return false;
+		for (uint32_t i = 0; i < m_size; ++i) {
+			if (!m_elems[i].accept(handler)) return false;
+		}
+		return handler.endArray();
+
+	case KsonType::STRING:
+		return handler.string(m_str, m_size);
+
+	case KsonType::NUMBER:
+		return m_isInt ? handler.integer(m_int) : handler.floating(m_double);
+
+	case KsonType::BOOL:
+		return handler.boolean(m_bool);
+
+	default:
+		return handler.null();
+	}
+}
+
+
+//============================================================
+//  ksonDocBuilder
+//============================================================
+
+// startObject
+bool KsonDocBuilder::startObject() {
+	return startContainer(true);
+}
+
+// key
+bool KsonDocBuilder::key(const char* str, size_t len) {
+	Frame& frame = m_stack.back();
+	frame.m_key = m_internKeys ? m_keys.intern(str, len, !inSource(str, len)) : store(str, len);
+	frame.m_keyLen = static_cast<uint32_t>(len);
+	return true;
+}
+
+// endObject: 成员按 (key, 出现的顺序) 排序，重复的 key 保留最后一个
+bool KsonDocBuilder::endObject() {
+	size_t start = m_stack.back().m_start;
+	m_stack.pop_back();
+
+	size_t count = m_members.size() - start;
+	const KsonMember* members = m_members.data() + start;
+
+	m_order.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		m_order[i] = static_cast<uint32_t>(i);
+	}
+	std::sort(m_order.begin(), m_order.end(), [&](uint32_t i, uint32_t j) {
+		int ret = compareKey(members[i], members[j]);
+		return ret != 0 ? ret < 0 : i < j;
+	});
+
+	KsonMember* result = count ? m_arena.allocate<KsonMember>(count) : nullptr;
+	uint32_t size = 0;
+	for (size_t i = 0; i < count; ++i) {
+		const KsonMember& member = members[m_order[i]];
+		bool isLast = (i + 1 == count) || compareKey(member, members[m_order[i + 1]]) != 0;
+		if (isLast) {
+			new (&result[size++]) KsonMember(member);
+		}
+	}
+	m_members.erase(m_members.begin() + start, m_members.end());
+
+	KsonNode node;
+	node.m_type = KsonType::OBJECT;
+	node.m_size = size;
+	node.m_members = result;
+	return addValue(node);
+}
+
+// startArray
+bool KsonDocBuilder::startArray() {
+	return startContainer(false);
+}
+
+// endArray
+bool KsonDocBuilder::endArray() {
+	size_t start = m_stack.back().m_start;
+	m_stack.pop_back();
+
+	size_t count = m_elems.size() - start;
+	KsonNode* elems = count ? m_arena.allocate<KsonNode>(count) : nullptr;
+	for (size_t i = 0; i < count; ++i) {
+		new (&elems[i]) KsonNode(m_elems[start + i]);
+	}
+	m_elems.erase(m_elems.begin() + start, m_elems.end());
+
+	KsonNode node;
+	node.m_type = KsonType::ARRAY;
+	node.m_size = static_cast<uint32_t>(count);
+	node.m_elems = elems;
+	return addValue(node);
+}
+
+// string
+bool KsonDocBuilder::string(const char* str, size_t len) {
+	KsonNode node;
+	node.m_type = KsonType::STRING;
+	node.m_size = static_cast<uint32_t>(len);
+	node.m_str = store(str, len);
+	return addValue(node);
+}
+
+// integer
+bool KsonDocBuilder::integer(KsonInt value) {
+	KsonNode node;
+	node.m_type = KsonType::NUMBER;
+	node.m_isInt = true;
+	node.m_int = value;
+	return addValue(node);
+}
+
+// floating
+bool KsonDocBuilder::floating(double value) {
+	KsonNode node;
+	node.m_type = KsonType::NUMBER;
+	node.m_isInt = false;
+	node.m_double = value;
+	return addValue(node);
+}
+
+// boolean
+bool KsonDocBuilder::boolean(bool value) {
+	KsonNode node;
+	node.m_type = KsonType::BOOL;
+	node.m_bool = value;
+	return addValue(node);
+}
+
+// null
+bool KsonDocBuilder::null() {
+	KsonNode node;
+	node.m_type = KsonType::NUL;
+	return addValue(node);
+}
+
+// reset
+void KsonDocBuilder::reset() {
+	m_stack.clear();
+	m_members.clear();
+	m_elems.clear();
+	m_keys.clear();
+	m_root = KsonNode();
+}
+
+// addValue: 根 object 结束时保存为 m_root
+bool KsonDocBuilder::addValue(const KsonNode& node) {
+	if (m_stack.empty()) {
+		m_root = node;
+		return true;
+	}
+
+	Frame& frame = m_stack.back();
+	if (frame.m_isObject) {
+		m_members.push_back({ frame.m_key, frame.m_keyLen, node });
+	}
+	else {
+		m_elems.push_back(node);
+	}
+	return true;
+}
+
+// startContainer
+bool KsonDocBuilder::startContainer(bool isObject) {
+	m_stack.push_back({ isObject, isObject ? m_members.size() : m_elems.size(), nullptr, 0 });
+	return true;
+}
+
+// store
+const char* KsonDocBuilder::store(const char* str, size_t len) {
+	return inSource(str, len) ? str : m_arena.copyStr(str, len);
+}
+
+// inSource
+bool KsonDocBuilder::inSource(const char* str, size_t len) const {
+	std::less<const char*> less;
+	return m_begin && !less(str, m_begin) && !less(m_end, str + len);
+}
+
+
+//============================================================
+//  ksonDocument
+//============================================================
+
+// parse
+bool KsonDocument::parse(const std::string& ksonStr) {
+	KsonBuffer buf;
+	buf.borrow(ksonStr.c_str(), ksonStr.size());
+	return parse(std::move(buf), false);
+}
+
+// parseInSitu
+bool KsonDocument::parseInSitu(std::string ksonStr) {
+	KsonBuffer buf;
+	buf.assign(std::move(ksonStr));
+	return parse(std::move(buf), true);
+}
+
+// load
+bool KsonDocument::load(const std::string& file, bool inSitu) {
+	KsonBuffer buf;
+	std::string error;
+	if (!buf.load(file, error)) {
+		reset();
+		m_error = error + "\n";
+		return false;
+	}
+	return parse(std::move(buf), inSitu);
+}
+
+// key: 没有开启符号表时符号表为空，查找时比较字符串
+KsonKey KsonDocument::key(std::string_view name) const {
+	KsonKey key;
+	key.m_name = name;
+	key.m_id = m_builder.keys().find(name.data(), name.size());
+	return key;
+}
+
+// reset
+void KsonDocument::reset() {
+	m_arena.reset();
+	m_builder.reset();
+	m_buf.clear();
+	m_error.clear();
+}
+
+// parse: 失败时根 object 为空
+bool KsonDocument::parse(KsonBuffer&& buf, bool inSitu) {
+	reset();
+
+	// in-situ 模式：文档保存 kson 文本，解析器只引用它
+	if (inSitu) {
+		m_buf = std::move(buf);
+		buf.borrow(m_buf.data(), m_buf.size());
+		m_builder.setSource(m_buf.data(), m_buf.data() + m_buf.size());
+	}
+	else {
+		m_builder.setSource(nullptr, nullptr);
+	}
+
+	Kson kson(std::move(buf));
+	if (!kson.parse(m_builder)) {
+		m_error = kson.getErrorInfo();
+		m_builder.reset();
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,319 @@
+﻿#ifndef __K_DOC_H__
+#define __K_DOC_H__
+
+#include "kson.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//============================================================
+//  ksonArena: 单调增长的内存池
+//============================================================
+
+// 只分配不释放，reset() 后保留已申请的内存块供下一次使用
+// 超过块大小的请求单独申请一块
+
+namespace kson {
+
+	class KsonArena {
+	public:
+		explicit KsonArena(size_t blockSize = 64 * 1024) : m_blockSize(blockSize) {}
+		KsonArena(const KsonArena&) = delete;
+		KsonArena& operator=(const KsonArena&) = delete;
+		~KsonArena() { release(); }
+
+		// 分配 size 字节，按 align 对齐
+		void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+		template<typename T>
+		T* allocate(size_t count) { return static_cast<T*>(allocate(sizeof(T) * count, alignof(T))); }
+
+		// 拷贝字符串，结尾补 '\0'
+		const char* copyStr(const char* str, size_t len);
+
+		// 所有分配失效，保留内存块，O(1)
+		void reset();
+
+		// 释放所有内存块
+		void release();
+
+		// 已分配的字节数 / 申请的内存块总字节数
+		size_t used() const { return m_used; }
+		size_t capacity() const { return m_capacity; }
+
+	private:
+		struct Block {
+			char*   m_data;
+			size_t  m_size;
+		};
+
+		// 切换到能容纳 size 字节的下一块，没有时申请新的一块
+		void nextBlock(size_t size, size_t align);
+
+	private:
+		std::vector<Block> m_blocks;
+		size_t             m_blockSize;         // 第一块的大小，之后每块加倍（最大 1MB）
+		size_t             m_current = 0;       // 当前使用的块
+		char*              m_ptr = nullptr;     // 当前块中未分配部分的起始位置
+		char*              m_end = nullptr;     // 当前块的结束位置
+		size_t             m_used = 0;
+		size_t             m_capacity = 0;
+	};
+}
+
+
+//============================================================
+//  ksonKeyTable: 文档中 key 的符号表
+//============================================================
+
+// 同一个文档中相同的 key 只保存一份，所有 KsonMember::m_key 指向这一份，比较 key 是否相同只需要比较指针
+// 开放寻址的哈希表，clear() 后保留表的内存
+
+namespace kson {
+
+	class KsonKeyTable {
+	public:
+		explicit KsonKeyTable(KsonArena& arena) : m_arena(arena) {}
+
+		// 查找 key，不存在时返回 nullptr
+		const char* find(const char* str, size_t len) const;
+
+		// 查找 key，不存在时加入：copy 为 true 时拷贝到内存池，否则直接使用 str（调用者保证 str 在文档的生命周期内有效）
+		const char* intern(const char* str, size_t len, bool copy);
+
+		// 不同的 key 的个数
+		size_t size() const { return m_size; }
+
+		// 清空，保留表的内存
+		void clear();
+
+	private:
+		struct Entry {
+			const char*  m_str;      // nullptr 表示空位
+			uint32_t     m_len;
+			uint32_t     m_hash;
+		};
+
+		static uint32_t hash(const char* str, size_t len);
+
+		// 返回 key 所在的位置，不存在时返回应插入的空位
+		size_t probe(const char* str, size_t len, uint32_t hash) const;
+
+		void grow();
+
+	private:
+		KsonArena&         m_arena;
+		std::vector<Entry> m_entries;   // 大小为 2 的幂
+		size_t             m_size = 0;
+	};
+
+	// 文档中的 key，由 KsonDocument::key() 获取，用于重复的查找
+	struct KsonKey {
+		std::string_view  m_name;
+		const char*       m_id = nullptr;   // 符号表中的地址，文档中没有这个 key 或没有开启符号表时为 nullptr
+	};
+}
+
+
+//============================================================
+//  ksonNode: KsonDocument 中的只读节点
+//============================================================
+
+// 所有节点、key、字符串都分配在 KsonDocument 的内存池中（in-situ 模式下 key 和不含转义字符的字符串直接指向文档保存的 kson 文本），节点不需要析构
+// 读取接口与 KsonValue 相同，object 的成员按 key 排序（与 std::map 的遍历顺序相同），重复的 key 保留最后一个
+
+namespace kson {
+
+	struct KsonMember;
+
+	class KsonNode {
+	public:
+		KsonNode() : m_type(KsonType::OBJECT), m_isInt(false), m_size(0), m_int(0) {}
+
+		// 获取 KsonType
+		KsonType     getType()   const { return m_type; }
+
+		// 获取值（类型不符时返回空值）
+		KsonStr      getStr()    const { return m_type == KsonType::STRING ? KsonStr(m_str, m_size) : KsonStr(); }
+		KsonInt      getInt()    const { return m_type != KsonType::NUMBER ? 0 : m_isInt ? m_int : toKsonInt(m_double); }
+		KsonDouble   getDouble() const { return m_type != KsonType::NUMBER ? 0.0 : m_isInt ? static_cast<KsonDouble>(m_int) : m_double; }
+		KsonBool     getBool()   const { return m_type == KsonType::BOOL ? m_bool : false; }
+		KsonNull     getNull()   const { return nullptr; }
+		bool         isInt()     const { return m_type == KsonType::NUMBER && m_isInt; }
+
+		// 字符串，不复制；类型不符时为空字符串
+		std::string_view strView() const { return m_type == KsonType::STRING ? std::string_view(m_str, m_size) : std::string_view(); }
+
+		// 字符串长度，或 object/array 的元素个数
+		size_t       size()      const { return (m_type == KsonType::NUMBER || m_type == KsonType::BOOL) ? 0 : m_size; }
+
+		// object: 按 key 查找，不存在或类型不符时返回 nullptr
+		// 传入 KsonKey 时比较符号表中的地址（成员较少时顺序比较指针），不需要比较字符串
+		const KsonNode* find(std::string_view key) const;
+		const KsonNode* find(const KsonKey& key) const;
+
+		// object: 第 index 个成员（按 key 排序），调用者保证类型为 object 且 index < size()
+		const KsonMember& member(size_t index) const;
+
+		// 按 key / index 访问，不存在或类型不符时抛出 std::out_of_range
+		const KsonNode& at(std::string_view key) const;
+		const KsonNode& at(const KsonKey& key) const;
+		const KsonNode& at(size_t index) const;
+
+		// 按遍历顺序向 handler 发送事件，例如用 KsonDomHandler 转换为 KsonObject
+		bool accept(KsonHandler& handler) const;
+
+	private:
+		friend class KsonDocBuilder;
+
+		KsonType      m_type;
+		bool          m_isInt;
+		uint32_t      m_size;              // string/object/array
+		union {
+			const char*       m_str;       // string
+			const KsonNode*   m_elems;     // array
+			const KsonMember* m_members;   // object
+			KsonInt           m_int;       // number: 整数
+			double            m_double;    // number: 浮点数
+			bool              m_bool;      // bool
+		};
+	};
+
+	// object 的成员（in-situ 模式下 m_key 不以 '\0' 结尾）
+	struct KsonMember {
+		const char*   m_key;
+		uint32_t      m_keyLen;
+		KsonNode      m_value;
+
+		std::string_view key() const { return std::string_view(m_key, m_keyLen); }
+	};
+
+	inline const KsonMember& KsonNode::member(size_t index) const {
+		return m_members[index];
+	}
+}
+
+
+//============================================================
+//  ksonDocument: 分配在内存池中的 kson 文档
+//============================================================
+
+// 解析时每个节点、key、字符串只是从内存池中取一段内存，销毁和 reset() 只需要释放（或保留）内存块
+// 重复使用同一个 KsonDocument 解析时，内存池和临时栈都已经分配好，不再有堆分配：
+//
+//     KsonDocument doc;
+//     while (...) {
+//         if (doc.parse(ksonStr)) use(doc.root().at("key").getInt());
+//     }
+//
+// in-situ 模式：文档保存 kson 文本（移入的字符串或 mmap 的文件），key 和不含转义字符的字符串不再拷贝，
+// 只有含转义字符的字符串解码到内存池中；节点在下一次解析或 reset() 之前有效
+//
+// key 默认保存在文档的符号表中，由同样结构的 object 组成的大数组中每个 key 只保存一次；
+// 重复按同一个 key 查找时可以先取得 KsonKey：
+//
+//     KsonKey id = doc.key("id");
+//     for (size_t i = 0; i < records.size(); ++i) sum += records.at(i).at(id).getInt();
+
+namespace kson {
+
+	// 由事件构建 KsonNode
+	class KsonDocBuilder : public KsonHandler {
+	public:
+		explicit KsonDocBuilder(KsonArena& arena) : m_arena(arena), m_keys(arena) {}
+
+		bool startObject() override;
+		bool key(const char* str, size_t len) override;
+		bool endObject() override;
+		bool startArray() override;
+		bool endArray() override;
+		bool string(const char* str, size_t len) override;
+		bool integer(KsonInt value) override;
+		bool floating(double value) override;
+		bool boolean(bool value) override;
+		bool null() override;
+
+		// 清空状态，保留临时栈的内存
+		void reset();
+
+		// in-situ 模式：位于 [begin, end) 中的 key 和字符串直接引用，不拷贝；传入 nullptr 时全部拷贝
+		void setSource(const char* begin, const char* end) { m_begin = begin; m_end = end; }
+
+		// 是否使用符号表保存 key（默认使用）
+		void setInternKeys(bool enable) { m_internKeys = enable; }
+		const KsonKeyTable& keys() const { return m_keys; }
+
+		const KsonNode& root() const { return m_root; }
+
+	private:
+		struct Frame {
+			bool         m_isObject;
+			size_t       m_start;    // 第一个元素在 m_members / m_elems 中的位置
+			const char*  m_key;      // object 中等待 value 的 key（已保存到内存池或符号表）
+			uint32_t     m_keyLen;
+		};
+
+		bool addValue(const KsonNode& node);
+		bool startContainer(bool isObject);
+
+		// 位于 kson 文本中时直接返回 str，否则拷贝到内存池
+		const char* store(const char* str, size_t len);
+		bool inSource(const char* str, size_t len) const;
+
+	private:
+		KsonArena&                  m_arena;
+		std::vector<Frame>          m_stack;     // 容器栈
+		std::vector<KsonMember>     m_members;   // 未结束的 object 的成员
+		std::vector<KsonNode>       m_elems;     // 未结束的 array 的元素
+		std::vector<uint32_t>       m_order;     // 成员排序时使用
+		KsonKeyTable                m_keys;      // key 的符号表
+		bool                        m_internKeys = true;
+		const char*                 m_begin = nullptr;   // in-situ 模式下 kson 文本的范围
+		const char*                 m_end = nullptr;
+		KsonNode                    m_root;
+	};
+
+	class KsonDocument {
+	public:
+		explicit KsonDocument(size_t blockSize = 64 * 1024) : m_arena(blockSize), m_builder(m_arena) {}
+		KsonDocument(const KsonDocument&) = delete;
+		KsonDocument& operator=(const KsonDocument&) = delete;
+
+		// 解析 kson 字符串，不拷贝 ksonStr，节点中的 key 和字符串拷贝到内存池
+		bool parse(const std::string& ksonStr);
+
+		// 解析 kson 字符串（in-situ 模式），文档保存 ksonStr
+		bool parseInSitu(std::string ksonStr);
+
+		// 解析 kson 文件，inSitu 为 true 时文档保存读入（或 mmap）的文件内容
+		bool load(const std::string& file, bool inSitu = false);
+
+		// 根 object，解析失败时为空 object
+		const KsonNode& root() const { return m_builder.root(); }
+
+		// 取得 key 在符号表中的地址，用于 KsonNode::find() / at()；在下一次解析或 reset() 之前有效
+		KsonKey key(std::string_view name) const;
+
+		// 是否使用符号表保存 key（默认使用），在下一次解析时生效
+		void setInternKeys(bool enable) { m_builder.setInternKeys(enable); }
+
+		// 清空文档，保留内存池，O(1)（in-situ 模式下同时释放保存的 kson 文本）
+		void reset();
+
+		// 获取解析过程中的错误信息
+		std::string getErrorInfo() const { return m_error; }
+
+		const KsonArena& arena() const { return m_arena; }
+
+	private:
+		bool parse(KsonBuffer&& buf, bool inSitu);
+
+	private:
+		KsonArena       m_arena;
+		KsonDocBuilder  m_builder;
+		KsonBuffer      m_buf;         // in-situ 模式下保存的 kson 文本
+		std::string     m_error;
+	};
+}
+
+#endif
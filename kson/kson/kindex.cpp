@@ -0,0 +1,577 @@
+﻿#include "stdafx.h"
+#include "kindex.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+using namespace kson;
+
+namespace {
+
+	// 为 1 的位的个数
+	inline int bitCount(uint64_t mask) {
+		mask = mask - ((mask >> 1) & 0x5555555555555555ULL);
+		mask = (mask & 0x3333333333333333ULL) + ((mask >> 2) & 0x3333333333333333ULL);
+		mask = (mask + (mask >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		return static_cast<int>((mask * 0x0101010101010101ULL) >> 56);
+	}
+
+	// 前缀异或：第 i 位为 mask 第 0~i 位的异或，由 '"' 的位图得到字符串的范围（开始的 '"' 到结束的 '"' 之前）
+	inline uint64_t prefixXor(uint64_t mask) {
+		mask ^= mask << 1;
+		mask ^= mask << 2;
+		mask ^= mask << 4;
+		mask ^= mask << 8;
+		mask ^= mask << 16;
+		mask ^= mask << 32;
+		return mask;
+	}
+
+	// 被转义的字符：前面有奇数个连续的 '\'
+	// 从奇数位开始的 '\' 序列加上整个 '\' 位图，进位停在序列之后，据此区分序列的结尾在奇数位还是偶数位
+	inline uint64_t findEscaped(uint64_t backslash, uint64_t& prevEscaped) {
+		const uint64_t EVEN_BITS = 0x5555555555555555ULL;
+		backslash &= ~prevEscaped;
+		uint64_t followsEscape = (backslash << 1) | prevEscaped;
+		uint64_t oddStarts = backslash & ~EVEN_BITS & ~followsEscape;
+		uint64_t evenEnds = oddStarts + backslash;
+		prevEscaped = evenEnds < oddStarts ? 1 : 0;
+		return (EVEN_BITS ^ (evenEnds << 1)) & followsEscape;
+	}
+
+	// [begin, end) 的位，end 最大为 64
+	inline uint64_t bitRange(int begin, int end) {
+		uint64_t high = end >= 64 ? ~uint64_t(0) : (uint64_t(1) << end) - 1;
+		return high & ~((uint64_t(1) << begin) - 1);
+	}
+
+	// 重新解析时代替原来的 handler：在同一个事件处停止
+	class KsonReplayHandler : public KsonHandler {
+	public:
+		KsonReplayHandler(size_t stopAt, bool isLazy) : m_stopAt(stopAt), m_isLazy(isLazy) {}
+
+		bool startObject() override { return next(); }
+		bool key(const char* str, size_t len) override { return next(); }
+		bool endObject() override { return next(); }
+		bool startArray() override { return next(); }
+		bool endArray() override { return next(); }
+		bool string(const char* str, size_t len) override { return next(); }
+		bool integer(KsonInt value) override { return next(); }
+		bool floating(double value) override { return next(); }
+		bool boolean(bool value) override { return next(); }
+		bool null() override { return next(); }
+		bool isLazy() const override { return m_isLazy; }
+		bool rawString(const char* str, size_t len, bool isEscaped) override { return next(); }
+		bool rawNumber(const char* str, size_t len) override { return next(); }
+
+	private:
+		bool next() { return ++m_events != m_stopAt; }
+
+	private:
+		size_t  m_stopAt;
+		bool    m_isLazy;
+		size_t  m_events = 0;
+	};
+
+	// p 以 word 开始，遇到不同的字符（包括结尾的 '\0'）即停止比较，不会越过文本的结尾
+	inline bool startsWith(const char* p, const char* word) {
+		for (; *word; ++p, ++word) {
+			if (*p != *word) return false;
+		}
+		return true;
+	}
+
+	// 索引中的位置为 uint32_t
+	const size_t KSON_INDEX_MAX_SIZE = std::numeric_limits<uint32_t>::max() - 64;
+
+	// 容器栈中的 object
+	const char KSON_INDEX_OBJECT = 1;
+}
+
+//============================================================
+//  ksonBlockScanner
+//============================================================
+
+// KsonBlockScanner
+KsonBlockScanner::KsonBlockScanner(const char* data, size_t end)
+	: m_data(data), m_end(end), m_scanner(getKsonScanner()) {}
+
+// next
+bool KsonBlockScanner::next(Block& block) {
+	size_t base = m_base;
+	if (base >= m_end) return false;
+	m_base += 64;
+
+	// 最后不足 64 字节的部分补空白（多一个字节供 scanComment() 读取 p[64]）
+	const char* p = m_data + base;
+	char tail[65];
+	if (m_end - base < 64) {
+		std::memcpy(tail, p, m_end - base);
+		std::memset(tail + (m_end - base), ' ', sizeof(tail) - (m_end - base));
+		p = tail;
+	}
+
+	KsonCharMasks masks;
+	m_scanner.classify(p, masks);
+	uint64_t quote = masks.m_quote & ~findEscaped(masks.m_backslash, m_prevEscaped);
+	uint64_t inStr = prefixXor(quote) ^ (m_mode == Mode::STRING ? ~uint64_t(0) : 0);
+	uint64_t comment = 0;
+
+	// 字符串之外没有 '/' 时不会有注释，前缀异或的结果就是字符串的范围
+	bool inComment = m_mode == Mode::LINE_COMMENT || m_mode == Mode::BLOCK_COMMENT;
+	if (!inComment && (masks.m_slash & ~inStr) == 0) {
+		m_mode = (inStr >> 63) ? Mode::STRING : Mode::NORMAL;
+	}
+	else {
+		scanComment(p, masks, quote, inStr, comment);
+		quote &= ~comment;
+	}
+
+	// key / value 的字符：不在字符串和注释中，不是空白和结构字符；每一段的第一个字符
+	uint64_t outside = ~(inStr | quote | comment);
+	uint64_t other = outside & ~(masks.m_space | masks.m_struct);
+
+	block.m_base = base;
+	block.m_struct = masks.m_struct & outside;
+	block.m_quote = quote;
+	block.m_starts = other & ~((other << 1) | m_prevOther);
+	m_prevOther = other >> 63;
+	// 字符串中只支持 ' '，'\t' '\n' '\r' 与其它不支持的字符一样交给 Kson 报错
+	block.m_invalid = (masks.m_invalid & ~comment) | (masks.m_ctrlSpace & inStr & ~quote);
+	return true;
+}
+
+// scanComment: 确定字符串和注释的范围（与 Kson::skipWS() 的规则相同），inStr 为开始的 '"' 到结束的 '"' 之前，comment 为注释（包括 "//" "/*" "*/"）
+// 只在当前状态关心的字符之间跳转：字符串中找 '"'，行注释中找 '\n'，块注释中找 '*'，其它情况找 '"' 和 '/'
+// quote 为没有被转义的 '"'，p[64] 必须可读
+void KsonBlockScanner::scanComment(const char* p, const KsonCharMasks& masks, uint64_t quote, uint64_t& inStr, uint64_t& comment) {
+	inStr = 0;
+	comment = 0;
+	int i = 0;
+	if (m_skip) {
+		m_skip = false;
+		comment = 1;
+		i = 1;
+	}
+
+	int begin = i;   // 当前字符串（注释）在本块中的开始位置
+	while (i < 64) {
+		uint64_t wanted = 0;
+		switch (m_mode) {
+		case Mode::NORMAL:         wanted = quote | masks.m_slash; break;
+		case Mode::STRING:         wanted = quote; break;
+		case Mode::LINE_COMMENT:   wanted = masks.m_newline; break;
+		case Mode::BLOCK_COMMENT:  wanted = masks.m_star; break;
+		}
+		wanted &= ~((uint64_t(1) << i) - 1);
+		if (!wanted) break;
+
+		int j = lowestBit(wanted);
+		i = j + 1;
+		switch (m_mode) {
+		case Mode::NORMAL:
+			if (quote & (uint64_t(1) << j)) {
+				m_mode = Mode::STRING;
+				begin = j;
+			}
+			else if (p[j + 1] == '/' || p[j + 1] == '*') {
+				m_mode = p[j + 1] == '/' ? Mode::LINE_COMMENT : Mode::BLOCK_COMMENT;
+				begin = j;
+				i = j + 2;
+			}
+			break;
+
+		case Mode::STRING:
+			inStr |= bitRange(begin, j);
+			m_mode = Mode::NORMAL;
+			break;
+
+		case Mode::LINE_COMMENT:
+			comment |= bitRange(begin, j);
+			m_mode = Mode::NORMAL;
+			break;
+
+		case Mode::BLOCK_COMMENT:
+			if (p[j + 1] == '/') {
+				i = j + 2;
+				comment |= bitRange(begin, i);
+				m_mode = Mode::NORMAL;
+			}
+			break;
+		}
+	}
+
+	// 跨到下一块的字符串（注释），以及 "//" "/*" "*/" 的第二个字符
+	if (m_mode == Mode::STRING) inStr |= bitRange(begin, 64);
+	else if (m_mode != Mode::NORMAL) comment |= bitRange(begin, 64);
+	m_skip = i > 64;
+}
+
+
+//============================================================
+//  ksonIndexParser
+//============================================================
+
+// parse
+std::pair<bool, KsonObject> KsonIndexParser::parse(const std::string& ksonStr) {
+	KsonDomHandler dom;
+	bool ret = parse(ksonStr, dom);
+	return { ret, dom.release() };
+}
+
+// parse: handler
+bool KsonIndexParser::parse(const std::string& ksonStr, KsonHandler& handler) {
+	return parse(ksonStr.data(), ksonStr.size(), handler);
+}
+
+// parse: data
+bool KsonIndexParser::parse(const char* data, size_t size, KsonHandler& handler) {
+	index(data, size);
+	return walk(handler);
+}
+
+// index: 第一阶段
+void KsonIndexParser::index(const char* data, size_t size) {
+	m_data = data;
+	m_size = size;
+	m_count = 0;
+	m_indexed = size <= KSON_INDEX_MAX_SIZE;
+	if (!m_indexed) return;
+
+	// '\0' 为文件结束，之后的内容不属于文档
+	const char* zero = static_cast<const char*>(std::memchr(data, '\0', size));
+	size_t end = zero ? size_t(zero - data) : size;
+
+	KsonBlockScanner scanner(data, end);
+	KsonBlockScanner::Block block;
+	size_t firstInvalid = end;
+	while (scanner.next(block)) {
+		if (block.m_invalid && firstInvalid == end) {
+			firstInvalid = block.m_base + lowestBit(block.m_invalid);
+		}
+
+		// 位置写入索引：先不判断个数连续写 8 个（多写的位置之后被覆盖，最高位保证 lowestBit() 的参数不为 0），多于 8 个时再继续
+		if (m_index.size() - m_count < 64) {
+			m_index.resize(std::max<size_t>(m_index.size() * 2, 1024));
+		}
+		uint64_t bits = block.m_struct | block.m_quote | block.m_starts;
+		int count = bitCount(bits);
+		uint32_t* out = m_index.data() + m_count;
+		uint32_t pos = static_cast<uint32_t>(block.m_base);
+		const uint64_t HIGHEST = uint64_t(1) << 63;
+		for (int k = 0; k < 8; ++k) {
+			out[k] = pos + lowestBit(bits | HIGHEST);
+			bits &= bits - 1;
+		}
+		if (count > 8) {
+			for (int k = 8; k < 16; ++k) {
+				out[k] = pos + lowestBit(bits | HIGHEST);
+				bits &= bits - 1;
+			}
+			for (int k = 16; bits; ++k) {
+				out[k] = pos + lowestBit(bits);
+				bits &= bits - 1;
+			}
+		}
+		m_count += count;
+	}
+
+	// 结尾：文件结束的位置；有不支持的字符时在它之前结束（Kson 一定在它之前或它所在的位置报错）
+	if (firstInvalid < end) {
+		m_count = size_t(std::lower_bound(m_index.data(), m_index.data() + m_count, static_cast<uint32_t>(firstInvalid)) - m_index.data());
+	}
+	if (m_index.size() == m_count) {
+		m_index.resize(m_count + 1);
+	}
+	m_index[m_count++] = static_cast<uint32_t>(firstInvalid);
+}
+
+// walk: 第二阶段
+bool KsonIndexParser::walk(KsonHandler& handler) {
+	m_error.clear();
+
+	// 没有建立索引
+	if (!m_indexed) {
+		KsonBuffer buf;
+		buf.borrow(m_data, m_size);
+		Kson kson(std::move(buf));
+		if (kson.parse(handler)) return true;
+		m_error = kson.getErrorInfo();
+		return false;
+	}
+
+	m_handler = &handler;
+	m_scanner = &getKsonScanner();
+	m_lazy = handler.isLazy();
+	m_stopped = false;
+	m_events = 0;
+	if (walkIndex()) return true;
+
+	setError();
+	return false;
+}
+
+// walkIndex: 容器栈代替递归；索引的最后一项为 '\0' 或不支持的字符，不会与任何结构字符相同
+bool KsonIndexParser::walkIndex() {
+	const char* data = m_data;
+	const uint32_t* index = m_index.data();
+	size_t i = 0;
+
+	// 根 object
+	if (data[index[i]] != '{') return false;
+	++i;
+	if (!handled(m_handler->startObject())) return false;
+	m_stack.assign(1, KSON_INDEX_OBJECT);
+
+	bool afterValue = false;
+	while (true) {
+		bool isObject = m_stack.back() == KSON_INDEX_OBJECT;
+		char close = isObject ? '}' : ']';
+		char c = data[index[i]];
+
+		// value 之后：',' 或者容器结束（',' 之后也可以结束）
+		if (afterValue) {
+			if (c == ',') {
+				++i;
+				afterValue = false;
+				continue;
+			}
+			if (c != close) return false;
+		}
+
+		if (c == close) {
+			const char* p = data + index[i++];
+			m_stack.pop_back();
+			if (!handled(isObject ? m_handler->endObject() : m_handler->endArray())) return false;
+
+			// 根 object 结束，之后的内容只检查第一个字符（与 Kson::parse() 相同）
+			if (m_stack.empty()) {
+				p = skipSpace(p + 1);
+				return *p == '\0' || isCharClass(*p, KSON_CHAR_VALID);
+			}
+			afterValue = true;
+			continue;
+		}
+
+		// object 的成员以 key: 开始
+		if (isObject && !walkKey(i)) return false;
+
+		c = data[index[i]];
+		if (c == '{' || c == '[') {
+			++i;
+			m_stack.push_back(c == '{' ? KSON_INDEX_OBJECT : 0);
+			if (!handled(c == '{' ? m_handler->startObject() : m_handler->startArray())) return false;
+			continue;
+		}
+
+		if (!walkValue(i)) return false;
+		afterValue = true;
+	}
+}
+
+// walkKey: key 以及之后的 ':'
+bool KsonIndexParser::walkKey(size_t& i) {
+	const char* key = m_data + m_index[i];
+	if (!isCharClass(*key, KSON_CHAR_KEY_START)) return false;
+
+	const char* end = key + 1;
+	while (isCharClass(*end, KSON_CHAR_KEY)) {
+		++end;
+	}
+	if (!handled(m_handler->key(key, size_t(end - key)))) return false;
+
+	// key 之后的字符没有记入索引，必须是空白、结构字符、'"' 或注释
+	if (!isCharClass(*end, KSON_CHAR_WS | KSON_CHAR_STRUCT) && *end != '"' && skipSpace(end) == end) return false;
+	++i;
+
+	if (m_data[m_index[i]] != ':') return false;
+	++i;
+	return true;
+}
+
+// walkValue: object / array 之外的 value
+bool KsonIndexParser::walkValue(size_t& i) {
+	const char* p = m_data + m_index[i];
+	const char* end = nullptr;
+	switch (*p) {
+
+	// 字符串：结束的 '"' 是索引中的下一项
+	case '"': {
+		const char* close = m_data + m_index[i + 1];
+		if (*close != '"') return false;
+		i += 2;
+
+		const char* str = p + 1;
+		size_t len = size_t(close - str);
+		bool isEscaped = std::memchr(str, '\\', len) != nullptr;
+		if (m_lazy) return handled(m_handler->rawString(str, len, isEscaped));
+		if (!isEscaped) return handled(m_handler->string(str, len));
+
+		m_str.clear();
+		unescapeKsonStr(str, len, m_str);
+		return handled(m_handler->string(m_str.data(), m_str.size()));
+	}
+
+	case '+': case '-':
+	case '0': case '1': case '2': case '3': case '4':
+	case '5': case '6': case '7': case '8': case '9':
+		end = walkNum(p);
+		if (!end) return false;
+		break;
+
+	// true / TRUE / false / FALSE
+	case 't': case 'T': case 'f': case 'F': {
+		bool isTrue = startsWith(p, "true") || startsWith(p, "TRUE");
+		bool isFalse = startsWith(p, "false") || startsWith(p, "FALSE");
+		if (!isTrue && !isFalse) return false;
+		if (!handled(m_handler->boolean(isTrue))) return false;
+		end = p + (isTrue ? 4 : 5);
+		break;
+	}
+
+	// null / NULL
+	case 'n': case 'N':
+		if (!startsWith(p, "null") && !startsWith(p, "NULL")) return false;
+		if (!handled(m_handler->null())) return false;
+		end = p + 4;
+		break;
+
+	default:
+		return false;
+	}
+
+	// value 之后的字符没有记入索引，必须是空白、结构字符、'"' 或注释
+	if (!isCharClass(*end, KSON_CHAR_WS | KSON_CHAR_STRUCT) && *end != '"' && *end != '\0' && skipSpace(end) == end) return false;
+
+	// 数值中间可以有空白和注释（符号之后、指数之前），跳过其中的索引
+	size_t pos = size_t(end - m_data);
+	while (m_index[i] < pos) {
+		++i;
+	}
+	return true;
+}
+
+// walkNum: 与 Kson::parseNum() 的规则相同，返回数值的结束位置，失败时返回 nullptr
+const char* KsonIndexParser::walkNum(const char* p) {
+	const char* numStart = p;
+	bool isNeg = false;
+	bool isInt = true;
+
+	if (*p == '+' || *p == '-') {
+		isNeg = *p == '-';
+		p = skipSpace(p + 1);
+	}
+	if (!isCharClass(*p, KSON_CHAR_DIGIT)) return nullptr;
+
+	// 十六进制
+	if (p[0] == '0' && p[1] == 'x') {
+		const char* digits = p + 2;
+		const char* end = digits;
+		while (isCharClass(*end, KSON_CHAR_HEX)) {
+			++end;
+		}
+		if (end == digits) return nullptr;
+
+		auto num = toKsonHex(digits, size_t(end - digits));
+		if (!num.first) return nullptr;
+		return handled(m_handler->integer(num.second.m_int)) ? end : nullptr;
+	}
+
+	// 整数部分
+	const char* intPart = p;
+	bool isContiguous = intPart - numStart == ((*numStart == '+' || *numStart == '-') ? 1 : 0);
+	while (isCharClass(*p, KSON_CHAR_DIGIT)) {
+		++p;
+	}
+	size_t intLen = size_t(p - intPart);
+	const char* numEnd = p;
+
+	// 小数部分，之后可以有空白和注释
+	const char* fracPart = nullptr;
+	size_t fracLen = 0;
+	const char* next = p;
+	if (*p == '.') {
+		if (!isCharClass(p[1], KSON_CHAR_DIGIT)) return nullptr;
+		isInt = false;
+		fracPart = ++p;
+		while (isCharClass(*p, KSON_CHAR_DIGIT)) {
+			++p;
+		}
+		fracLen = size_t(p - fracPart);
+		numEnd = p;
+		next = skipSpace(p);
+	}
+
+	// 指数部分
+	const char* expPart = nullptr;
+	size_t expLen = 0;
+	if (*next == 'e' || *next == 'E') {
+		int sign = (next[1] == '+' || next[1] == '-') ? 1 : 0;
+		if (!isCharClass(next[1 + sign], KSON_CHAR_DIGIT)) return nullptr;
+
+		expPart = next + 1;
+		p = expPart + sign;
+		while (isCharClass(*p, KSON_CHAR_DIGIT)) {
+			++p;
+		}
+		expLen = size_t(p - expPart);
+		isContiguous = isContiguous && expPart - 1 == numEnd;
+		numEnd = p;
+	}
+
+	// 延迟解码：不会超出范围的连续数值只给出位置
+	if (m_lazy && isContiguous && isSafeKsonNum(intLen, expPart, expLen)) {
+		return handled(m_handler->rawNumber(numStart, size_t(numEnd - numStart))) ? numEnd : nullptr;
+	}
+
+	auto num = toKsonNum(isNeg, isInt, intPart, intLen, fracPart, fracLen, expPart, expLen);
+	if (!num.first) return nullptr;
+	bool ret = num.second.m_isInt ? m_handler->integer(num.second.m_int) : m_handler->floating(num.second.m_double);
+	return handled(ret) ? numEnd : nullptr;
+}
+
+// skipSpace
+const char* KsonIndexParser::skipSpace(const char* p) const {
+	const char* end = m_data + m_size;
+	while (true) {
+		while (isCharClass(*p, KSON_CHAR_WS)) {
+			++p;
+		}
+		if (p[0] != '/') return p;
+
+		if (p[1] == '/') {
+			p = m_scanner->findLineEnd(p + 2, end);
+			if (*p == '\0') return p;
+		}
+		else if (p[1] == '*') {
+			p = m_scanner->findBlockEnd(p + 2, end);
+			if (*p == '\0') return p;
+			p += 2;
+		}
+		else {
+			return p;
+		}
+	}
+}
+
+// handled
+bool KsonIndexParser::handled(bool ret) {
+	++m_events;
+	if (!ret) {
+		m_stopped = true;
+	}
+	return ret;
+}
+
+// setError: handler 停止解析时，重新解析也在同一个事件处停止
+void KsonIndexParser::setError() {
+	KsonBuffer buf;
+	buf.borrow(m_data, m_size);
+	Kson kson(std::move(buf));
+	KsonReplayHandler replay(m_stopped ? m_events : 0, m_lazy);
+	if (kson.parse(replay)) {
+		m_error = "index parser rejected a document accepted by Kson\n";
+		return;
+	}
+	m_error = kson.getErrorInfo();
+}
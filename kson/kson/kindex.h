@@ -0,0 +1,144 @@
+﻿#ifndef __K_INDEX_H__
+#define __K_INDEX_H__
+
+#include "kson.h"
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//============================================================
+//  ksonIndexParser: 两阶段（结构索引）解析器
+//============================================================
+
+// 第一阶段每次处理 64 个字节：由 SIMD 比较得到 '"' '\' '/' 空白 结构字符 的位图，再用位运算得到
+// 被转义的 '"'（前面有奇数个连续的 '\'）、字符串的范围（'"' 位图的前缀异或）、key 和 value 的起始位置，
+// 把结构字符、字符串两端的 '"'、key 和 value 的起始位置依次记录到索引中；
+// 字符串之外有 '/' 的块（以及从注释中开始的块）逐字节确定注释的范围，其它块不逐字节处理
+//
+//     { a: 1, /* c */ b: "x" }   ->   {  a  :  1  ,  b  :  "  "  }
+//
+// 第二阶段只访问索引中的位置，向 handler 发送事件：KsonDomHandler 构建 KsonObject，KsonTapeBuilder 构建 tape
+// 接受的文本、发送的事件与 Kson::parse() 相同（包括不带引号的 key、注释、十六进制、TRUE/NULL 等写法）；
+// 出错时用 Kson 重新解析一遍，得到相同的错误信息（包括行号），此时 handler 收到的事件可能比 Kson::parse() 多
+//
+//     KsonIndexParser parser;
+//     auto ret = parser.parse(ksonStr);
+
+namespace kson {
+
+	// 最低的为 1 的位，调用者保证 mask 不为 0
+	inline int lowestBit(uint64_t mask) {
+#if defined(__GNUC__)
+		return __builtin_ctzll(mask);
+#elif defined(_M_X64)
+		unsigned long idx;
+		_BitScanForward64(&idx, mask);
+		return static_cast<int>(idx);
+#else
+		unsigned long idx;
+		if (_BitScanForward(&idx, static_cast<unsigned long>(mask))) return static_cast<int>(idx);
+		_BitScanForward(&idx, static_cast<unsigned long>(mask >> 32));
+		return static_cast<int>(idx) + 32;
+#endif
+	}
+
+	// 第一阶段的逐块扫描：每次 64 个字节，给出字符串和注释之外的字符位图（第 i 位对应 data[base + i]）
+	// KsonIndexParser 由它建立索引，KsonParallelParser 由它寻找数组元素的边界
+	class KsonBlockScanner {
+	public:
+		struct Block {
+			size_t    m_base;       // 块的起始位置
+			uint64_t  m_struct;     // 结构字符
+			uint64_t  m_quote;      // 字符串两端的 '"'
+			uint64_t  m_starts;     // key / value 的第一个字符
+			uint64_t  m_invalid;    // 不支持的字符（包括字符串中的，以及字符串中的 '\t' '\n' '\r'；注释中的除外）
+		};
+
+		// 扫描 [data, data + end)，调用者保证 data[end] 可读
+		KsonBlockScanner(const char* data, size_t end);
+
+		// 扫描下一块，已经到达结尾时返回 false
+		bool next(Block& block);
+
+	private:
+		// 块之间保存的状态
+		enum class Mode : unsigned char {
+			NORMAL,
+			STRING,
+			LINE_COMMENT,
+			BLOCK_COMMENT
+		};
+
+		// 块中有注释（或可能有注释）时，逐个跳转确定字符串和注释的范围
+		void scanComment(const char* p, const KsonCharMasks& masks, uint64_t quote, uint64_t& inStr, uint64_t& comment);
+
+	private:
+		const char*         m_data;
+		size_t              m_end;
+		size_t              m_base = 0;             // 下一块的起始位置
+		const KsonScanner&  m_scanner;
+		Mode                m_mode = Mode::NORMAL;
+		bool                m_skip = false;         // 下一个字符是 "//" "/*" "*/" 的第二个字符
+		uint64_t            m_prevEscaped = 0;      // 上一块末尾的 '\' 转义了本块的第一个字符
+		uint64_t            m_prevOther = 0;        // 上一块的最后一个字符属于 key / value（不是空白、结构字符、字符串、注释）
+	};
+
+	class KsonIndexParser {
+	public:
+		KsonIndexParser() = default;
+		KsonIndexParser(const KsonIndexParser&) = delete;
+		KsonIndexParser& operator=(const KsonIndexParser&) = delete;
+
+		// 解析 kson 字符串
+		std::pair<bool, KsonObject> parse(const std::string& ksonStr);
+		bool parse(const std::string& ksonStr, KsonHandler& handler);
+
+		// 解析 data，调用者保证 data[size] == '\0'
+		bool parse(const char* data, size_t size, KsonHandler& handler);
+
+		// 第一阶段：建立结构索引，data 在第二阶段结束之前必须有效（调用者保证 data[size] == '\0'）
+		void index(const char* data, size_t size);
+
+		// 第二阶段：按最近一次 index() 的结果向 handler 发送事件，可以对同一份索引重复调用
+		bool walk(KsonHandler& handler);
+
+		// 索引中的位置个数（包括结尾的 '\0'）
+		size_t indexSize() const { return m_count; }
+
+		// 获取解析过程中的错误信息
+		std::string getErrorInfo() const { return m_error; }
+
+	private:
+		bool walkIndex();
+		bool walkKey(size_t& i);
+		bool walkValue(size_t& i);
+		const char* walkNum(const char* p);
+
+		// 跳过空白和注释（与 Kson::skipWS() 的规则相同，不检查字符）
+		const char* skipSpace(const char* p) const;
+
+		// 检查回调的返回值，并统计发送的事件个数
+		bool handled(bool ret);
+
+		// 出错时用 Kson 重新解析，得到相同的错误信息
+		void setError();
+
+	private:
+		const char*            m_data = "";           // kson 文本
+		size_t                 m_size = 0;
+		bool                   m_indexed = false;     // 文本超过 4GB 时不建立索引，walk() 直接使用 Kson
+		std::vector<uint32_t>  m_index;               // 结构索引（前 m_count 项有效）
+		size_t                 m_count = 0;
+		std::vector<char>      m_stack;               // 未结束的容器，1 为 object
+		std::string            m_str;                 // 含有转义字符的字符串的转义结果（重复使用）
+		KsonHandler*           m_handler = nullptr;
+		const KsonScanner*     m_scanner = nullptr;
+		bool                   m_lazy = false;        // handler 的 isLazy()
+		bool                   m_stopped = false;     // handler 返回了 false
+		size_t                 m_events = 0;          // 已经发送的事件个数
+		std::string            m_error;
+	};
+}
+
+#endif
@@ -0,0 +1,217 @@
+﻿#ifndef __K_MAP_H__
+#define __K_MAP_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//============================================================
+//  ksonFlatMap: KsonObject 使用的有序扁平容器
+//============================================================
+
+// 成员按 key 排序后连续存放在一个 vector 中，接口与 std::map 相同（常用的部分），遍历顺序也与 std::map 相同
+// 查找：成员较少时顺序比较，较多时二分查找；插入新 key 需要移动其后的成员，构建时应使用
+// KsonFlatMap(container_type&&) 一次性排序
+// 与 std::map 不同，成员的类型为 std::pair<std::string, V>（排序和删除需要移动成员），非 const 的迭代器可以修改 key：
+// 不要通过 iter->first 修改 key，否则破坏排序，find() / at() / emplace() 的结果不再正确；需要改名时先 erase() 再插入
+
+namespace kson {
+
+	template<typename V>
+	class KsonFlatMap {
+	public:
+		using key_type = std::string;
+		using mapped_type = V;
+		using value_type = std::pair<std::string, V>;     // key 不是 const，但不能通过迭代器修改（见上）
+		using container_type = std::vector<value_type>;
+		using iterator = typename container_type::iterator;
+		using const_iterator = typename container_type::const_iterator;
+		using size_type = size_t;
+
+		KsonFlatMap() = default;
+
+		// 由未排序的成员构建：按 key 排序，重复的 key 保留最后一个
+		explicit KsonFlatMap(container_type&& items);
+
+		iterator        begin()        { return m_items.begin(); }
+		iterator        end()          { return m_items.end(); }
+		const_iterator  begin()  const { return m_items.begin(); }
+		const_iterator  end()    const { return m_items.end(); }
+		const_iterator  cbegin() const { return m_items.cbegin(); }
+		const_iterator  cend()   const { return m_items.cend(); }
+
+		size_type  size()  const { return m_items.size(); }
+		bool       empty() const { return m_items.empty(); }
+		void       clear()       { m_items.clear(); }
+		void       reserve(size_type size) { m_items.reserve(size); }
+
+		// 查找，不存在时返回 end()
+		iterator        find(std::string_view key);
+		const_iterator  find(std::string_view key) const;
+		size_type       count(std::string_view key) const { return find(key) != end() ? 1 : 0; }
+
+		// 不存在时抛出 std::out_of_range
+		V&        at(std::string_view key);
+		const V&  at(std::string_view key) const;
+
+		// 不存在时插入默认值
+		V&  operator[](const std::string& key) { return emplace(key, V()).first->second; }
+		V&  operator[](std::string&& key) { return emplace(std::move(key), V()).first->second; }
+
+		// key 已经存在时不插入，返回已有的成员
+		template<typename K, typename T>
+		std::pair<iterator, bool> emplace(K&& key, T&& value);
+		std::pair<iterator, bool> insert(value_type&& item) { return emplace(std::move(item.first), std::move(item.second)); }
+
+		size_type  erase(std::string_view key);
+		iterator   erase(const_iterator pos) { return m_items.erase(pos); }
+
+	private:
+
+		// 成员不超过该个数时顺序查找 / 插入排序
+		static const size_type LINEAR_SEARCH_MAX = 8;
+		static const size_type INSERTION_SORT_MAX = 16;
+
+		const_iterator lowerBound(std::string_view key) const;
+
+		// 排序后相同的 key 相邻，保留每组的最后一个
+		void dedup();
+
+	private:
+		container_type m_items;
+	};
+
+	// KsonFlatMap
+	template<typename V>
+	KsonFlatMap<V>::KsonFlatMap(container_type&& items) : m_items(std::move(items)) {
+
+		// 已经按 key 严格递增时不需要排序
+		bool isSorted = true;
+		for (size_type i = 1; i < m_items.size() && isSorted; ++i) {
+			isSorted = m_items[i - 1].first < m_items[i].first;
+		}
+		if (isSorted) return;
+
+		// 成员较少时插入排序（稳定，不需要额外的内存）
+		if (m_items.size() <= INSERTION_SORT_MAX) {
+			for (size_type i = 1; i < m_items.size(); ++i) {
+				if (!(m_items[i].first < m_items[i - 1].first)) continue;
+				value_type item = std::move(m_items[i]);
+				size_type j = i;
+				for (; j > 0 && item.first < m_items[j - 1].first; --j) {
+					m_items[j] = std::move(m_items[j - 1]);
+				}
+				m_items[j] = std::move(item);
+			}
+			dedup();
+			return;
+		}
+
+		// 成员较多时只对下标排序（相同的 key 按出现的顺序），每个成员只移动一次
+		std::vector<uint32_t> order(m_items.size());
+		for (size_type i = 0; i < order.size(); ++i) {
+			order[i] = static_cast<uint32_t>(i);
+		}
+		std::sort(order.begin(), order.end(), [&](uint32_t i, uint32_t j) {
+			int ret = m_items[i].first.compare(m_items[j].first);
+			return ret != 0 ? ret < 0 : i < j;
+		});
+
+		container_type sorted;
+		sorted.reserve(m_items.size());
+		for (uint32_t i : order) {
+			sorted.push_back(std::move(m_items[i]));
+		}
+		m_items.swap(sorted);
+		dedup();
+	}
+
+	// dedup: 重复的 key 保留最后一个
+	template<typename V>
+	void KsonFlatMap<V>::dedup() {
+		auto out = m_items.begin();
+		for (auto iter = m_items.begin(); iter != m_items.end(); ) {
+			auto next = iter + 1;
+			while (next != m_items.end() && next->first == iter->first) {
+				iter = next++;
+			}
+			if (out != iter) {
+				*out = std::move(*iter);
+			}
+			++out;
+			iter = next;
+		}
+		m_items.erase(out, m_items.end());
+	}
+
+	// find
+	template<typename V>
+	typename KsonFlatMap<V>::iterator KsonFlatMap<V>::find(std::string_view key) {
+		auto iter = static_cast<const KsonFlatMap&>(*this).find(key);
+		return m_items.begin() + (iter - m_items.cbegin());
+	}
+
+	// find: const
+	template<typename V>
+	typename KsonFlatMap<V>::const_iterator KsonFlatMap<V>::find(std::string_view key) const {
+		if (m_items.size() <= LINEAR_SEARCH_MAX) {
+			for (auto iter = m_items.begin(); iter != m_items.end(); ++iter) {
+				if (iter->first == key) return iter;
+			}
+			return m_items.end();
+		}
+
+		auto iter = lowerBound(key);
+		return (iter != m_items.end() && iter->first == key) ? iter : m_items.end();
+	}
+
+	// at
+	template<typename V>
+	V& KsonFlatMap<V>::at(std::string_view key) {
+		return const_cast<V&>(static_cast<const KsonFlatMap&>(*this).at(key));
+	}
+
+	// at: const
+	template<typename V>
+	const V& KsonFlatMap<V>::at(std::string_view key) const {
+		auto iter = find(key);
+		if (iter == m_items.end()) {
+			throw std::out_of_range("KsonObject::at: key '" + std::string(key) + "' not found");
+		}
+		return iter->second;
+	}
+
+	// emplace
+	template<typename V>
+	template<typename K, typename T>
+	std::pair<typename KsonFlatMap<V>::iterator, bool> KsonFlatMap<V>::emplace(K&& key, T&& value) {
+		auto pos = lowerBound(key);
+		if (pos != m_items.end() && pos->first == key) {
+			return { m_items.begin() + (pos - m_items.cbegin()), false };
+		}
+		return { m_items.emplace(pos, std::forward<K>(key), std::forward<T>(value)), true };
+	}
+
+	// erase
+	template<typename V>
+	typename KsonFlatMap<V>::size_type KsonFlatMap<V>::erase(std::string_view key) {
+		auto iter = find(key);
+		if (iter == m_items.end()) return 0;
+		m_items.erase(iter);
+		return 1;
+	}
+
+	// lowerBound
+	template<typename V>
+	typename KsonFlatMap<V>::const_iterator KsonFlatMap<V>::lowerBound(std::string_view key) const {
+		return std::lower_bound(m_items.begin(), m_items.end(), key, [](const value_type& item, std::string_view key) {
+			return std::string_view(item.first) < key;
+		});
+	}
+}
+
+#endif
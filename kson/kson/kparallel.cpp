@@ -0,0 +1,252 @@
+﻿#include "stdafx.h"
+#include "kparallel.h"
+#include "kindex.h"
+#include <cstring>
+
+using namespace kson;
+
+namespace {
+
+	// 构建其它部分的 KsonObject：第 ordinals[k] 个 array 替换为并行解析的 arrays[k]（其它部分中它们没有元素）
+	class KsonSpliceHandler : public KsonDomHandler {
+	public:
+		KsonSpliceHandler(const std::vector<size_t>& ordinals, std::vector<KsonValue>& arrays)
+			: m_ordinals(ordinals), m_arrays(arrays) {}
+
+		bool startArray() override {
+			if (m_next < m_ordinals.size() && m_ordinals[m_next] == m_opens++) {
+				m_splicing = true;
+				return true;
+			}
+			return KsonDomHandler::startArray();
+		}
+
+		bool endArray() override {
+			if (m_splicing) {
+				m_splicing = false;
+				return value(std::move(m_arrays[m_next++]));
+			}
+			return KsonDomHandler::endArray();
+		}
+
+	private:
+		const std::vector<size_t>&  m_ordinals;
+		std::vector<KsonValue>&     m_arrays;
+		size_t                      m_next = 0;        // 下一个替换的 array
+		size_t                      m_opens = 0;       // 已经开始的 array 个数
+		bool                        m_splicing = false;
+	};
+}
+
+//============================================================
+//  ksonParallelParser
+//============================================================
+
+// parse
+std::pair<bool, KsonObject> KsonParallelParser::parse(const std::string& ksonStr) {
+	return parse(ksonStr.data(), ksonStr.size());
+}
+
+// parseFile
+std::pair<bool, KsonObject> KsonParallelParser::parseFile(const std::string& file) {
+	KsonBuffer buf;
+	std::string error;
+	if (!buf.load(file, error)) {
+		m_chunkCount = 0;
+		m_error = error + "\n";
+		return { false, KsonObject() };
+	}
+	return parse(buf.data(), buf.size());
+}
+
+// parse: data
+std::pair<bool, KsonObject> KsonParallelParser::parse(const char* data, size_t size) {
+	m_chunks.clear();
+	m_spliced.clear();
+	m_chunkCount = 0;
+	m_error.clear();
+	m_failed = false;
+
+	// '\0' 为文件结束，之后的内容不属于文档
+	const char* zero = static_cast<const char*>(std::memchr(data, '\0', size));
+	size_t end = zero ? size_t(zero - data) : size;
+
+	// 切分失败时已经提交的段仍然引用 data 和 m_chunks，等它们结束
+	bool ok = split(data, end);
+	m_pool.wait();
+	if (ok && !m_failed && !m_spliced.empty()) {
+		auto ret = splice(data, size);
+		if (ret.first) {
+			m_chunkCount = m_chunks.size();
+			m_chunks.clear();
+			return ret;
+		}
+	}
+
+	m_chunks.clear();
+	return parseSequential(data, size);
+}
+
+// split: 调用者的线程扫描，每凑够 m_chunkSize 字节提交一段
+// 不在其它 array 中的 array 为切分的对象，它的元素之间的 ',' 比它深一层；元素总长度不足一段时不切分，留在其它部分中
+bool KsonParallelParser::split(const char* data, size_t end) {
+	KsonBlockScanner scanner(data, end);
+	KsonBlockScanner::Block block;
+	long long depth = 0;
+	bool isEnded = false;       // 根 object 已经结束，之后只检查不支持的字符
+	bool inArray = false;       // 正在切分一个 array
+	long long arrayDepth = 0;   // 切分的 array 外面的深度
+	size_t opens = 0;           // 其它部分中 '[' 的个数
+	size_t innerOpens = 0;      // 切分的 array 中 '[' 的个数
+	size_t ordinal = 0;
+	size_t open = 0;
+	size_t chunkBegin = 0;
+	size_t firstChunk = 0;
+
+	while (scanner.next(block)) {
+		if (block.m_invalid || m_failed) return false;
+		if (isEnded) continue;
+
+		uint64_t bits = block.m_struct;
+		while (bits) {
+			size_t pos = block.m_base + lowestBit(bits);
+			bits &= bits - 1;
+
+			switch (data[pos]) {
+			case '[':
+				if (inArray) {
+					++innerOpens;
+				}
+				else {
+					inArray = true;
+					arrayDepth = depth;
+					ordinal = opens++;
+					open = pos;
+					chunkBegin = pos + 1;
+					innerOpens = 0;
+					firstChunk = m_chunks.size();
+				}
+				++depth;
+				break;
+
+			case '{':
+				++depth;
+				break;
+
+			case ']':
+			case '}':
+				if (--depth < 0) return false;
+				if (inArray && depth == arrayDepth) {
+					inArray = false;
+					if (data[pos] != ']') return false;
+
+					if (m_chunks.size() == firstChunk && pos - chunkBegin < m_chunkSize) {
+						opens += innerOpens;
+					}
+					else {
+						submit(data, chunkBegin, pos);
+						m_spliced.push_back({ ordinal, open, pos, firstChunk, m_chunks.size() });
+					}
+				}
+				if (depth == 0) {
+					isEnded = true;
+					bits = 0;
+				}
+				break;
+
+			case ',':
+				if (inArray && depth == arrayDepth + 1 && pos + 1 - chunkBegin >= m_chunkSize) {
+					submit(data, chunkBegin, pos + 1);
+					chunkBegin = pos + 1;
+				}
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+	return isEnded;
+}
+
+// submit
+void KsonParallelParser::submit(const char* data, size_t begin, size_t end) {
+	m_chunks.push_back({ begin, end, KsonArray() });
+	Chunk* chunk = &m_chunks.back();
+	m_pool.submit([this, data, chunk]() { parseChunk(data, *chunk); });
+}
+
+// parseChunk: 作为根 object 中的 array 解析，'\n' 结束段末尾可能有的行注释
+void KsonParallelParser::parseChunk(const char* data, Chunk& chunk) {
+	if (m_failed) return;
+
+	std::string text;
+	text.reserve(chunk.m_end - chunk.m_begin + 8);
+	text += "{a:[";
+	text.append(data + chunk.m_begin, chunk.m_end - chunk.m_begin);
+	text += "\n]}";
+
+	KsonBuffer buf;
+	buf.borrow(text.data(), text.size());
+	Kson kson(std::move(buf));
+	auto ret = kson.parse();
+	if (!ret.first) {
+		m_failed = true;
+		return;
+	}
+
+	KsonValue& value = ret.second.begin()->second;
+	if (value.m_array) {
+		chunk.m_elems = std::move(*value.m_array);
+	}
+}
+
+// splice: 其它部分为去掉各个 array 的元素（保留 '[' 和 ']'）之后的文本
+std::pair<bool, KsonObject> KsonParallelParser::splice(const char* data, size_t size) {
+	std::string rest;
+	std::vector<size_t> ordinals;
+	std::vector<KsonValue> arrays;
+	size_t from = 0;
+	for (const Spliced& spliced : m_spliced) {
+		rest.append(data + from, spliced.m_open + 1 - from);
+		from = spliced.m_close;
+
+		size_t count = 0;
+		for (size_t i = spliced.m_firstChunk; i < spliced.m_lastChunk; ++i) {
+			count += m_chunks[i].m_elems.size();
+		}
+		KsonArray elems;
+		elems.reserve(count);
+		for (size_t i = spliced.m_firstChunk; i < spliced.m_lastChunk; ++i) {
+			KsonArray& part = m_chunks[i].m_elems;
+			elems.insert(elems.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+			KsonArray().swap(part);
+		}
+
+		ordinals.push_back(spliced.m_ordinal);
+		arrays.emplace_back();
+		arrays.back().setArray(std::move(elems));
+	}
+	rest.append(data + from, size - from);
+
+	KsonBuffer buf;
+	buf.borrow(rest.data(), rest.size());
+	Kson kson(std::move(buf));
+	KsonSpliceHandler handler(ordinals, arrays);
+	if (!kson.parse(handler)) {
+		return { false, KsonObject() };
+	}
+	return { true, handler.release() };
+}
+
+// parseSequential
+std::pair<bool, KsonObject> KsonParallelParser::parseSequential(const char* data, size_t size) {
+	KsonBuffer buf;
+	buf.borrow(data, size);
+	Kson kson(std::move(buf));
+	auto ret = kson.parse();
+	if (!ret.first) {
+		m_error = kson.getErrorInfo();
+	}
+	return ret;
+}
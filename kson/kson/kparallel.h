@@ -0,0 +1,96 @@
+﻿#ifndef __K_PARALLEL_H__
+#define __K_PARALLEL_H__
+
+#include "kson.h"
+#include "kpool.h"
+#include <atomic>
+
+//============================================================
+//  ksonParallelParser: 大数组的多线程解析
+//============================================================
+
+// 根 object 中较大的 array（例如 { records: [ {...}, {...}, ... ] }）按元素切分为若干段，在线程池中并行解析，再按顺序拼接：
+//
+//     { records: [ e0, e1, e2, e3, e4 ] }   ->   段: "e0, e1,"  " e2, e3,"  " e4 "     其它部分: { records: [] }
+//
+// 切分由调用者的线程完成：用 KsonBlockScanner 扫描一遍文本（跳过字符串和注释），按嵌套深度找到元素之间的 ','，
+// 每凑够 chunkSize 字节就提交一段，扫描与各段的解析同时进行；其它部分去掉这些 array 的元素后由 Kson 解析
+// 任何一部分出错（或有不支持的字符）时用 Kson 重新解析整个文本，结果和错误信息（包括行号）与 Kson::parse() 相同
+//
+//     KsonParallelParser parser(8);
+//     auto ret = parser.parseFile("records.kson");
+
+namespace kson {
+
+	class KsonParallelParser {
+	public:
+		// threads 为解析线程数，为 0 时使用 std::thread::hardware_concurrency()
+		explicit KsonParallelParser(size_t threads = 0) : m_pool(threads) {}
+		KsonParallelParser(const KsonParallelParser&) = delete;
+		KsonParallelParser& operator=(const KsonParallelParser&) = delete;
+
+		// 解析 kson 字符串
+		std::pair<bool, KsonObject> parse(const std::string& ksonStr);
+
+		// 解析 kson 文件（KsonBuffer 读入）
+		std::pair<bool, KsonObject> parseFile(const std::string& file);
+
+		// 解析 data，调用者保证 data[size] == '\0'
+		std::pair<bool, KsonObject> parse(const char* data, size_t size);
+
+		// 每段的字节数（默认 1MB），元素总长度不足一段的 array 不切分
+		void setChunkSize(size_t size) { m_chunkSize = size > 0 ? size : 1; }
+
+		// 解析线程数
+		size_t threadCount() const { return m_pool.size(); }
+
+		// 最近一次解析切分出的段数，0 表示没有并行解析（没有较大的 array，或出错后由 Kson 重新解析）
+		size_t chunkCount() const { return m_chunkCount; }
+
+		// 获取解析过程中的错误信息
+		std::string getErrorInfo() const { return m_error; }
+
+	private:
+		// 切分出的一段：[m_begin, m_end) 为若干个元素及其后的 ','
+		struct Chunk {
+			size_t     m_begin;
+			size_t     m_end;
+			KsonArray  m_elems;     // 解析结果
+		};
+
+		// 并行解析的 array：第 m_ordinal 个 '['（其它部分中的顺序），元素来自 [m_firstChunk, m_lastChunk) 段
+		struct Spliced {
+			size_t  m_ordinal;
+			size_t  m_open;         // '[' 的位置
+			size_t  m_close;        // ']' 的位置
+			size_t  m_firstChunk;
+			size_t  m_lastChunk;
+		};
+
+		// 扫描并提交各段，返回 false 表示需要由 Kson 重新解析
+		bool split(const char* data, size_t end);
+
+		// 提交 [begin, end) 为一段
+		void submit(const char* data, size_t begin, size_t end);
+
+		// 解析一段（在线程池中执行）
+		void parseChunk(const char* data, Chunk& chunk);
+
+		// 解析其它部分，并拼接各段的结果
+		std::pair<bool, KsonObject> splice(const char* data, size_t size);
+
+		// 用 Kson 解析整个文本
+		std::pair<bool, KsonObject> parseSequential(const char* data, size_t size);
+
+	private:
+		KsonThreadPool       m_pool;
+		size_t               m_chunkSize = 1 << 20;
+		std::deque<Chunk>    m_chunks;        // 提交后位置不变，解析线程直接写入
+		std::atomic<bool>    m_failed{ false };  // 某一段解析失败，其余的段不再解析
+		std::vector<Spliced> m_spliced;
+		size_t               m_chunkCount = 0;
+		std::string          m_error;
+	};
+}
+
+#endif
@@ -0,0 +1,227 @@
+﻿#include "stdafx.h"
+#include "kpath.h"
+#include <unordered_map>
+
+using namespace kson;
+
+namespace {
+
+	// 一步的 key 为十进制整数（没有多余的前导 0）时也是 array 的下标
+	void setIndex(KsonPathStep& step) {
+		const std::string& key = step.m_key;
+		step.m_isWildcard = key == "*";
+		step.m_index = KsonPathStep::NO_INDEX;
+		if (key.empty() || key.size() > 18 || (key.size() > 1 && key[0] == '0')) return;
+		size_t index = 0;
+		for (char c : key) {
+			if (c < '0' || c > '9') return;
+			index = index * 10 + (c - '0');
+		}
+		step.m_index = index;
+	}
+
+	// JSON Pointer: "/a/b~1c/0"
+	bool parsePointer(const std::string& path, std::vector<KsonPathStep>& steps, std::string& error) {
+		for (size_t i = 0; i < path.size(); ) {
+			KsonPathStep step;
+			for (++i; i < path.size() && path[i] != '/'; ++i) {
+				if (path[i] != '~') {
+					step.m_key += path[i];
+					continue;
+				}
+				char next = i + 1 < path.size() ? path[i + 1] : '\0';
+				if (next != '0' && next != '1') {
+					error = "invalid path '" + path + "': '~' at " + std::to_string(i) + " must be followed by '0' or '1'";
+					return false;
+				}
+				step.m_key += next == '0' ? '~' : '/';
+				++i;
+			}
+			setIndex(step);
+			steps.push_back(std::move(step));
+		}
+		return true;
+	}
+
+	// 点号和下标: "a.b[0].c"、"a[*]"
+	bool parseDotted(const std::string& path, std::vector<KsonPathStep>& steps, std::string& error) {
+		auto fail = [&](size_t pos, const char* msg) {
+			error = "invalid path '" + path + "': " + msg + " at " + std::to_string(pos);
+			return false;
+		};
+
+		size_t i = 0;
+		while (i < path.size()) {
+			KsonPathStep step;
+			if (path[i] == '[') {
+				size_t end = path.find(']', i);
+				if (end == std::string::npos) return fail(i, "unclosed '['");
+				step.m_key = path.substr(i + 1, end - i - 1);
+				setIndex(step);
+				if (!step.m_isWildcard && step.m_index == KsonPathStep::NO_INDEX) return fail(i, "expect an index or '*' in '[]'");
+				i = end + 1;
+			}
+			else {
+				size_t end = path.find_first_of(".[", i);
+				if (end == std::string::npos) end = path.size();
+				if (end == i) return fail(i, "empty key");
+				step.m_key = path.substr(i, end - i);
+				setIndex(step);
+				i = end;
+			}
+			steps.push_back(std::move(step));
+
+			// 下一步之前为 '.' 或 '['
+			if (i < path.size() && path[i] == '.') {
+				if (++i == path.size()) return fail(i, "empty key");
+				if (path[i] == '.' || path[i] == '[') return fail(i, "empty key");
+			}
+			else if (i < path.size() && path[i] != '[') {
+				return fail(i, "expect '.' or '['");
+			}
+		}
+		return true;
+	}
+}
+
+//============================================================
+//  ksonPath
+//============================================================
+
+// compile
+bool KsonPath::compile(const std::string& path, std::string& error) {
+	std::vector<KsonPathStep> steps;
+	bool ret = path.empty() || path[0] == '/'
+		? parsePointer(path, steps, error)
+		: parseDotted(path, steps, error);
+	if (!ret) return false;
+
+	m_path = path;
+	m_steps = std::move(steps);
+	m_isWildcard = false;
+	for (const auto& step : m_steps) {
+		m_isWildcard = m_isWildcard || step.m_isWildcard;
+	}
+	return true;
+}
+
+// first: KsonObject
+const KsonValue* KsonPath::first(const KsonObject& root) const {
+	const KsonValue* found = nullptr;
+	forEach(root, [&found](const KsonValue& val) {
+		found = &val;
+		return false;
+	});
+	return found;
+}
+
+// first: KsonValue
+const KsonValue* KsonPath::first(const KsonValue& root) const {
+	const KsonValue* found = nullptr;
+	forEach(root, [&found](const KsonValue& val) {
+		found = &val;
+		return false;
+	});
+	return found;
+}
+
+// count: KsonObject
+size_t KsonPath::count(const KsonObject& root) const {
+	return forEach(root, [](const KsonValue&) { return true; });
+}
+
+// count: KsonValue
+size_t KsonPath::count(const KsonValue& root) const {
+	return forEach(root, [](const KsonValue&) { return true; });
+}
+
+//============================================================
+//  ksonPathSet
+//============================================================
+
+// add: 字符串
+bool KsonPathSet::add(const std::string& path, std::string& error) {
+	KsonPath compiled;
+	if (!compiled.compile(path, error)) return false;
+	add(compiled);
+	return true;
+}
+
+// add
+void KsonPathSet::add(const KsonPath& path) {
+	m_steps.push_back(path.steps());
+	m_isDirty = true;
+}
+
+// build: 由 m_steps 重新建立 m_nodes 和 m_pathList，按层建立，同一个节点的子节点连续存放
+void KsonPathSet::build() {
+	if (!m_isDirty) return;
+	m_isDirty = false;
+	m_nodes.assign(1, Node());
+	m_pathList.clear();
+
+	// 待处理的节点和经过它的路径，按层处理（depth 为当前层的深度）
+	struct Pending {
+		uint32_t               m_node;
+		std::vector<uint32_t>  m_paths;
+	};
+	std::vector<Pending> pending(1);
+	for (uint32_t i = 0; i < m_steps.size(); ++i) {
+		pending[0].m_paths.push_back(i);
+	}
+
+	for (size_t head = 0, depth = 0, levelEnd = 1; head < pending.size(); ++head) {
+		if (head == levelEnd) {
+			++depth;
+			levelEnd = pending.size();
+		}
+		uint32_t node = pending[head].m_node;
+		std::vector<uint32_t> paths = std::move(pending[head].m_paths);
+
+		// 在这里结束的路径（空路径在 KsonObject 为根时没有匹配，不记录在根上）
+		m_nodes[node].m_paths = static_cast<uint32_t>(m_pathList.size());
+		for (uint32_t path : paths) {
+			if (m_steps[path].size() == depth && node != 0) m_pathList.push_back(path);
+		}
+		m_nodes[node].m_pathEnd = static_cast<uint32_t>(m_pathList.size());
+
+		// 按下一步分组，组的顺序为通配符、下标、其它的 key，同类中按第一次出现的顺序
+		// （同类中 key 相同即为同一步，按 key 查找组，同一层有很多不同的 key 时不是 O(N^2)）
+		std::vector<std::vector<uint32_t>> groups;
+		std::unordered_map<std::string, size_t> groupOf;
+		for (int kind = 0; kind < 3; ++kind) {
+			groupOf.clear();
+			for (uint32_t path : paths) {
+				if (m_steps[path].size() == depth) continue;
+				const KsonPathStep& step = m_steps[path][depth];
+				int stepKind = step.m_isWildcard ? 0 : (step.m_index != KsonPathStep::NO_INDEX ? 1 : 2);
+				if (stepKind != kind) continue;
+
+				auto inserted = groupOf.emplace(step.m_key, groups.size());
+				if (inserted.second) groups.emplace_back();
+				groups[inserted.first->second].push_back(path);
+			}
+			if (kind == 0) m_nodes[node].m_indexes = static_cast<uint32_t>(m_nodes.size() + groups.size());
+			if (kind == 1) m_nodes[node].m_keys = static_cast<uint32_t>(m_nodes.size() + groups.size());
+		}
+
+		uint32_t children = static_cast<uint32_t>(m_nodes.size());
+		m_nodes[node].m_children = children;
+		m_nodes[node].m_childEnd = static_cast<uint32_t>(children + groups.size());
+		for (size_t i = 0; i < groups.size(); ++i) {
+			const KsonPathStep& step = m_steps[groups[i][0]][depth];
+			m_nodes.emplace_back();
+			m_nodes.back().m_key = step.m_key;
+			m_nodes.back().m_index = step.m_index;
+			pending.push_back(Pending{ static_cast<uint32_t>(children + i), std::move(groups[i]) });
+		}
+	}
+}
+
+// first
+void KsonPathSet::first(const KsonObject& root, std::vector<const KsonValue*>& results) const {
+	results.assign(m_steps.size(), nullptr);
+	forEach(root, [&results](size_t index, const KsonValue& val) {
+		if (!results[index]) results[index] = &val;
+	});
+}
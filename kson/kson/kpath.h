@@ -0,0 +1,237 @@
+﻿#ifndef __K_PATH_H__
+#define __K_PATH_H__
+
+#include "kson.h"
+#include <cstdint>
+
+//============================================================
+//  ksonPath: 编译后可重复使用的路径查询
+//============================================================
+
+// 路径有两种写法，编译后相同：
+//
+//     JSON Pointer:  "/servers/3/limits/qps"   "/servers/*/port"   "/a~1b/c~0d"（~1 为 '/'，~0 为 '~'）
+//     点号和下标:     "servers[3].limits.qps"   "servers[*].port"
+//
+// 每一步在 object 上按 key 查找，在 array 上按下标查找（key 为十进制整数时）；
+// "*" 在 array 上匹配所有元素，在 object 上仍然是名为 "*" 的 key；"" 为根本身（只在以 KsonValue 为根时匹配）
+//
+//     KsonPath qps;
+//     std::string error;
+//     if (!qps.compile("servers[3].limits.qps", error)) std::cout << error;
+//     const KsonValue* val = qps.first(obj);        // 没有匹配时为 nullptr
+//     qps.forEach(obj, [](const KsonValue& val) { ...; return true; });
+//
+// 查询时不分配内存、不拷贝子树，返回的指针指向文档中的值
+
+namespace kson {
+
+	// 路径中的一步
+	struct KsonPathStep {
+		static constexpr size_t NO_INDEX = static_cast<size_t>(-1);
+
+		std::string  m_key;                   // object 的 key
+		size_t       m_index = NO_INDEX;      // array 的下标，m_key 不是十进制整数时为 NO_INDEX
+		bool         m_isWildcard = false;    // "*"：array 的所有元素
+
+		bool operator==(const KsonPathStep& other) const { return m_key == other.m_key && m_isWildcard == other.m_isWildcard; }
+	};
+
+	class KsonPath {
+	public:
+
+		// 编译路径，格式错误时返回 false，error 中给出原因
+		bool compile(const std::string& path, std::string& error);
+
+		// 第一个匹配的值（按文档中的顺序），没有时返回 nullptr
+		const KsonValue* first(const KsonObject& root) const;
+		const KsonValue* first(const KsonValue& root) const;
+
+		// 依次对每个匹配的值调用 func(const KsonValue&)，func 返回 false 时停止；返回已经调用的次数
+		template<typename Func>
+		size_t forEach(const KsonObject& root, Func&& func) const;
+		template<typename Func>
+		size_t forEach(const KsonValue& root, Func&& func) const;
+
+		// 匹配的个数
+		size_t count(const KsonObject& root) const;
+		size_t count(const KsonValue& root) const;
+
+		const std::string&                str() const { return m_path; }
+		const std::vector<KsonPathStep>&  steps() const { return m_steps; }
+
+		// 是否含有通配符（可能有多个匹配）
+		bool isWildcard() const { return m_isWildcard; }
+
+	private:
+		template<typename Func>
+		bool visit(const KsonValue& val, size_t step, Func& func, size_t& count) const;
+		template<typename Func>
+		bool visitObject(const KsonObject& obj, size_t step, Func& func, size_t& count) const;
+
+	private:
+		std::string                m_path;
+		std::vector<KsonPathStep>  m_steps;
+		bool                       m_isWildcard = false;
+	};
+
+	// 一组路径：共同的前缀合并为一棵树，一次遍历得到所有路径的结果（共同的前缀只查找一次，每个 array 只遍历一次）
+	//
+	//     KsonPathSet paths;
+	//     paths.add("/listen/port", error);         // 编号 0
+	//     paths.add("/servers/*/port", error);      // 编号 1
+	//     paths.build();                            // 添加完之后建立树，之后的查询只读
+	//     std::vector<const KsonValue*> results;
+	//     paths.first(obj, results);                // results[i] 为第 i 个路径的第一个匹配
+	class KsonPathSet {
+	public:
+
+		// 添加路径，编号为添加前的 size()；格式错误时返回 false，error 中给出原因
+		// 添加只记录路径，由 build() 一次建立树（添加 N 个路径为 O(N)）
+		bool add(const std::string& path, std::string& error);
+		void add(const KsonPath& path);
+
+		// 由添加的路径建立树，没有新添加的路径时不做任何事；查询之前调用
+		// 查询不修改 KsonPathSet，build() 之后可以在多个线程中同时查询；build() 之后添加的路径在下一次 build() 之前没有匹配
+		void build();
+
+		size_t size() const { return m_steps.size(); }
+
+		// 每个路径的第一个匹配，没有匹配时为 nullptr；results 的大小设为 size()（重复使用同一个 vector 时不再分配）
+		void first(const KsonObject& root, std::vector<const KsonValue*>& results) const;
+
+		// 对每个匹配调用 func(size_t index, const KsonValue& val)，同一个路径的匹配按文档中的顺序
+		template<typename Func>
+		void forEach(const KsonObject& root, Func&& func) const;
+
+	private:
+
+		// 树的节点，m_nodes[0] 为根；每个节点的子节点在 m_nodes 中连续存放，依次为通配符、下标、其它的 key
+		struct Node {
+			std::string  m_key;
+			size_t       m_index = KsonPathStep::NO_INDEX;
+			uint32_t     m_children = 0;      // 子节点 m_nodes[m_children, m_childEnd)，其中 array 上的通配符为 [m_children, m_indexes)，
+			uint32_t     m_indexes = 0;       // 下标为 [m_indexes, m_keys)
+			uint32_t     m_keys = 0;
+			uint32_t     m_childEnd = 0;
+			uint32_t     m_paths = 0;         // 在这个节点结束的路径 m_pathList[m_paths, m_pathEnd)
+			uint32_t     m_pathEnd = 0;
+		};
+
+		template<typename Func>
+		void visit(const KsonValue& val, uint32_t node, Func& func) const;
+		template<typename Func>
+		void visitObject(const KsonObject& obj, uint32_t node, Func& func) const;
+
+	private:
+		std::vector<std::vector<KsonPathStep>>  m_steps;      // 每个路径的步骤
+		std::vector<Node>                       m_nodes;
+		std::vector<uint32_t>                   m_pathList;
+		bool                                    m_isDirty = false;   // 添加了路径，还没有建立树
+	};
+
+	// forEach: KsonObject
+	template<typename Func>
+	size_t KsonPath::forEach(const KsonObject& root, Func&& func) const {
+		size_t count = 0;
+		if (!m_steps.empty()) {
+			visitObject(root, 0, func, count);
+		}
+		return count;
+	}
+
+	// forEach: KsonValue
+	template<typename Func>
+	size_t KsonPath::forEach(const KsonValue& root, Func&& func) const {
+		size_t count = 0;
+		visit(root, 0, func, count);
+		return count;
+	}
+
+	// visit: 返回 false 表示 func 要求停止
+	template<typename Func>
+	bool KsonPath::visit(const KsonValue& val, size_t step, Func& func, size_t& count) const {
+		if (step == m_steps.size()) {
+			++count;
+			return func(val);
+		}
+
+		switch (val.getType()) {
+		case KsonType::OBJECT:
+			return visitObject(val.objectRef(), step, func, count);
+		case KsonType::ARRAY: {
+			const KsonPathStep& cur = m_steps[step];
+			const KsonArray& arr = val.arrayRef();
+			if (cur.m_isWildcard) {
+				for (const KsonValue& elem : arr) {
+					if (!visit(elem, step + 1, func, count)) return false;
+				}
+				return true;
+			}
+			return cur.m_index < arr.size() ? visit(arr[cur.m_index], step + 1, func, count) : true;
+		}
+		default:
+			return true;
+		}
+	}
+
+	// visitObject
+	template<typename Func>
+	bool KsonPath::visitObject(const KsonObject& obj, size_t step, Func& func, size_t& count) const {
+		auto iter = obj.find(m_steps[step].m_key);
+		return iter != obj.end() ? visit(iter->second, step + 1, func, count) : true;
+	}
+
+	// forEach
+	template<typename Func>
+	void KsonPathSet::forEach(const KsonObject& root, Func&& func) const {
+		if (!m_nodes.empty()) visitObject(root, 0, func);
+	}
+
+	// visit: val 与 node 匹配
+	template<typename Func>
+	void KsonPathSet::visit(const KsonValue& val, uint32_t node, Func& func) const {
+		const Node& cur = m_nodes[node];
+		for (uint32_t i = cur.m_paths; i < cur.m_pathEnd; ++i) {
+			func(static_cast<size_t>(m_pathList[i]), val);
+		}
+		if (cur.m_children == cur.m_childEnd) return;
+
+		switch (val.getType()) {
+		case KsonType::OBJECT:
+			visitObject(val.objectRef(), node, func);
+			break;
+		case KsonType::ARRAY: {
+			const KsonArray& arr = val.arrayRef();
+
+			// 通配符：每个元素交给所有通配符的子节点，array 只遍历一次
+			if (cur.m_children < cur.m_indexes) {
+				for (const KsonValue& elem : arr) {
+					for (uint32_t child = cur.m_children; child < cur.m_indexes; ++child) {
+						visit(elem, child, func);
+					}
+				}
+			}
+			for (uint32_t child = cur.m_indexes; child < cur.m_keys; ++child) {
+				size_t index = m_nodes[child].m_index;
+				if (index < arr.size()) visit(arr[index], child, func);
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	// visitObject
+	template<typename Func>
+	void KsonPathSet::visitObject(const KsonObject& obj, uint32_t node, Func& func) const {
+		const Node& cur = m_nodes[node];
+		for (uint32_t child = cur.m_children; child < cur.m_childEnd; ++child) {
+			auto iter = obj.find(m_nodes[child].m_key);
+			if (iter != obj.end()) visit(iter->second, child, func);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,67 @@
+﻿#include "stdafx.h"
+#include "kpool.h"
+
+using namespace kson;
+
+//============================================================
+//  ksonThreadPool
+//============================================================
+
+// KsonThreadPool
+KsonThreadPool::KsonThreadPool(size_t threads) {
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+		if (threads == 0) threads = 1;
+	}
+	m_threads.reserve(threads);
+	for (size_t i = 0; i < threads; ++i) {
+		m_threads.emplace_back(&KsonThreadPool::run, this);
+	}
+}
+
+// ~KsonThreadPool
+KsonThreadPool::~KsonThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_taskCond.notify_all();
+	for (std::thread& thread : m_threads) {
+		thread.join();
+	}
+}
+
+// submit
+void KsonThreadPool::submit(Task task) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_taskCond.notify_one();
+}
+
+// wait
+void KsonThreadPool::wait() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCond.wait(lock, [this]() { return m_tasks.empty() && m_running == 0; });
+}
+
+// run: 工作线程，队列为空并且需要结束时退出
+void KsonThreadPool::run() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_taskCond.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+		if (m_tasks.empty()) return;
+
+		Task task = std::move(m_tasks.front());
+		m_tasks.pop_front();
+		++m_running;
+		lock.unlock();
+		task();
+		lock.lock();
+		--m_running;
+		if (m_tasks.empty() && m_running == 0) {
+			m_doneCond.notify_all();
+		}
+	}
+}
@@ -0,0 +1,56 @@
+﻿#ifndef __K_POOL_H__
+#define __K_POOL_H__
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//============================================================
+//  ksonThreadPool: 固定线程数的任务队列
+//============================================================
+
+// 任务按提交的顺序开始执行（完成的顺序不确定），析构时执行完剩余的任务再结束线程
+//
+//     KsonThreadPool pool(4);
+//     for (auto& part : parts) pool.submit([&part]() { parse(part); });
+//     pool.wait();
+
+namespace kson {
+
+	class KsonThreadPool {
+	public:
+		using Task = std::function<void()>;
+
+		// threads 为 0 时使用 std::thread::hardware_concurrency()（至少 1 个）
+		explicit KsonThreadPool(size_t threads = 0);
+		KsonThreadPool(const KsonThreadPool&) = delete;
+		KsonThreadPool& operator=(const KsonThreadPool&) = delete;
+		~KsonThreadPool();
+
+		// 提交任务，任务中不能抛出异常
+		void submit(Task task);
+
+		// 等待已经提交的任务全部完成
+		void wait();
+
+		// 线程数
+		size_t size() const { return m_threads.size(); }
+
+	private:
+		void run();
+
+	private:
+		std::vector<std::thread>  m_threads;
+		std::deque<Task>          m_tasks;        // 等待执行的任务
+		size_t                    m_running = 0;  // 正在执行的任务个数
+		bool                      m_stop = false;
+		std::mutex                m_mutex;
+		std::condition_variable   m_taskCond;     // 有新的任务，或需要结束
+		std::condition_variable   m_doneCond;     // 任务全部完成
+	};
+}
+
+#endif
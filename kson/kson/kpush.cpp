@@ -0,0 +1,504 @@
+﻿#include "stdafx.h"
+#include "kpush.h"
+
+#define END_OF_FILE '\0'
+
+using namespace kson;
+
+//============================================================
+//  ksonPushParser: 增量解析器
+//============================================================
+
+// feed
+bool KsonPushParser::feed(const char* data, size_t size) {
+	size_t i = 0;
+	while (i < size && m_state != State::DONE && m_state != State::FAILED) {
+
+		// 与 Kson 相同，'\0' 视为文件结束
+		if (data[i] == END_OF_FILE) {
+			end();
+			break;
+		}
+
+		if (step(data[i])) {
+			++i;
+		}
+	}
+	return m_state != State::FAILED;
+}
+
+// finish
+std::pair<bool, KsonObject> KsonPushParser::finish() {
+	end();
+	return { m_state == State::DONE, m_dom.release() };
+}
+
+// reset
+void KsonPushParser::reset() {
+	m_state = State::ROOT;
+	m_commentRet = State::ROOT;
+	m_stack.clear();
+	m_dom.reset();
+	m_str.clear();
+	m_literal = nullptr;
+	m_literalIdx = 0;
+	m_isNeg = false;
+	m_isInt = true;
+	m_isHex = false;
+	m_intPart.clear();
+	m_fracPart.clear();
+	m_expPart.clear();
+	m_error.clear();
+	m_line = 1;
+}
+
+// step
+bool KsonPushParser::step(char c) {
+	switch (m_state) {
+
+	// 根 object
+	case State::ROOT:
+		if (skipWS(c)) return true;
+		if (c == '{') {
+			startContainer(true);
+		}
+		else {
+			unexpected(c, "'{'");
+		}
+		return true;
+
+	// object: key 或 '}'（允许末尾的 ','）
+	case State::KEY_OR_END:
+		if (skipWS(c)) return true;
+		if (c == '}') {
+			endContainer();
+		}
+		else if (isCharClass(c, KSON_CHAR_KEY_START)) {
+			m_str.assign(1, c);
+			m_state = State::KEY;
+		}
+		else {
+			unexpected(c, "'_' or 'a~zA~Z' for key.");
+		}
+		return true;
+
+	// key: 字母/数字/下划线
+	case State::KEY:
+		if (isCharClass(c, KSON_CHAR_KEY)) {
+			m_str.push_back(c);
+			return true;
+		}
+		if (!m_handler->key(m_str.data(), m_str.size())) {
+			fail("stopped by handler");
+			return true;
+		}
+		m_state = State::COLON;
+		return false;
+
+	case State::COLON:
+		if (skipWS(c)) return true;
+		if (c == ':') {
+			m_state = State::VALUE;
+		}
+		else {
+			unexpected(c, "':'");
+		}
+		return true;
+
+	// value
+	case State::VALUE:
+		if (skipWS(c)) return true;
+		return startValue(c);
+
+	// array: value 或 ']'（允许末尾的 ','）
+	case State::VALUE_OR_END:
+		if (skipWS(c)) return true;
+		if (c == ']') {
+			endContainer();
+			return true;
+		}
+		return startValue(c);
+
+	case State::COMMA_OR_END: {
+		if (skipWS(c)) return true;
+		bool isObject = m_stack.back();
+		if (c == ',') {
+			m_state = isObject ? State::KEY_OR_END : State::VALUE_OR_END;
+		}
+		else if (c == (isObject ? '}' : ']')) {
+			endContainer();
+		}
+		else {
+			unexpected(c, "','");
+		}
+		return true;
+	}
+
+	// 字符串，转义字符 \n \t \\ \' \"
+	case State::STR:
+		if (c == '"') {
+			endValue(m_handler->string(m_str.data(), m_str.size()));
+		}
+		else if (c == '\\') {
+			m_state = State::STR_ESCAPE;
+		}
+		else if (isCharClass(c, KSON_CHAR_STR)) {
+			m_str.push_back(c);
+		}
+		else {
+			unexpected(c, "'\"'");
+		}
+		return true;
+
+	// 不支持的转义字符：保留 '\'，之后的字符按普通字符处理
+	case State::STR_ESCAPE:
+		m_state = State::STR;
+		switch (c) {
+		case 'n':  m_str.push_back('\n'); return true;
+		case 't':  m_str.push_back('\t'); return true;
+		case '\\': m_str.push_back('\\'); return true;
+		case '\'': m_str.push_back('\''); return true;
+		case '"':  m_str.push_back('"');  return true;
+		default:
+			m_str.push_back('\\');
+			return false;
+		}
+
+	// true / TRUE / false / FALSE / null / NULL
+	case State::LITERAL:
+		if (c != m_literal[m_literalIdx]) {
+			fail("expect true/TRUE/false/FALSE/null/NULL.");
+			return true;
+		}
+		if (m_literal[++m_literalIdx] == '\0') {
+			if (m_literal[0] == 'n' || m_literal[0] == 'N') {
+				endValue(m_handler->null());
+			}
+			else {
+				endValue(m_handler->boolean(m_literal[0] == 't' || m_literal[0] == 'T'));
+			}
+		}
+		return true;
+
+	// 正负号之后可以有空白和注释
+	case State::NUM_SIGN:
+		if (skipWS(c)) return true;
+		if (!isCharClass(c, KSON_CHAR_DIGIT)) {
+			unexpected(c, "number.");
+			return true;
+		}
+		m_intPart.push_back(c);
+		m_state = (c == '0') ? State::NUM_ZERO : State::NUM_INT;
+		return true;
+
+	// 十六进制
+	case State::NUM_ZERO:
+		if (c == 'x') {
+			m_isHex = true;
+			m_intPart.clear();
+			m_state = State::NUM_HEX_FIRST;
+			return true;
+		}
+		m_state = State::NUM_INT;
+		return false;
+
+	case State::NUM_INT:
+		if (isCharClass(c, KSON_CHAR_DIGIT)) {
+			m_intPart.push_back(c);
+		}
+		else if (c == '.') {
+			m_state = State::NUM_DOT;
+		}
+		else if (c == 'e' || c == 'E') {
+			m_state = State::NUM_EXP_MARK;
+		}
+		else {
+			endNum();
+			return false;
+		}
+		return true;
+
+	// 小数点后必须有数字
+	case State::NUM_DOT:
+		if (!isCharClass(c, KSON_CHAR_DIGIT)) {
+			unexpected(c, "number after '.'");
+			return true;
+		}
+		m_isInt = false;
+		m_fracPart.push_back(c);
+		m_state = State::NUM_FRAC;
+		return true;
+
+	case State::NUM_FRAC:
+		if (isCharClass(c, KSON_CHAR_DIGIT)) {
+			m_fracPart.push_back(c);
+			return true;
+		}
+		m_state = State::NUM_FRAC_WS;
+		return false;
+
+	// 小数部分和 'e' 之间可以有空白和注释
+	case State::NUM_FRAC_WS:
+		if (skipWS(c)) return true;
+		if (c == 'e' || c == 'E') {
+			m_state = State::NUM_EXP_MARK;
+			return true;
+		}
+		endNum();
+		return false;
+
+	// 科学计数法字符 E 后面必须有数字，数字前可以有正负号
+	case State::NUM_EXP_MARK:
+		if (c == '+' || c == '-') {
+			m_expPart.push_back(c);
+			m_state = State::NUM_EXP_SIGN;
+			return true;
+		}
+		m_state = State::NUM_EXP_SIGN;
+		return false;
+
+	case State::NUM_EXP_SIGN:
+		if (!isCharClass(c, KSON_CHAR_DIGIT)) {
+			unexpected(c, "number after 'E'");
+			return true;
+		}
+		m_expPart.push_back(c);
+		m_state = State::NUM_EXP;
+		return true;
+
+	case State::NUM_EXP:
+		if (isCharClass(c, KSON_CHAR_DIGIT)) {
+			m_expPart.push_back(c);
+			return true;
+		}
+		endNum();
+		return false;
+
+	// 0x 后面必须要有数字或a~f或A~F的字符
+	case State::NUM_HEX_FIRST:
+		if (!isCharClass(c, KSON_CHAR_HEX)) {
+			unexpected(c, "number.");
+			return true;
+		}
+		m_intPart.push_back(c);
+		m_state = State::NUM_HEX;
+		return true;
+
+	case State::NUM_HEX:
+		if (isCharClass(c, KSON_CHAR_HEX)) {
+			m_intPart.push_back(c);
+			return true;
+		}
+		endNum();
+		return false;
+
+	// 注释：'/' 之后不是 '/' 或 '*' 时，'/' 留给原来的状态（只有根 object 结束之后才合法）
+	case State::COMMENT_START:
+		if (c == '/') {
+			m_state = State::LINE_COMMENT;
+		}
+		else if (c == '*') {
+			m_state = State::BLOCK_COMMENT;
+		}
+		else if (m_commentRet == State::TRAILING) {
+			m_state = State::DONE;
+		}
+		else {
+			unexpected('/', "value");
+		}
+		return true;
+
+	// 行注释结束的 '\n' 交给原来的状态按空白处理
+	case State::LINE_COMMENT:
+		if (c == '\n') {
+			m_state = m_commentRet;
+			return false;
+		}
+		return true;
+
+	case State::BLOCK_COMMENT:
+		if (c == '*') {
+			m_state = State::BLOCK_COMMENT_STAR;
+		}
+		return true;
+
+	case State::BLOCK_COMMENT_STAR:
+		if (c == '/') {
+			m_state = m_commentRet;
+		}
+		else if (c != '*') {
+			m_state = State::BLOCK_COMMENT;
+		}
+		return true;
+
+	// 根 object 之后：跳过空白和注释，之后的内容忽略
+	case State::TRAILING:
+		if (skipWS(c)) return true;
+		m_state = State::DONE;
+		return true;
+
+	default:
+		return true;
+	}
+}
+
+// skipWS
+bool KsonPushParser::skipWS(char c) {
+	if (isCharClass(c, KSON_CHAR_WS)) {
+		if (c == '\n') {
+			++m_line;
+		}
+		return true;
+	}
+
+	// 注释
+	if (c == '/') {
+		m_commentRet = m_state;
+		m_state = State::COMMENT_START;
+		return true;
+	}
+
+	// charactor: '0' (ASCII: 48) not supported!
+	if (!isCharClass(c, KSON_CHAR_VALID)) {
+		fail(std::string("charactor: '") + c + "' (ASCII: " + std::to_string(int(c)) + ") not supported!");
+		return true;
+	}
+	return false;
+}
+
+// startValue
+bool KsonPushParser::startValue(char c) {
+	switch (c) {
+	case '{':
+		startContainer(true);
+		return true;
+
+	case '[':
+		startContainer(false);
+		return true;
+
+	case '"':
+		m_str.clear();
+		m_state = State::STR;
+		return true;
+
+	case 't': m_literal = "true";  break;
+	case 'T': m_literal = "TRUE";  break;
+	case 'f': m_literal = "false"; break;
+	case 'F': m_literal = "FALSE"; break;
+	case 'n': m_literal = "null";  break;
+	case 'N': m_literal = "NULL";  break;
+
+	// number
+	default:
+		if (c != '+' && c != '-' && !isCharClass(c, KSON_CHAR_DIGIT)) {
+			unexpected(c, "value");
+			return true;
+		}
+		m_isNeg = (c == '-');
+		m_isInt = true;
+		m_isHex = false;
+		m_intPart.clear();
+		m_fracPart.clear();
+		m_expPart.clear();
+		m_state = State::NUM_SIGN;
+
+		// 首字符是数字时在 NUM_SIGN 中重新处理
+		return c == '+' || c == '-';
+	}
+
+	m_literalIdx = 1;
+	m_state = State::LITERAL;
+	return true;
+}
+
+// startContainer
+void KsonPushParser::startContainer(bool isObject) {
+	m_stack.push_back(isObject);
+	m_state = isObject ? State::KEY_OR_END : State::VALUE_OR_END;
+	if (!(isObject ? m_handler->startObject() : m_handler->startArray())) {
+		fail("stopped by handler");
+	}
+}
+
+// endContainer
+void KsonPushParser::endContainer() {
+	bool isObject = m_stack.back();
+	m_stack.pop_back();
+	if (!(isObject ? m_handler->endObject() : m_handler->endArray())) {
+		fail("stopped by handler");
+		return;
+	}
+
+	// 根 object 结束
+	m_state = m_stack.empty() ? State::TRAILING : State::COMMA_OR_END;
+}
+
+// endValue
+void KsonPushParser::endValue(bool handled) {
+	if (!handled) {
+		fail("stopped by handler");
+		return;
+	}
+	m_state = State::COMMA_OR_END;
+}
+
+// endNum
+void KsonPushParser::endNum() {
+	auto num = m_isHex
+		? toKsonHex(m_intPart.data(), m_intPart.size())
+		: toKsonNum(
+			m_isNeg, m_isInt,
+			m_intPart.data(), m_intPart.size(),
+			m_fracPart.data(), m_fracPart.size(),
+			m_expPart.data(), m_expPart.size());
+	if (!num.first) {
+		fail(m_isHex ? "hex number out of range." : "number out of range.");
+		return;
+	}
+	endValue(num.second.m_isInt ? m_handler->integer(num.second.m_int) : m_handler->floating(num.second.m_double));
+}
+
+// end
+void KsonPushParser::end() {
+	switch (m_state) {
+	case State::TRAILING:
+	case State::DONE:
+		m_state = State::DONE;
+		break;
+
+	// 根 object 之后的注释可以不结束
+	case State::COMMENT_START:
+	case State::LINE_COMMENT:
+	case State::BLOCK_COMMENT:
+	case State::BLOCK_COMMENT_STAR:
+		if (m_commentRet == State::TRAILING) {
+			m_state = State::DONE;
+		}
+		else {
+			fail("unexpected  END_OF_FILE");
+		}
+		break;
+
+	case State::FAILED:
+		break;
+
+	default:
+		fail("unexpected  END_OF_FILE");
+		break;
+	}
+}
+
+// fail
+void KsonPushParser::fail(const std::string& errInfo) {
+	m_error += "line ";
+	m_error += std::to_string(m_line);
+	m_error += ": ";
+	m_error += errInfo + "\n";
+	m_state = State::FAILED;
+}
+
+// unexpected
+void KsonPushParser::unexpected(char c, const std::string& expect) {
+	fail(std::string("unexpected  '") + c + "', expect " + expect);
+}
@@ -0,0 +1,119 @@
+﻿#ifndef __K_PUSH_H__
+#define __K_PUSH_H__
+
+#include "kson.h"
+
+//============================================================
+//  ksonPushParser: 增量解析器
+//============================================================
+
+// 按任意大小的数据块输入 kson 文本，解析状态在数据块之间保持（包括字符串、数值、注释和嵌套的容器中）
+// 结果与 Kson::parse() 相同：
+//
+//     KsonPushParser parser;
+//     while (...) parser.feed(buf, len);
+//     auto ret = parser.finish();
+//
+// 传入 KsonHandler 时只发送事件，finish() 返回的 object 为空
+
+namespace kson {
+
+	class KsonPushParser {
+	public:
+		KsonPushParser() : m_handler(&m_dom) { reset(); }
+		explicit KsonPushParser(KsonHandler& handler) : m_handler(&handler) { reset(); }
+		KsonPushParser(const KsonPushParser&) = delete;
+		KsonPushParser& operator=(const KsonPushParser&) = delete;
+
+		// 输入一块数据，返回 false 表示已经出错，之后的输入都会被忽略
+		bool feed(const char* data, size_t size);
+		bool feed(const std::string& str) { return feed(str.data(), str.size()); }
+
+		// 输入结束，返回解析结果
+		std::pair<bool, KsonObject> finish();
+
+		// 获取解析过程中的错误信息
+		std::string getErrorInfo() const { return m_error; }
+
+		// 清空状态，重新开始解析
+		void reset();
+
+	private:
+
+		enum class State : unsigned char {
+			ROOT,                 // 等待根 object 的 '{'
+			KEY_OR_END,           // 等待 key 或 '}'
+			KEY,                  // key 中
+			COLON,                // 等待 ':'
+			VALUE,                // 等待 value
+			VALUE_OR_END,         // 等待 value 或 ']'
+			COMMA_OR_END,         // 等待 ',' 或 '}' / ']'
+			STR,                  // 字符串中
+			STR_ESCAPE,           // 字符串中的 '\' 之后
+			LITERAL,              // true/TRUE/false/FALSE/null/NULL
+			NUM_SIGN,             // 正负号之后
+			NUM_ZERO,             // 首位数字 '0' 之后（可能是十六进制）
+			NUM_INT,              // 整数部分
+			NUM_DOT,              // 小数点之后
+			NUM_FRAC,             // 小数部分
+			NUM_FRAC_WS,          // 小数部分之后的空白（之后还可以有 'e'）
+			NUM_EXP_MARK,         // 'e' / 'E' 之后
+			NUM_EXP_SIGN,         // 指数的正负号之后
+			NUM_EXP,              // 指数部分
+			NUM_HEX_FIRST,        // "0x" 之后
+			NUM_HEX,              // 十六进制数字
+			COMMENT_START,        // '/' 之后
+			LINE_COMMENT,         // 行注释中
+			BLOCK_COMMENT,        // 块注释中
+			BLOCK_COMMENT_STAR,   // 块注释中的 '*' 之后
+			TRAILING,             // 根 object 结束之后
+			DONE,                 // 解析完成，忽略之后的输入
+			FAILED                // 出错，忽略之后的输入
+		};
+
+		// 处理一个字符，返回 false 表示该字符需要在新的状态下重新处理
+		bool step(char c);
+
+		// 跳过空白和注释，返回 true 表示该字符已处理
+		bool skipWS(char c);
+
+		// 开始解析一个 value，返回 false 表示该字符需要在新的状态下重新处理
+		bool startValue(char c);
+		void startContainer(bool isObject);
+		void endContainer();
+
+		// 完成一个 value：检查回调的返回值，进入 COMMA_OR_END
+		void endValue(bool handled);
+		void endNum();
+
+		// 输入结束（finish() 或遇到 '\0'）
+		void end();
+
+		// 记录错误，进入 FAILED 状态
+		void fail(const std::string& errInfo);
+		void unexpected(char c, const std::string& expect);
+
+	private:
+		State              m_state;
+		State              m_commentRet;      // 注释结束后返回的状态
+		std::vector<bool>  m_stack;           // 容器栈：true 为 object，false 为 array
+		KsonHandler*       m_handler;         // 接收事件的 handler
+		KsonDomHandler     m_dom;             // 没有传入 handler 时构建 KsonObject
+
+		std::string        m_str;             // 字符串或 key
+		const char*        m_literal;         // 正在匹配的 true/false/null
+		size_t             m_literalIdx;
+
+		bool               m_isNeg;           // 数值：是否为负数
+		bool               m_isInt;           // 数值：是否为整数
+		bool               m_isHex;           // 数值：是否为十六进制
+		std::string        m_intPart;         // 数值：整数部分（或十六进制数字）
+		std::string        m_fracPart;        // 数值：小数部分
+		std::string        m_expPart;         // 数值：指数部分（可以以正负号开头）
+
+		std::string        m_error;           // 错误信息
+		int                m_line;            // 当前行号
+	};
+}
+
+#endif
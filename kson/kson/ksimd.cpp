@@ -0,0 +1,447 @@
+﻿#include "stdafx.h"
+#include "ksimd.h"
+#include "kson.h"
+#include <atomic>
+
+#if KSON_SIMD
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 的函数需要单独指定编译目标（MSVC 不需要）
+#if KSON_SIMD && (defined(__GNUC__) || defined(_MSC_VER))
+#define KSON_SIMD_AVX2 1
+#if defined(__GNUC__)
+#define KSON_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define KSON_TARGET_AVX2
+#endif
+#else
+#define KSON_SIMD_AVX2 0
+#endif
+
+using namespace kson;
+
+//============================================================
+//  逐字节的实现
+//============================================================
+
+namespace {
+
+	// skipSpace
+	const char* scalarSkipSpace(const char* p, const char* end, int& lines) {
+		while (p < end && isCharClass(*p, KSON_CHAR_WS)) {
+			if (*p == '\n') ++lines;
+			++p;
+		}
+		return p;
+	}
+
+	// findLineEnd
+	const char* scalarFindLineEnd(const char* p, const char* end) {
+		while (p < end && *p != '\n' && *p != '\0') {
+			++p;
+		}
+		return p;
+	}
+
+	// findBlockEnd
+	const char* scalarFindBlockEnd(const char* p, const char* end) {
+		for (; p < end; ++p) {
+			if (*p == '\0') return p;
+			if (*p == '*' && p + 1 < end && p[1] == '/') return p;
+		}
+		return p;
+	}
+
+	// findStrSpecial
+	const char* scalarFindStrSpecial(const char* p, const char* end) {
+		while (p < end && *p != '\\' && isCharClass(*p, KSON_CHAR_STR)) {
+			++p;
+		}
+		return p;
+	}
+
+	// classify
+	void scalarClassify(const char* p, KsonCharMasks& masks) {
+		masks = KsonCharMasks();
+		for (int i = 0; i < 64; ++i) {
+			char c = p[i];
+			uint64_t bit = uint64_t(1) << i;
+			if (c == '"') masks.m_quote |= bit;
+			if (c == '\\') masks.m_backslash |= bit;
+			if (c == '/') masks.m_slash |= bit;
+			if (c == '*') masks.m_star |= bit;
+			if (c == '\n') masks.m_newline |= bit;
+			if (isCharClass(c, KSON_CHAR_WS)) masks.m_space |= bit;
+			if (isCharClass(c, KSON_CHAR_WS) && c != ' ') masks.m_ctrlSpace |= bit;
+			else if (isCharClass(c, KSON_CHAR_STRUCT)) masks.m_struct |= bit;
+			else if (!isCharClass(c, KSON_CHAR_VALID)) masks.m_invalid |= bit;
+		}
+	}
+
+	const KsonScanner s_scalar = {
+		scalarSkipSpace, scalarFindLineEnd, scalarFindBlockEnd, scalarFindStrSpecial, scalarClassify
+	};
+}
+
+
+//============================================================
+//  SSE2 / AVX2 的实现
+//============================================================
+
+// 每次比较 16 / 32 个字节得到位掩码，第 i 位对应 p[i]；剩余不足一组的字节逐个处理
+
+#if KSON_SIMD
+namespace {
+
+	// 最低的为 1 的位，调用者保证 mask 不为 0
+	inline int firstBit(unsigned mask) {
+#if defined(__GNUC__)
+		return __builtin_ctz(mask);
+#else
+		unsigned long idx;
+		_BitScanForward(&idx, mask);
+		return static_cast<int>(idx);
+#endif
+	}
+
+	// 为 1 的位的个数（'\n' 较少，不需要 POPCNT 指令）
+	inline int bitCount(unsigned mask) {
+		int count = 0;
+		for (; mask; mask &= mask - 1) {
+			++count;
+		}
+		return count;
+	}
+
+	// 块注释：mask 为 '*' 或 '\0' 的位置，返回 "*/" 中的 '*' 或 '\0'，没有时返回 nullptr
+	inline const char* checkBlockEnd(const char* p, const char* end, unsigned mask) {
+		for (; mask; mask &= mask - 1) {
+			const char* c = p + firstBit(mask);
+			if (*c == '\0') return c;
+			if (c + 1 < end && c[1] == '/') return c;
+		}
+		return nullptr;
+	}
+
+	// skipSpace
+	const char* sse2SkipSpace(const char* p, const char* end, int& lines) {
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i tab = _mm_set1_epi8('\t');
+		const __m128i cr = _mm_set1_epi8('\r');
+		const __m128i lf = _mm_set1_epi8('\n');
+		for (; end - p >= 16; p += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			__m128i isLf = _mm_cmpeq_epi8(v, lf);
+			__m128i isWS = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+				_mm_or_si128(_mm_cmpeq_epi8(v, cr), isLf));
+			unsigned other = ~static_cast<unsigned>(_mm_movemask_epi8(isWS)) & 0xFFFF;
+			unsigned lfMask = static_cast<unsigned>(_mm_movemask_epi8(isLf));
+			if (other) {
+				int idx = firstBit(other);
+				lines += bitCount(lfMask & ((1u << idx) - 1));
+				return p + idx;
+			}
+			lines += bitCount(lfMask);
+		}
+		return scalarSkipSpace(p, end, lines);
+	}
+
+	// findLineEnd
+	const char* sse2FindLineEnd(const char* p, const char* end) {
+		const __m128i lf = _mm_set1_epi8('\n');
+		const __m128i zero = _mm_setzero_si128();
+		for (; end - p >= 16; p += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+				_mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, zero))));
+			if (mask) return p + firstBit(mask);
+		}
+		return scalarFindLineEnd(p, end);
+	}
+
+	// findBlockEnd
+	const char* sse2FindBlockEnd(const char* p, const char* end) {
+		const __m128i star = _mm_set1_epi8('*');
+		const __m128i zero = _mm_setzero_si128();
+		for (; end - p >= 16; p += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+				_mm_or_si128(_mm_cmpeq_epi8(v, star), _mm_cmpeq_epi8(v, zero))));
+			const char* ret = checkBlockEnd(p, end, mask);
+			if (ret) return ret;
+		}
+		return scalarFindBlockEnd(p, end);
+	}
+
+	// findStrSpecial: '"'、'\\'、小于 ' '（有符号比较，包括 0x80~0xFF）、'\x7f'
+	const char* sse2FindStrSpecial(const char* p, const char* end) {
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i slash = _mm_set1_epi8('\\');
+		const __m128i low = _mm_set1_epi8(' ');
+		const __m128i high = _mm_set1_epi8('~');
+		for (; end - p >= 16; p += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			__m128i special = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+				_mm_or_si128(_mm_cmplt_epi8(v, low), _mm_cmpgt_epi8(v, high)));
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+			if (mask) return p + firstBit(mask);
+		}
+		return scalarFindStrSpecial(p, end);
+	}
+
+	// classify16: 16 个字节的分类位图，顺序与 KsonCharMasks 的成员相同
+	// '[' ']' 与 '{' '}' 只差 0x20 这一位，或上 0x20 后只需要比较两次
+	inline void sse2Classify16(const char* p, unsigned bits[9]) {
+		const __m128i space = _mm_set1_epi8(' ');
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i isLf = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+		__m128i isCtrlSpace = _mm_or_si128(
+			_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), isLf));
+		__m128i isSpace = _mm_or_si128(_mm_cmpeq_epi8(v, space), isCtrlSpace);
+		__m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		__m128i isStruct = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+		__m128i isInvalid = _mm_andnot_si128(isSpace,
+			_mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, _mm_set1_epi8('\x7f'))));
+
+		bits[0] = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))));
+		bits[1] = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+		bits[2] = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('/'))));
+		bits[3] = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('*'))));
+		bits[4] = static_cast<unsigned>(_mm_movemask_epi8(isLf));
+		bits[5] = static_cast<unsigned>(_mm_movemask_epi8(isSpace));
+		bits[6] = static_cast<unsigned>(_mm_movemask_epi8(isCtrlSpace));
+		bits[7] = static_cast<unsigned>(_mm_movemask_epi8(isStruct));
+		bits[8] = static_cast<unsigned>(_mm_movemask_epi8(isInvalid));
+	}
+
+	// classify
+	void sse2Classify(const char* p, KsonCharMasks& masks) {
+		unsigned b0[9], b1[9], b2[9], b3[9];
+		sse2Classify16(p, b0);
+		sse2Classify16(p + 16, b1);
+		sse2Classify16(p + 32, b2);
+		sse2Classify16(p + 48, b3);
+
+		uint64_t bits[9];
+		for (int k = 0; k < 9; ++k) {
+			bits[k] = uint64_t(b0[k]) | (uint64_t(b1[k]) << 16) | (uint64_t(b2[k]) << 32) | (uint64_t(b3[k]) << 48);
+		}
+		masks = { bits[0], bits[1], bits[2], bits[3], bits[4], bits[5], bits[6], bits[7], bits[8] };
+	}
+
+	const KsonScanner s_sse2 = {
+		sse2SkipSpace, sse2FindLineEnd, sse2FindBlockEnd, sse2FindStrSpecial, sse2Classify
+	};
+
+#if KSON_SIMD_AVX2
+
+	// skipSpace
+	KSON_TARGET_AVX2 const char* avx2SkipSpace(const char* p, const char* end, int& lines) {
+		const __m256i space = _mm256_set1_epi8(' ');
+		const __m256i tab = _mm256_set1_epi8('\t');
+		const __m256i cr = _mm256_set1_epi8('\r');
+		const __m256i lf = _mm256_set1_epi8('\n');
+		for (; end - p >= 32; p += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			__m256i isLf = _mm256_cmpeq_epi8(v, lf);
+			__m256i isWS = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)),
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, cr), isLf));
+			unsigned other = ~static_cast<unsigned>(_mm256_movemask_epi8(isWS));
+			unsigned lfMask = static_cast<unsigned>(_mm256_movemask_epi8(isLf));
+			if (other) {
+				int idx = firstBit(other);
+				lines += bitCount(lfMask & ((1u << idx) - 1));
+				return p + idx;
+			}
+			lines += bitCount(lfMask);
+		}
+		return scalarSkipSpace(p, end, lines);
+	}
+
+	// findLineEnd
+	KSON_TARGET_AVX2 const char* avx2FindLineEnd(const char* p, const char* end) {
+		const __m256i lf = _mm256_set1_epi8('\n');
+		const __m256i zero = _mm256_setzero_si256();
+		for (; end - p >= 32; p += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, zero))));
+			if (mask) return p + firstBit(mask);
+		}
+		return scalarFindLineEnd(p, end);
+	}
+
+	// findBlockEnd
+	KSON_TARGET_AVX2 const char* avx2FindBlockEnd(const char* p, const char* end) {
+		const __m256i star = _mm256_set1_epi8('*');
+		const __m256i zero = _mm256_setzero_si256();
+		for (; end - p >= 32; p += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, star), _mm256_cmpeq_epi8(v, zero))));
+			const char* ret = checkBlockEnd(p, end, mask);
+			if (ret) return ret;
+		}
+		return scalarFindBlockEnd(p, end);
+	}
+
+	// findStrSpecial
+	KSON_TARGET_AVX2 const char* avx2FindStrSpecial(const char* p, const char* end) {
+		const __m256i quote = _mm256_set1_epi8('"');
+		const __m256i slash = _mm256_set1_epi8('\\');
+		const __m256i low = _mm256_set1_epi8(' ');
+		const __m256i high = _mm256_set1_epi8('~');
+		for (; end - p >= 32; p += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			__m256i special = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, slash)),
+				_mm256_or_si256(_mm256_cmpgt_epi8(low, v), _mm256_cmpgt_epi8(v, high)));
+			unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(special));
+			if (mask) return p + firstBit(mask);
+		}
+		return scalarFindStrSpecial(p, end);
+	}
+
+	// classify32
+	KSON_TARGET_AVX2 inline void avx2Classify32(const char* p, unsigned bits[9]) {
+		const __m256i space = _mm256_set1_epi8(' ');
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i isLf = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+		__m256i isCtrlSpace = _mm256_or_si256(
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), isLf));
+		__m256i isSpace = _mm256_or_si256(_mm256_cmpeq_epi8(v, space), isCtrlSpace);
+		__m256i folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+		__m256i isStruct = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+		__m256i isInvalid = _mm256_andnot_si256(isSpace,
+			_mm256_or_si256(_mm256_cmpgt_epi8(space, v), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\x7f'))));
+
+		bits[0] = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))));
+		bits[1] = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))));
+		bits[2] = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/'))));
+		bits[3] = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('*'))));
+		bits[4] = static_cast<unsigned>(_mm256_movemask_epi8(isLf));
+		bits[5] = static_cast<unsigned>(_mm256_movemask_epi8(isSpace));
+		bits[6] = static_cast<unsigned>(_mm256_movemask_epi8(isCtrlSpace));
+		bits[7] = static_cast<unsigned>(_mm256_movemask_epi8(isStruct));
+		bits[8] = static_cast<unsigned>(_mm256_movemask_epi8(isInvalid));
+	}
+
+	// classify
+	KSON_TARGET_AVX2 void avx2Classify(const char* p, KsonCharMasks& masks) {
+		unsigned low[9], high[9];
+		avx2Classify32(p, low);
+		avx2Classify32(p + 32, high);
+
+		uint64_t bits[9];
+		for (int k = 0; k < 9; ++k) {
+			bits[k] = uint64_t(low[k]) | (uint64_t(high[k]) << 32);
+		}
+		masks = { bits[0], bits[1], bits[2], bits[3], bits[4], bits[5], bits[6], bits[7], bits[8] };
+	}
+
+	const KsonScanner s_avx2 = {
+		avx2SkipSpace, avx2FindLineEnd, avx2FindBlockEnd, avx2FindStrSpecial, avx2Classify
+	};
+
+	// CPU 和操作系统是否支持 AVX2
+	bool hasAvx2() {
+#if defined(__GNUC__)
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#else
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+
+		// OSXSAVE、AVX，并且操作系统保存 YMM 寄存器
+		__cpuid(info, 1);
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return false;
+		if ((_xgetbv(0) & 6) != 6) return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#endif
+	}
+
+#endif
+}
+#endif
+
+
+//============================================================
+//  实现的选择
+//============================================================
+
+namespace {
+
+	// 默认的实现
+	KsonSimd bestSimd() {
+#if KSON_SIMD_AVX2
+		if (hasAvx2()) return KsonSimd::AVX2;
+#endif
+#if KSON_SIMD
+		return KsonSimd::SSE2;
+#else
+		return KsonSimd::SCALAR;
+#endif
+	}
+
+	std::atomic<KsonSimd>& currentSimd() {
+		static std::atomic<KsonSimd> s_simd(bestSimd());
+		return s_simd;
+	}
+}
+
+// getKsonScanner
+const KsonScanner& kson::getKsonScanner() {
+	return *getKsonScanner(getKsonSimd());
+}
+
+// getKsonSimd
+KsonSimd kson::getKsonSimd() {
+	return currentSimd().load(std::memory_order_relaxed);
+}
+
+// setKsonSimd
+bool kson::setKsonSimd(KsonSimd simd) {
+	if (!getKsonScanner(simd)) return false;
+	currentSimd().store(simd, std::memory_order_relaxed);
+	return true;
+}
+
+// getKsonScanner: simd
+const KsonScanner* kson::getKsonScanner(KsonSimd simd) {
+	switch (simd) {
+	case KsonSimd::SCALAR:
+		return &s_scalar;
+
+#if KSON_SIMD
+	case KsonSimd::SSE2:
+		return &s_sse2;
+#endif
+
+#if KSON_SIMD_AVX2
+	case KsonSimd::AVX2: {
+		static const bool s_hasAvx2 = hasAvx2();
+		return s_hasAvx2 ? &s_avx2 : nullptr;
+	}
+#endif
+
+	default:
+		return nullptr;
+	}
+}
@@ -0,0 +1,73 @@
+﻿#ifndef __K_SIMD_H__
+#define __K_SIMD_H__
+
+#include <cstddef>
+#include <cstdint>
+
+//============================================================
+//  ksonScanner: 空白、注释、字符串内容的批量扫描
+//============================================================
+
+// 每个函数在 [p, end) 中查找，找不到时返回 end，不会读取 end 及之后的字节
+// 三种实现的结果完全相同：逐字节（所有平台）、SSE2（x86/x64 的基线）、AVX2（运行时检测到 CPU 支持时使用）
+// 编译时定义 KSON_SIMD=0 后只使用逐字节的实现
+
+#ifndef KSON_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KSON_SIMD 1
+#else
+#define KSON_SIMD 0
+#endif
+#endif
+
+namespace kson {
+
+	enum class KsonSimd : unsigned char {
+		SCALAR,
+		SSE2,
+		AVX2
+	};
+
+	// 64 个字节的字符分类位图，第 i 位对应 p[i]（结构索引的第一阶段使用）
+	struct KsonCharMasks {
+		uint64_t m_quote;       // '"'
+		uint64_t m_backslash;   // '\\'
+		uint64_t m_slash;       // '/'
+		uint64_t m_star;        // '*'
+		uint64_t m_newline;     // '\n'
+		uint64_t m_space;       // 空白: ' ' '\n' '\t' '\r'
+		uint64_t m_ctrlSpace;   // ' ' 之外的空白: '\n' '\t' '\r'（字符串中不支持）
+		uint64_t m_struct;      // 结构字符: { } [ ] : ,
+		uint64_t m_invalid;     // 不支持的字符（包括 '\0'）
+	};
+
+	struct KsonScanner {
+
+		// 第一个不是空白（' ' '\t' '\r' '\n'）的字符，lines 加上跳过的 '\n' 的个数
+		const char* (*skipSpace)(const char* p, const char* end, int& lines);
+
+		// 行注释的结束：第一个 '\n' 或 '\0'
+		const char* (*findLineEnd)(const char* p, const char* end);
+
+		// 块注释的结束：第一个 "*/" 中的 '*'，或第一个 '\0'
+		const char* (*findBlockEnd)(const char* p, const char* end);
+
+		// 字符串中第一个需要单独处理的字符：'"'、'\\' 或不支持的字符（包括 '\0'）
+		const char* (*findStrSpecial)(const char* p, const char* end);
+
+		// p 开始的 64 个字节的分类位图，调用者保证这 64 个字节可读
+		void (*classify)(const char* p, KsonCharMasks& masks);
+	};
+
+	// 当前使用的实现，默认为 CPU 支持的最快的实现
+	const KsonScanner& getKsonScanner();
+	KsonSimd getKsonSimd();
+
+	// 切换实现（测试和性能测试使用），CPU 或编译器不支持时返回 false
+	bool setKsonSimd(KsonSimd simd);
+
+	// 获取指定的实现，不支持时返回 nullptr
+	const KsonScanner* getKsonScanner(KsonSimd simd);
+}
+
+#endif
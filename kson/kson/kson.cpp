@@ -1,18 +1,49 @@
 ﻿#include "stdafx.h"
 #include "kson.h"
+#include "ksimd.h"
 #include <fstream>
 #include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <iomanip>
+#include <sstream>
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #define INT_MAX_STR_NO_SIGN "2147483647"
 #define INT_MIN_STR_NO_SIGN "2147483648"
 #define END_OF_FILE '\0'
-#define F (format + "    ")
 
-#define CURRENT (m_str[m_idx])
+#define CURRENT (m_buf.data()[m_idx])
+
+// 调试跟踪：编译时定义 KSON_TRACE=1 后，输出进入的解析函数、嵌套深度和当前字符
+// 未开启时 KSON_TRACE_ENTER 展开为空，不产生任何代码和内存分配
+#if KSON_TRACE
+namespace {
+	class KsonTraceScope {
+	public:
+		KsonTraceScope(int& depth, const char* func, char c) : m_depth(depth) {
+			std::cout << std::setw(m_depth * 4) << "" << "[" << m_depth << "] " << func << ": '" << c << "'" << std::endl;
+			++m_depth;
+		}
+		~KsonTraceScope() { --m_depth; }
+
+	private:
+		int& m_depth;
+	};
+}
 
-// DEBUG
-#define DEBUG_ENABLE false
-#define KSON_DEBUG(arg) { if (DEBUG_ENABLE) std::cout<<format<<arg<<std::endl; }
+#define KSON_TRACE_ENTER(func) KsonTraceScope traceScope(m_depth, func, CURRENT)
+#else
+#define KSON_TRACE_ENTER(func)
+#endif
 
 using namespace kson;
 
@@ -29,10 +60,616 @@ std::string mkStr(std::string str, char c) {
 //============================================================
 
 // KsonValue
-KsonValue::KsonValue() :
-	m_object{}, m_array{}, m_str(),
-	m_num(true, 0, 0.0), m_bool(false),
-	m_null(nullptr), m_type(KsonType::OBJECT) {}
+KsonValue::KsonValue(
+	KsonType type,
+	KsonObject&& obj, KsonArray&& arr, KsonStr&& str,
+	KsonNum&& num, KsonBool bol, KsonNull nul
+) : m_object(nullptr), m_type(KsonType::OBJECT) {
+	switch (type) {
+	case KsonType::OBJECT: setObject(std::move(obj)); break;
+	case KsonType::ARRAY:  setArray(std::move(arr)); break;
+	case KsonType::STRING: setStr(std::move(str)); break;
+	case KsonType::NUMBER: setNum(num); break;
+	case KsonType::BOOL:   setBool(bol); break;
+	case KsonType::NUL:    setNull(); break;
+	}
+}
+
+// KsonValue: copy
+KsonValue::KsonValue(const KsonValue& other) : m_object(nullptr), m_type(KsonType::OBJECT) {
+	*this = other;
+}
+
+// KsonValue: move
+KsonValue::KsonValue(KsonValue&& other) noexcept : m_object(nullptr), m_type(KsonType::OBJECT) {
+	*this = std::move(other);
+}
+
+// operator=: copy
+KsonValue& KsonValue::operator=(const KsonValue& other) {
+	if (this == &other) return *this;
+
+	switch (other.m_type) {
+	case KsonType::OBJECT: setObject(KsonObject(other.objectRef())); break;
+	case KsonType::ARRAY:  setArray(KsonArray(other.arrayRef())); break;
+	case KsonType::STRING: setStr(KsonStr(other.strRef())); break;
+	case KsonType::NUMBER: setNum(other.m_num); break;
+	case KsonType::BOOL:   setBool(other.m_bool); break;
+	case KsonType::NUL:    setNull(); break;
+	}
+	return *this;
+}
+
+// operator=: move，直接接管 other 的指针，other 变为空 object
+KsonValue& KsonValue::operator=(KsonValue&& other) noexcept {
+	if (this == &other) return *this;
+
+	release();
+	switch (other.m_type) {
+	case KsonType::OBJECT: m_object = other.m_object; break;
+	case KsonType::ARRAY:  m_array = other.m_array; break;
+	case KsonType::STRING: m_str = other.m_str; break;
+	case KsonType::NUMBER: m_num = other.m_num; break;
+	case KsonType::BOOL:   m_bool = other.m_bool; break;
+	case KsonType::NUL:    m_object = nullptr; break;
+	}
+	m_type = other.m_type;
+
+	other.m_object = nullptr;
+	other.m_type = KsonType::OBJECT;
+	return *this;
+}
+
+// setObject
+void KsonValue::setObject(KsonObject&& obj) {
+	KsonObject* p = obj.empty() ? nullptr : new KsonObject(std::move(obj));
+	release();
+	m_object = p;
+	m_type = KsonType::OBJECT;
+}
+
+// setArray
+void KsonValue::setArray(KsonArray&& arr) {
+	KsonArray* p = arr.empty() ? nullptr : new KsonArray(std::move(arr));
+	release();
+	m_array = p;
+	m_type = KsonType::ARRAY;
+}
+
+// setStr
+void KsonValue::setStr(KsonStr&& str) {
+	KsonStr* p = str.empty() ? nullptr : new KsonStr(std::move(str));
+	release();
+	m_str = p;
+	m_type = KsonType::STRING;
+}
+
+// setNum
+void KsonValue::setNum(const KsonNum& num) {
+	release();
+	new (&m_num) KsonNum(num);
+	m_type = KsonType::NUMBER;
+}
+
+// setBool
+void KsonValue::setBool(KsonBool bol) {
+	release();
+	m_bool = bol;
+	m_type = KsonType::BOOL;
+}
+
+// setNull
+void KsonValue::setNull() {
+	release();
+	m_object = nullptr;
+	m_type = KsonType::NUL;
+}
+
+// 空值，类型不符或容器为空时返回它们的引用
+const KsonObject KsonValue::s_emptyObject;
+const KsonArray  KsonValue::s_emptyArray;
+const KsonStr    KsonValue::s_emptyStr;
+
+// find
+const KsonValue* KsonValue::find(const std::string& key) const {
+	if (m_type != KsonType::OBJECT || !m_object) return nullptr;
+	auto iter = m_object->find(key);
+	return iter != m_object->end() ? &iter->second : nullptr;
+}
+
+// at: key
+const KsonValue& KsonValue::at(const std::string& key) const {
+	const KsonValue* val = find(key);
+	if (!val) throw std::out_of_range("KsonValue::at: key '" + key + "' not found");
+	return *val;
+}
+
+// at: index
+const KsonValue& KsonValue::at(size_t index) const {
+	return arrayRef().at(index);
+}
+
+// size
+size_t KsonValue::size() const {
+	switch (m_type) {
+	case KsonType::OBJECT: return objectRef().size();
+	case KsonType::ARRAY:  return arrayRef().size();
+	case KsonType::STRING: return strRef().size();
+	default: return 0;
+	}
+}
+
+// makeObject
+KsonValue KsonValue::makeObject(KsonObject&& obj) {
+	KsonValue val;
+	val.setObject(std::move(obj));
+	return val;
+}
+
+// makeArray
+KsonValue KsonValue::makeArray(KsonArray&& arr) {
+	KsonValue val;
+	val.setArray(std::move(arr));
+	return val;
+}
+
+// makeStr
+KsonValue KsonValue::makeStr(KsonStr&& str) {
+	KsonValue val;
+	val.setStr(std::move(str));
+	return val;
+}
+
+// makeInt
+KsonValue KsonValue::makeInt(KsonInt value) {
+	KsonValue val;
+	val.setNum(KsonNum(true, value, 0.0));
+	return val;
+}
+
+// makeDouble
+KsonValue KsonValue::makeDouble(KsonDouble value) {
+	KsonValue val;
+	val.setNum(KsonNum(false, 0, value));
+	return val;
+}
+
+// makeBool
+KsonValue KsonValue::makeBool(KsonBool value) {
+	KsonValue val;
+	val.setBool(value);
+	return val;
+}
+
+// makeNull
+KsonValue KsonValue::makeNull() {
+	KsonValue val;
+	val.setNull();
+	return val;
+}
+
+// set
+KsonValue& KsonValue::set(std::string key, KsonValue value) {
+	auto ret = mutObject().emplace(std::move(key), std::move(value));
+	if (!ret.second) {
+		ret.first->second = std::move(value);
+	}
+	return ret.first->second;
+}
+
+// emplace
+KsonValue& KsonValue::emplace(std::string key) {
+	return mutObject().emplace(std::move(key), KsonValue()).first->second;
+}
+
+// erase: key
+bool KsonValue::erase(const std::string& key) {
+	if (m_type != KsonType::OBJECT || !m_object) return false;
+	return m_object->erase(key) > 0;
+}
+
+// push_back
+KsonValue& KsonValue::push_back(KsonValue value) {
+	KsonArray& arr = mutArray();
+	arr.push_back(std::move(value));
+	return arr.back();
+}
+
+// emplace_back
+KsonValue& KsonValue::emplace_back() {
+	return mutArray().emplace_back();
+}
+
+// erase: index
+bool KsonValue::erase(size_t index) {
+	if (m_type != KsonType::ARRAY || !m_array || index >= m_array->size()) return false;
+	m_array->erase(m_array->begin() + index);
+	return true;
+}
+
+// reserve
+void KsonValue::reserve(size_t size) {
+	if (size == 0) return;
+	if (m_type == KsonType::OBJECT) mutObject().reserve(size);
+	else if (m_type == KsonType::ARRAY) mutArray().reserve(size);
+}
+
+// mutObject: 空的 object 不分配，修改时才分配
+KsonObject& KsonValue::mutObject() {
+	if (m_type != KsonType::OBJECT || !m_object) {
+		KsonObject* p = new KsonObject();
+		release();
+		m_object = p;
+		m_type = KsonType::OBJECT;
+	}
+	return *m_object;
+}
+
+// mutArray
+KsonArray& KsonValue::mutArray() {
+	if (m_type != KsonType::ARRAY || !m_array) {
+		KsonArray* p = new KsonArray();
+		release();
+		m_array = p;
+		m_type = KsonType::ARRAY;
+	}
+	return *m_array;
+}
+
+// release: 释放堆上的 object/array/string，之后 m_type 由调用者重新设置
+// 嵌套的容器先移出，再逐个释放，释放很深的文档时不递归（每层的容器释放时子节点都已经不含容器）
+// 只有含嵌套容器时 pending 才分配；release() 在析构和 noexcept 的移动赋值中调用，pending 分配失败时不抛出，
+// 没有移出的容器留在原位，随父容器递归释放（只在内存不足时退回递归）
+void KsonValue::release() {
+	std::vector<KsonValue> pending;
+	detachChildren(pending);
+	releaseHeap();
+	while (!pending.empty()) {
+		KsonValue val = std::move(pending.back());
+		pending.pop_back();
+		val.detachChildren(pending);
+		val.releaseHeap();
+	}
+}
+
+// detachChildren: 把非空的 object/array 成员移到 pending，原位置变为空 object；pending 分配失败时成员留在原位
+void KsonValue::detachChildren(std::vector<KsonValue>& pending) noexcept {
+	auto detach = [&pending](KsonValue& val) {
+		bool isNested = (val.m_type == KsonType::OBJECT && val.m_object) || (val.m_type == KsonType::ARRAY && val.m_array);
+		if (!isNested) return;
+		try {
+			pending.push_back(std::move(val));
+		}
+		catch (const std::bad_alloc&) {}
+	};
+	if (m_type == KsonType::OBJECT && m_object) {
+		for (auto& item : *m_object) {
+			detach(item.second);
+		}
+	}
+	else if (m_type == KsonType::ARRAY && m_array) {
+		for (auto& elem : *m_array) {
+			detach(elem);
+		}
+	}
+}
+
+// releaseHeap
+void KsonValue::releaseHeap() {
+	switch (m_type) {
+	case KsonType::OBJECT: delete m_object; break;
+	case KsonType::ARRAY:  delete m_array; break;
+	case KsonType::STRING: delete m_str; break;
+	default: break;
+	}
+	m_object = nullptr;
+	m_type = KsonType::NUL;
+}
+
+
+//============================================================
+//  ksonBuffer
+//============================================================
+
+namespace {
+
+	// 读取失败的错误信息
+	std::string ioError(const std::string& file, const char* what) {
+		return "read file '" + file + "' failed: " + what + " (" + std::strerror(errno) + ")";
+	}
+
+#ifndef _WIN32
+	// 从管道、设备文件等不能 mmap 的文件中整块读入
+	bool readAll(int fd, std::string& out) {
+		const size_t CHUNK = 64 * 1024;
+		size_t size = 0;
+		while (true) {
+			out.resize(size + CHUNK);
+			ssize_t n = ::read(fd, &out[size], CHUNK);
+			if (n < 0) {
+				if (errno == EINTR) continue;
+				out.clear();
+				return false;
+			}
+			if (n == 0) break;
+			size += n;
+		}
+		out.resize(size);
+		return true;
+	}
+#endif
+}
+
+// KsonBuffer: move
+KsonBuffer::KsonBuffer(KsonBuffer&& other) noexcept {
+	*this = std::move(other);
+}
+
+// operator=: move
+KsonBuffer& KsonBuffer::operator=(KsonBuffer&& other) noexcept {
+	if (this == &other) return *this;
+
+	clear();
+	bool isCopy = other.m_data == other.m_copy.c_str();
+	m_copy = std::move(other.m_copy);
+	m_data = isCopy ? m_copy.c_str() : other.m_data;
+	m_size = other.m_size;
+	m_map = other.m_map;
+	m_mapSize = other.m_mapSize;
+
+	other.m_map = nullptr;
+	other.m_mapSize = 0;
+	other.clear();
+	return *this;
+}
+
+// load
+bool KsonBuffer::load(const std::string& file, std::string& error) {
+	clear();
+
+#ifndef _WIN32
+	int fd = ::open(file.c_str(), O_RDONLY);
+	if (fd < 0) {
+		error += ioError(file, "open");
+		return false;
+	}
+
+	// 普通文件：只读映射
+	struct stat st;
+	if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		size_t size = static_cast<size_t>(st.st_size);
+		void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			::close(fd);
+			::madvise(map, size, MADV_SEQUENTIAL);
+
+			// 文件大小恰好是页大小的整数倍，映射区后面没有 '\0'，需要拷贝
+			if (size % static_cast<size_t>(::sysconf(_SC_PAGESIZE)) == 0) {
+				m_copy.assign(static_cast<const char*>(map), size);
+				::munmap(map, size);
+				m_data = m_copy.c_str();
+				m_size = size;
+				return true;
+			}
+
+			m_map = map;
+			m_mapSize = size;
+			m_data = static_cast<const char*>(map);
+			m_size = size;
+			return true;
+		}
+	}
+
+	// 管道、设备文件，或 mmap 失败：整块读入
+	bool ok = readAll(fd, m_copy);
+	::close(fd);
+	if (!ok) {
+		error += ioError(file, "read");
+		return false;
+	}
+#else
+	std::ifstream in(file, std::ios::binary);
+	if (!in) {
+		error += ioError(file, "open");
+		return false;
+	}
+
+	// 能获取大小时一次读入，否则按流读入
+	in.seekg(0, std::ios::end);
+	std::streamoff size = in.tellg();
+	if (size > 0) {
+		in.seekg(0, std::ios::beg);
+		m_copy.resize(static_cast<size_t>(size));
+		in.read(&m_copy[0], size);
+		m_copy.resize(static_cast<size_t>(in.gcount()));
+	}
+	else {
+		in.clear();
+		in.seekg(0, std::ios::beg);
+		std::ostringstream os;
+		os << in.rdbuf();
+		m_copy = os.str();
+	}
+	if (in.bad()) {
+		m_copy.clear();
+		error += ioError(file, "read");
+		return false;
+	}
+#endif
+
+	m_data = m_copy.c_str();
+	m_size = m_copy.size();
+	return true;
+}
+
+// assign
+void KsonBuffer::assign(const std::string& str) {
+	clear();
+	m_copy = str;
+	m_data = m_copy.c_str();
+	m_size = m_copy.size();
+}
+
+// assign: move
+void KsonBuffer::assign(std::string&& str) {
+	clear();
+	m_copy = std::move(str);
+	m_data = m_copy.c_str();
+	m_size = m_copy.size();
+}
+
+// borrow
+void KsonBuffer::borrow(const char* data, size_t size) {
+	clear();
+	m_data = data;
+	m_size = size;
+}
+
+// clear
+void KsonBuffer::clear() {
+#ifndef _WIN32
+	if (m_map) {
+		::munmap(m_map, m_mapSize);
+	}
+#endif
+	m_map = nullptr;
+	m_mapSize = 0;
+	m_copy.clear();
+	m_data = "";
+	m_size = 0;
+}
+
+
+//============================================================
+//  ksonDomHandler
+//============================================================
+
+// startObject
+bool KsonDomHandler::startObject() {
+	return startContainer(true);
+}
+
+// key
+bool KsonDomHandler::key(const char* str, size_t len) {
+	Frame& frame = m_stack[m_depth - 1];
+	frame.m_members.emplace_back(std::string(str, len), KsonValue());
+	frame.m_isPending = true;
+	return true;
+}
+
+// endObject
+bool KsonDomHandler::endObject() {
+	return endContainer();
+}
+
+// startArray
+bool KsonDomHandler::startArray() {
+	return startContainer(false);
+}
+
+// endArray
+bool KsonDomHandler::endArray() {
+	return endContainer();
+}
+
+// string
+bool KsonDomHandler::string(const char* str, size_t len) {
+	KsonValue value;
+	value.setStr(KsonStr(str, len));
+	return addValue(std::move(value));
+}
+
+// integer
+bool KsonDomHandler::integer(KsonInt value) {
+	KsonValue val;
+	val.setNum(KsonNum(true, value, 0.0));
+	return addValue(std::move(val));
+}
+
+// floating
+bool KsonDomHandler::floating(double value) {
+	KsonValue val;
+	val.setNum(KsonNum(false, 0, value));
+	return addValue(std::move(val));
+}
+
+// boolean
+bool KsonDomHandler::boolean(bool value) {
+	KsonValue val;
+	val.setBool(value);
+	return addValue(std::move(val));
+}
+
+// null
+bool KsonDomHandler::null() {
+	KsonValue val;
+	val.setNull();
+	return addValue(std::move(val));
+}
+
+// release
+KsonObject KsonDomHandler::release() {
+	if (m_depth > 0) {
+		Frame& frame = m_stack[0];
+		if (frame.m_isPending) {
+			frame.m_members.pop_back();   // 没有完成的成员
+		}
+		return KsonObject(std::move(frame.m_members));
+	}
+	return std::move(m_root);
+}
+
+// reset
+void KsonDomHandler::reset() {
+	m_depth = 0;
+	m_root.clear();
+}
+
+// startContainer: 复用之前分配的 Frame
+bool KsonDomHandler::startContainer(bool isObject) {
+	if (m_depth == m_stack.size()) {
+		m_stack.emplace_back();
+	}
+	Frame& frame = m_stack[m_depth++];
+	frame.m_isObject = isObject;
+	frame.m_isPending = false;
+	frame.m_members.clear();
+	frame.m_array.clear();
+	return true;
+}
+
+// endContainer
+bool KsonDomHandler::endContainer() {
+	Frame& frame = m_stack[--m_depth];
+
+	// 根 object
+	if (m_depth == 0) {
+		m_root = KsonObject(std::move(frame.m_members));
+		return true;
+	}
+
+	KsonValue value;
+	if (frame.m_isObject) {
+		value.setObject(KsonObject(std::move(frame.m_members)));
+	}
+	else {
+		value.setArray(std::move(frame.m_array));
+	}
+	return addValue(std::move(value));
+}
+
+// addValue
+bool KsonDomHandler::addValue(KsonValue&& value) {
+	Frame& frame = m_stack[m_depth - 1];
+	if (frame.m_isObject) {
+		frame.m_members.back().second = std::move(value);
+		frame.m_isPending = false;
+	}
+	else {
+		frame.m_array.push_back(std::move(value));
+	}
+	return true;
+}
 
 
 //============================================================
@@ -42,52 +679,126 @@ KsonValue::KsonValue() :
 // Kson
 Kson::Kson(const std::string& str, bool isFile) {
 	if (isFile) {
-		std::ifstream file(str);
-		file >> std::noskipws;  //不要跳过空白
-		char ic;
-		while (file >> ic) {
-			m_str.push_back(ic);
+		if (!m_buf.load(str, m_error)) {
+			m_error += "\n";
+			m_ioFailed = true;
 		}
-		file.close();
-		m_str.push_back(END_OF_FILE);  // 末尾增加空白符 '\0' 来标记结束
 	}
 	else {
-		m_str = str;
+		m_buf.assign(str);
 	}
 }
 
+// Kson: buffer
+Kson::Kson(KsonBuffer&& buf) : m_buf(std::move(buf)) {}
+
 // parse
 std::pair<bool, KsonObject> Kson::parse()
 {
+	KsonDomHandler dom;
+	bool ret = parse(dom);
+	return { ret, dom.release() };
+}
+
+// parse: handler
+bool Kson::parse(KsonHandler& handler)
+{
+	m_errorText = true;
+	m_handler = &handler;
+	bool ret = parseRoot();
+
+	// 遇到不支持的字符
+	if (m_aborted) {
+		std::cout << m_error << std::endl;
+	}
+	return ret;
+}
+
+// parse: 不抛出异常
+bool Kson::parse(KsonHandler& handler, KsonError& error) noexcept
+{
+	m_errorText = false;
+	m_handler = &handler;
+	bool ret = false;
 	try {
-		skipWS();
-		return std::move(parseObject(""));
+		ret = parseRoot();
 	}
-	catch (KSON_UNEXPECTED_CHARACTOR) {  // 遇到不支持的字符
-		std::cout << m_error << std::endl;
-		return { false,{} };
+	catch (const std::bad_alloc&) {
+		setError(KsonErrorCode::OUT_OF_MEMORY);
+	}
+	catch (...) {
+		setError(KsonErrorCode::STOPPED);
+	}
+	error = m_err;
+	return ret;
+}
+
+// parse: KsonObject，不抛出异常
+bool Kson::parse(KsonObject& obj, KsonError& error) noexcept
+{
+	try {
+		KsonDomHandler dom;
+		bool ret = parse(dom, error);
+		obj = dom.release();
+		return ret;
+	}
+	catch (...) {  // KsonDomHandler 的内存分配失败
+		setError(KsonErrorCode::OUT_OF_MEMORY);
+		error = m_err;
+		return false;
+	}
+}
+
+// getErrorInfo
+std::string Kson::getErrorInfo() {
+	if (m_errorText || m_err.m_code == KsonErrorCode::IO_FAILED) {
+		return m_error;
+	}
+	return m_err ? formatKsonError(m_err, m_buf.data()) + "\n" : std::string();
+}
+
+// parseRoot
+bool Kson::parseRoot()
+{
+	// 文件读取失败
+	if (m_ioFailed) {
+		m_err.m_code = KsonErrorCode::IO_FAILED;
+		return false;
+	}
+
+	m_scanner = &getKsonScanner();
+	m_lazy = m_handler->isLazy();
+	m_nesting = 0;
+	m_stack.clear();
+	skipWS();
+
+	bool ret = false;
+	if (m_iterative) {
+		ret = parseIterative();
+	}
+	else {
+		m_nesting = 1;
+		ret = parseObject();
 	}
+	return ret && !m_aborted;
 }
 
 // parseObject
-std::pair<bool, KsonObject> Kson::parseObject(const std::string& format) {
-	KSON_DEBUG(mkStr("parseObject: ", CURRENT));
+bool Kson::parseObject() {
+	KSON_TRACE_ENTER("parseObject");
 
-	KsonObject object;
 	if (isChar('{')) {
 		++m_idx;
+		if (!handled(m_handler->startObject())) return false;
 		skipWS();
 
 		// parse key/value
 		while (!isChar('}') && !isChar(END_OF_FILE)) {
 
 			// get key
-			auto ret = parseKey(F);
-			skipWS();
-
-			if (!ret.first) {
-				addError("expect key");
-				return { false, std::move(object) };
+			if (!parseKey()) {
+				addError(KsonErrorCode::EXPECT_KEY, "expect key");
+				return false;
 			}
 
 			// get value
@@ -95,21 +806,16 @@ std::pair<bool, KsonObject> Kson::parseObject(const std::string& format) {
 				++m_idx;
 				skipWS();
 
-				auto val = parseValue(F);
-				skipWS();
-
 				// 没有成功解析到 value，则直接退出
-				if (!val.first) {
-					addError("expect value");
-					return { false, std::move(object) };
+				if (!parseValue()) {
+					addError(KsonErrorCode::EXPECT_VALUE, "expect value");
+					return false;
 				}
-
-				// 向 object 中写入 key/value
-				object[ret.second] = std::move(val.second);
+				skipWS();
 			}
 			else {
-				addError(mkStr("unexpected  ", CURRENT) + ", expect ':'");
-				return { false, std::move(object) };
+				addError(KsonErrorCode::EXPECT_COLON, "unexpected  ", CURRENT, ", expect ':'");
+				return false;
 			}
 
 			if (!isChar('}')) {
@@ -118,53 +824,49 @@ std::pair<bool, KsonObject> Kson::parseObject(const std::string& format) {
 					skipWS();
 				}
 				else {
-					addError(mkStr("unexpected  ", CURRENT) + ", expect ','");
-					return { false, std::move(object) };
+					addError(KsonErrorCode::EXPECT_COMMA, "unexpected  ", CURRENT, ", expect ','");
+					return false;
 				}
 			}
 		}
 
 		if (isChar('}')) {
 			++m_idx;
+			if (!handled(m_handler->endObject())) return false;
 			skipWS();
 
-			return { true, std::move(object) };
+			return true;
 		}
 
 		// 文件结束
 		else {
-			addError("unexpected  END_OF_FILE, expect '}'");
-			return { false, std::move(object) };
+			addError(KsonErrorCode::UNEXPECTED_END, "unexpected  END_OF_FILE, expect '}'");
+			return false;
 		}
 	}
 
-	addError(mkStr("unexpected  ", CURRENT) + ", expect '{'");
-	return { false, std::move(object) };
+	addError(KsonErrorCode::EXPECT_OBJECT, "unexpected  ", CURRENT, ", expect '{'");
+	return false;
 }
 
 // parseArray
-std::pair<bool, KsonArray> Kson::parseArray(const std::string& format) {
-	KSON_DEBUG(mkStr("parseArray: ", CURRENT));
+bool Kson::parseArray() {
+	KSON_TRACE_ENTER("parseArray");
 
-	KsonArray arr;
 	if (isChar('[')) {
 		++m_idx;
+		if (!handled(m_handler->startArray())) return false;
 		skipWS();
 
 		// parse value
 		while (!isChar(']') && !isChar(END_OF_FILE)) {
 
-			auto val = parseValue(F);
-			skipWS();
-
 			// 没有成功解析到 value，则直接退出
-			if (!val.first) {
-				addError("expect value");
-				return { false, std::move(arr) };
+			if (!parseValue()) {
+				addError(KsonErrorCode::EXPECT_VALUE, "expect value");
+				return false;
 			}
-
-			// 向 object 中写入 key/value
-			arr.push_back(std::move(val.second));
+			skipWS();
 
 			if (!isChar(']')) {
 				if (isChar(',')) {
@@ -172,87 +874,127 @@ std::pair<bool, KsonArray> Kson::parseArray(const std::string& format) {
 					skipWS();
 				}
 				else {
-					addError(mkStr("unexpected  ", CURRENT) + ", expect ','");
-					return { false, std::move(arr) };
+					addError(KsonErrorCode::EXPECT_COMMA, "unexpected  ", CURRENT, ", expect ','");
+					return false;
 				}
 			}
 		}
 
 		if (isChar(']')) {
 			++m_idx;
+			if (!handled(m_handler->endArray())) return false;
 			skipWS();
 			
-			return { true, std::move(arr) };
+			return true;
 		}
 
 		// 文件结束
 		else {
-			addError("unexpected  END_OF_FILE, expect ']'");
-			return { false, std::move(arr) };
+			addError(KsonErrorCode::UNEXPECTED_END, "unexpected  END_OF_FILE, expect ']'");
+			return false;
 		}
 	}
 
-	return { false, std::move(arr) };
+	return false;
 }
 
 // parseStr
-std::pair<bool, KsonStr> Kson::parseStr(const std::string& format) {
-	KSON_DEBUG(mkStr("parseStr: ", CURRENT));
+bool Kson::parseStr() {
+	KSON_TRACE_ENTER("parseStr");
 
 	++m_idx;  // 跳过开始的 '"'
-	std::string result;
-	while (isValidStrChar(CURRENT)) {
+
+	// 延迟解码：只检查格式，转义由 unescapeKsonStr() 在读取时处理
+	if (m_lazy) {
+		const char* start = &CURRENT;
+		bool isEscaped = false;
+		while (true) {
+			m_idx = toIdx(m_scanner->findStrSpecial(&CURRENT, scanEnd()));
+			if (!isChar('\\')) break;
+			isEscaped = true;
+			bool isKnown = isChar(1, 'n') || isChar(1, 't') || isChar(1, '\\') || isChar(1, '\'') || isChar(1, '\"');
+			m_idx += isKnown ? 2 : 1;
+		}
+		if (isChar('"')) {
+			size_t len = size_t(&CURRENT - start);
+			++m_idx;
+			if (!handled(m_handler->rawString(start, len, isEscaped))) return false;
+			skipWS();
+			return true;
+		}
+		addError(KsonErrorCode::UNSUPPORTED_CHAR, "unexpected  ", CURRENT, ", expect '\"'");
+		return false;
+	}
+
+	// 没有转义字符时直接指向 kson 文本，遇到第一个转义字符后才拷贝到 m_str 中
+	// 普通字符批量扫描，停在 '"'、'\' 或不支持的字符处
+	const char* start = &CURRENT;
+	bool isEscaped = false;
+	while (true) {
+		const char* p = m_scanner->findStrSpecial(&CURRENT, scanEnd());
+		if (isEscaped) {
+			m_str.append(&CURRENT, p - &CURRENT);
+		}
+		m_idx = toIdx(p);
+		if (!isChar('\\')) break;
 
 		// 转义字符 \n \t \\ \' \"
-		char c = CURRENT;
-		if (isChar('\\')) {
-			char c1 = '1';
-			if (isChar(1, 'n')) {
-				c1 = '\n';
-			}
-			else if (isChar(1, 't')) {
-				c1 = '\t';
-			}
-			else if (isChar(1, '\\')) {
-				c1 = '\\';
-			}
-			else if (isChar(1, '\'')) {
-				c1 = '\'';
-			}
-			else if (isChar(1, '\"')) {
-				c1 = '\"';
-			}
-			if (c1 != '1') {
-				c = c1;
-				++m_idx;
+		char c1 = '1';
+		if (isChar(1, 'n')) {
+			c1 = '\n';
+		}
+		else if (isChar(1, 't')) {
+			c1 = '\t';
+		}
+		else if (isChar(1, '\\')) {
+			c1 = '\\';
+		}
+		else if (isChar(1, '\'')) {
+			c1 = '\'';
+		}
+		else if (isChar(1, '\"')) {
+			c1 = '\"';
+		}
+		if (c1 != '1') {
+			if (!isEscaped) {
+				m_str.assign(start, &CURRENT - start);
+				isEscaped = true;
 			}
+			m_str.push_back(c1);
+			m_idx += 2;
+			continue;
+		}
+
+		// 不支持的转义字符保留 '\'
+		if (isEscaped) {
+			m_str.push_back(CURRENT);
 		}
-		result.push_back(c);
 		++m_idx;
 	}
 
 	if (isChar('"')) {
+		const char* str = isEscaped ? m_str.data() : start;
+		size_t len = isEscaped ? m_str.size() : size_t(&CURRENT - start);
 
 		// 跳过结尾的 '"'
 		++m_idx;
+		if (!handled(m_handler->string(str, len))) return false;
 		skipWS();
 
-		return { true, std::move(result) };
+		return true;
 	}
 
-	addError(mkStr("unexpected  ", CURRENT) + ", expect '\"'");
-	return { false, "" };
+	addError(KsonErrorCode::UNSUPPORTED_CHAR, "unexpected  ", CURRENT, ", expect '\"'");
+	return false;
 }
 
 // paseInt : integer / floating
-std::pair<bool, KsonNum> Kson::parseNum(const std::string& format) {
-	KSON_DEBUG(mkStr("parseNum: ", CURRENT));
+bool Kson::parseNum() {
+	KSON_TRACE_ENTER("parseNum");
 
-	int intNum = 0;
-	double doubleNum = 0;
 	bool isNeg = false;   // 是否为负数
 	bool isInt = true;    // 是否为整数
-	bool hasNum = false;  // 是否解析到数字
+	const char* numStart = &CURRENT;
 
 	if (isChar('+')) {
 		++m_idx;
@@ -263,98 +1005,95 @@ std::pair<bool, KsonNum> Kson::parseNum(const std::string& format) {
 		skipWS();
 		isNeg = true;
 	}
-	if (isNum()) hasNum = true;
-	else {
-		addError(mkStr("unexpected  ", CURRENT) + ", expect number.");
-		return { false, KsonNum(true, 0, 0.0) };
+	if (!isNum()) {
+		addError(KsonErrorCode::INVALID_NUMBER, "unexpected  ", CURRENT, ", expect number.");
+		return false;
 	}
 
 	// 十六进制
 	if (isChar('0') && (isChar(1, 'x') || isChar('X'))) {
 		m_idx += 2;
-		return parseHex(F);
+		return parseHex();
 	}
 
-	// 整数或浮点数
-	// 不判断数值是否溢出，由使用者自己注意整型值的大小
+	// 整数部分（符号与数字之间没有空白时，整个数值是一段连续的文本）
+	const char* intPart = &CURRENT;
+	bool isContiguous = intPart - numStart == ((isNeg || *numStart == '+') ? 1 : 0);
+	size_t intLen = 0;
 	while (isNum()) {
-		intNum = intNum * 10 + CURRENT - 0x30;
+		++intLen;
 		++m_idx;
 	}
+	const char* numEnd = &CURRENT;
 
 	// 浮点数
+	const char* fracPart = nullptr;
+	size_t fracLen = 0;
 	if (isChar('.')) {
 
 		// 小数点后必须有数字才行
 		if (!isNum(1)) {
 			skipWS();
-			return { false, KsonNum(true, 0, 0.0) };
+			return false;
 		}
 
 		isInt = false;
 		++m_idx;
 
-		int tail = 0;        // 记录小数点后的数字
-		int count = 0;       // 记录小数点后的数字的位数
+		fracPart = &CURRENT;
 		while (isNum()) {
-			tail = tail * 10 + CURRENT - 0x30;
-			++count;
+			++fracLen;
 			++m_idx;
 		}
+		numEnd = &CURRENT;
 		skipWS();
-
-		double doubleTail = tail;
-		while (--count >= 0) {
-			doubleTail /= 10;
-		}
-		doubleNum = intNum + doubleTail;
 	}
 
 	// 科学计数法
+	const char* expPart = nullptr;
+	size_t expLen = 0;
 	if (isChar('e') || isChar('E')) {
 
-		// 科学计数法字符 E 后面必须有数字
-		if (!isNum(1)) {
+		// 科学计数法字符 E 后面必须有数字，数字前可以有正负号
+		int sign = (isChar(1, '+') || isChar(1, '-')) ? 1 : 0;
+		if (!isNum(1 + sign)) {
 			skipWS();
-			addError(mkStr("unexpected  ", CURRENT) + ", expect number after 'E'");
-			return { false, std::move(KsonNum(false, 0, 0.0)) };
+			addError(KsonErrorCode::INVALID_NUMBER, "unexpected  ", CURRENT, ", expect number after 'E'");
+			return false;
 		}
 
 		++m_idx;
 
-		int tail = 0;      // 记录 E 后面的数字
+		expPart = &CURRENT;
+		expLen = sign;
+		m_idx += sign;
 		while (isNum()) {
-			tail = tail * 10 + CURRENT - 0x30;
+			++expLen;
 			++m_idx;
 		}
+		isContiguous = isContiguous && expPart - 1 == numEnd;
+		numEnd = &CURRENT;
 		skipWS();
-
-		if (isInt) {
-			while (tail > 0) {
-				intNum *= 10;
-				--tail;
-			}
-		}
-		else {
-			while (tail > 0) {
-				doubleNum *= 10;
-				--tail;
-			}
-		}
 	}
+	skipWS();
+	if (m_aborted) return false;
 
-	if (isNeg) {
-		if (isInt) intNum = -intNum;
-		else doubleNum = -doubleNum;
+	// 延迟解码：不会超出范围的连续数值只给出位置
+	if (m_lazy && isContiguous && isSafeKsonNum(intLen, expPart, expLen)) {
+		return handled(m_handler->rawNumber(numStart, size_t(numEnd - numStart)));
 	}
-	skipWS();
 
-	return { hasNum, std::move(KsonNum(isInt, intNum, doubleNum)) };
+	auto num = toKsonNum(isNeg, isInt, intPart, intLen, fracPart, fracLen, expPart, expLen);
+	if (!num.first) {
+		addError(KsonErrorCode::NUMBER_OUT_OF_RANGE, "number out of range.");
+		return false;
+	}
+	return handled(num.second.m_isInt ? m_handler->integer(num.second.m_int) : m_handler->floating(num.second.m_double));
 }
 
 // parseBool: true / TRUE / false / FALSE
-std::pair<bool, KsonBool> Kson::parseBool(const std::string& format) {
-	KSON_DEBUG(mkStr("parseBool: ", CURRENT));
+bool Kson::parseBool() {
+	KSON_TRACE_ENTER("parseBool");
 
 	// true
 	bool isTL =
@@ -391,22 +1130,22 @@ std::pair<bool, KsonBool> Kson::parseBool(const std::string& format) {
 	// true / TRUE
 	if (isTL || isTU) {
 		m_idx += 4;
-		return { true, true };
+		return handled(m_handler->boolean(true));
 	}
 
 	// false / FALSE
 	if (isFL || isFU) {
 		m_idx += 5;
-		return { true, false };
+		return handled(m_handler->boolean(false));
 	}
 
-	addError("expect true/TRUE/false/FALSE.");
-	return { false, false };
+	addError(KsonErrorCode::INVALID_LITERAL, "expect true/TRUE/false/FALSE.");
+	return false;
 }
 
 // parseNull: null / NULL
-std::pair<bool, KsonNull> Kson::parseNull(const std::string& format) {
-	KSON_DEBUG(mkStr("parseNull: ", CURRENT));
+bool Kson::parseNull() {
+	KSON_TRACE_ENTER("parseNull");
 
 	// null
 	bool isNL =
@@ -427,196 +1166,397 @@ std::pair<bool, KsonNull> Kson::parseNull(const std::string& format) {
 	// null / NULL
 	if (isNL || isNU) {
 		m_idx += 4;
-		return { true, nullptr };
+		return handled(m_handler->null());
 	}
 
-	addError("expect null/NULL");
-	return { false, nullptr };
+	addError(KsonErrorCode::INVALID_LITERAL, "expect null/NULL");
+	return false;
 }
 
 // parseKey
-std::pair<bool, std::string> Kson::parseKey(const std::string& format) {
-	KSON_DEBUG(mkStr("parseKey: ", CURRENT));
+bool Kson::parseKey() {
+	KSON_TRACE_ENTER("parseKey");
 
-	std::string str;
 	// 第一个字符不能是数字
-	if (!isAlpha(CURRENT) && !isChar('_')) {
-		addError(mkStr("unexpected  ", CURRENT) + ", expect '_' or 'a~zA~Z' for key.");
-		return { false, std::move(str) };
+	if (!isClass(KSON_CHAR_KEY_START)) {
+		addError(KsonErrorCode::EXPECT_KEY, "unexpected  ", CURRENT, ", expect '_' or 'a~zA~Z' for key.");
+		return false;
 	}
 
-	// 支持 字母/数字/下划线
-	while (isAlpha(CURRENT) || isNumber(CURRENT) || isChar('_')) {
-		str.push_back(CURRENT);
+	// 支持 字母/数字/下划线，key 直接指向 kson 文本，不需要拷贝
+	const char* key = &CURRENT;
+	size_t len = 0;
+	while (isClass(KSON_CHAR_KEY)) {
+		++len;
 		++m_idx;
 	}
+	if (!handled(m_handler->key(key, len))) return false;
 	skipWS();
 
-	return { true, std::move(str) };
+	return true;
 }
 
 // parseValue
-std::pair<bool, KsonValue> Kson::parseValue(const std::string& format) {
-	KSON_DEBUG(mkStr("parseValue: ", CURRENT));
+bool Kson::parseValue() {
+	KSON_TRACE_ENTER("parseValue");
 
-	KsonValue value;
-	// object
-	if (isChar('{')) {
-		auto ret = parseObject(F);
-		skipWS();
-		value.m_object = std::move(ret.second);
-		value.m_type = KsonType::OBJECT;
-		return { ret.first, std::move(value) };
+	bool ret = false;
+
+	// object / array：超过最大嵌套深度时不再进入
+	if (isChar('{') || isChar('[')) {
+		if (isTooDeep(m_nesting + 1)) return false;
+		++m_nesting;
+		ret = isChar('{') ? parseObject() : parseArray();
+		--m_nesting;
 	}
 
-	// array
-	else if (isChar('[')) {
-		auto ret = parseArray(F);
-		skipWS();
-		value.m_array = std::move(ret.second);
-		value.m_type = KsonType::ARRAY;
-		return { ret.first, std::move(value) };
+	// string / number / bool / null
+	else {
+		ret = parseScalar();
 	}
 
+	skipWS();
+	return ret;
+}
+
+// parseScalar: object/array 之外的 value
+bool Kson::parseScalar() {
+
 	// string
-	else if (isChar('"')) {
-		auto ret = parseStr(F);
-		skipWS();
-		value.m_str = std::move(ret.second);
-		value.m_type = KsonType::STRING;
-		return { ret.first, std::move(value) };
+	if (isChar('"')) {
+		return parseStr();
 	}
 
 	// number
 	else if (isChar('+') || isChar('-') || isNum()) {
-		auto ret = parseNum(F);
-		skipWS();
-		value.m_num = ret.second;
-		value.m_type = KsonType::NUMBER;
-		return { ret.first, std::move(value) };
+		return parseNum();
 	}
 
 	// bool
 	else if (isChar('t') || isChar('T') || isChar('f') || isChar('F')) {
-		auto ret = parseBool(F);
-		skipWS();
-		value.m_bool = ret.second;
-		value.m_type = KsonType::BOOL;
-		return { ret.first, std::move(value) };
+		return parseBool();
 	}
 
 	// null
 	else if (isChar('n') || isChar('N')) {
-		auto ret = parseNull(F);
-		skipWS();
-		value.m_null = nullptr;
-		value.m_type = KsonType::NUL;
-		return { ret.first, std::move(value) };
+		return parseNull();
 	}
 
 	// others
-	else {
-		addError("unexpect ", CURRENT);
-		return { false, std::move(value) };
+	setError(isChar(END_OF_FILE) ? KsonErrorCode::UNEXPECTED_END : KsonErrorCode::EXPECT_VALUE);
+	if (m_errorText && !m_aborted) {
+		m_error += std::to_string(m_line) + ": unexpect " + CURRENT + "\n";
 	}
+	return false;
 }
 
-// parseHex
-std::pair<bool, KsonNum> Kson::parseHex(const std::string& format) {
-	auto isAF = [](char c) -> bool {
-		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+// parseIterative: 与 parseObject()/parseArray()/parseValue() 的递归解析逐步对应（包括 skipWS() 的位置和出错时逐层添加的错误信息）
+bool Kson::parseIterative() {
+	KSON_TRACE_ENTER("parseIterative");
+
+	m_stack.clear();
+	m_stack.push_back(1);
+	if (!isChar('{')) {
+		addError(KsonErrorCode::EXPECT_OBJECT, "unexpected  ", CURRENT, ", expect '{'");
+		return false;
+	}
+
+	++m_idx;
+	if (!handled(m_handler->startObject())) return false;
+	skipWS();
+
+	// 出错：当前容器结束，外层的每个容器依次添加 "expect value"
+	auto fail = [this]() {
+		m_stack.pop_back();
+		while (!m_stack.empty()) {
+			skipWS();
+			addError(KsonErrorCode::EXPECT_VALUE, "expect value");
+			m_stack.pop_back();
+		}
+		return false;
 	};
 
+	// 子节点出错：由当前容器添加 "expect value"
+	auto failValue = [this, &fail]() {
+		skipWS();
+		addError(KsonErrorCode::EXPECT_VALUE, "expect value");
+		return fail();
+	};
+
+	while (true) {
+		bool isObject = m_stack.back() == 1;
+		char close = isObject ? '}' : ']';
+
+		// 容器结束
+		if (isChar(close)) {
+			++m_idx;
+			if (!handled(isObject ? m_handler->endObject() : m_handler->endArray())) return fail();
+			skipWS();
+
+			m_stack.pop_back();
+			if (m_stack.empty()) return true;
+		}
+
+		// 文件结束
+		else if (isChar(END_OF_FILE)) {
+			addError(KsonErrorCode::UNEXPECTED_END, isObject ? "unexpected  END_OF_FILE, expect '}'" : "unexpected  END_OF_FILE, expect ']'");
+			return fail();
+		}
+
+		else {
+
+			// object: key ':'
+			if (isObject) {
+				if (!parseKey()) {
+					addError(KsonErrorCode::EXPECT_KEY, "expect key");
+					return fail();
+				}
+				if (!isChar(':')) {
+					addError(KsonErrorCode::EXPECT_COLON, "unexpected  ", CURRENT, ", expect ':'");
+					return fail();
+				}
+				++m_idx;
+				skipWS();
+			}
+
+			// object / array：进入子容器，结束后回到这里继续
+			if (isChar('{') || isChar('[')) {
+				if (isTooDeep(m_stack.size() + 1)) {
+					addError(KsonErrorCode::EXPECT_VALUE, "expect value");
+					return fail();
+				}
+				bool isChildObject = isChar('{');
+				++m_idx;
+				m_stack.push_back(isChildObject ? 1 : 0);
+				if (!handled(isChildObject ? m_handler->startObject() : m_handler->startArray())) {
+					m_stack.pop_back();
+					return failValue();
+				}
+				skipWS();
+				continue;
+			}
+
+			if (!parseScalar()) return failValue();
+			skipWS();
+		}
+
+		// value 之后：',' 或容器结束
+		skipWS();
+		isObject = m_stack.back() == 1;
+		close = isObject ? '}' : ']';
+		if (!isChar(close)) {
+			if (isChar(',')) {
+				++m_idx;
+				skipWS();
+			}
+			else {
+				addError(KsonErrorCode::EXPECT_COMMA, "unexpected  ", CURRENT, ", expect ','");
+				return fail();
+			}
+		}
+	}
+}
+
+// parseHex
+bool Kson::parseHex() {
+	KSON_TRACE_ENTER("parseHex");
+
 	// 0x 后面必须要有数字或a~f或A~F的字符
-	if (!isNum() && !isAF(CURRENT)) {
-		addError(mkStr("unexpected  ", CURRENT) + ", expect number.");
-		return { false, KsonNum(true, 0, 0.0) };
+	if (!isClass(KSON_CHAR_HEX)) {
+		addError(KsonErrorCode::INVALID_NUMBER, "unexpected  ", CURRENT, ", expect number.");
+		return false;
 	}
 
-	int num = 0;
-	while (isNum() || isAF(CURRENT)) {
-		num = num * 16 + (CURRENT & 15) + (CURRENT >= 'A' ? 9 : 0);
+	const char* digits = &CURRENT;
+	size_t len = 0;
+	while (isClass(KSON_CHAR_HEX)) {
+		++len;
 		++m_idx;
 	}
 	skipWS();
-	return { true, KsonNum(true, num, 0.0) };
+	if (m_aborted) return false;
+
+	auto num = toKsonHex(digits, len);
+	if (!num.first) {
+		addError(KsonErrorCode::NUMBER_OUT_OF_RANGE, "hex number out of range.");
+		return false;
+	}
+	return handled(m_handler->integer(num.second.m_int));
 }
 
-// skipWS
-void Kson::skipWS() {
-	while (CURRENT == ' ' || CURRENT == '\n' || CURRENT == '\t') {
-		if (CURRENT == '\n') {
-			++m_line;
+// unescapeKsonStr: 与 Kson::parseStr() 的转义规则相同
+void kson::unescapeKsonStr(const char* str, size_t len, std::string& out) {
+	const char* end = str + len;
+	while (str < end) {
+		const char* p = static_cast<const char*>(std::memchr(str, '\\', size_t(end - str)));
+		if (!p) p = end;
+		out.append(str, p - str);
+		if (p == end) break;
+
+		char c = p + 1 < end ? p[1] : '\0';
+		switch (c) {
+		case 'n':  out.push_back('\n'); break;
+		case 't':  out.push_back('\t'); break;
+		case '\\': out.push_back('\\'); break;
+		case '\'': out.push_back('\''); break;
+		case '"':  out.push_back('"'); break;
+
+		// 不支持的转义字符保留 '\'
+		default:
+			out.push_back('\\');
+			str = p + 1;
+			continue;
 		}
-		++m_idx;
+		str = p + 2;
 	}
+}
 
-	auto valid = [this](char arg) -> bool {
-		return CURRENT == arg;
-	};
+// getKsonTextPos: 只在需要时计算，解析过程中不统计列号
+KsonTextPos kson::getKsonTextPos(const char* data, size_t offset) {
+	KsonTextPos pos;
+	const char* lineStart = data;
+	const char* end = data + offset;
+	for (const char* p = data; (p = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)))) != nullptr; ) {
+		++pos.m_line;
+		lineStart = ++p;
+	}
+	pos.m_column = size_t(end - lineStart) + 1;
+	return pos;
+}
 
-	// charactor: '0' (ASCII: 48) not supported!
-	if (!std::any_of(VALID_CHARACTOR.cbegin(), VALID_CHARACTOR.cend(), valid)) {
+// getKsonErrorName
+const char* kson::getKsonErrorName(KsonErrorCode code) {
+	switch (code) {
+	case KsonErrorCode::NONE:                 return "NONE";
+	case KsonErrorCode::IO_FAILED:            return "IO_FAILED";
+	case KsonErrorCode::UNSUPPORTED_CHAR:     return "UNSUPPORTED_CHAR";
+	case KsonErrorCode::EXPECT_OBJECT:        return "EXPECT_OBJECT";
+	case KsonErrorCode::EXPECT_KEY:           return "EXPECT_KEY";
+	case KsonErrorCode::EXPECT_COLON:         return "EXPECT_COLON";
+	case KsonErrorCode::EXPECT_COMMA:         return "EXPECT_COMMA";
+	case KsonErrorCode::EXPECT_VALUE:         return "EXPECT_VALUE";
+	case KsonErrorCode::UNEXPECTED_END:       return "UNEXPECTED_END";
+	case KsonErrorCode::INVALID_NUMBER:       return "INVALID_NUMBER";
+	case KsonErrorCode::INVALID_LITERAL:      return "INVALID_LITERAL";
+	case KsonErrorCode::NUMBER_OUT_OF_RANGE:  return "NUMBER_OUT_OF_RANGE";
+	case KsonErrorCode::TOO_DEEP:             return "TOO_DEEP";
+	case KsonErrorCode::STOPPED:              return "STOPPED";
+	case KsonErrorCode::OUT_OF_MEMORY:        return "OUT_OF_MEMORY";
+	default:                                  return "UNKNOWN";
+	}
+}
 
-		// 文件结束
-		if (CURRENT == END_OF_FILE) return;
+// formatKsonError
+std::string kson::formatKsonError(const KsonError& error, const char* data) {
+	KsonTextPos pos = getKsonTextPos(data, error.m_offset);
+	return "line " + std::to_string(pos.m_line) + ", column " + std::to_string(pos.m_column) + ": "
+		+ getKsonErrorName(error.m_code) + " (depth " + std::to_string(error.m_depth) + ")";
+}
+
+// isTooDeep
+bool Kson::isTooDeep(size_t depth) {
+	if (m_maxDepth == 0 || depth <= m_maxDepth) return false;
+	setError(KsonErrorCode::TOO_DEEP);
+	if (m_errorText) {
+		addText("nesting too deep (max depth " + std::to_string(m_maxDepth) + ")");
+	}
+	return true;
+}
 
-		addError(mkStr("charactor: ", CURRENT) + " (ASCII: " + std::to_string(int(CURRENT)) + ") not supported!");
-		throw KSON_UNEXPECTED_CHARACTOR();
+// handled
+bool Kson::handled(bool ret) {
+	if (!ret) {
+		addError(KsonErrorCode::STOPPED, "stopped by handler");
 	}
+	return ret;
+}
+
+// skipWS
+void Kson::skipWS() {
+
+	// 每次循环跳过一段空白和之后的一个注释，连续的注释不递归（调用栈不随注释的个数增长）
+	for (;;) {
+
+		// 单个空白逐字节处理，连续的空白批量扫描
+		if (isClass(KSON_CHAR_WS)) {
+			if (CURRENT == '\n') {
+				++m_line;
+			}
+			++m_idx;
+			if (isClass(KSON_CHAR_WS)) {
+				m_idx = toIdx(m_scanner->skipSpace(&CURRENT, scanEnd(), m_line));
+			}
+		}
+
+		// charactor: '0' (ASCII: 48) not supported!
+		if (!isClass(KSON_CHAR_VALID)) {
+
+			// 文件结束
+			if (CURRENT == END_OF_FILE) return;
+
+			// 解析在这里结束：跳到文本结尾，各层依次返回 false，之后的错误不再添加到错误文本
+			setError(KsonErrorCode::UNSUPPORTED_CHAR);
+			if (m_errorText) {
+				addText(mkStr("charactor: ", CURRENT) + " (ASCII: " + std::to_string(int(CURRENT)) + ") not supported!");
+			}
+			m_aborted = true;
+			m_idx = m_buf.size();
+			return;
+		}
 
-	// 跳过注释
-	if (isChar('/')) {
+		// 跳过注释
+		if (!isChar('/')) return;
 
-		// 行注释
+		// 行注释：停在 '\n' 或文件结束处
 		if (isChar(1, '/')) {
 			m_idx += 2;
-			while (CURRENT != '\n') {
-				if (isChar(END_OF_FILE)) return;
-				++m_idx;
-			}
-			skipWS();
+			m_idx = toIdx(m_scanner->findLineEnd(&CURRENT, scanEnd()));
+			if (isChar(END_OF_FILE)) return;
 		}
-		
-		// 块注释
+
+		// 块注释：停在 "*/" 或文件结束处
 		else if (isChar(1, '*')) {
 			m_idx += 2;
-			while (true) {
-				if (isChar(END_OF_FILE)) return;
-				if (isChar('*') && isChar(1, '/')) {
-					m_idx += 2;
-					break;
-				}
-				++m_idx;
-			}
-			skipWS();
+			m_idx = toIdx(m_scanner->findBlockEnd(&CURRENT, scanEnd()));
+			if (isChar(END_OF_FILE)) return;
+			m_idx += 2;
+		}
+		else {
+			return;
 		}
 	}
 }
 
-// addError
-void Kson::addError(std::string errorInfo) {
-	m_error += "line ";
-	m_error += std::move(std::to_string(m_line));
-	m_error += ": ";
-	m_error += errorInfo + "\n";
+// setError: 只记录最先遇到的错误
+void Kson::setError(KsonErrorCode code) {
+	if (m_err) return;
+	m_err.m_code = code;
+	m_err.m_offset = m_idx;
+	m_err.m_depth = m_iterative ? m_stack.size() : m_nesting;
 }
 
 // addError
-void Kson::addError(std::string errorInfo, char appChar) {
-	errorInfo.push_back(appChar);
-	m_error += std::move(std::to_string(m_line));
-	m_error += ": ";
-	m_error += errorInfo + "\n";
+void Kson::addError(KsonErrorCode code, const char* info) {
+	setError(code);
+	if (m_errorText) {
+		addText(info);
+	}
 }
 
-// isValidStrChar
-bool Kson::isValidStrChar(char c) {
-	auto valid = [this, c](char arg) -> bool {
-		return arg == c;
-	};
+// addError: "unexpected  'c', expect ..."，c 为文件结束时错误码为 UNEXPECTED_END
+void Kson::addError(KsonErrorCode code, const char* prefix, char c, const char* suffix) {
+	setError(c == END_OF_FILE ? KsonErrorCode::UNEXPECTED_END : code);
+	if (m_errorText) {
+		addText(mkStr(prefix, c) + suffix);
+	}
+}
 
-	std::string str = VALID_CHARACTOR;
-	str.pop_back();
-	return std::any_of(str.begin(), str.end(), valid);
+// addText
+void Kson::addText(const std::string& info) {
+	if (m_aborted) return;
+	m_error += "line ";
+	m_error += std::to_string(m_line);
+	m_error += ": ";
+	m_error += info;
+	m_error += "\n";
 }
@@ -1,37 +1,39 @@
-#ifndef __KSON__H__
+#ifndef __KSON_H__
 #define __KSON_H__
 
-#include <map>
 #include <vector>
 #include <string>
 #include <iostream>
+#include <cstdint>
+#include "kmap.h"
+#include "ksimd.h"
 
 //============================================================
-//  ksonʽ
+//  kson格式介绍
 //============================================================
 
 /*
-kson ֧ 6 :
-object:    
-array:     
-string:    ַ
-number:    
-bool:      ֵ
-null:      
+kson 支持 6 种数据类型:
+object:    对象
+array:     数组
+string:    字符串
+number:    数字
+bool:      布尔值
+null:      空
 
-ͬʱkson֧עͣעͺͿעͣͬ C еע
+同时，kson支持两种注释：行注释和块注释，定义同 C 语言中的注释
 
-======== object:  ========
-// key ˫Ű
-// value κ kson ֵ֧
+======== object: 对象 ========
+// key 不用双引号包括
+// value 可以是任何 kson 支持的数据类型
 
-// ---- ʽ ----
+// ---- 格式 ----
 {
 key : value
 key : value
 }
 
-// ---- ʾ ----
+// ---- 示例 ----
 
 {
 a : 1,
@@ -45,15 +47,15 @@ b : {
 d : [1, "abc"]
 }
 
-======== array:  ========
+======== array: 数组 ========
 
-// ---- ʽ ----
+// ---- 格式 ----
 
 [
 value, value, value  //...
 ]
 
-// ---- ʾ ----
+// ---- 示例 ----
 
 [
 1,
@@ -64,39 +66,43 @@ a : 1
 [1, "abc", true]
 }
 
-======== string: ַ ========
+======== string: 字符串 ========
 
-// ---- ʽ ----
-"abcd1234!@#$"    // ַͨ
-"\t \n \" \\"     // תַ
+// ---- 格式 ----
+"abcd1234!@#$"    // 普通字符
+"\t \n \" \\"     // 转义字符
 
-======== number: ֵ ========
+======== number: 数值 ========
 
-// ---- ʾ ----
+// ---- 示例 ----
 
-// 
-1234    // ʮ
-0xab    // ʮ
-12e3    // ѧ
+// 整数
+1234    // 十进制
+0xab    // 十六进制
+12e3    // 科学计数法
 
 +0xab
 -12e3
 
-// 
+// 浮点数
 1.1
 2.2e3
+2.2e-3    // 指数可以带正负号，负指数的结果为浮点数
 
-======= ֵ =======
+// 整数为 64 位，超出 int64 范围的十进制整数作为浮点数（正确舍入）
+// 十六进制最多 64 位，按位解释为 int64（0xffffffffffffffff 为 -1）
 
-// ---- ʾ ----
+======= 布尔值 =======
+
+// ---- 示例 ----
 true
 false
 TRUE
 FALSE
 
-======== null:  ========
+======== null: 空 ========
 
-// ---- ʾ ----
+// ---- 示例 ----
 null
 NULL
 
@@ -104,12 +110,12 @@ NULL
 
 
 //============================================================
-//  ksonݽṹ
+//  kson数据结构
 //============================================================
 
 namespace kson {
 
-	enum class KsonType {
+	enum class KsonType : unsigned char {
 		OBJECT,
 		ARRAY,
 		STRING,
@@ -120,135 +126,543 @@ namespace kson {
 
 	class KsonValue;
 
-	using KsonObject = std::map<std::string, KsonValue>;
+	using KsonObject = KsonFlatMap<KsonValue>;   // 按 key 排序的扁平容器，接口与 std::map 相同
 	using KsonArray = std::vector<KsonValue>;
 	using KsonStr = std::string;
-	using KsonInt = int;
+	using KsonInt = std::int64_t;
 	using KsonDouble = double;
 	using KsonBool = bool;
 	using KsonNull = void*;
 
+	// double 截断为整数，超出 int64 范围（或为 NaN）时为 0
+	inline KsonInt toKsonInt(KsonDouble value) {
+		return (value >= -9223372036854775808.0 && value < 9223372036854775808.0) ? static_cast<KsonInt>(value) : 0;
+	}
+
+	// 整数和浮点数共用存储，由 m_isInt 区分
 	struct KsonNum {
-		KsonNum(bool b, int i, double d) : m_isInt(b), m_int(i), m_double(d) {}
+		KsonNum(bool b, KsonInt i, KsonDouble d) : m_isInt(b) {
+			if (b) m_int = i;
+			else m_double = d;
+		}
 
+		// 浮点数取整数时截断，整数取浮点数时转换
+		KsonInt     getInt()    const { return m_isInt ? m_int : toKsonInt(m_double); }
+		KsonDouble  getDouble() const { return m_isInt ? static_cast<KsonDouble>(m_int) : m_double; }
+
+		union {
+			KsonInt     m_int;
+			KsonDouble  m_double;
+		};
 		bool m_isInt;
-		int m_int;
-		double m_double;
 	};
 
 	class KsonValue {
 	public:
 
-		// friend: kson kson 
+		// friend: kson 解析器，事件构建器，并行解析器，kson 测试类，kson 性能测试类
 		friend class Kson;
+		friend class KsonDomHandler;
+		friend class KsonParallelParser;
 		friend class KsonTest;
+		friend class KsonBench;
 
-		// ȡ KsonType
+		// 获取 KsonType
 		KsonType     getType()   const { return m_type; }
 
-		// ȡֵ
-		KsonObject   getObject() const { return m_object; }
-		KsonArray    getArray()  const { return m_array; }
-		KsonStr      getStr() const { return m_str; }
-		KsonInt      getInt()    const { return m_num.m_int; }
-		KsonDouble   getDouble() const { return m_num.m_double; }
-		KsonNull     getNull()   const { return m_null; }
+		// 获取值（类型不符时返回空值）
+		KsonObject   getObject() const { return objectRef(); }
+		KsonArray    getArray()  const { return arrayRef(); }
+		KsonStr      getStr()    const { return strRef(); }
+		KsonInt      getInt()    const { return m_type == KsonType::NUMBER ? m_num.getInt() : 0; }
+		KsonDouble   getDouble() const { return m_type == KsonType::NUMBER ? m_num.getDouble() : 0.0; }
+		bool         isInt()     const { return m_type == KsonType::NUMBER && m_num.m_isInt; }
+		KsonBool     getBool()   const { return m_type == KsonType::BOOL ? m_bool : false; }
+		KsonNull     getNull()   const { return nullptr; }
+
+		// 从 m_object[key] 中获取 KsonObject
+		// 从 m_array[index] 中获取 KsonObject
+		KsonObject   getObject(const std::string& key) { return objectRef().at(key).objectRef(); }
+		KsonObject   getObject(int index) { return arrayRef().at(index).objectRef(); }
+
+		// 从 m_object[key] 中获取 KsonArray
+		// 从 m_array[index] 中获取 KsonArray
+		KsonArray    getArray(const std::string& key) { return objectRef().at(key).arrayRef(); }
+		KsonArray    getArray(int index) { return arrayRef().at(index).arrayRef(); }
+
+		// 获取值的引用，不拷贝（类型不符时返回空值的引用）
+		const KsonObject& objectRef() const;
+		const KsonArray&  arrayRef() const;
+		const KsonStr&    strRef() const;
+
+		// 查找 m_object[key]，不存在或不是 object 时返回 nullptr
+		const KsonValue*  find(const std::string& key) const;
+
+		// 链式查找，不拷贝：value.at("a").at(3).at("b")
+		// 不存在或类型不符时抛出 std::out_of_range
+		const KsonValue&  at(const std::string& key) const;
+		const KsonValue&  at(size_t index) const;
+
+		// object 的成员个数 / array 的元素个数 / string 的长度，其它类型为 0
+		size_t            size() const;
 
-		//  m_object[key] лȡ KsonObject
-		//  m_array[index] лȡ KsonObject
-		KsonObject   getObject(const std::string& key) { return m_object.at(key).m_object; }
-		KsonObject   getObject(int index) { return m_array.at(index).m_object; }
+	public:
 
-		//  m_object[key] лȡ KsonArray
-		//  m_array[index] лȡ KsonArray
-		KsonArray    getArray(const std::string& key) { return m_object.at(key).m_array; }
-		KsonArray    getArray(int index) { return m_array.at(index).m_array; }
+		// 构建值：容器和字符串移入，不拷贝
+		static KsonValue  makeObject(KsonObject&& obj = KsonObject());
+		static KsonValue  makeArray(KsonArray&& arr = KsonArray());
+		static KsonValue  makeStr(KsonStr&& str);
+		static KsonValue  makeInt(KsonInt value);
+		static KsonValue  makeDouble(KsonDouble value);
+		static KsonValue  makeBool(KsonBool value);
+		static KsonValue  makeNull();
+
+		// 修改 object：不是 object 时先变为空 object，返回成员的引用（可以继续在其中添加）
+		// set() 覆盖已有的成员，emplace() 在成员不存在时插入空 object，已经存在时返回已有的成员
+		// 成员按 key 排序存放，按 key 的顺序添加时不需要移动已有的成员
+		// 返回的引用只在同一个 object 下一次 set() / emplace() / erase() 之前有效：成员存放在排序的 vector 中，
+		// 插入可能重新分配（引用悬空），插入排在前面的 key 或 erase 会移动后面的成员（引用不报错，但指向另一个成员的值）；
+		// reserve() 只能避免前一种情况，之后还要使用成员时用 at() / find() 重新获取
+		KsonValue&  set(std::string key, KsonValue value);
+		KsonValue&  emplace(std::string key);
+		bool        erase(const std::string& key);
+
+		// 修改 array：不是 array 时先变为空 array，返回元素的引用；emplace_back() 追加一个空 object
+		// 返回的引用在 array 再次增长（超过 reserve() 的容量）之前有效
+		KsonValue&  push_back(KsonValue value);
+		KsonValue&  emplace_back();
+		bool        erase(size_t index);
+
+		// 为 object / array 预留 size 个成员 / 元素的空间，其它类型不变
+		void        reserve(size_t size);
 
 	public:
-		KsonValue();
+		KsonValue() : m_object(nullptr), m_type(KsonType::OBJECT) {}
 		KsonValue(
 			KsonType type,
 			KsonObject&& obj, KsonArray&& arr, KsonStr&& str,
 			KsonNum&& num, KsonBool bol, KsonNull nul
-		) : m_type(type), m_object(std::move(obj)), m_array(std::move(arr)), m_str(std::move(str)), 
-			m_num(std::move(num)), m_bool(bol), m_null(nul) {}
-		
+		);
+
+		KsonValue(const KsonValue& other);
+		KsonValue(KsonValue&& other) noexcept;
+		KsonValue& operator=(const KsonValue& other);
+		KsonValue& operator=(KsonValue&& other) noexcept;
+		~KsonValue() { release(); }
+
+	private:
+
+		// 设置值，释放原有的 object/array/string
+		void setObject(KsonObject&& obj);
+		void setArray(KsonArray&& arr);
+		void setStr(KsonStr&& str);
+		void setNum(const KsonNum& num);
+		void setBool(KsonBool bol);
+		void setNull();
+
+		// 修改之前取得容器，类型不符时先变为空的 object / array
+		KsonObject& mutObject();
+		KsonArray&  mutArray();
+
+		// 释放时嵌套的容器先移到 pending 中，再在 release() 的循环中逐个释放
+		void release();
+		void detachChildren(std::vector<KsonValue>& pending) noexcept;
+		void releaseHeap();
+
 	private:
-		KsonObject      m_object;   // object
-		KsonArray       m_array;    // array
-		KsonStr         m_str;      // string
-		KsonNum         m_num;      // number
-		KsonBool        m_bool;     // bool
-		KsonNull        m_null;     // null
+
+		static const KsonObject s_emptyObject;
+		static const KsonArray  s_emptyArray;
+		static const KsonStr    s_emptyStr;
+
+		// 同一时刻只保存一种类型的值，由 m_type 区分
+		// object/array/string 存放在堆上，这里只保存指针（为空时不分配）
+		union {
+			KsonObject*     m_object;   // object
+			KsonArray*      m_array;    // array
+			KsonStr*        m_str;      // string
+			KsonNum         m_num;      // number
+			KsonBool        m_bool;     // bool
+		};
 
 		KsonType        m_type = KsonType::OBJECT;
 	};
+
+	inline const KsonObject& KsonValue::objectRef() const {
+		return (m_type == KsonType::OBJECT && m_object) ? *m_object : s_emptyObject;
+	}
+
+	inline const KsonArray& KsonValue::arrayRef() const {
+		return (m_type == KsonType::ARRAY && m_array) ? *m_array : s_emptyArray;
+	}
+
+	inline const KsonStr& KsonValue::strRef() const {
+		return (m_type == KsonType::STRING && m_str) ? *m_str : s_emptyStr;
+	}
 }
 
 
 //============================================================
-//  kson
+//  kson字符分类
 //============================================================
 
 namespace kson {
 
+	// 字符类别，可以按位组合
+	enum KsonCharClass : unsigned char {
+		KSON_CHAR_WS        = 1 << 0,   // 空白: ' ' '\n' '\t' '\r'
+		KSON_CHAR_KEY_START = 1 << 1,   // key 首字符: a~z A~Z _
+		KSON_CHAR_KEY       = 1 << 2,   // key 字符: a~z A~Z 0~9 _
+		KSON_CHAR_DIGIT     = 1 << 3,   // 0~9
+		KSON_CHAR_HEX       = 1 << 4,   // 0~9 a~f A~F
+		KSON_CHAR_STR       = 1 << 5,   // 字符串中的字符: 可见字符和空格，'"' 除外
+		KSON_CHAR_STRUCT    = 1 << 6,   // 结构字符: { } [ ] : ,
+		KSON_CHAR_VALID     = 1 << 7,   // 支持的字符: 可见字符和空格
+	};
+
+	struct KsonCharTable {
+		unsigned char m_class[256];
+	};
+
+	// 编译期生成 256 项的字符分类表
+	constexpr KsonCharTable makeKsonCharTable() {
+		KsonCharTable table = {};
+		for (int c = 0; c < 256; ++c) {
+			bool lower = c >= 'a' && c <= 'z';
+			bool upper = c >= 'A' && c <= 'Z';
+			bool digit = c >= '0' && c <= '9';
+			bool valid = c >= ' ' && c <= '~';
+
+			unsigned char cls = 0;
+			if (c == ' ' || c == '\n' || c == '\t' || c == '\r') cls |= KSON_CHAR_WS;
+			if (lower || upper || c == '_') cls |= KSON_CHAR_KEY_START;
+			if (lower || upper || digit || c == '_') cls |= KSON_CHAR_KEY;
+			if (digit) cls |= KSON_CHAR_DIGIT;
+			if (digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) cls |= KSON_CHAR_HEX;
+			if (valid && c != '"') cls |= KSON_CHAR_STR;
+			if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') cls |= KSON_CHAR_STRUCT;
+			if (valid) cls |= KSON_CHAR_VALID;
+			table.m_class[c] = cls;
+		}
+		return table;
+	}
+
+	constexpr KsonCharTable KSON_CHAR_TABLE = makeKsonCharTable();
+
+	// 字符 c 是否属于 cls 中的某一类
+	inline bool isCharClass(char c, unsigned char cls) {
+		return (KSON_CHAR_TABLE.m_class[static_cast<unsigned char>(c)] & cls) != 0;
+	}
+}
+
+
+//============================================================
+//  kson解析器
+//============================================================
+
+// 调试跟踪开关：编译时定义 KSON_TRACE=1 后，解析过程中输出进入的函数及嵌套深度
+#ifndef KSON_TRACE
+#define KSON_TRACE 0
+#endif
+
+namespace kson {
+
+	// 数值转换：由整数部分、小数部分、指数部分的数字串得到 KsonNum
+	// isInt 为 false 时表示有小数部分；expLen 为 0 表示没有指数部分，指数部分可以以 '+' / '-' 开头
+	// 没有小数部分和负指数、且在 int64 范围内时为整数，否则为正确舍入的 double；超出 double 范围时返回 false
+	std::pair<bool, KsonNum> toKsonNum(
+		bool isNeg, bool isInt,
+		const char* intPart, size_t intLen,
+		const char* fracPart, size_t fracLen,
+		const char* expPart, size_t expLen
+	);
+
+	// 十六进制数字串（不含 0x）转换为 KsonNum，超过 64 位时返回 false
+	std::pair<bool, KsonNum> toKsonHex(const char* digits, size_t len);
+
+	// 连续的数值文本 [+-]digits[.digits][(e|E)[+-]digits] 转换为 KsonNum（延迟解码使用），格式不符或超出范围时返回 false
+	std::pair<bool, KsonNum> toKsonNum(const char* str, size_t len);
+
+	// 数值一定不会超出 double 的范围（不需要转换就可以确定），用于延迟解码时跳过转换
+	bool isSafeKsonNum(size_t intLen, const char* expPart, size_t expLen);
+
+	// 字符串的转义：\n \t \\ \' \" 转换为对应的字符，其它 '\' 保留；结果追加到 out
+	void unescapeKsonStr(const char* str, size_t len, std::string& out);
+
+	// 数值输出到 buf（至少 KSON_NUM_BUF_SIZE 字节），返回长度
+	// double 输出为能精确还原的最短形式（15~17 位有效数字），总是含有 '.'，重新解析后仍为浮点数；调用者保证 value 为有限值
+	const size_t KSON_NUM_BUF_SIZE = 32;
+	size_t formatKsonInt(KsonInt value, char* buf);
+	size_t formatKsonDouble(double value, char* buf);
+
+	// 错误码：解析失败时最先遇到的错误
+	enum class KsonErrorCode : unsigned char {
+		NONE,
+		IO_FAILED,            // 文件读取失败
+		UNSUPPORTED_CHAR,     // 不支持的字符（字符串中的也是）
+		EXPECT_OBJECT,        // 根不是 object
+		EXPECT_KEY,           // key 不以 '_' 或字母开始
+		EXPECT_COLON,         // key 之后没有 ':'
+		EXPECT_COMMA,         // value 之后既没有 ',' 也没有 '}' / ']'
+		EXPECT_VALUE,         // 无法识别的 value
+		UNEXPECTED_END,       // object / array / 字符串没有结束
+		INVALID_NUMBER,       // 数值格式错误
+		INVALID_LITERAL,      // true / false / null 拼写错误
+		NUMBER_OUT_OF_RANGE,  // 数值超出范围
+		TOO_DEEP,             // 超过最大嵌套深度
+		STOPPED,              // handler 返回 false（或抛出异常）
+		OUT_OF_MEMORY         // 内存分配失败
+	};
+
+	// 结构化的错误信息：只记录位置，行号和列号在需要时由 getKsonTextPos() 计算
+	struct KsonError {
+		KsonErrorCode  m_code = KsonErrorCode::NONE;
+		size_t         m_offset = 0;   // 出错位置在 kson 文本中的字节偏移
+		size_t         m_depth = 0;    // 出错时未结束的 object / array 个数（根 object 为 1）
+
+		explicit operator bool() const { return m_code != KsonErrorCode::NONE; }
+	};
+
+	// 文本中的位置，行号和列号从 1 开始，列号按字节计算
+	struct KsonTextPos {
+		size_t  m_line = 1;
+		size_t  m_column = 1;
+	};
+
+	// 偏移 offset 处的行号和列号（统计 offset 之前的每一个 '\n'，包括块注释中的）
+	KsonTextPos getKsonTextPos(const char* data, size_t offset);
+
+	// 错误码的名称，例如 "EXPECT_COLON"
+	const char* getKsonErrorName(KsonErrorCode code);
+
+	// 可读的错误信息："line 3, column 7: EXPECT_COLON (depth 2)"，data 为解析的 kson 文本
+	std::string formatKsonError(const KsonError& error, const char* data);
+
+	// kson文本缓冲区
+	// 文件在 Linux 等 POSIX 系统上以只读方式 mmap，其它情况（管道、设备文件、Windows）整块读入
+	// 保证 data()[size()] == '\0'，解析器以此作为结束标记：
+	// mmap 时文件末尾所在页的剩余部分由系统填 0，只有文件大小恰好是页大小的整数倍时才需要拷贝一份并补 '\0'
+	class KsonBuffer {
+	public:
+		KsonBuffer() = default;
+		KsonBuffer(const KsonBuffer&) = delete;
+		KsonBuffer& operator=(const KsonBuffer&) = delete;
+		KsonBuffer(KsonBuffer&& other) noexcept;
+		KsonBuffer& operator=(KsonBuffer&& other) noexcept;
+		~KsonBuffer() { clear(); }
+
+		// 读入文件，失败时返回 false，并在 error 中写入原因
+		bool load(const std::string& file, std::string& error);
+
+		// 拷贝（或移入）字符串
+		void assign(const std::string& str);
+		void assign(std::string&& str);
+
+		// 不拷贝，直接使用 data，调用者保证 data[size] == '\0' 并且在使用期间有效
+		void borrow(const char* data, size_t size);
+
+		// 释放映射或拷贝，变为空缓冲区
+		void clear();
+
+		const char*  data() const { return m_data; }
+		size_t       size() const { return m_size; }
+		bool         isMapped() const { return m_map != nullptr; }
+
+	private:
+		std::string  m_copy;              // 整块读入的内容，或 mmap 后补 '\0' 的拷贝
+		const char*  m_data = "";         // 文本起始位置
+		size_t       m_size = 0;          // 文本长度（不含结尾的 '\0'）
+		void*        m_map = nullptr;     // mmap 的起始地址
+		size_t       m_mapSize = 0;       // mmap 的长度
+	};
+
+	// 事件接口（SAX）：解析时按文本中的顺序回调，不构建 KsonObject
+	// 回调返回 false 时停止解析，parse() 返回 false；未重写的回调忽略该事件
+	// key()/string() 中的 str 只在回调期间有效：没有转义字符时指向 kson 文本，否则指向解析器内部的缓冲区
+	class KsonHandler {
+	public:
+		virtual ~KsonHandler() = default;
+
+		virtual bool startObject() { return true; }
+		virtual bool key(const char* str, size_t len) { return true; }
+		virtual bool endObject() { return true; }
+		virtual bool startArray() { return true; }
+		virtual bool endArray() { return true; }
+		virtual bool string(const char* str, size_t len) { return true; }
+		virtual bool integer(KsonInt value) { return true; }
+		virtual bool floating(double value) { return true; }
+		virtual bool boolean(bool value) { return true; }
+		virtual bool null() { return true; }
+
+		// 延迟解码（KsonLazyDocument 使用）：isLazy() 返回 true 时，Kson 不转义字符串、不转换数值，
+		// 改为调用 rawString() / rawNumber() 给出它们在 kson 文本中的位置，格式检查与一般的解析相同
+		// 十六进制、中间有空白或注释、可能超出范围的数值仍然转换后调用 integer() / floating()
+		virtual bool isLazy() const { return false; }
+
+		// 字符串两个引号之间的原始内容，isEscaped 表示其中有 '\'
+		virtual bool rawString(const char* str, size_t len, bool isEscaped) { return true; }
+
+		// 连续的数值文本，由 toKsonNum(str, len) 转换
+		virtual bool rawNumber(const char* str, size_t len) { return true; }
+	};
+
+	// 由事件构建 KsonObject，Kson::parse() 和 KsonPushParser 使用
+	class KsonDomHandler : public KsonHandler {
+	public:
+		KsonDomHandler() { m_stack.reserve(32); }   // 常见的嵌套深度下不需要重新分配
+
+		bool startObject() override;
+		bool key(const char* str, size_t len) override;
+		bool endObject() override;
+		bool startArray() override;
+		bool endArray() override;
+		bool string(const char* str, size_t len) override;
+		bool integer(KsonInt value) override;
+		bool floating(double value) override;
+		bool boolean(bool value) override;
+		bool null() override;
+
+		// 已经构建好的值作为下一个 value（KsonParallelParser 拼接并行解析的 array）
+		bool value(KsonValue&& value) { return addValue(std::move(value)); }
+
+		// 取出根 object；解析失败时为根 object 中已经完成的部分
+		KsonObject release();
+
+		// 清空状态，保留已分配的 Frame
+		void reset();
+
+	private:
+
+		// 正在构建的 object / array
+		struct Frame {
+			bool                          m_isObject;
+			bool                          m_isPending; // object 的最后一个成员只有 key，等待 value
+			KsonObject::container_type    m_members;   // object 的成员（按出现的顺序，结束时排序）
+			KsonArray                     m_array;
+		};
+
+		bool startContainer(bool isObject);
+		bool endContainer();
+		bool addValue(KsonValue&& value);
+
+	private:
+		std::vector<Frame> m_stack;       // 容器栈
+		size_t             m_depth = 0;   // m_stack 中正在使用的层数（保留已分配的 Frame 以便复用）
+		KsonObject         m_root;        // 解析完成的根 object
+	};
+
 	class Kson
 	{
 	public:
-		// ͨļksonַн
+		// 通过传入文件名，或kson字符串来进行解析
+		// 文件读取失败时，parse() 返回 false，getErrorInfo() 中给出原因
 		Kson(const std::string& str, bool isFile = true);
+
+		// 解析已经准备好的缓冲区，例如 KsonBuffer::borrow() 指向的文本
+		explicit Kson(KsonBuffer&& buf);
 		
-		// 
+		// 解析函数
 		std::pair<bool, KsonObject> parse();
+
+		// 解析函数：只向 handler 发送事件
+		bool parse(KsonHandler& handler);
 		
-		// ȡеĴϢ
-		std::string getErrorInfo() { return m_error; }
+		// 不抛出异常的解析：出错时不生成错误文本、不输出到 std::cout，error 中为最先遇到的错误
+		// handler 抛出的异常（包括内存分配失败）也在这里转换为错误码
+		bool parse(KsonHandler& handler, KsonError& error) noexcept;
+		bool parse(KsonObject& obj, KsonError& error) noexcept;
+
+		// 获取解析过程中的错误信息
+		// 不抛出异常的解析之后由 formatKsonError() 生成
+		std::string getErrorInfo();
+
+		// 最近一次解析的结构化错误信息，以及出错位置的行号和列号
+		const KsonError& getError() const { return m_err; }
+		KsonTextPos getErrorPos() const { return getKsonTextPos(m_buf.data(), m_err.m_offset); }
 
-		// Ƿȷļ
-		void printFile() { std::cout << m_str << std::endl; }
+		// 非递归解析：object/array 的嵌套由容器栈代替函数递归，事件、结果和错误信息与递归的解析相同
+		// 解析和析构结果（KsonValue 的释放不递归）在任意深度、任意多的连续注释下都不会栈溢出
+		void setIterative(bool iterative) { m_iterative = iterative; }
+
+		// 最大嵌套深度（根 object 为第 1 层），超过时报错，0 表示不限制（默认）
+		// 递归的解析在嵌套很深时会栈溢出，不可信的输入应同时使用非递归的解析；
+		// 拷贝、比较和 toKsonStr() 仍然是递归的，结果还要做这些操作时必须同时设置有限的深度
+		void setMaxDepth(size_t maxDepth) { m_maxDepth = maxDepth; }
+
+		// 测试是否正确读入了文件
+		void printFile() { std::cout << m_buf.data() << std::endl; }
 
 	private:
-		std::pair<bool, KsonObject>   parseObject(const std::string& format);
-		std::pair<bool, KsonArray>    parseArray(const std::string& format);
-		std::pair<bool, KsonStr>      parseStr(const std::string& format);
-		std::pair<bool, KsonNum>      parseNum(const std::string& format);
-		std::pair<bool, KsonBool>     parseBool(const std::string& format);
-		std::pair<bool, KsonNull>     parseNull(const std::string& format);
+		bool parseObject();
+		bool parseArray();
+		bool parseStr();
+		bool parseNum();
+		bool parseBool();
+		bool parseNull();
+
+		bool parseKey();
+		bool parseValue();
+		bool parseScalar();
+		bool parseHex();
+
+		// 非递归解析：从根 object 开始，m_stack 为未结束的容器
+		bool parseIterative();
+
+		// 嵌套深度超过 m_maxDepth 时记录错误
+		bool isTooDeep(size_t depth);
 
-		std::pair<bool, std::string>  parseKey(const std::string& format);
-		std::pair<bool, KsonValue>    parseValue(const std::string& format);
-		std::pair<bool, KsonNum>      parseHex(const std::string& format);
+		// 解析，返回前检查是否遇到了不支持的字符
+		bool parseRoot();
 
-		// Ϸַַ
-		bool isValidStrChar(char c);
+		// 检查回调的返回值，返回 false 时记录错误
+		bool handled(bool ret);
 
-		// հסעַͣǷ֧
+		// 合法的字符串字符
+		bool isValidStrChar(char c) { return isCharClass(c, KSON_CHAR_STR); }
+
+		// 跳过空白、注释，并检查后续字符是否支持（连续的空白、注释由 m_scanner 批量扫描）
 		void skipWS();
 		void skipComment();
 
-		// ӴϢ
-		void addError(std::string errInfo);
-		void addError(std::string errInfo, char appChar);
+		// 记录最先遇到的错误码、位置和嵌套深度
+		void setError(KsonErrorCode code);
+
+		// 添加错误信息：记录错误码，需要错误文本时再生成 "line N: info"
+		void addError(KsonErrorCode code, const char* info);
+		void addError(KsonErrorCode code, const char* prefix, char c, const char* suffix);
+		void addText(const std::string& info);
 
 	private:
 
 		// inlines
-		inline bool isChar(int offset, char c) { return m_str[m_idx + offset] == c; }
+		inline bool isChar(int offset, char c) { return m_buf.data()[m_idx + offset] == c; }
 		inline bool isChar(char c) { return isChar(0, c); }
-		inline bool isAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
-		inline bool isNumber(char c) { return (c >= '0' && c < '9'); }
-		inline bool isNum(int offset = 0) {
-			return (m_str[m_idx + offset] >= '0' && m_str[m_idx + offset] <= '9');
-		}
+		inline bool isClass(int offset, unsigned char cls) { return isCharClass(m_buf.data()[m_idx + offset], cls); }
+		inline bool isClass(unsigned char cls) { return isClass(0, cls); }
+		inline bool isNum(int offset = 0) { return isClass(offset, KSON_CHAR_DIGIT); }
 
-	private:
-		std::string m_str;      // jsonı
-		std::string m_error;    // Ϣ
-		int m_idx = 0;          // ǰλ
-		int m_line = 1;         // ǰкţӵһпʼ
+		// 扫描的结束位置（结尾的 '\0'），以及扫描结果对应的下标
+		inline const char* scanEnd() { return m_buf.data() + m_buf.size(); }
+		inline size_t toIdx(const char* p) { return static_cast<size_t>(p - m_buf.data()); }
 
-		const std::string VALID_CHARACTOR = " ~!@#$%^&*()_+`1234567890-=qwertyuiopQWERTYUIOP{}|[]\\asdfghjklASDFGHJKL:;'zxcvbnmZXCVBNM<>?,./\"";  // ˫󣬱ַ
-		using KSON_UNEXPECTED_CHARACTOR = int;
+	private:
+		KsonBuffer m_buf;       // kson文本，以 '\0' 结束
+		std::string m_error;    // 错误信息
+		bool m_ioFailed = false;// 文件读取失败
+		size_t m_idx = 0;       // 当前解析的位置
+		int m_line = 1;         // 当前行号（从第一行开始）
+		int m_depth = 0;        // 当前嵌套深度（KSON_TRACE 开启时使用）
+		KsonError m_err;        // 最先遇到的错误
+		bool m_errorText = true;// 生成错误文本（不抛出异常的解析时关闭）
+		bool m_aborted = false; // 遇到了不支持的字符：跳到文本结尾，之后不再添加错误文本
+		KsonHandler* m_handler = nullptr;  // 接收事件的 handler
+		std::string m_str;      // 含有转义字符的字符串的转义结果（重复使用）
+		const KsonScanner* m_scanner = nullptr;  // 空白、注释、字符串的批量扫描（parse() 开始时获取）
+		bool m_lazy = false;    // 延迟解码：handler 的 isLazy()
+		bool m_iterative = false;          // 非递归解析
+		size_t m_maxDepth = 0;             // 最大嵌套深度，0 表示不限制
+		size_t m_nesting = 0;              // 递归解析时未结束的容器个数
+		std::vector<char> m_stack;         // 非递归解析时未结束的容器，1 为 object（重复使用）
 	};
 }
 
@@ -0,0 +1,315 @@
+﻿#include "stdafx.h"
+#include "kstream.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <io.h>
+#include <climits>
+#endif
+
+using namespace kson;
+
+namespace {
+
+	// 每次读入的字节数
+	const size_t KSON_STREAM_READ_SIZE = 1024 * 1024;
+
+	int openFile(const std::string& file) {
+#ifndef _WIN32
+		return ::open(file.c_str(), O_RDONLY);
+#else
+		return ::_open(file.c_str(), _O_RDONLY | _O_BINARY);
+#endif
+	}
+
+	void closeFile(int fd) {
+#ifndef _WIN32
+		::close(fd);
+#else
+		::_close(fd);
+#endif
+	}
+
+	// 读取最多 size 个字节，返回读到的字节数，结束时为 0，出错时为 -1
+	long long readFile(int fd, char* buf, size_t size) {
+#ifndef _WIN32
+		for (;;) {
+			ssize_t n = ::read(fd, buf, size);
+			if (n < 0 && errno == EINTR) continue;
+			return n;
+		}
+#else
+		return ::_read(fd, buf, static_cast<unsigned>(std::min<size_t>(size, INT_MAX)));
+#endif
+	}
+
+	// 只有空白和注释
+	bool isBlank(const char* p, const char* end) {
+		while (p < end) {
+			if (isCharClass(*p, KSON_CHAR_WS)) {
+				++p;
+			}
+			else if (*p == '/' && p + 1 < end && p[1] == '/') {
+				const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+				p = nl ? nl + 1 : end;
+			}
+			else if (*p == '/' && p + 1 < end && p[1] == '*') {
+				const char* q = p + 2;
+				while (q + 1 < end && !(q[0] == '*' && q[1] == '/')) ++q;
+				if (q + 1 >= end) return false;
+				p = q + 2;
+			}
+			else {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+//============================================================
+//  ksonStreamReader
+//============================================================
+
+// KsonStreamReader
+KsonStreamReader::KsonStreamReader(size_t threads) : m_pool(threads) {
+	m_maxPending = m_pool.size() * 4;
+}
+
+// open: 文件
+bool KsonStreamReader::open(const std::string& file) {
+	close();
+	int fd = openFile(file);
+	if (fd < 0) {
+		m_failed = true;
+		m_error = "read file '" + file + "' failed: open (" + std::strerror(errno) + ")\n";
+		return false;
+	}
+	open(fd);
+	m_ownsFd = true;
+	m_name = "file '" + file + "'";
+	return true;
+}
+
+// open: 文件描述符
+void KsonStreamReader::open(int fd) {
+	close();
+	m_fd = fd;
+	m_eof = false;
+	m_name = "fd " + std::to_string(fd);
+}
+
+// assign: 字符串
+void KsonStreamReader::assign(std::string str) {
+	close();
+	m_buf = std::move(str);
+}
+
+// close
+void KsonStreamReader::close() {
+	m_pool.wait();
+	if (m_ownsFd) {
+		closeFile(m_fd);
+	}
+	reset();
+}
+
+// reset
+void KsonStreamReader::reset() {
+	m_name.clear();
+	m_fd = -1;
+	m_ownsFd = false;
+	m_eof = true;
+	m_failed = false;
+	m_error.clear();
+	m_buf.clear();
+	m_bufPos = 0;
+	m_scanPos = 0;
+	m_inBlock = false;
+	m_line = 1;
+	m_index = 0;
+	m_batches.clear();
+	m_current.reset();
+}
+
+// next: 先补充任务，再交付已经完成的任务，都不能进行时等待
+bool KsonStreamReader::next(KsonRecord& record) {
+	for (;;) {
+		if (m_current && m_current->m_next < m_current->m_records.size()) {
+			record = std::move(m_current->m_records[m_current->m_next++]);
+			return true;
+		}
+		m_current.reset();
+
+		while (m_batches.size() < m_maxPending && produce()) {}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_batches.empty()) return false;
+
+		auto ready = m_batches.end();
+		if (m_ordered) {
+			if (m_batches.front()->m_done) ready = m_batches.begin();
+		}
+		else {
+			ready = std::find_if(m_batches.begin(), m_batches.end(), [](const std::unique_ptr<Batch>& batch) { return batch->m_done; });
+		}
+		if (ready == m_batches.end()) {
+			m_doneCond.wait(lock);
+			continue;
+		}
+		m_current = std::move(*ready);
+		m_batches.erase(ready);
+	}
+}
+
+// readAll
+bool KsonStreamReader::readAll(const Callback& callback) {
+	KsonRecord record;
+	while (next(record)) {
+		callback(record);
+	}
+	return !m_failed;
+}
+
+// produce
+bool KsonStreamReader::produce() {
+	std::unique_ptr<Batch> batch(new Batch());
+	while (batch->m_text.size() < m_batchSize) {
+		size_t boundary;
+		if (!findBoundary(boundary)) {
+			if (!m_eof) {
+				fill();
+				continue;
+			}
+
+			// 最后一条记录可以没有换行
+			if (m_bufPos >= m_buf.size()) break;
+			boundary = m_buf.size();
+		}
+		addRecord(*batch, m_bufPos, boundary);
+		m_bufPos = std::min(boundary + 1, m_buf.size());
+		m_scanPos = m_bufPos;
+	}
+	if (batch->m_records.empty()) return false;
+
+	Batch* task = batch.get();
+	m_batches.push_back(std::move(batch));
+	m_pool.submit([this, task]() { parseBatch(*task); });
+	return true;
+}
+
+// findBoundary: 逐行查找，只有块注释中（或含有 '/'）的行需要逐字节扫描
+bool KsonStreamReader::findBoundary(size_t& boundary) {
+	const char* data = m_buf.data();
+	size_t end = m_buf.size();
+	while (m_scanPos < end) {
+		const char* nl = static_cast<const char*>(std::memchr(data + m_scanPos, '\n', end - m_scanPos));
+		if (!nl && !m_eof) return false;
+
+		size_t lineEnd = nl ? size_t(nl - data) : end;
+		if (m_inBlock || std::memchr(data + m_scanPos, '/', lineEnd - m_scanPos)) {
+			scanLine(data + m_scanPos, data + lineEnd);
+		}
+		m_scanPos = lineEnd + (nl ? 1 : 0);
+		if (nl && !m_inBlock) {
+			boundary = lineEnd;
+			return true;
+		}
+	}
+	return false;
+}
+
+// scanLine: 字符串和行注释在行尾结束，只有块注释可以跨行
+void KsonStreamReader::scanLine(const char* p, const char* end) {
+	bool inStr = false;
+	for (; p < end; ++p) {
+		if (m_inBlock) {
+			if (p[0] == '*' && p + 1 < end && p[1] == '/') {
+				m_inBlock = false;
+				++p;
+			}
+		}
+		else if (inStr) {
+			if (*p == '\\' && p + 1 < end) ++p;
+			else if (*p == '"') inStr = false;
+		}
+		else if (*p == '"') {
+			inStr = true;
+		}
+		else if (*p == '/' && p + 1 < end && p[1] == '/') {
+			return;
+		}
+		else if (*p == '/' && p + 1 < end && p[1] == '*') {
+			m_inBlock = true;
+			++p;
+		}
+	}
+}
+
+// addRecord
+void KsonStreamReader::addRecord(Batch& batch, size_t begin, size_t end) {
+	const char* p = m_buf.data() + begin;
+	size_t line = m_line;
+	m_line += 1 + std::count(p, p + (end - begin), '\n');
+	if (isBlank(p, p + (end - begin))) return;
+
+	batch.m_records.emplace_back();
+	KsonRecord& record = batch.m_records.back();
+	record.m_index = m_index++;
+	record.m_line = line;
+	batch.m_offsets.push_back(batch.m_text.size());
+	batch.m_text.append(p, end - begin);
+	batch.m_text.push_back('\0');
+}
+
+// fill: 丢弃已经切分的部分，再读入一块
+void KsonStreamReader::fill() {
+	m_buf.erase(0, m_bufPos);
+	m_scanPos -= m_bufPos;
+	m_bufPos = 0;
+
+	size_t size = m_buf.size();
+	m_buf.resize(size + KSON_STREAM_READ_SIZE);
+	long long n = readFile(m_fd, &m_buf[size], KSON_STREAM_READ_SIZE);
+	m_buf.resize(size + (n > 0 ? static_cast<size_t>(n) : 0));
+	if (n <= 0) {
+		m_eof = true;
+		if (n < 0) {
+			m_failed = true;
+			m_error = "read " + m_name + " failed: read (" + std::strerror(errno) + ")\n";
+		}
+	}
+}
+
+// parseBatch
+void KsonStreamReader::parseBatch(Batch& batch) {
+	size_t count = batch.m_records.size();
+	for (size_t k = 0; k < count; ++k) {
+		size_t begin = batch.m_offsets[k];
+		size_t end = (k + 1 < count ? batch.m_offsets[k + 1] : batch.m_text.size()) - 1;
+
+		KsonBuffer buf;
+		buf.borrow(batch.m_text.data() + begin, end - begin);
+		Kson kson(std::move(buf));
+		auto ret = kson.parse();
+
+		KsonRecord& record = batch.m_records[k];
+		record.m_ok = ret.first;
+		record.m_object = std::move(ret.second);
+		if (!ret.first) {
+			record.m_error = kson.getErrorInfo();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		batch.m_done = true;
+	}
+	m_doneCond.notify_all();
+}
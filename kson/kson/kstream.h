@@ -0,0 +1,136 @@
+﻿#ifndef __K_STREAM_H__
+#define __K_STREAM_H__
+
+#include "kson.h"
+#include "kpool.h"
+#include <memory>
+#include <deque>
+#include <functional>
+
+//============================================================
+//  ksonStreamReader: 记录流的多线程解析
+//============================================================
+
+// 每条记录是一个 kson 文档（根 object），记录之间以换行分隔：
+//
+//     { id: 1, name: "a" }
+//     { id: 2, name: "b" }   // 行注释属于这条记录
+//     { id: 3, /* 块注释可以跨行
+//        */ name: "c" }
+//
+// 调用者的线程按块读入，在不属于块注释的 '\n' 处切分（字符串和行注释中的 "/*" 不开始块注释），只有空白和注释的行被跳过；
+// 每凑够 batchSize 字节的记录提交一个任务，由线程池解析，等待解析和交付的任务数不超过 maxPending（有界，内存占用固定）
+// 出错的记录不影响其它记录：m_ok 为 false，m_error 为 Kson 的错误信息（行号从记录的第一行算起，m_line 为记录在输入中的行号）
+//
+//     KsonStreamReader reader(8);
+//     if (reader.open("access.log")) {
+//         KsonRecord record;
+//         while (reader.next(record)) use(record);
+//     }
+//     reader.readAll([](KsonRecord& record) { ... });   // 或者交给 callback（在调用者的线程中）
+
+namespace kson {
+
+	struct KsonRecord {
+		size_t       m_index = 0;     // 第几条记录（从 0 开始，不计跳过的行）
+		size_t       m_line = 0;      // 记录的第一行在输入中的行号（从 1 开始）
+		bool         m_ok = false;
+		KsonObject   m_object;        // 解析结果，失败时为已经完成的部分（与 Kson::parse() 相同）
+		std::string  m_error;         // Kson::getErrorInfo()
+	};
+
+	class KsonStreamReader {
+	public:
+		using Callback = std::function<void(KsonRecord& record)>;
+
+		// threads 为解析线程数，为 0 时使用 std::thread::hardware_concurrency()
+		explicit KsonStreamReader(size_t threads = 0);
+		KsonStreamReader(const KsonStreamReader&) = delete;
+		KsonStreamReader& operator=(const KsonStreamReader&) = delete;
+		~KsonStreamReader() { close(); }
+
+		// 输入：文件，文件描述符（不会被关闭），或字符串；打开文件失败时返回 false，getErrorInfo() 中给出原因
+		bool open(const std::string& file);
+		void open(int fd);
+		void assign(std::string str);
+
+		// 取出下一条记录，没有更多记录（或读取出错）时返回 false
+		bool next(KsonRecord& record);
+
+		// 把所有的记录交给 callback，读取出错时返回 false
+		bool readAll(const Callback& callback);
+
+		// 结束读取：等待正在解析的任务，关闭打开的文件
+		void close();
+
+		// 交付顺序：true 为输入的顺序（默认），false 为解析完成的顺序（吞吐量更高）
+		void setOrdered(bool ordered) { m_ordered = ordered; }
+
+		// 每个任务的字节数（默认 64KB），以及等待解析和交付的任务数上限（默认为线程数的 4 倍）
+		void setBatchSize(size_t size) { m_batchSize = size > 0 ? size : 1; }
+		void setMaxPending(size_t count) { m_maxPending = count > 0 ? count : 1; }
+
+		// 读取出错
+		bool isFailed() const { return m_failed; }
+
+		// 获取读取过程中的错误信息（记录的解析错误在 KsonRecord::m_error 中）
+		std::string getErrorInfo() const { return m_error; }
+
+	private:
+		// 一个任务：若干条记录的文本（每条以 '\0' 结束）和解析结果
+		struct Batch {
+			std::string              m_text;
+			std::vector<size_t>      m_offsets;    // 每条记录在 m_text 中的起始位置
+			std::vector<KsonRecord>  m_records;
+			size_t                   m_next = 0;   // 下一条交付的记录
+			bool                     m_done = false;
+		};
+
+		void reset();
+
+		// 切分出下一个任务并提交，没有更多记录时返回 false
+		bool produce();
+
+		// 从 m_scanPos 开始查找记录的结尾（不属于块注释的 '\n'），需要读入更多数据时返回 false
+		bool findBoundary(size_t& boundary);
+
+		// 扫描完整的一行，更新 m_inBlock
+		void scanLine(const char* p, const char* end);
+
+		// 把 [begin, end) 加入任务，只有空白和注释时跳过
+		void addRecord(Batch& batch, size_t begin, size_t end);
+
+		// 读入更多数据
+		void fill();
+
+		// 解析一个任务（在线程池中执行）
+		void parseBatch(Batch& batch);
+
+	private:
+		std::string                         m_name;              // 错误信息中的输入名称
+		int                                 m_fd = -1;
+		bool                                m_ownsFd = false;
+		bool                                m_eof = true;        // 输入已经读完
+		bool                                m_failed = false;
+		std::string                         m_error;
+
+		std::string                         m_buf;               // 读入还未切分的数据
+		size_t                              m_bufPos = 0;        // 当前记录的起始位置
+		size_t                              m_scanPos = 0;       // 继续查找的位置（当前记录中未扫描的行）
+		bool                                m_inBlock = false;   // 扫描到的位置在块注释中
+		size_t                              m_line = 1;          // 当前记录的起始行
+		size_t                              m_index = 0;         // 下一条记录的序号
+
+		bool                                m_ordered = true;
+		size_t                              m_batchSize = 64 * 1024;
+		size_t                              m_maxPending;
+		std::deque<std::unique_ptr<Batch>>  m_batches;           // 已提交的任务（按提交的顺序）
+		std::unique_ptr<Batch>              m_current;           // 正在交付的任务
+		std::mutex                          m_mutex;             // 保护 Batch::m_done
+		std::condition_variable             m_doneCond;
+
+		KsonThreadPool                      m_pool;              // 最后构造：任务开始时其它成员已经初始化
+	};
+}
+
+#endif
@@ -0,0 +1,337 @@
+﻿#include "stdafx.h"
+#include "ktape.h"
+#include <stdexcept>
+
+using namespace kson;
+
+//============================================================
+//  ksonTapeBuilder
+//============================================================
+
+// key
+bool KsonTapeBuilder::key(const char* str, size_t len) {
+	KsonTapeEntry& entry = add(KsonTapeType::KEY);
+	entry.m_len = static_cast<uint32_t>(len);
+	entry.m_offset = static_cast<uint64_t>(str - m_begin);
+	return true;
+}
+
+// rawString
+bool KsonTapeBuilder::rawString(const char* str, size_t len, bool isEscaped) {
+	KsonTapeEntry& entry = add(KsonTapeType::STRING);
+	entry.m_flag = isEscaped;
+	entry.m_len = static_cast<uint32_t>(len);
+	entry.m_offset = static_cast<uint64_t>(str - m_begin);
+	return true;
+}
+
+// rawNumber
+bool KsonTapeBuilder::rawNumber(const char* str, size_t len) {
+	KsonTapeEntry& entry = add(KsonTapeType::NUMBER);
+	entry.m_len = static_cast<uint32_t>(len);
+	entry.m_offset = static_cast<uint64_t>(str - m_begin);
+	return true;
+}
+
+// integer
+bool KsonTapeBuilder::integer(KsonInt value) {
+	add(KsonTapeType::INT).m_int = value;
+	return true;
+}
+
+// floating
+bool KsonTapeBuilder::floating(double value) {
+	add(KsonTapeType::DOUBLE).m_double = value;
+	return true;
+}
+
+// boolean
+bool KsonTapeBuilder::boolean(bool value) {
+	add(KsonTapeType::BOOL).m_flag = value;
+	return true;
+}
+
+// null
+bool KsonTapeBuilder::null() {
+	add(KsonTapeType::NUL);
+	return true;
+}
+
+// startContainer
+bool KsonTapeBuilder::startContainer(KsonTapeType type) {
+	m_stack.push_back(m_tape.size());
+	add(type);
+	return true;
+}
+
+// endContainer: 记录子树之后的位置和元素个数
+bool KsonTapeBuilder::endContainer() {
+	size_t start = m_stack.back();
+	m_stack.pop_back();
+
+	KsonTapeEntry& entry = m_tape[start];
+	entry.m_next = m_tape.size();
+	if (!m_stack.empty()) {
+		++m_tape[m_stack.back()].m_len;
+	}
+	return true;
+}
+
+// add: 新的一项，所在容器的元素个数在 value 之后统计（key 不计入）
+KsonTapeEntry& KsonTapeBuilder::add(KsonTapeType type) {
+	if (!m_stack.empty() && type != KsonTapeType::KEY && type != KsonTapeType::OBJECT && type != KsonTapeType::ARRAY) {
+		++m_tape[m_stack.back()].m_len;
+	}
+	m_tape.emplace_back();
+	KsonTapeEntry& entry = m_tape.back();
+	entry.m_type = type;
+	entry.m_flag = false;
+	entry.m_len = 0;
+	entry.m_offset = 0;
+	return entry;
+}
+
+//============================================================
+//  ksonLazyNode
+//============================================================
+
+// getType
+KsonType KsonLazyNode::getType() const {
+	if (!isValid()) return KsonType::NUL;
+	switch (entry().m_type) {
+	case KsonTapeType::OBJECT:  return KsonType::OBJECT;
+	case KsonTapeType::ARRAY:   return KsonType::ARRAY;
+	case KsonTapeType::STRING:  return KsonType::STRING;
+	case KsonTapeType::NUMBER:
+	case KsonTapeType::INT:
+	case KsonTapeType::DOUBLE:  return KsonType::NUMBER;
+	case KsonTapeType::BOOL:    return KsonType::BOOL;
+	default:                    return KsonType::NUL;
+	}
+}
+
+// getStr: 含有转义字符时解码
+KsonStr KsonLazyNode::getStr() const {
+	if (!isValid() || entry().m_type != KsonTapeType::STRING) return KsonStr();
+
+	const KsonTapeEntry& e = entry();
+	const char* str = m_doc->m_buf.data() + e.m_offset;
+	if (!e.m_flag) return KsonStr(str, e.m_len);
+
+	KsonStr out;
+	out.reserve(e.m_len);
+	unescapeKsonStr(str, e.m_len, out);
+	return out;
+}
+
+// isInt
+bool KsonLazyNode::isInt() const {
+	if (!isValid()) return false;
+	switch (entry().m_type) {
+	case KsonTapeType::INT:     return true;
+	case KsonTapeType::NUMBER:  return getNum().m_isInt;
+	default:                    return false;
+	}
+}
+
+// rawStr
+std::string_view KsonLazyNode::rawStr() const {
+	if (!isValid() || entry().m_type != KsonTapeType::STRING || entry().m_flag) return std::string_view();
+	return std::string_view(m_doc->m_buf.data() + entry().m_offset, entry().m_len);
+}
+
+// size
+size_t KsonLazyNode::size() const {
+	if (!isValid()) return 0;
+	switch (entry().m_type) {
+	case KsonTapeType::OBJECT:
+	case KsonTapeType::ARRAY:   return entry().m_len;
+	case KsonTapeType::STRING:  return entry().m_flag ? getStr().size() : entry().m_len;
+	default:                    return 0;
+	}
+}
+
+// key
+std::string_view KsonLazyNode::key() const {
+	if (!isValid() || !m_isMember) return std::string_view();
+	const KsonTapeEntry& e = m_doc->m_tape[m_index - 1];
+	return std::string_view(m_doc->m_buf.data() + e.m_offset, e.m_len);
+}
+
+// first
+KsonLazyNode KsonLazyNode::first() const {
+	if (!isValid() || entry().m_len == 0) return KsonLazyNode();
+
+	KsonTapeType type = entry().m_type;
+	if (type == KsonTapeType::OBJECT) return KsonLazyNode(m_doc, m_index + 2, entry().m_next, true);
+	if (type == KsonTapeType::ARRAY) return KsonLazyNode(m_doc, m_index + 1, entry().m_next, false);
+	return KsonLazyNode();
+}
+
+// next
+KsonLazyNode KsonLazyNode::next() const {
+	if (!isValid()) return KsonLazyNode();
+
+	size_t index = skip();
+	if (index >= m_parentEnd) return KsonLazyNode();
+	return KsonLazyNode(m_doc, m_isMember ? index + 1 : index, m_parentEnd, m_isMember);
+}
+
+// find: 重复的 key 取最后一个（与 KsonObject 相同）
+KsonLazyNode KsonLazyNode::find(std::string_view key) const {
+	KsonLazyNode found;
+	if (!isValid() || entry().m_type != KsonTapeType::OBJECT) return found;
+
+	for (KsonLazyNode member = first(); member.isValid(); member = member.next()) {
+		if (member.key() == key) found = member;
+	}
+	return found;
+}
+
+// at: key
+KsonLazyNode KsonLazyNode::at(std::string_view key) const {
+	KsonLazyNode member = find(key);
+	if (!member.isValid()) {
+		throw std::out_of_range("KsonLazyNode::at: key '" + std::string(key) + "' not found");
+	}
+	return member;
+}
+
+// at: index
+KsonLazyNode KsonLazyNode::at(size_t index) const {
+	if (isValid() && entry().m_type == KsonTapeType::ARRAY && index < entry().m_len) {
+		KsonLazyNode elem = first();
+		for (size_t i = 0; i < index; ++i) {
+			elem = elem.next();
+		}
+		return elem;
+	}
+	throw std::out_of_range("KsonLazyNode::at: index " + std::to_string(index) + " out of range");
+}
+
+// accept
+bool KsonLazyNode::accept(KsonHandler& handler) const {
+	if (!isValid()) return false;
+
+	const KsonTapeEntry& e = entry();
+	switch (e.m_type) {
+	case KsonTapeType::OBJECT:
+	case KsonTapeType::ARRAY: {
+		bool isObject = e.m_type == KsonTapeType::OBJECT;
+		if (!(isObject ? handler.startObject() : handler.startArray())) return false;
+		for (KsonLazyNode elem = first(); elem.isValid(); elem = elem.next()) {
+			if (isObject) {
+				std::string_view key = elem.key();
+				if (!handler.key(key.data(), key.size())) return false;
+			}
+			if (!elem.accept(handler)) return false;
+		}
+		return isObject ? handler.endObject() : handler.endArray();
+	}
+
+	case KsonTapeType::STRING: {
+		if (!e.m_flag) {
+			return handler.string(m_doc->m_buf.data() + e.m_offset, e.m_len);
+		}
+		KsonStr str = getStr();
+		return handler.string(str.data(), str.size());
+	}
+
+	case KsonTapeType::NUMBER:
+	case KsonTapeType::INT:
+	case KsonTapeType::DOUBLE: {
+		KsonNum num = getNum();
+		return num.m_isInt ? handler.integer(num.m_int) : handler.floating(num.m_double);
+	}
+
+	case KsonTapeType::BOOL:
+		return handler.boolean(e.m_flag);
+
+	default:
+		return handler.null();
+	}
+}
+
+// getNum: 数值文本在解析时已经检查过格式和范围
+KsonNum KsonLazyNode::getNum() const {
+	if (isValid()) {
+		const KsonTapeEntry& e = entry();
+		switch (e.m_type) {
+		case KsonTapeType::NUMBER:  return toKsonNum(m_doc->m_buf.data() + e.m_offset, e.m_len).second;
+		case KsonTapeType::INT:     return KsonNum(true, e.m_int, 0.0);
+		case KsonTapeType::DOUBLE:  return KsonNum(false, 0, e.m_double);
+		default:                    break;
+		}
+	}
+	return KsonNum(true, 0, 0.0);
+}
+
+// skip
+size_t KsonLazyNode::skip() const {
+	KsonTapeType type = entry().m_type;
+	return (type == KsonTapeType::OBJECT || type == KsonTapeType::ARRAY) ? static_cast<size_t>(entry().m_next) : m_index + 1;
+}
+
+//============================================================
+//  ksonLazyDocument
+//============================================================
+
+// parse
+bool KsonLazyDocument::parse(std::string ksonStr) {
+	KsonBuffer buf;
+	buf.assign(std::move(ksonStr));
+	return parse(std::move(buf));
+}
+
+// load
+bool KsonLazyDocument::load(const std::string& file) {
+	KsonBuffer buf;
+	std::string error;
+	if (!buf.load(file, error)) {
+		reset();
+		m_error = error + "\n";
+		return false;
+	}
+	return parse(std::move(buf));
+}
+
+// root
+KsonLazyNode KsonLazyDocument::root() const {
+	if (m_tape.empty()) return KsonLazyNode();
+	return KsonLazyNode(this, 0, m_tape.size(), false);
+}
+
+// toObject
+KsonObject KsonLazyDocument::toObject() const {
+	KsonDomHandler dom;
+	if (!root().accept(dom)) return KsonObject();
+	return dom.release();
+}
+
+// reset
+void KsonLazyDocument::reset() {
+	m_tape.clear();
+	m_builder.reset();
+	m_buf.clear();
+	m_error.clear();
+}
+
+// parse: 文档保存 kson 文本，解析器只引用它；失败时 tape 为空
+bool KsonLazyDocument::parse(KsonBuffer&& buf) {
+	reset();
+	m_buf = std::move(buf);
+	buf.borrow(m_buf.data(), m_buf.size());
+	m_builder.setSource(m_buf.data());
+
+	// 预估 tape 的项数（紧凑的文档平均约 6 字节一项），避免增长时反复拷贝
+	m_tape.reserve(m_buf.size() / 6 + 16);
+
+	Kson kson(std::move(buf));
+	if (!kson.parse(m_builder)) {
+		m_error = kson.getErrorInfo();
+		m_tape.clear();
+		m_builder.reset();
+		return false;
+	}
+	return true;
+}
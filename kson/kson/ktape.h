@@ -0,0 +1,196 @@
+﻿#ifndef __K_TAPE_H__
+#define __K_TAPE_H__
+
+#include "kson.h"
+#include <cstdint>
+#include <string_view>
+
+//============================================================
+//  ksonLazyDocument: 延迟解码的 kson 文档
+//============================================================
+
+// 解析时只做一遍格式检查（与 Kson::parse() 相同的检查和错误信息），把每个 key 和 value 的类型与位置记录在一条扁平的 tape 中：
+//
+//     { a: 1, b: [2, "x"] }   ->   [0] OBJECT(next=7, 2)  [1] KEY(a)  [2] NUMBER(1)  [3] KEY(b)  [4] ARRAY(next=7, 2)  [5] NUMBER(2)  [6] STRING(x)
+//
+// object/array 的 next 为子树之后的第一项（结束时的 tape 长度，这里 b 的数组是最后一个子树，两者都为 7），跳过整个子树为 O(1)；字符串的转义和数值的转换在读取时才进行
+// 文档保存 kson 文本，节点在下一次解析或 reset() 之前有效
+//
+//     KsonLazyDocument doc;
+//     if (doc.load("config.kson")) use(doc.root().at("server").at("port").getInt());
+//     KsonObject obj = doc.toObject();   // 需要时转换为 KsonObject
+
+namespace kson {
+
+	enum class KsonTapeType : unsigned char {
+		OBJECT,
+		ARRAY,
+		KEY,
+		STRING,
+		NUMBER,     // 数值文本，读取时转换
+		INT,        // 已经转换的整数（十六进制等）
+		DOUBLE,     // 已经转换的浮点数
+		BOOL,
+		NUL
+	};
+
+	// tape 中的一项，16 字节
+	struct KsonTapeEntry {
+		KsonTapeType  m_type;
+		bool          m_flag;       // STRING: 含有转义字符；BOOL: 值
+		uint32_t      m_len;        // KEY/STRING/NUMBER: 文本长度；OBJECT/ARRAY: 成员（元素）个数
+		union {
+			uint64_t  m_offset;     // KEY/STRING/NUMBER: 在 kson 文本中的位置
+			uint64_t  m_next;       // OBJECT/ARRAY: 子树之后的位置
+			KsonInt   m_int;        // INT
+			double    m_double;     // DOUBLE
+		};
+	};
+
+	class KsonLazyDocument;
+
+	// 文档中的一个值（或 object 的一个成员），只保存 tape 中的位置，可以按值传递
+	// 读取接口与 KsonNode 相同；object 的成员按 kson 文本中的顺序遍历，重复的 key 由 find() 返回最后一个
+	class KsonLazyNode {
+	public:
+		KsonLazyNode() = default;
+
+		bool         isValid()   const { return m_doc != nullptr; }
+
+		// 获取 KsonType，无效时为 NUL
+		KsonType     getType()   const;
+
+		// 获取值（类型不符时返回空值），字符串和数值在这里解码
+		KsonStr      getStr()    const;
+		KsonInt      getInt()    const { return getNum().getInt(); }
+		KsonDouble   getDouble() const { return getNum().getDouble(); }
+		KsonBool     getBool()   const { return isValid() && entry().m_type == KsonTapeType::BOOL && entry().m_flag; }
+		KsonNull     getNull()   const { return nullptr; }
+		bool         isInt()     const;
+
+		// 不含转义字符的字符串直接指向 kson 文本；含有转义字符或类型不符时为空字符串，需要使用 getStr()
+		std::string_view rawStr() const;
+
+		// 字符串长度（解码后），或 object/array 的元素个数
+		size_t       size()      const;
+
+		// object 的成员：所在 object 中的 key；其它情况为空字符串
+		std::string_view key()   const;
+
+		// 遍历：第一个元素（或成员），下一个元素（或成员），没有时返回无效的 node
+		KsonLazyNode first()     const;
+		KsonLazyNode next()      const;
+
+		// object: 按 key 查找（跳过每个成员的子树），不存在或类型不符时返回无效的 node
+		KsonLazyNode find(std::string_view key) const;
+
+		// 按 key / index 访问，不存在或类型不符时抛出 std::out_of_range
+		KsonLazyNode at(std::string_view key) const;
+		KsonLazyNode at(size_t index) const;
+
+		// 按遍历顺序向 handler 发送事件，例如用 KsonDomHandler 转换为 KsonObject
+		bool accept(KsonHandler& handler) const;
+
+	private:
+		friend class KsonLazyDocument;
+
+		KsonLazyNode(const KsonLazyDocument* doc, size_t index, size_t parentEnd, bool isMember)
+			: m_doc(doc), m_index(index), m_parentEnd(parentEnd), m_isMember(isMember) {}
+
+		const KsonTapeEntry& entry() const;
+		KsonNum getNum() const;
+
+		// 子树之后的位置
+		size_t skip() const;
+
+	private:
+		const KsonLazyDocument*  m_doc = nullptr;
+		size_t                   m_index = 0;        // value 在 tape 中的位置
+		size_t                   m_parentEnd = 0;    // 所在容器的子树结束位置
+		bool                     m_isMember = false; // 是 object 的成员（m_index - 1 为 key）
+	};
+
+	// 由事件构建 tape（Kson 以延迟解码的方式调用）
+	class KsonTapeBuilder : public KsonHandler {
+	public:
+		explicit KsonTapeBuilder(std::vector<KsonTapeEntry>& tape) : m_tape(tape) {}
+
+		bool isLazy() const override { return true; }
+
+		bool startObject() override { return startContainer(KsonTapeType::OBJECT); }
+		bool key(const char* str, size_t len) override;
+		bool endObject() override { return endContainer(); }
+		bool startArray() override { return startContainer(KsonTapeType::ARRAY); }
+		bool endArray() override { return endContainer(); }
+		bool rawString(const char* str, size_t len, bool isEscaped) override;
+		bool rawNumber(const char* str, size_t len) override;
+		bool integer(KsonInt value) override;
+		bool floating(double value) override;
+		bool boolean(bool value) override;
+		bool null() override;
+
+		// 只支持延迟解码：字符串必须位于 kson 文本中
+		bool string(const char* str, size_t len) override { return false; }
+
+		// kson 文本的起始位置，偏移量由它计算
+		void setSource(const char* begin) { m_begin = begin; }
+
+		// 清空状态，保留临时栈的内存
+		void reset() { m_stack.clear(); }
+
+	private:
+		bool startContainer(KsonTapeType type);
+		bool endContainer();
+		KsonTapeEntry& add(KsonTapeType type);
+
+	private:
+		std::vector<KsonTapeEntry>&  m_tape;
+		std::vector<size_t>          m_stack;    // 未结束的 object/array 在 tape 中的位置
+		const char*                  m_begin = nullptr;
+	};
+
+	class KsonLazyDocument {
+	public:
+		KsonLazyDocument() : m_builder(m_tape) {}
+		KsonLazyDocument(const KsonLazyDocument&) = delete;
+		KsonLazyDocument& operator=(const KsonLazyDocument&) = delete;
+
+		// 解析 kson 字符串，文档保存 ksonStr
+		bool parse(std::string ksonStr);
+
+		// 解析 kson 文件，文档保存读入（或 mmap）的文件内容
+		bool load(const std::string& file);
+
+		// 根 object，解析失败时为无效的 node
+		KsonLazyNode root() const;
+
+		// 转换为 KsonObject（解码所有的值），解析失败时为空 object
+		KsonObject toObject() const;
+
+		// 清空文档，保留 tape 的内存
+		void reset();
+
+		// 获取解析过程中的错误信息
+		std::string getErrorInfo() const { return m_error; }
+
+		// tape 的项数
+		size_t tapeSize() const { return m_tape.size(); }
+
+	private:
+		friend class KsonLazyNode;
+
+		bool parse(KsonBuffer&& buf);
+
+	private:
+		KsonBuffer                  m_buf;       // kson 文本
+		std::vector<KsonTapeEntry>  m_tape;
+		KsonTapeBuilder             m_builder;
+		std::string                 m_error;
+	};
+
+	inline const KsonTapeEntry& KsonLazyNode::entry() const {
+		return m_doc->m_tape[m_index];
+	}
+}
+
+#endif
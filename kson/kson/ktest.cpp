@@ -1,23 +1,133 @@
 #include "stdafx.h"
 #include "ktest.h"
+#include "kalloc.h"
+#include "kpush.h"
+#include "kdoc.h"
+#include "ksimd.h"
+#include "kwriter.h"
+#include "kindex.h"
+#include "kparallel.h"
+#include "kstream.h"
+#include "kcorpus.h"
+#include "kbind.h"
+#include "kpath.h"
 #include <fstream>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
 
 using namespace kson;
 
+namespace {
+
+	// 把收到的事件记录成字符串，遇到名为 stopKey 的 key 时停止解析（或者在第 m_stopAt 个事件时停止，0 表示不停止）
+	class KsonTraceHandler : public KsonHandler {
+	public:
+		explicit KsonTraceHandler(const std::string& stopKey = "") : m_stopKey(stopKey) {}
+
+		bool startObject() override { return add("{ "); }
+		bool endObject() override { return add("} "); }
+		bool startArray() override { return add("[ "); }
+		bool endArray() override { return add("] "); }
+		bool key(const char* str, size_t len) override {
+			return add(std::string(str, len) + ": ") && m_stopKey != std::string(str, len);
+		}
+		bool string(const char* str, size_t len) override { return add("\"" + std::string(str, len) + "\" "); }
+		bool integer(KsonInt value) override { return add("i" + std::to_string(value) + " "); }
+		bool floating(double value) override { return add("d" + std::to_string(value) + " "); }
+		bool boolean(bool value) override { return add(value ? "true " : "false "); }
+		bool null() override { return add("null "); }
+
+		std::string m_trace;
+		std::string m_stopKey;
+		size_t m_stopAt = 0;
+		size_t m_events = 0;
+
+	private:
+		bool add(const std::string& event) {
+			m_trace += event;
+			return ++m_events != m_stopAt;
+		}
+	};
+
+	// testBind 使用的结构体
+	struct BindLimit {
+		int qps = 0;
+		std::optional<int> burst;
+	};
+
+	struct BindServer {
+		std::string host;
+		uint16_t port = 0;
+		bool enable = false;
+		double weight = 0;
+		std::vector<std::string> tags;
+		std::optional<BindLimit> limit;
+	};
+
+	struct BindConfig {
+		std::string name;
+		int64_t version = 0;
+		std::vector<BindServer> servers;
+		std::map<std::string, int> ports;
+		std::unordered_map<std::string, std::vector<int>> groups;
+		std::vector<std::vector<double>> matrix;
+		std::optional<std::string> comment;
+		std::string unset = "keep";
+	};
+
+	KSON_BIND(BindLimit, KSON_FIELD(qps), KSON_FIELD(burst))
+	KSON_BIND(BindServer, KSON_FIELD(host), KSON_FIELD(port), KSON_FIELD(enable), KSON_FIELD(weight), KSON_FIELD(tags), KSON_FIELD(limit))
+	KSON_BIND(BindConfig, KSON_FIELD(name), KSON_FIELD_AS(version, "ver"), KSON_FIELD(servers), KSON_FIELD(ports),
+		KSON_FIELD(groups), KSON_FIELD(matrix), KSON_FIELD(comment), KSON_FIELD(unset))
+}
+
 //============================================================
-//  ksonTest: KsonĲ
+//  ksonTest: Kson解析器的测试类
 //============================================================
 
 // runAllTest
 void KsonTest::runAllTest(KsonTestType type) {
 
-	// ֻʾԽ
+	// 只显示测试结果
 	if (type == KsonTestType::ONLY_RESULT) {
 		try {
 			testAll1();
 			testAll2();
 			testSpace();
 			testComment();
+			testAccessor();
+			testCharClass();
+			testAllocation();
+			testLoad();
+			testPush();
+			testSax();
+			testDocument();
+			testInSitu();
+			testFlatMap();
+			testInternKeys();
+			testNumber();
+			testSimd();
+			testWriter();
+			testBinary();
+			testLazy();
+			testIndex();
+			testParallel();
+			testStream();
+			testIterative();
+			testError();
+			testCorpus();
+			testBind();
+			testPath();
+			testBuilder();
 		}
 		catch (int) {
 			print("[ FAIL! ]\n");
@@ -25,18 +135,18 @@ void KsonTest::runAllTest(KsonTestType type) {
 		print("\n");
 	}
 
-	// ʾӲļ
+	// 显示从测试文件解析出的内容
 	else {
 		std::vector<std::string> files = {
 
-			// : ͵
+			// 测试: 所有数据类型的组合
 			"test_case/test_all1.kson",
 			"test_case/test_all2.kson",
 			
-			// : ո / ע / ַ֧
+			// 测试: 空格 / 注释 / 不支持字符
 			"test_case/test_space.kson",
 			"test_case/test_comment.kson",
-			//"test_case/test_unsurpport.kson",   // Ҫͨвԣ֪ôַ֧дļ
+			//"test_case/test_unsurpport.kson",   // 需要单独通过程序进行测试，不知道怎么将不支持字符写入文件。。。
 		};
 
 		for (auto file : files) {
@@ -102,21 +212,21 @@ void KsonTest::printValue(const KsonValue& val, const std::string& format, bool
 	case KsonType::OBJECT:
 		if (fromObject) print("{\n");
 		else print(format + "{\n");
-		printObject(val.m_object, F);
+		printObject(val.objectRef(), F);
 		print(format + "}");
 		break;
 
 	case KsonType::ARRAY:
 		if (fromObject) print("[\n");
 		else print(format + "[\n");
-		printArray(val.m_array, F);
+		printArray(val.arrayRef(), F);
 		print(format + "]");
 		break;
 
 	case KsonType::STRING: {
 		std::string str;
 		if (!fromObject) str += format;
-		print(str + "\"" + val.m_str + "\"");
+		print(str + "\"" + val.strRef() + "\"");
 		break;
 	}
 
@@ -132,7 +242,7 @@ void KsonTest::printValue(const KsonValue& val, const std::string& format, bool
 	case KsonType::BOOL: {
 		std::string str;
 		if (!fromObject) str += format;
-		print(str + (val.m_bool ? "true" : "false"));
+		print(str + (val.getBool() ? "true" : "false"));
 		break;
 	}
 
@@ -164,42 +274,42 @@ void KsonTest::testAll1() {
 	auto obj = testTwoKson(ksonStr, ksonFile);
 	
 	expectEQ(obj["a"].m_type, KsonType::NUMBER, "");
-	expectEQ(obj["b"].m_str, std::string("abcd"), "");
+	expectEQ(obj["b"].getStr(), std::string("abcd"), "");
 	expectEQ(obj["c"].m_type, KsonType::OBJECT, "");
 
-	auto obj1 = std::move(obj["c"].m_object);
+	auto obj1 = obj["c"].getObject();
 	expectEQ(obj1.size(), size_t(4), "");
-	expectEQ(obj1["d"].m_num.m_int, 1, "");
-	expectEQ(obj1["e"].m_str, std::string("abcd"), "");
+	expectEQ(obj1["d"].m_num.m_int, KsonInt(1), "");
+	expectEQ(obj1["e"].getStr(), std::string("abcd"), "");
 	expectEQ(obj1["f"].m_type, KsonType::OBJECT, "");
 	
-	auto obj2 = std::move(obj1["f"].m_object);
+	auto obj2 = obj1["f"].getObject();
 	expectEQ(obj2.size(), size_t(1), "");
-	expectEQ(obj2["g"].m_num.m_int, 1, "");
+	expectEQ(obj2["g"].m_num.m_int, KsonInt(1), "");
 
 	expectEQ(obj1["h"].m_type, KsonType::ARRAY, "");
 
-	auto arr1 = std::move(obj1["h"].m_array);
+	auto arr1 = obj1["h"].getArray();
 	expectEQ(arr1.size(), size_t(5), "");
-	expectEQ(arr1[0].m_num.m_int, 1, "");
-	expectEQ(arr1[1].m_str, std::string("abcd"), "");
-	expectEQ(arr1[2].m_bool, true, "");
+	expectEQ(arr1[0].m_num.m_int, KsonInt(1), "");
+	expectEQ(arr1[1].getStr(), std::string("abcd"), "");
+	expectEQ(arr1[2].getBool(), true, "");
 	expectEQ(arr1[3].m_type, KsonType::OBJECT, "");
-	expectEQ(arr1[3].m_object.size(), size_t(0), "");
+	expectEQ(arr1[3].getObject().size(), size_t(0), "");
 	expectEQ(arr1[4].m_type, KsonType::ARRAY, "");
-	expectEQ(arr1[4].m_array.size(), size_t(0), "");
+	expectEQ(arr1[4].getArray().size(), size_t(0), "");
 
 	expectEQ(obj["i"].m_type, KsonType::ARRAY, "");
 
-	auto arr2 = std::move(obj["i"].m_array);
+	auto arr2 = obj["i"].getArray();
 	expectEQ(arr2.size(), size_t(1), "");
 
-	auto obj3 = std::move(arr2[0].m_object);
+	auto obj3 = arr2[0].getObject();
 	expectEQ(obj3.size(), size_t(3), "");
-	expectEQ(obj3["j"].m_num.m_int, 1, "");
-	expectEQ(obj3["k"].m_str, std::string("abcd"), "");
+	expectEQ(obj3["j"].m_num.m_int, KsonInt(1), "");
+	expectEQ(obj3["k"].getStr(), std::string("abcd"), "");
 	expectEQ(obj3["l"].m_type, KsonType::OBJECT, "");
-	expectEQ(obj3["l"].m_object.size(), size_t(0), "");
+	expectEQ(obj3["l"].getObject().size(), size_t(0), "");
 
 	print("[ SUCCESS! ]\n");
 }
@@ -212,51 +322,51 @@ void KsonTest::testAll2() {
 	std::string ksonFile = "test_case/test_all2.kson";
 	auto obj = testTwoKson(ksonStr, ksonFile);
 
-	expectEQ(obj["a_b"].m_num.m_int, 0xff, "");
-	expectEQ(obj["cde123"].m_num.m_int, -12, "");
+	expectEQ(obj["a_b"].m_num.m_int, KsonInt(0xff), "");
+	expectEQ(obj["cde123"].m_num.m_int, KsonInt(-12), "");
 	expectEQ(obj["_"].m_type, KsonType::ARRAY, "");
 
-	auto arr1 = std::move(obj["_"].m_array);
+	auto arr1 = obj["_"].getArray();
 	expectEQ(arr1.size(), size_t(1), "");
 	expectEQ(arr1[0].m_type, KsonType::OBJECT, "");
 
-	auto obj1 = std::move(arr1[0].m_object);
-	expectEQ(obj1["_a_b_"].m_str, std::string("\\ \\ \\ \\ \" \' \n \t \\\\\\\\"), "");
+	auto obj1 = arr1[0].getObject();
+	expectEQ(obj1["_a_b_"].getStr(), std::string("\\ \\ \\ \\ \" \' \n \t \\\\\\\\"), "");
 	expectEQ(obj1["Abd_3dg"].m_type, KsonType::ARRAY, "");
 	
-	auto arr2 = std::move(obj1["Abd_3dg"].m_array);
+	auto arr2 = obj1["Abd_3dg"].getArray();
 	expectEQ(arr2.size(), size_t(10), "");
-	expectEQ(arr2[0].m_null, (void*)(nullptr), "");
-	expectEQ(arr2[1].m_null, (void*)(nullptr), "");
-	expectEQ(arr2[2].m_bool, true, "");
-	expectEQ(arr2[3].m_bool, true, "");
-	expectEQ(arr2[4].m_bool, false, "");
-	expectEQ(arr2[5].m_bool, false, "");
+	expectEQ(arr2[0].getNull(), (void*)(nullptr), "");
+	expectEQ(arr2[1].getNull(), (void*)(nullptr), "");
+	expectEQ(arr2[2].getBool(), true, "");
+	expectEQ(arr2[3].getBool(), true, "");
+	expectEQ(arr2[4].getBool(), false, "");
+	expectEQ(arr2[5].getBool(), false, "");
 	expectEQ(arr2[6].m_num.m_double < -12.0, true, "");
-	expectEQ(arr2[7].m_num.m_int, 0xaabb, "");
+	expectEQ(arr2[7].m_num.m_int, KsonInt(0xaabb), "");
 	expectEQ(arr2[8].m_num.m_double > 1.2e11, true, "");
 	expectEQ(arr2[9].m_type, KsonType::ARRAY, "");
 
 	expectEQ(obj["q12"].m_type, KsonType::ARRAY, "");
 
-	auto arr3 = std::move(obj["q12"].m_array);
+	auto arr3 = obj["q12"].getArray();
 	expectEQ(arr3.size(), size_t(6), "");
 
 	expectEQ(arr3[0].m_type, KsonType::OBJECT, "");
-	expectEQ(arr3[0].m_object.size(), size_t(0), "");
+	expectEQ(arr3[0].getObject().size(), size_t(0), "");
 	expectEQ(arr3[1].m_type, KsonType::OBJECT, "");
-	expectEQ(arr3[1].m_object.size(), size_t(0), "");
+	expectEQ(arr3[1].getObject().size(), size_t(0), "");
 	expectEQ(arr3[2].m_type, KsonType::ARRAY, "");
-	expectEQ(arr3[2].m_object.size(), size_t(0), "");
+	expectEQ(arr3[2].getArray().size(), size_t(0), "");
 	expectEQ(arr3[3].m_type, KsonType::OBJECT, "");
-	expectEQ(arr3[3].m_object.size(), size_t(0), "");
+	expectEQ(arr3[3].getObject().size(), size_t(0), "");
 	expectEQ(arr3[4].m_type, KsonType::ARRAY, "");
-	expectEQ(arr3[4].m_object.size(), size_t(0), "");
+	expectEQ(arr3[4].getArray().size(), size_t(0), "");
 	expectEQ(arr3[5].m_type, KsonType::ARRAY, "");
-	expectEQ(arr3[5].m_object.size(), size_t(0), "");
+	expectEQ(arr3[5].getArray().size(), size_t(0), "");
 
 	expectEQ(obj["zx12_1_1_1_"].m_type, KsonType::ARRAY, "");
-	expectEQ(obj["zx12_1_1_1_"].m_array.size(), size_t(0), "");
+	expectEQ(obj["zx12_1_1_1_"].getArray().size(), size_t(0), "");
 
 	print("[ SUCCESS! ]\n");
 }
@@ -269,36 +379,36 @@ void KsonTest::testSpace() {
 	std::string ksonFile = "test_case/test_space.kson";
 
 	auto obj = testTwoKson(ksonStr, ksonFile);
-	expectEQ(obj.at("a").m_num.m_int, 1, "");
+	expectEQ(obj.at("a").m_num.m_int, KsonInt(1), "");
 	double db = obj.at("b").m_num.m_double;
 	expectEQ(db > 1.0 && db < 1.11, true, "");
 
-	KsonArray arr = obj["c"].m_array;
+	KsonArray arr = obj["c"].getArray();
 	expectEQ(arr.size(), size_t(5), "");
 	expectEQ(arr[0].m_type, KsonType::OBJECT, "");
 	
 	expectEQ(arr[1].m_type, KsonType::NUMBER, "");
-	expectEQ(arr[1].m_num.m_int, 3, "");
+	expectEQ(arr[1].m_num.m_int, KsonInt(3), "");
 
 	expectEQ(arr[2].m_type, KsonType::STRING, "");
-	expectEQ(arr[2].m_str, std::string("abcd"), "");
+	expectEQ(arr[2].getStr(), std::string("abcd"), "");
 
 	expectEQ(arr[3].m_type, KsonType::BOOL, "");
-	expectEQ(arr[3].m_bool, true, "");
+	expectEQ(arr[3].getBool(), true, "");
 
 	expectEQ(arr[4].m_type, KsonType::NUL, "");
-	expectEQ(arr[4].m_null, (void*)nullptr, "");
+	expectEQ(arr[4].getNull(), (void*)nullptr, "");
 
-	KsonObject obj1 = arr[0].m_object;
+	KsonObject obj1 = arr[0].getObject();
 	expectEQ(obj1.size(), size_t(3), "");
-	expectEQ(obj1["d"].m_num.m_int, 1, "");
-	expectEQ(obj1["e"].m_num.m_int, 1, "");
-	expectEQ(obj1["f"].m_array.size(), size_t(3), "");
-
-	KsonArray arr1 = obj1["f"].m_array;
-	expectEQ(arr1[0].m_num.m_int, 1, "");
-	expectEQ(arr1[1].m_num.m_int, 2, "");
-	expectEQ(arr1[2].m_bool, true, "");
+	expectEQ(obj1["d"].m_num.m_int, KsonInt(1), "");
+	expectEQ(obj1["e"].m_num.m_int, KsonInt(1), "");
+	expectEQ(obj1["f"].getArray().size(), size_t(3), "");
+
+	KsonArray arr1 = obj1["f"].getArray();
+	expectEQ(arr1[0].m_num.m_int, KsonInt(1), "");
+	expectEQ(arr1[1].m_num.m_int, KsonInt(2), "");
+	expectEQ(arr1[2].getBool(), true, "");
 	
 	print("[ SUCCESS! ]\n");
 }
@@ -311,16 +421,504 @@ void KsonTest::testComment() {
 	std::string ksonFile = "test_case/test_comment.kson";
 	auto obj = testTwoKson(ksonStr, ksonFile);
 	
-	expectEQ(obj["a"].m_num.m_int, 1, "");
-	expectEQ(obj["b"].m_str, std::string("abcd"), "");
+	expectEQ(obj["a"].m_num.m_int, KsonInt(1), "");
+	expectEQ(obj["b"].getStr(), std::string("abcd"), "");
 	expectEQ(obj["c"].m_type, KsonType::OBJECT, "");
-	expectEQ(obj["c"].m_object.size(), size_t(0), "");
+	expectEQ(obj["c"].getObject().size(), size_t(0), "");
 	expectEQ(obj["d"].m_type, KsonType::ARRAY, "");
-	expectEQ(obj["d"].m_array.size(), size_t(0), "");
+	expectEQ(obj["d"].getArray().size(), size_t(0), "");
 	
 	print("[ SUCCESS! ]\n");
 }
 
+// testAccessor: test_case/test_all1.kson
+void KsonTest::testAccessor() {
+	print("\n==== test: accessor ====\n");
+
+	Kson kson("test_case/test_all1.kson");
+	auto ret = kson.parse();
+	expectEQ(ret.first, true, "");
+
+	KsonValue root;
+	root.setObject(std::move(ret.second));
+
+	// 链式查找
+	expectEQ(root.at("a").getInt(), KsonInt(1), "");
+	expectEQ(root.at("c").at("f").at("g").getInt(), KsonInt(1), "");
+	expectEQ(root.at("c").at("h").at(1).strRef(), std::string("abcd"), "");
+	expectEQ(root.at("c").at("h").at(2).getBool(), true, "");
+	expectEQ(root.at("i").at(0).at("k").strRef(), std::string("abcd"), "");
+	expectEQ(root.at("c").at("h").arrayRef().size(), size_t(5), "");
+
+	// 引用指向树中的同一个节点，没有拷贝
+	expectEQ(&root.at("c").objectRef() == &root.find("c")->objectRef(), true, "");
+	expectEQ(&root.at("c").at("h").at(0) == &root.at("c").at("h").arrayRef()[0], true, "");
+
+	// find: 不存在或类型不符时返回 nullptr
+	expectEQ(root.find("x") == nullptr, true, "");
+	expectEQ(root.at("a").find("x") == nullptr, true, "");
+	expectEQ(root.at("c").find("d") != nullptr, true, "");
+
+	// at: 不存在或类型不符时抛出 std::out_of_range
+	auto throws = [](const std::function<void()>& func) -> bool {
+		try {
+			func();
+		}
+		catch (std::out_of_range&) {
+			return true;
+		}
+		return false;
+	};
+	expectEQ(throws([&]() { root.at("x"); }), true, "");
+	expectEQ(throws([&]() { root.at("c").at("h").at(5); }), true, "");
+	expectEQ(throws([&]() { root.at("a").at(0); }), true, "");
+
+	// 类型不符时返回空值的引用
+	expectEQ(root.at("a").strRef().empty(), true, "");
+	expectEQ(root.at("b").objectRef().empty(), true, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testCharClass
+void KsonTest::testCharClass() {
+	print("\n==== test: char class ====\n");
+
+	// key 中可以包含数字 9，十六进制数支持 a~f A~F
+	Kson kson1("{a9:1, _99_z:0x9aF, s:\" ~!@#$%^&*()_+`1234567890-={}|[]\\\\:;'<>?,./\"}", false);
+	auto ret1 = kson1.parse();
+	expectEQ(ret1.first, true, "");
+	expectEQ(ret1.second["a9"].getInt(), KsonInt(1), "");
+	expectEQ(ret1.second["_99_z"].getInt(), KsonInt(0x9af), "");
+	expectEQ(ret1.second["s"].getStr(), std::string(" ~!@#$%^&*()_+`1234567890-={}|[]\\:;'<>?,./"), "");
+
+	// 0x 后面的 g 不是十六进制字符
+	Kson kson2("{a:0xfg}", false);
+	expectEQ(kson2.parse().first, false, "");
+
+	// 0x 后面必须有十六进制字符
+	Kson kson3("{a:0xg}", false);
+	expectEQ(kson3.parse().first, false, "");
+
+	// key 不能以数字开头
+	Kson kson4("{9a:1}", false);
+	expectEQ(kson4.parse().first, false, "");
+
+	// 不支持的字符
+	Kson kson5("{a:1,\x01 b:2}", false);
+	expectEQ(kson5.parse().first, false, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testAllocation: test_case/test_all2.kson
+void KsonTest::testAllocation() {
+	print("\n==== test: allocation ====\n");
+
+	std::ifstream file("test_case/test_all2.kson");
+	std::string ksonStr((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	// 在外面包裹 depth 层 {x: ...}，每层只多出一个 object 节点
+	auto wrap = [&](int depth) -> std::string {
+		std::string str;
+		for (int i = 0; i < depth; ++i) str += "{x:";
+		str += ksonStr;
+		for (int i = 0; i < depth; ++i) str += "}";
+		return str;
+	};
+
+	// 每多一层的分配次数应当是固定的，与文档内部节点所在的深度无关
+	size_t count0 = countParseAlloc(wrap(0));
+	size_t count1 = countParseAlloc(wrap(1));
+	size_t count8 = countParseAlloc(wrap(8));
+	expectEQ(count8 - count0, (count1 - count0) * 8, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// countParseAlloc: 解析过程中的内存分配次数（不含读入文本）
+size_t KsonTest::countParseAlloc(const std::string& ksonStr) {
+	Kson kson(ksonStr, false);
+	KsonAlloc::reset();
+	auto ret = kson.parse();
+	size_t count = KsonAlloc::stat().m_count;
+	expectEQ(ret.first, true, "");
+	return count;
+}
+
+// testLoad
+void KsonTest::testLoad() {
+	print("\n==== test: load ====\n");
+
+	// 文件不存在
+	Kson kson1("test_case/not_exist.kson");
+	expectEQ(kson1.parse().first, false, "");
+	expectEQ(kson1.getErrorInfo().find("test_case/not_exist.kson") != std::string::npos, true, "");
+
+	// 文件大小恰好为 64KB（页大小的整数倍），文本后面需要补 '\0'
+	std::string pageFile = "test_case/tmp_page.kson";
+	std::string pageStr = "{a:1,";
+	pageStr += std::string(65536 - pageStr.size() - 4, ' ');
+	pageStr += "b:2}";
+	std::ofstream(pageFile, std::ios::binary) << pageStr;
+
+	Kson kson2(pageFile);
+	auto ret2 = kson2.parse();
+	std::remove(pageFile.c_str());
+	expectEQ(ret2.first, true, "");
+	expectEQ(ret2.second["b"].getInt(), KsonInt(2), "");
+
+	// CRLF 换行
+	std::string crlfFile = "test_case/tmp_crlf.kson";
+	std::ofstream(crlfFile, std::ios::binary) << "{\r\n    a : 1, // comment\r\n    b : [true]\r\n}\r\n";
+
+	Kson kson3(crlfFile);
+	auto ret3 = kson3.parse();
+	std::remove(crlfFile.c_str());
+	expectEQ(ret3.first, true, "");
+	expectEQ(ret3.second["b"].arrayRef().size(), size_t(1), "");
+
+	// KsonBuffer 移动后内容不变
+	std::string error;
+	KsonBuffer buf1;
+	expectEQ(buf1.load("test_case/test_all1.kson", error), true, "");
+#ifndef _WIN32
+	expectEQ(buf1.isMapped(), true, "");
+#endif
+	size_t size = buf1.size();
+	std::string text(buf1.data(), size);
+
+	KsonBuffer buf2(std::move(buf1));
+	expectEQ(buf1.size(), size_t(0), "");
+	expectEQ(buf2.size(), size, "");
+	expectEQ(std::string(buf2.data(), buf2.size()), text, "");
+	expectEQ(buf2.data()[buf2.size()], '\0', "");
+
+	KsonBuffer buf3;
+	buf3.assign("{}");
+	buf2 = std::move(buf3);
+	expectEQ(std::string(buf2.data()), std::string("{}"), "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testPush
+void KsonTest::testPush() {
+	print("\n==== test: push ====\n");
+
+	std::vector<std::string> files = {
+		"test_case/test_all1.kson",
+		"test_case/test_all2.kson",
+		"test_case/test_space.kson",
+		"test_case/test_comment.kson",
+		"test_case/test_unsurpport.kson",
+	};
+	for (const auto& file : files) {
+		std::ifstream in(file, std::ios::binary);
+		std::string ksonStr((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		expectPush(ksonStr);
+	}
+
+	// 数值：正负号后的空白和注释、小数部分与 'e' 之间的空白、十六进制
+	expectPush("{a: - /* c */ 12, b: +0x1F, c: -0xff, d: 1.25 // c\n e2, e: 3e2, f: 007, g: 0}");
+	expectPush("{a: 1 e2}");
+	expectPush("{a: 1.}");
+	expectPush("{a: 1e}");
+	expectPush("{a: 0X1}");
+	expectPush("{a: 0x}");
+
+	// 字符串中的转义字符，不支持的转义保留 '\'
+	expectPush("{a: \"x\\ny\\t\\\\\\'\\\"\", b: \"\\a\\\"\"}");
+	expectPush("{a: \"abc}");
+
+	// true/false/null，末尾的 ','，重复的 key
+	expectPush("{a: [true, TRUE, false, FALSE, null, NULL,], b: {c: 1,}, b: 2,}");
+	expectPush("{a: tRUE}");
+	expectPush("{a: nul}");
+	expectPush("{,}");
+	expectPush("{a: [,]}");
+	expectPush("{a 1}");
+
+	// 根 object 之后的内容
+	expectPush("{} abc");
+	expectPush("{} /");
+	expectPush("{} /* abc");
+	expectPush(std::string("{}\x01"));
+	expectPush(std::string("{a: 1}\0{", 9));
+	expectPush("");
+	expectPush("[]");
+	expectPush("{a: 1} // comment\n \x01");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// expectPush
+void KsonTest::expectPush(const std::string& ksonStr) {
+	Kson kson(ksonStr, false);
+	auto expect = kson.parse();
+
+	auto check = [&](const std::pair<bool, KsonObject>& ret) {
+		expectEQ(ret.first, expect.first, "");
+		if (expect.first) {
+			expectEQ(ret.second, expect.second, "");
+		}
+	};
+
+	// 在每个位置切成两块
+	KsonPushParser parser;
+	for (size_t i = 0; i <= ksonStr.size(); ++i) {
+		parser.reset();
+		parser.feed(ksonStr.data(), i);
+		parser.feed(ksonStr.data() + i, ksonStr.size() - i);
+		check(parser.finish());
+	}
+
+	// 逐字节输入
+	parser.reset();
+	for (char c : ksonStr) {
+		parser.feed(&c, 1);
+	}
+	check(parser.finish());
+}
+
+// testSax
+void KsonTest::testSax() {
+	print("\n==== test: sax ====\n");
+
+	std::string ksonStr = "{ a: 1, b: [\"x\\n\", -1.5, true, FALSE, NULL, [],], /* c */ c: { d: 0x10 }, }";
+	std::string expect = "{ a: i1 b: [ \"x\n\" d-1.500000 true false null [ ] ] c: { d: i16 } } ";
+
+	KsonTraceHandler handler1;
+	Kson kson1(ksonStr, false);
+	expectEQ(kson1.parse(handler1), true, "");
+	expectEQ(handler1.m_trace, expect, "");
+
+	KsonTraceHandler handler2;
+	KsonPushParser parser(handler2);
+	parser.feed(ksonStr);
+	expectEQ(parser.finish().first, true, "");
+	expectEQ(handler2.m_trace, expect, "");
+
+	// 回调返回 false 时停止解析
+	KsonTraceHandler handler3("b");
+	Kson kson3(ksonStr, false);
+	expectEQ(kson3.parse(handler3), false, "");
+	expectEQ(handler3.m_trace, std::string("{ a: i1 b: "), "");
+	expectEQ(kson3.getErrorInfo().find("stopped by handler") != std::string::npos, true, "");
+
+	KsonTraceHandler handler4("b");
+	KsonPushParser parser4(handler4);
+	expectEQ(parser4.feed(ksonStr), false, "");
+	expectEQ(parser4.finish().first, false, "");
+	expectEQ(handler4.m_trace, std::string("{ a: i1 b: "), "");
+
+	// 默认的 handler 忽略所有事件，只检查语法
+	KsonHandler handler5;
+	expectEQ(Kson(ksonStr, false).parse(handler5), true, "");
+	expectEQ(Kson("{ a: }", false).parse(handler5), false, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testDocument
+void KsonTest::testDocument() {
+	print("\n==== test: document ====\n");
+
+	// 与 Kson::parse() 的结果相同
+	std::vector<std::string> files = {
+		"test_case/test_all1.kson",
+		"test_case/test_all2.kson",
+		"test_case/test_space.kson",
+		"test_case/test_comment.kson",
+		"test_case/test_unsurpport.kson",
+	};
+	KsonDocument doc;
+	for (const auto& file : files) {
+		auto expect = Kson(file).parse();
+		expectEQ(doc.load(file), expect.first, "");
+
+		KsonDomHandler dom;
+		expectEQ(doc.root().accept(dom), true, "");
+		expectEQ(dom.release(), expect.first ? expect.second : KsonObject(), "");
+	}
+
+	// 读取接口
+	expectEQ(doc.load("test_case/test_all2.kson"), true, "");
+	const KsonNode& root = doc.root();
+	expectEQ(root.getType(), KsonType::OBJECT, "");
+	expectEQ(root.at("a_b").getInt(), KsonInt(0xff), "");
+	expectEQ(root.at("cde123").getInt(), KsonInt(-12), "");
+	expectEQ(root.find("not_exist") == nullptr, true, "");
+	expectEQ(root.at("a_b").find("a_b") == nullptr, true, "");
+
+	const KsonNode& arr = root.at("_").at(0).at("Abd_3dg");
+	expectEQ(arr.size(), size_t(10), "");
+	expectEQ(arr.at(0).getType(), KsonType::NUL, "");
+	expectEQ(arr.at(2).getBool(), true, "");
+	expectEQ(arr.at(6).isInt(), false, "");
+	expectEQ(arr.at(6).getDouble(), -12.1234, "");
+	expectEQ(arr.at(7).getInt(), KsonInt(0xaabb), "");
+	expectEQ(root.at("_").at(0).at("_a_b_").getStr(), std::string("\\ \\ \\ \\ \" \' \n \t \\\\\\\\"), "");
+
+	bool thrown = false;
+	try { arr.at(10); }
+	catch (const std::out_of_range&) { thrown = true; }
+	expectEQ(thrown, true, "");
+
+	// 成员按 key 排序，重复的 key 保留最后一个
+	expectEQ(doc.parse("{ b: 1, a: 2, c: 3, a: 4, }"), true, "");
+	expectEQ(doc.root().size(), size_t(3), "");
+	expectEQ(std::string(doc.root().member(0).key()), std::string("a"), "");
+	expectEQ(doc.root().member(0).m_value.getInt(), KsonInt(4), "");
+	expectEQ(std::string(doc.root().member(2).key()), std::string("c"), "");
+
+	// 解析失败时根 object 为空
+	expectEQ(doc.parse("{ a: 1, b: }"), false, "");
+	expectEQ(doc.root().size(), size_t(0), "");
+	expectEQ(doc.getErrorInfo().empty(), false, "");
+
+	// 重复使用同一个文档解析时没有堆分配，reset() 保留内存池
+	std::string ksonStr = "{ items: [";
+	for (int i = 0; i < 2000; ++i) {
+		ksonStr += "{ id: " + std::to_string(i) + ", name: \"item_" + std::to_string(i) + "\", tags: [1, 2.5, true, null] },";
+	}
+	ksonStr += "] }";
+
+	KsonDocument doc2;
+	expectEQ(doc2.parse(ksonStr), true, "");
+	size_t capacity = doc2.arena().capacity();
+
+	KsonAlloc::reset();
+	expectEQ(doc2.parse(ksonStr), true, "");
+	expectEQ(KsonAlloc::stat().m_count, size_t(0), "");
+	expectEQ(doc2.arena().capacity(), capacity, "");
+	expectEQ(doc2.root().at("items").at(1999).at("id").getInt(), KsonInt(1999), "");
+
+	doc2.reset();
+	expectEQ(doc2.arena().used(), size_t(0), "");
+	expectEQ(doc2.arena().capacity(), capacity, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testInSitu
+void KsonTest::testInSitu() {
+	print("\n==== test: in-situ ====\n");
+
+	// 与拷贝模式的结果相同
+	std::vector<std::string> files = {
+		"test_case/test_all1.kson",
+		"test_case/test_all2.kson",
+		"test_case/test_space.kson",
+		"test_case/test_comment.kson",
+	};
+	for (const auto& file : files) {
+		KsonDocument doc1, doc2;
+		expectEQ(doc1.load(file, false), true, "");
+		expectEQ(doc2.load(file, true), true, "");
+
+		KsonDomHandler dom1, dom2;
+		doc1.root().accept(dom1);
+		doc2.root().accept(dom2);
+		expectEQ(dom1.release(), dom2.release(), "");
+	}
+
+	// key 和不含转义字符的字符串指向 kson 文本，含转义字符的字符串解码到内存池
+	std::string ksonStr = "{ plain_key: \"plain string value\", escaped: \"tab\\there \\\"quoted\\\"\", odd: \"a\\b\" }";
+	const char* begin = ksonStr.data();
+	const char* end = begin + ksonStr.size();
+	auto inText = [&](std::string_view str) { return str.data() >= begin && str.data() + str.size() <= end; };
+
+	KsonDocument doc;
+	expectEQ(doc.parseInSitu(std::move(ksonStr)), true, "");
+	const KsonNode& root = doc.root();
+	expectEQ(root.at("plain_key").strView() == "plain string value", true, "");
+	expectEQ(inText(root.at("plain_key").strView()), true, "");
+	expectEQ(inText(root.member(2).key()), true, "");
+
+	expectEQ(root.at("escaped").getStr(), std::string("tab\there \"quoted\""), "");
+	expectEQ(inText(root.at("escaped").strView()), false, "");
+
+	// 不支持的转义字符保留 '\'，不需要解码
+	expectEQ(root.at("odd").getStr(), std::string("a\\b"), "");
+	expectEQ(inText(root.at("odd").strView()), true, "");
+
+	// 内存池中只有节点和含转义字符的字符串
+	std::string strs = "{ items: [";
+	for (int i = 0; i < 1000; ++i) {
+		strs += "{ name: \"The quick brown fox jumps over the lazy dog " + std::to_string(i) + "\" },";
+	}
+	strs += "] }";
+	KsonDocument doc1, doc2;
+	expectEQ(doc1.parse(strs), true, "");
+	expectEQ(doc2.parseInSitu(strs), true, "");
+	expectEQ(doc1.arena().used() - doc2.arena().used() > 1000 * 40, true, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testFlatMap
+void KsonTest::testFlatMap() {
+	print("\n==== test: flat map ====\n");
+
+	// 成员个数跨过顺序查找和二分查找的分界
+	for (int count : { 3, 8, 9, 30, 100 }) {
+		std::map<std::string, int> expect;
+		KsonObject obj;
+		KsonObject::container_type items;
+		for (int i = 0; i < count; ++i) {
+			std::string key = "k" + std::to_string((i * 37) % count);
+			expect[key] = i;
+			obj[key].setNum(KsonNum(true, i, 0.0));
+			items.emplace_back(key, KsonValue());
+			items.back().second.setNum(KsonNum(true, i, 0.0));
+		}
+
+		// 按 key 排序后构建
+		KsonObject built(std::move(items));
+		expectEQ(obj, built, "");
+		expectEQ(obj.size(), expect.size(), "");
+
+		auto iter = obj.begin();
+		for (const auto& p : expect) {
+			expectEQ(iter->first, p.first, "");
+			expectEQ(iter->second.getInt(), KsonInt(p.second), "");
+			expectEQ(obj.find(p.first) == iter, true, "");
+			expectEQ(obj.at(p.first).getInt(), KsonInt(p.second), "");
+			++iter;
+		}
+		expectEQ(obj.find("k") == obj.end(), true, "");
+		expectEQ(obj.count("k" + std::to_string(count)), size_t(0), "");
+	}
+
+	// 重复的 key 保留最后一个，emplace 不覆盖已有的成员
+	KsonObject::container_type items;
+	for (int i = 0; i < 4; ++i) {
+		items.emplace_back(i % 2 ? "b" : "a", KsonValue());
+		items.back().second.setNum(KsonNum(true, i, 0.0));
+	}
+	KsonObject obj(std::move(items));
+	expectEQ(obj.size(), size_t(2), "");
+	expectEQ(obj.at("a").getInt(), KsonInt(2), "");
+	expectEQ(obj.at("b").getInt(), KsonInt(3), "");
+
+	expectEQ(obj.emplace(std::string("a"), KsonValue()).second, false, "");
+	expectEQ(obj.at("a").getInt(), KsonInt(2), "");
+
+	// 删除
+	expectEQ(obj.erase("a"), size_t(1), "");
+	expectEQ(obj.erase("a"), size_t(0), "");
+	expectEQ(obj.size(), size_t(1), "");
+	expectEQ(obj.begin()->first, std::string("b"), "");
+
+	bool thrown = false;
+	try { obj.at("a"); }
+	catch (const std::out_of_range&) { thrown = true; }
+	expectEQ(thrown, true, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
 KsonObject KsonTest::testTwoKson(const std::string& ksonStr, const std::string& ksonFile) {
 	Kson kson1(ksonStr, false);
 	Kson kson2(ksonFile, true);
@@ -331,3 +929,1648 @@ KsonObject KsonTest::testTwoKson(const std::string& ksonStr, const std::string&
 	expectEQ(ret1.second, ret2.second, "");
 	return std::move(ret2.second);
 }
+
+// testInternKeys
+void KsonTest::testInternKeys() {
+	print("\n==== test: intern keys ====\n");
+
+	std::string ksonStr = "{ items: [";
+	for (int i = 0; i < 100; ++i) {
+		ksonStr += "{ id: " + std::to_string(i) + ", name: \"n" + std::to_string(i) + "\", id: " + std::to_string(i * 2) + " },";
+	}
+	ksonStr += "], id: -1 }";
+
+	// 不同 object 中相同的 key 指向同一个地址
+	for (bool inSitu : { false, true }) {
+		KsonDocument doc;
+		expectEQ(inSitu ? doc.parseInSitu(ksonStr) : doc.parse(ksonStr), true, "");
+		const KsonNode& items = doc.root().at("items");
+		expectEQ(items.size(), size_t(100), "");
+
+		const char* id = doc.root().member(0).m_key;
+		for (size_t i = 0; i < items.size(); ++i) {
+			const KsonNode& item = items.at(i);
+			expectEQ(item.size(), size_t(2), "");
+			expectEQ(item.member(0).m_key == id, true, "");
+			expectEQ(item.member(1).m_key == items.at(0).member(1).m_key, true, "");
+		}
+
+		// KsonKey 查找，重复的 key 保留最后一个
+		KsonKey idKey = doc.key("id");
+		expectEQ(idKey.m_id == id, true, "");
+		expectEQ(items.at(7).at(idKey).getInt(), KsonInt(14), "");
+		expectEQ(doc.root().at(idKey).getInt(), KsonInt(-1), "");
+		expectEQ(items.at(7).find(doc.key("items")) == nullptr, true, "");
+
+		// 文档中没有的 key
+		KsonKey missing = doc.key("missing");
+		expectEQ(missing.m_id == nullptr, true, "");
+		expectEQ(items.at(7).find(missing) == nullptr, true, "");
+	}
+
+	// 关闭符号表时内容相同，KsonKey 退化为字符串查找
+	KsonDocument doc1, doc2;
+	doc2.setInternKeys(false);
+	expectEQ(doc1.parse(ksonStr), true, "");
+	expectEQ(doc2.parse(ksonStr), true, "");
+	KsonDomHandler dom1, dom2;
+	doc1.root().accept(dom1);
+	doc2.root().accept(dom2);
+	expectEQ(dom1.release(), dom2.release(), "");
+	expectEQ(doc2.key("id").m_id == nullptr, true, "");
+	expectEQ(doc2.root().at("items").at(3).at(doc2.key("id")).getInt(), KsonInt(6), "");
+	expectEQ(doc1.arena().used() < doc2.arena().used(), true, "");
+
+	// 失败和 reset() 之后符号表被清空
+	expectEQ(doc1.parse("{ id: 1, "), false, "");
+	expectEQ(doc1.key("id").m_id == nullptr, true, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testNumber
+void KsonTest::testNumber() {
+	print("\n==== test: number ====\n");
+
+	// 解析 { v: numStr }，增量解析的结果相同
+	auto parseNum = [&](const std::string& numStr, bool expect = true) {
+		std::string ksonStr = "{ v: " + numStr + " }";
+		expectPush(ksonStr);
+		Kson kson(ksonStr, false);
+		auto ret = kson.parse();
+		expectEQ(ret.first, expect, "");
+		return ret.second.count("v") ? ret.second.at("v").m_num : KsonNum(true, 0, 0.0);
+	};
+	auto expectInt = [&](const std::string& numStr, KsonInt value) {
+		KsonNum num = parseNum(numStr);
+		expectEQ(num.m_isInt, true, "");
+		expectEQ(num.m_int, value, "");
+	};
+	auto expectDouble = [&](const std::string& numStr, double value) {
+		KsonNum num = parseNum(numStr);
+		expectEQ(num.m_isInt, false, "");
+		expectEQ(num.m_double, value, "");
+	};
+
+	// int64 边界，超出时为 double
+	expectInt("9223372036854775807", INT64_MAX);
+	expectInt("-9223372036854775808", INT64_MIN);
+	expectInt("+00000000000000000000000123", KsonInt(123));
+	expectDouble("9223372036854775808", 9223372036854775808.0);
+	expectDouble("-9223372036854775809", -9223372036854775808.0);
+	expectDouble("123456789012345678901234567890", 1.2345678901234568e29);
+
+	// 整数的指数
+	expectInt("12e3", KsonInt(12000));
+	expectInt("1E+18", KsonInt(1000000000000000000LL));
+	expectInt("0e999999999999999999", KsonInt(0));
+	expectDouble("1e19", 1e19);
+
+	// 十六进制：最多 64 位，忽略正负号
+	expectInt("0xffffffff", KsonInt(4294967295LL));
+	expectInt("0xffffffffffffffff", KsonInt(-1));
+	expectInt("0x00000000000000000000ff", KsonInt(255));
+	expectInt("-0x10", KsonInt(16));
+	parseNum("0x10000000000000000", false);
+
+	// 负指数、较长的小数部分
+	expectDouble("2.2e-3", 0.0022);
+	expectDouble("5e-1", 0.5);
+	expectDouble("1.5E+2", 150.0);
+	expectDouble("0.1", 0.1);
+	expectDouble("3.14159265358979323846264338327950288", 3.14159265358979323846264338327950288);
+	expectDouble("0.000000000000000000000000000001234", 1.234e-30);
+	expectDouble("17976931348623157e292", 1.7976931348623157e308);
+	expectDouble("4.9406564584124654e-324", 4.9406564584124654e-324);
+	expectDouble("1e-400", 0.0);
+	expectDouble("-0.0", -0.0);
+
+	// 超出 double 范围、指数格式错误
+	parseNum("1e400", false);
+	parseNum("-1.8e308", false);
+	parseNum("1e+", false);
+	parseNum("1e-x", false);
+	parseNum("1.5e", false);
+
+	// 整数与浮点数的互相转换
+	expectEQ(KsonNum(false, 0, 2.9).getInt(), KsonInt(2), "");
+	expectEQ(KsonNum(false, 0, -2.9).getInt(), KsonInt(-2), "");
+	expectEQ(KsonNum(false, 0, 1e300).getInt(), KsonInt(0), "");
+	expectEQ(KsonNum(true, -7, 0.0).getDouble(), -7.0, "");
+
+	std::mt19937_64 rand(20240601);
+	char buf[64];
+
+	// 随机 double（随机的位）按 %.17g 输出后解析，结果完全相同
+	for (int i = 0; i < 100000; ++i) {
+		uint64_t bits = rand();
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		if (!std::isfinite(value)) continue;
+
+		std::snprintf(buf, sizeof(buf), "%.17g", value);
+		Kson kson(std::string("{ v: ") + buf + " }", false);
+		auto ret = kson.parse();
+		expectEQ(ret.first, true, "");
+		expectEQ(ret.second.at("v").getDouble(), value, "");
+	}
+
+	// 随机的十进制数字串（有效数字 1~25 位，指数 -340~320）与 strtod 的结果相同
+	for (int i = 0; i < 100000; ++i) {
+		std::string digits;
+		int count = 1 + rand() % 25;
+		for (int j = 0; j < count; ++j) {
+			digits += static_cast<char>('0' + rand() % 10);
+		}
+		int dot = 1 + rand() % count;
+		std::string numStr = digits.substr(0, dot);
+		if (dot < count) numStr += "." + digits.substr(dot);
+		numStr += "e" + std::to_string(static_cast<int>(rand() % 661) - 340);
+
+		double expect = std::strtod(numStr.c_str(), nullptr);
+		Kson kson("{ v: " + numStr + " }", false);
+		auto ret = kson.parse();
+		expectEQ(ret.first, std::isfinite(expect) != 0, "");
+		if (ret.first) {
+			expectEQ(ret.second.at("v").getDouble(), expect, "");
+		}
+	}
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testSimd
+void KsonTest::testSimd() {
+	print("\n==== test: simd ====\n");
+
+	const KsonScanner& scalar = *getKsonScanner(KsonSimd::SCALAR);
+	std::vector<KsonSimd> simds = { KsonSimd::SSE2, KsonSimd::AVX2 };
+
+	// 随机的缓冲区：字符集中在各个函数关心的字符上，在每个起始位置和结束位置比较
+	std::mt19937 rand(20240615);
+	const char alphabet[] = { ' ', ' ', ' ', '\n', '\t', '\r', '*', '/', '"', '\\', 'a', '\0', '\x7f', '\x80', '\x1f', '~' };
+	for (int round = 0; round < 200; ++round) {
+		std::string buf(1 + rand() % 100, ' ');
+		for (char& c : buf) {
+			c = (rand() % 4 == 0) ? alphabet[rand() % sizeof(alphabet)] : ' ';
+		}
+		buf += '\0';
+
+		for (KsonSimd simd : simds) {
+			const KsonScanner* scanner = getKsonScanner(simd);
+			if (!scanner) continue;
+
+			const char* data = buf.data();
+			for (size_t begin = 0; begin < buf.size(); ++begin) {
+				for (size_t end = begin; end < buf.size(); ++end) {
+					int lines1 = 0, lines2 = 0;
+					expectEQ(scanner->skipSpace(data + begin, data + end, lines1) == scalar.skipSpace(data + begin, data + end, lines2), true, "");
+					expectEQ(lines1, lines2, "");
+					expectEQ(scanner->findLineEnd(data + begin, data + end) == scalar.findLineEnd(data + begin, data + end), true, "");
+					expectEQ(scanner->findBlockEnd(data + begin, data + end) == scalar.findBlockEnd(data + begin, data + end), true, "");
+					expectEQ(scanner->findStrSpecial(data + begin, data + end) == scalar.findStrSpecial(data + begin, data + end), true, "");
+				}
+			}
+		}
+	}
+
+	// 解析结果、错误信息（包括行号）相同
+	std::vector<std::string> ksonStrs;
+	for (const char* file : { "test_case/test_all1.kson", "test_case/test_all2.kson", "test_case/test_space.kson", "test_case/test_comment.kson" }) {
+		std::ifstream in(file, std::ios::binary);
+		ksonStrs.push_back(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+	}
+	std::string longStr(100, ' ');
+	ksonStrs.push_back("{" + longStr + "\n\n" + longStr + "a: \"" + std::string(70, 'x') + "\\t\\q" + std::string(40, 'y') + "\", /*" + longStr + "*/ b: 1 //" + longStr + "\n}");
+	ksonStrs.push_back("{\n" + longStr + "\n" + longStr + "a: \"" + std::string(50, 'x') + "\x01\" }");
+	ksonStrs.push_back("{ a: 1, /* " + longStr + " * / " + longStr);
+	ksonStrs.push_back("{ a: \"" + longStr);
+
+	KsonSimd saved = getKsonSimd();
+	for (const auto& ksonStr : ksonStrs) {
+		expectEQ(setKsonSimd(KsonSimd::SCALAR), true, "");
+		Kson kson1(ksonStr, false);
+		auto expect = kson1.parse();
+
+		for (KsonSimd simd : simds) {
+			if (!setKsonSimd(simd)) continue;
+			Kson kson2(ksonStr, false);
+			auto ret = kson2.parse();
+			expectEQ(ret.first, expect.first, "");
+			expectEQ(ret.second, expect.second, "");
+			expectEQ(kson2.getErrorInfo(), kson1.getErrorInfo(), "");
+		}
+	}
+	setKsonSimd(saved);
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testWriter
+void KsonTest::testWriter() {
+	print("\n==== test: writer ====\n");
+
+	// 测试文件：输出后重新解析，内容与原来相同；再次输出的文本与第一次相同
+	std::vector<std::string> files = {
+		"test_case/test_all1.kson",
+		"test_case/test_all2.kson",
+		"test_case/test_space.kson",
+		"test_case/test_comment.kson",
+	};
+	for (const auto& file : files) {
+		Kson kson(file);
+		auto obj = kson.parse();
+		expectEQ(obj.first, true, "");
+
+		for (bool pretty : { false, true }) {
+			KsonWriter writer(pretty);
+			expectEQ(writer.write(obj.second), true, "");
+			Kson kson2(writer.str(), false);
+			auto obj2 = kson2.parse();
+			expectEQ(obj2.first, true, "");
+			expectEQ(obj2.second, obj.second, "");
+			expectEQ(toKsonStr(obj2.second, pretty), writer.str(), "");
+		}
+
+		// 文档的事件输出与 KsonObject 的输出相同
+		KsonDocument doc;
+		std::ifstream in(file, std::ios::binary);
+		std::string ksonStr((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		expectEQ(doc.parse(ksonStr), true, "");
+		KsonWriter docWriter;
+		expectEQ(doc.root().accept(docWriter), true, "");
+		expectEQ(docWriter.str(), toKsonStr(obj.second), "");
+	}
+
+	// 格式
+	std::string ksonStr = "{ b: [1, 2.5, true, null, { }, []], a: { s: \"x\" } }";
+	auto obj = Kson(ksonStr, false).parse();
+	expectEQ(obj.first, true, "");
+	expectEQ(toKsonStr(obj.second), std::string("{a:{s:\"x\"},b:[1,2.5,true,null,{},[]]}"), "");
+	expectEQ(toKsonStr(obj.second, true), std::string(
+		"{\n"
+		"    a: {\n"
+		"        s: \"x\"\n"
+		"    },\n"
+		"    b: [\n"
+		"        1,\n"
+		"        2.5,\n"
+		"        true,\n"
+		"        null,\n"
+		"        {},\n"
+		"        []\n"
+		"    ]\n"
+		"}\n"), "");
+	expectEQ(toKsonStr(KsonObject()), std::string("{}"), "");
+
+	// 转义
+	KsonWriter escWriter;
+	escWriter.startObject();
+	escWriter.key("s", 1);
+	std::string raw = "a\"b\\c\nd\te'f";
+	expectEQ(escWriter.string(raw.data(), raw.size()), true, "");
+	escWriter.endObject();
+	expectEQ(escWriter.str(), std::string("{s:\"a\\\"b\\\\c\\nd\\te'f\"}"), "");
+	auto escObj = Kson(escWriter.str(), false).parse();
+	expectEQ(escObj.first, true, "");
+	expectEQ(escObj.second.at("s").strRef(), raw, "");
+
+	// kson 不能表示的内容
+	auto expectFail = [&](const std::function<bool(KsonWriter&)>& write) {
+		KsonWriter writer;
+		writer.startObject();
+		expectEQ(write(writer), false, "");
+		expectEQ(writer.getErrorInfo().empty(), false, "");
+	};
+	expectFail([](KsonWriter& w) { return w.key("1a", 2); });
+	expectFail([](KsonWriter& w) { return w.key("a-b", 3); });
+	expectFail([](KsonWriter& w) { return w.key("", 0); });
+	expectFail([](KsonWriter& w) { w.key("a", 1); return w.string("a\rb", 3); });
+	expectFail([](KsonWriter& w) { w.key("a", 1); return w.string("\x80", 1); });
+	expectFail([](KsonWriter& w) { w.key("a", 1); return w.floating(std::nan("")); });
+	expectFail([](KsonWriter& w) { w.key("a", 1); return w.floating(HUGE_VAL); });
+	expectEQ(toKsonStr(Kson("{ a: \"x\" }", false).parse().second).empty(), false, "");
+
+	// double 的往返：位模式相同，整数值的 double 仍然是 double
+	std::mt19937_64 rng(14);
+	std::vector<double> values = { 0.0, -0.0, 1.0, -1.0, 0.1, 1e21, 1e-7, 5e-324, 1.7976931348623157e308, 2.2250738585072014e-308, 9007199254740993.0, 123456789012345678.0 };
+	for (int i = 0; i < 20000; ++i) {
+		uint64_t bits = rng();
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		if (std::isfinite(value)) values.push_back(value);
+		values.push_back(std::ldexp(static_cast<double>(rng() >> 11), static_cast<int>(rng() % 128) - 64));
+	}
+	for (double value : values) {
+		KsonWriter writer;
+		writer.startObject();
+		writer.key("d", 1);
+		expectEQ(writer.floating(value), true, "");
+		writer.key("i", 1);
+		writer.integer(static_cast<KsonInt>(rng()));
+		writer.endObject();
+
+		auto parsed = Kson(writer.str(), false).parse();
+		expectEQ(parsed.first, true, "");
+		const KsonValue& d = parsed.second.at("d");
+		expectEQ(d.isInt(), false, "");
+		double back = d.getDouble();
+		expectEQ(std::memcmp(&back, &value, sizeof(value)), 0, "");
+		expectEQ(parsed.second.at("i").isInt(), true, "");
+	}
+	expectEQ(toKsonStr(Kson("{ a: -9223372036854775808, b: 9223372036854775807 }", false).parse().second),
+		std::string("{a:-9223372036854775808,b:9223372036854775807}"), "");
+
+	// sink：分块写出的内容与 str() 相同
+	std::string big = "{ items: [";
+	for (int i = 0; i < 20000; ++i) {
+		big += "{ id: " + std::to_string(i) + ", name: \"item " + std::to_string(i) + "\", v: " + std::to_string(i * 0.25) + " },";
+	}
+	big += "] }";
+	auto bigObj = Kson(big, false).parse();
+	expectEQ(bigObj.first, true, "");
+	for (bool pretty : { false, true }) {
+		std::string out;
+		size_t chunks = 0;
+		KsonWriter writer([&](const char* data, size_t size) { out.append(data, size); ++chunks; }, pretty);
+		expectEQ(writer.write(bigObj.second), true, "");
+		writer.flush();
+		expectEQ(out, toKsonStr(bigObj.second, pretty), "");
+		expectEQ(chunks > 1, true, "");
+		expectEQ(writer.str().empty(), true, "");
+	}
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testBinary
+void KsonTest::testBinary() {
+	print("\n==== test: binary ====\n");
+
+	std::vector<std::string> files = {
+		"test_case/test_all1.kson",
+		"test_case/test_all2.kson",
+		"test_case/test_space.kson",
+		"test_case/test_comment.kson",
+	};
+	std::vector<KsonObject> objs;
+	for (const auto& file : files) {
+		auto obj = Kson(file).parse();
+		expectEQ(obj.first, true, "");
+		objs.push_back(obj.second);
+	}
+
+	// 各种类型、整数宽度、空容器、嵌套
+	std::string ksonStr = "{ i8: -128, i16: 300, i32: -70000, i64: 0x7fffffffffffffff, imin: -9223372036854775808, "
+		"d: -0.0, e: 1.5e300, s: \"a\\\"b\\nc\", empty: \"\", b1: true, b0: false, n: null, "
+		"o: { }, a: [], deep: [[[{ x: [1, { y: \"z\" }] }]]] }";
+	auto mixed = Kson(ksonStr, false).parse();
+	expectEQ(mixed.first, true, "");
+	objs.push_back(mixed.second);
+
+	// 长字符串和大数组（varint 超过 1 字节）
+	KsonObject big = Kson("{ s: \"" + std::string(20000, 'x') + "\" }", false).parse().second;
+	std::string arr = "{ a: [";
+	for (int i = 0; i < 5000; ++i) arr += std::to_string(static_cast<KsonInt>(i) * 1000003) + ",";
+	arr += "] }";
+	objs.push_back(big);
+	objs.push_back(Kson(arr, false).parse().second);
+
+	for (const auto& obj : objs) {
+		std::string bin = encodeKsonBin(obj);
+		auto decoded = decodeKsonBin(bin.data(), bin.size());
+		expectEQ(decoded.first, true, "");
+		expectEQ(decoded.second, obj, "");
+
+		// 直接读取
+		KsonBinDocument doc;
+		expectEQ(doc.open(bin.data(), bin.size()), true, "");
+		KsonValue root;
+		root.setObject(KsonObject(obj));
+		expectBinView(root, doc.root());
+
+		// 事件输出与 KsonObject 相同
+		KsonWriter writer;
+		expectEQ(doc.root().accept(writer), true, "");
+		expectEQ(writer.str(), toKsonStr(obj), "");
+	}
+
+	// 整数选择最短的宽度
+	std::string bin = encodeKsonBin(mixed.second);
+	KsonBinDocument doc;
+	expectEQ(doc.open(std::string(bin)), true, "");
+	KsonBinView root = doc.root();
+	expectEQ(root.at("i8").getInt(), KsonInt(-128), "");
+	expectEQ(root.at("i64").getInt(), KsonInt(INT64_MAX), "");
+	expectEQ(root.at("imin").getInt(), KsonInt(INT64_MIN), "");
+	expectEQ(encodeKsonBin(Kson("{ a: 1 }", false).parse().second).size(), size_t(4 + 1 + 1 + 1 + 1 + 1 + 2), "");
+	expectEQ(encodeKsonBin(Kson("{ a: 300 }", false).parse().second).size(), size_t(4 + 1 + 1 + 1 + 1 + 1 + 3), "");
+	expectEQ(std::signbit(root.at("d").getDouble()), true, "");
+	expectEQ(root.at("d").isInt(), false, "");
+	expectEQ(root.at("deep").at(0).at(0).at(0).at("x").at(1).at("y").strView() == "z", true, "");
+	expectEQ(root.find("missing").isValid(), false, "");
+	expectEQ(root.at("s").find("x").isValid(), false, "");
+	bool thrown = false;
+	try { root.at("a").at(0); }
+	catch (const std::out_of_range&) { thrown = true; }
+	expectEQ(thrown, true, "");
+
+	// 文件
+	std::string binFile = "test_case/tmp_bin.ksb";
+	{
+		std::ofstream out(binFile, std::ios::binary);
+		out.write(bin.data(), bin.size());
+	}
+	KsonBinDocument fileDoc;
+	expectEQ(fileDoc.load(binFile), true, "");
+	expectEQ(fileDoc.decode().second, mixed.second, "");
+	std::remove(binFile.c_str());
+	expectEQ(fileDoc.load("test_case/not_exist.ksb"), false, "");
+	expectEQ(fileDoc.root().isValid(), false, "");
+
+	// 不是二进制编码、版本不符
+	expectEQ(doc.open("{ a: 1 }", 8), false, "");
+	expectEQ(doc.getErrorInfo().empty(), false, "");
+	std::string badVersion = bin;
+	badVersion[3] = 2;
+	expectEQ(doc.open(badVersion.data(), badVersion.size()), false, "");
+
+	// 截断：每个长度都打开或解码失败，不越界
+	for (size_t len = 0; len < bin.size(); ++len) {
+		std::string cut = bin.substr(0, len);
+		expectEQ(decodeKsonBin(cut.data(), cut.size()).first, false, "");
+	}
+
+	// 随机修改字节：解码和直接读取都不越界（结果可能成功也可能失败）
+	std::mt19937 rng(15);
+	for (int i = 0; i < 20000; ++i) {
+		std::string bad = bin;
+		for (int j = 0; j < 3; ++j) {
+			bad[KSON_BIN_HEADER_SIZE + rng() % (bad.size() - KSON_BIN_HEADER_SIZE)] = static_cast<char>(rng());
+		}
+		std::unique_ptr<char[]> exact(new char[bad.size()]);
+		std::memcpy(exact.get(), bad.data(), bad.size());
+		decodeKsonBin(exact.get(), bad.size());
+		KsonBinDocument badDoc;
+		if (badDoc.open(exact.get(), bad.size())) {
+			for (KsonBinView member = badDoc.root().first(); member.isValid(); member = member.next()) {
+				member.getInt();
+				member.getDouble();
+				member.strView();
+				member.size();
+				member.find("x");
+			}
+		}
+	}
+
+	print("[ SUCCESS! ]\n");
+}
+
+// expectBinView: 直接读取的内容与 KsonValue 相同
+void KsonTest::expectBinView(const KsonValue& val, const KsonBinView& view) {
+	expectEQ(view.isValid(), true, "");
+	expectEQ(view.getType() == val.getType(), true, "");
+	switch (val.getType()) {
+	case KsonType::OBJECT: {
+		const KsonObject& obj = val.objectRef();
+		expectEQ(view.size(), obj.size(), "");
+		KsonBinView member = view.first();
+		for (const auto& item : obj) {
+			expectEQ(std::string(member.key()), item.first, "");
+			expectBinView(item.second, member);
+			expectBinView(item.second, view.at(item.first));
+			member = member.next();
+		}
+		expectEQ(member.isValid(), false, "");
+		break;
+	}
+	case KsonType::ARRAY: {
+		const KsonArray& arr = val.arrayRef();
+		expectEQ(view.size(), arr.size(), "");
+		KsonBinView elem = view.first();
+		for (size_t i = 0; i < arr.size(); ++i) {
+			expectEQ(elem.key().empty(), true, "");
+			expectBinView(arr[i], elem);
+			elem = elem.next();
+		}
+		expectEQ(elem.isValid(), false, "");
+		if (!arr.empty()) expectBinView(arr.back(), view.at(arr.size() - 1));
+		break;
+	}
+	case KsonType::STRING:
+		expectEQ(view.getStr(), val.strRef(), "");
+		break;
+	case KsonType::NUMBER:
+		expectEQ(view.isInt(), val.isInt(), "");
+		expectEQ(view.getInt(), val.getInt(), "");
+		expectEQ(view.getDouble() == val.getDouble(), true, "");
+		break;
+	case KsonType::BOOL:
+		expectEQ(view.getBool(), val.getBool(), "");
+		break;
+	default:
+		break;
+	}
+}
+
+// testLazy
+void KsonTest::testLazy() {
+	print("\n==== test: lazy ====\n");
+
+	std::vector<std::string> ksonStrs;
+	for (const char* file : { "test_case/test_all1.kson", "test_case/test_all2.kson", "test_case/test_space.kson", "test_case/test_comment.kson", "test_case/test_unsurpport.kson" }) {
+		std::ifstream in(file, std::ios::binary);
+		ksonStrs.push_back(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+	}
+
+	// 转义、各种写法的数值（符号后的空白、指数前的空白和注释、十六进制、超出 int64、超出 double）、重复的 key
+	ksonStrs.push_back("{ s: \"a\\tb\\qc\\\\\\\"d\", e: \"\", n1: - 5, n2: 1.5 /* c */ e3, n3: +0x1F, n4: 12345678901234567890, "
+		"n5: 1e-400, n6: -2.5E+3, n7: 7e2, dup: 1, dup: [2], deep: [[{ a: [{ }] }], []] }");
+	ksonStrs.push_back("{ big: 1" + std::string(400, '0') + " }");
+	ksonStrs.push_back("{ big: 1e999 }");
+	ksonStrs.push_back("{ a: 1.5e }");
+	ksonStrs.push_back("{ a: \"x }");
+	ksonStrs.push_back("{ a: [1, 2 }");
+	ksonStrs.push_back("{ a: \"\x01\" }");
+	ksonStrs.push_back("{ 1a: 1 }");
+
+	for (const auto& ksonStr : ksonStrs) {
+		Kson kson(ksonStr, false);
+		auto expect = kson.parse();
+
+		KsonLazyDocument doc;
+		expectEQ(doc.parse(ksonStr), expect.first, "");
+		expectEQ(doc.getErrorInfo(), kson.getErrorInfo(), "");
+		if (!expect.first) {
+			expectEQ(doc.root().isValid(), false, "");
+			expectEQ(doc.toObject().empty(), true, "");
+			continue;
+		}
+
+		expectEQ(doc.toObject(), expect.second, "");
+		KsonValue root;
+		root.setObject(KsonObject(expect.second));
+		expectLazyNode(root, doc.root());
+	}
+
+	// tape 的结构：object/array 记录子树之后的位置，数值和字符串只记录位置
+	KsonLazyDocument doc;
+	expectEQ(doc.parse("{ a: 1, b: [2, \"x\"] }"), true, "");
+	expectEQ(doc.tapeSize(), size_t(7), "");
+	KsonLazyNode b = doc.root().at("b");
+	expectEQ(b.size(), size_t(2), "");
+	expectEQ(b.at(1).rawStr() == "x", true, "");
+	expectEQ(b.next().isValid(), false, "");
+	expectEQ(doc.root().first().key() == "a", true, "");
+	expectEQ(doc.root().first().next().key() == "b", true, "");
+
+	// 读取时才解码
+	expectEQ(doc.parse("{ s: \"a\\nb\", d: 0.1, i: -7, h: 0xff }"), true, "");
+	expectEQ(doc.root().at("s").rawStr().empty(), true, "");
+	expectEQ(doc.root().at("s").getStr(), std::string("a\nb"), "");
+	expectEQ(doc.root().at("s").size(), size_t(3), "");
+	expectEQ(doc.root().at("d").getDouble(), 0.1, "");
+	expectEQ(doc.root().at("d").isInt(), false, "");
+	expectEQ(doc.root().at("i").getInt(), KsonInt(-7), "");
+	expectEQ(doc.root().at("h").getInt(), KsonInt(255), "");
+	expectEQ(doc.root().find("missing").isValid(), false, "");
+	bool thrown = false;
+	try { doc.root().at("s").at(size_t(0)); }
+	catch (const std::out_of_range&) { thrown = true; }
+	expectEQ(thrown, true, "");
+
+	// 文件，以及重复使用
+	expectEQ(doc.load("test_case/test_all1.kson"), true, "");
+	expectEQ(doc.toObject(), Kson("test_case/test_all1.kson").parse().second, "");
+	expectEQ(doc.load("test_case/not_exist.kson"), false, "");
+	expectEQ(doc.root().isValid(), false, "");
+
+	// 连续数值的转换
+	expectEQ(toKsonNum("-12", 3).second.getInt(), KsonInt(-12), "");
+	expectEQ(toKsonNum("2.5e-1", 6).second.getDouble(), 0.25, "");
+	expectEQ(toKsonNum("1.", 2).first, false, "");
+	expectEQ(toKsonNum("1e+", 3).first, false, "");
+	expectEQ(toKsonNum("-", 1).first, false, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testIndex
+void KsonTest::testIndex() {
+	print("\n==== test: index ====\n");
+
+	std::vector<std::string> ksonStrs;
+	for (const char* file : { "test_case/test_all1.kson", "test_case/test_all2.kson", "test_case/test_space.kson", "test_case/test_comment.kson", "test_case/test_unsurpport.kson" }) {
+		std::ifstream in(file, std::ios::binary);
+		ksonStrs.push_back(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+	}
+
+	// 各种写法：符号后和指数前的空白与注释、十六进制、TRUE/NULL、结尾的 ','、字符串中的 "//"、注释中的 '"'、根 object 之后的内容
+	ksonStrs.push_back("{ a: - 5, b: 1.5 /* e */ e3, c: +0x1F, d: [TRUE, FALSE, NULL, ], e: \"// \\\" /*\", /* \" */ f: { }, }");
+	ksonStrs.push_back("// \"\n{ a: 1 } tail \x01");
+	ksonStrs.push_back("{ a: 1 } \x01");
+	ksonStrs.push_back("{ a: 1 } /* \x01 */ // x");
+	ksonStrs.push_back("{ a: 1 }\0\x01");
+	ksonStrs.push_back("{ a: 1.e5 }");
+	ksonStrs.push_back("{ a: 1 e5 }");
+	ksonStrs.push_back("{ a: truex }");
+	ksonStrs.push_back("{ a: 1, b: \"x\x01\" }");
+	ksonStrs.push_back("{a:\"x\ty\"}");
+	ksonStrs.push_back("{a:\"x\ny\"}");
+	ksonStrs.push_back("{a:\"x\ry\"}");
+	ksonStrs.push_back("{ a: 1, /* \t */ b: \"// \t\" }");
+	ksonStrs.push_back("{ a b: 1 }");
+	ksonStrs.push_back("{ a: [1 2] }");
+	ksonStrs.push_back("{ a: [1, 2 }");
+	ksonStrs.push_back("{ a: \"x }");
+	ksonStrs.push_back("{ a: 1, /* x ");
+	ksonStrs.push_back("{ a: 0x }");
+	ksonStrs.push_back("{ ,}");
+	ksonStrs.push_back("");
+
+	// 转义的 '"'、连续的 '\'、注释和字符串中的 '\n' 跨过 64 字节的边界
+	for (size_t pad = 0; pad < 70; ++pad) {
+		std::string space(pad, ' ');
+		ksonStrs.push_back("{" + space + "a: \"\\\\\\\\\\\"\\\\\", b: \"" + std::string(pad, '\\') + "\", c: 1 }");
+		ksonStrs.push_back("{" + space + "a: 1, /* \" */ b: \"//\" // \"\n, c: -/**/2 }");
+		ksonStrs.push_back("{" + space + "a: \"" + std::string(pad, 'x') + "\ny\" }");
+	}
+
+	// 随机拼接的片段
+	std::mt19937 rand(20240701);
+	const char* pieces[] = { "{", "}", "[", "]", ":", ",", " ", "\n", "a", "_b1", "\"s\"", "\"\\\"\"", "\\", "\"", "1", "-", " - 5",
+		"1.5", " e3", "0x1F", "true", "NULL", "tru", "//c\n", "/*c*/", "/*", "*/", "/", "\x01", "\x80", "\t", "." };
+	for (int round = 0; round < 3000; ++round) {
+		std::string ksonStr = "{";
+		for (int i = rand() % 30; i > 0; --i) {
+			ksonStr += pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+			if (rand() % 5 == 0) ksonStr += std::string(rand() % 70, ' ');
+		}
+		if (rand() % 2) ksonStr += "}";
+		ksonStrs.push_back(ksonStr);
+	}
+
+	// Kson 遇到不支持的字符时输出错误信息，解析时关闭输出
+	std::vector<KsonSimd> simds = { KsonSimd::SCALAR, KsonSimd::SSE2, KsonSimd::AVX2 };
+	KsonSimd saved = getKsonSimd();
+	for (const auto& ksonStr : ksonStrs) {
+		std::streambuf* out = std::cout.rdbuf(nullptr);
+		Kson kson(ksonStr, false);
+		auto expect = kson.parse();
+
+		std::vector<KsonTapeEntry> expectTape;
+		KsonTapeBuilder expectBuilder(expectTape);
+		expectBuilder.setSource(ksonStr.data());
+		KsonBuffer buf;
+		buf.borrow(ksonStr.data(), ksonStr.size());
+		Kson(std::move(buf)).parse(expectBuilder);
+		std::cout.rdbuf(out);
+
+		for (KsonSimd simd : simds) {
+			if (!setKsonSimd(simd)) continue;
+
+			// 延迟解码时 tape 也相同
+			KsonIndexParser parser;
+			std::vector<KsonTapeEntry> tape;
+			KsonTapeBuilder builder(tape);
+			builder.setSource(ksonStr.data());
+			out = std::cout.rdbuf(nullptr);
+			auto ret = parser.parse(ksonStr);
+			std::string error = parser.getErrorInfo();
+			bool lazyRet = parser.parse(ksonStr, builder);
+			std::cout.rdbuf(out);
+
+			expectEQ(ret.first, expect.first, "");
+			expectEQ(error, kson.getErrorInfo(), "");
+			expectEQ(lazyRet, expect.first, "");
+			if (expect.first) {
+				expectEQ(ret.second, expect.second, "");
+				expectEQ(tape.size(), expectTape.size(), "");
+				for (size_t i = 0; i < tape.size(); ++i) {
+					expectEQ(tape[i].m_type == expectTape[i].m_type && tape[i].m_flag == expectTape[i].m_flag, true, "");
+					expectEQ(tape[i].m_len, expectTape[i].m_len, "");
+					expectEQ(tape[i].m_offset, expectTape[i].m_offset, "");
+				}
+			}
+		}
+	}
+	setKsonSimd(saved);
+
+	// 索引只包含结构字符、字符串两端的 '"'、key 和 value 的起始位置，以及结尾
+	KsonIndexParser parser;
+	std::string ksonStr = "{ a: 1, /* c */ b: \"x\" }";
+	parser.index(ksonStr.data(), ksonStr.size());
+	expectEQ(parser.indexSize(), size_t(11), "");
+	KsonDomHandler dom;
+	expectEQ(parser.walk(dom), true, "");
+	expectEQ(dom.release().at("b").getStr(), std::string("x"), "");
+
+	// handler 停止解析：事件和错误信息相同
+	ksonStr = "{ a: 1, b: { c: [1, 2] }, d: 2 }";
+	for (const char* stopKey : { "a", "c", "d" }) {
+		KsonTraceHandler handler1(stopKey), handler2(stopKey);
+		Kson kson(ksonStr, false);
+		expectEQ(kson.parse(handler1), false, "");
+		expectEQ(parser.parse(ksonStr, handler2), false, "");
+		expectEQ(handler2.m_trace, handler1.m_trace, "");
+		expectEQ(parser.getErrorInfo(), kson.getErrorInfo(), "");
+	}
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testParallel
+void KsonTest::testParallel() {
+	print("\n==== test: parallel ====\n");
+
+	std::vector<std::string> ksonStrs;
+	for (const char* file : { "test_case/test_all1.kson", "test_case/test_all2.kson", "test_case/test_space.kson", "test_case/test_comment.kson", "test_case/test_unsurpport.kson" }) {
+		std::ifstream in(file, std::ios::binary);
+		ksonStrs.push_back(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+	}
+
+	// 元素中和元素之间的字符串、注释、嵌套的 array，段末尾的行注释，多个 array，更深的 array，结尾的 ','
+	std::string records = "{\n    head: [1, 2],\n    records: [\n";
+	for (int i = 0; i < 200; ++i) {
+		records += "        { id: " + std::to_string(i) + ", name: \"r,[" + std::to_string(i) + "]\\\"\", tags: [[" + std::to_string(i % 3) + "], []] }, // ],\n";
+		if (i % 7 == 0) records += "        /* [ , } */ [\"x\", { a: [] }],\n";
+	}
+	records += "    ],\n    meta: { list: [1, 2, 3, 4, 5, 6, 7, 8, 9], }, tail: [[1], [2, [3]], [],\n    ],\n}\n";
+	ksonStrs.push_back(records);
+
+	// 元素中的错误（行号），以及只有切分才会遇到的写法
+	std::string broken = records;
+	broken.replace(broken.find("id: 150"), 7, "id: 15x");
+	ksonStrs.push_back(broken);
+	ksonStrs.push_back("{ a: [1, 2, , 3] }");
+	ksonStrs.push_back("{ a: [1, 2, 3, ] }");
+	ksonStrs.push_back("{ a: [,] }");
+	ksonStrs.push_back("{ a: [1, { b: 2 ], 3} }");
+	ksonStrs.push_back("{ a: [1, [2, 3] ] } ]]");
+	ksonStrs.push_back("{ a: [1, 2, 3 } ");
+	ksonStrs.push_back("{ a: [1, 2, 3 ");
+	ksonStrs.push_back("[1, 2, 3]");
+	ksonStrs.push_back("{ a: [1, 2, 3] } \x01");
+	ksonStrs.push_back("{ a: [1, 2 // ]\n, 3] }");
+	ksonStrs.push_back("{ a: [1, 2, \"\x01\"] }");
+	ksonStrs.push_back("{ a: [1, 2]\0, b: [3, 4] }");
+	ksonStrs.push_back("");
+
+	// 随机拼接的片段
+	std::mt19937 rand(20240801);
+	const char* pieces[] = { "{", "}", "[", "]", "[", "]", ":", ",", ",", " ", "\n", "a", "b:", "\"s\"", "\"[,\"", "\"\\\"\"", "1", "-2",
+		"1.5", "0x1F", "true", "NULL", "//c\n", "/*,]*/", "/*", "*/", "/", "\x01", "\t" };
+	for (int round = 0; round < 2000; ++round) {
+		std::string ksonStr = "{ a: [";
+		for (int i = rand() % 40; i > 0; --i) {
+			ksonStr += pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+		}
+		if (rand() % 4) ksonStr += "] }";
+		ksonStrs.push_back(ksonStr);
+	}
+
+	// Kson 遇到不支持的字符时输出错误信息，解析时关闭输出
+	KsonParallelParser parser(4);
+	for (size_t chunkSize : { 1, 7, 64, 1 << 20 }) {
+		parser.setChunkSize(chunkSize);
+		for (const auto& ksonStr : ksonStrs) {
+			std::streambuf* out = std::cout.rdbuf(nullptr);
+			Kson kson(ksonStr, false);
+			auto expect = kson.parse();
+			auto ret = parser.parse(ksonStr);
+			std::cout.rdbuf(out);
+
+			expectEQ(ret.first, expect.first, "");
+			expectEQ(parser.getErrorInfo(), kson.getErrorInfo(), "");
+			if (expect.first) {
+				expectEQ(ret.second, expect.second, "");
+			}
+		}
+	}
+
+	// 较大的 array 切分为多段；较小的 array 不切分
+	parser.setChunkSize(256);
+	expectEQ(parser.parse(records).first, true, "");
+	expectEQ(parser.chunkCount() > 10, true, "");
+	expectEQ(parser.parse(std::string("{ a: [1, 2, 3] }")).first, true, "");
+	expectEQ(parser.chunkCount(), size_t(0), "");
+
+	// 文件读取失败
+	expectEQ(parser.parseFile("test_case/not_exist.kson").first, false, "");
+	expectEQ(parser.getErrorInfo().empty(), false, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testStream
+void KsonTest::testStream() {
+	print("\n==== test: stream ====\n");
+
+	// 记录，以及记录之间只有空白和注释的行
+	const char* samples[] = {
+		"{ id: 1, name: \"a\" }",
+		"{ id: 2, name: \"b // /* \" }   // comment",
+		"{ id: 3, /* block\n  comment */ name: \"c\" }",
+		"{ id: 4, name: \"x\\\"/*\" }",
+		"{ id: 5, name: }",
+		"{ id: 6, ",
+		"{ id: 7, name: \"\x01\" }",
+		"{ id: 8 }\r",
+		"{ id: 9 } /* a */ /* b\n */",
+	};
+	const char* blanks[] = { "", "   \t", "// comment", "/* comment\n */ " };
+
+	std::vector<std::string> records;
+	std::vector<size_t> lines;
+	std::string stream;
+	size_t line = 1;
+	std::mt19937 rand(20240901);
+	for (int i = 0; i < 300; ++i) {
+		if (rand() % 4 == 0) {
+			std::string blank = blanks[rand() % 4];
+			stream += blank + "\n";
+			line += 1 + std::count(blank.begin(), blank.end(), '\n');
+		}
+		records.push_back(samples[rand() % 9]);
+		lines.push_back(line);
+		stream += records.back();
+		line += std::count(records.back().begin(), records.back().end(), '\n');
+		if (i + 1 < 300) {
+			stream += "\n";
+			++line;
+		}
+	}
+
+	// 单独解析每条记录的结果
+	std::vector<std::pair<bool, KsonObject>> expects;
+	std::vector<std::string> errors;
+	std::streambuf* out = std::cout.rdbuf(nullptr);
+	for (const auto& record : records) {
+		Kson kson(record, false);
+		expects.push_back(kson.parse());
+		errors.push_back(kson.getErrorInfo());
+	}
+	std::cout.rdbuf(out);
+
+	std::string file = "test_case/test_stream.tmp";
+	std::ofstream(file, std::ios::binary) << stream;
+
+	KsonStreamReader reader(3);
+	for (bool isFile : { false, true }) {
+		for (bool ordered : { true, false }) {
+			for (size_t batchSize : { 1, 100, 1 << 16 }) {
+				if (isFile) expectEQ(reader.open(file), true, "");
+				else reader.assign(stream);
+				reader.setOrdered(ordered);
+				reader.setBatchSize(batchSize);
+
+				std::vector<KsonRecord> results;
+				out = std::cout.rdbuf(nullptr);
+				bool ret = reader.readAll([&](KsonRecord& record) { results.push_back(std::move(record)); });
+				std::cout.rdbuf(out);
+
+				expectEQ(ret, true, "");
+				expectEQ(results.size(), records.size(), "");
+				if (!ordered) {
+					std::sort(results.begin(), results.end(), [](const KsonRecord& a, const KsonRecord& b) { return a.m_index < b.m_index; });
+				}
+				for (size_t i = 0; i < results.size() && i < records.size(); ++i) {
+					expectEQ(results[i].m_index, i, "");
+					expectEQ(results[i].m_line, lines[i], "");
+					expectEQ(results[i].m_ok, expects[i].first, "");
+					expectEQ(results[i].m_error, errors[i], "");
+					if (expects[i].first) {
+						expectEQ(results[i].m_object, expects[i].second, "");
+					}
+				}
+			}
+		}
+	}
+	std::remove(file.c_str());
+
+	// next() 逐条取出；等待交付的任务数为 1 时仍然按顺序
+	reader.assign("{ a: 1 }\n\n{ a: 2 }\n{ a: 3 }");
+	reader.setOrdered(true);
+	reader.setBatchSize(1);
+	reader.setMaxPending(1);
+	KsonRecord record;
+	for (KsonInt i = 1; i <= 3; ++i) {
+		expectEQ(reader.next(record), true, "");
+		expectEQ(record.m_object.at("a").getInt(), i, "");
+	}
+	expectEQ(reader.next(record), false, "");
+
+	// 文件打开失败
+	expectEQ(reader.open("test_case/not_exist.kson"), false, "");
+	expectEQ(reader.getErrorInfo().empty(), false, "");
+	expectEQ(reader.next(record), false, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testIterative
+void KsonTest::testIterative() {
+	print("\n==== test: iterative ====\n");
+
+	std::vector<std::string> ksonStrs;
+	for (const char* file : { "test_case/test_all1.kson", "test_case/test_all2.kson", "test_case/test_space.kson", "test_case/test_comment.kson", "test_case/test_unsurpport.kson" }) {
+		std::ifstream in(file, std::ios::binary);
+		ksonStrs.push_back(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+	}
+
+	// 错误出现在各层嵌套中：缺少 ':'、','、value、结尾，以及不支持的字符
+	ksonStrs.push_back("{ a: [1, { b: [2, 3], c: { d: } }] }");
+	ksonStrs.push_back("{ a: [1, { b: [2 3] }] }");
+	ksonStrs.push_back("{ a: [[[[ ]]], { b { } }] }");
+	ksonStrs.push_back("{ a: [[[[ 1, ");
+	ksonStrs.push_back("{ a: { b: { c: [ \"x\x01\" ] } } }");
+	ksonStrs.push_back("{ a: [ ], b: { }, }");
+	ksonStrs.push_back("[ ]");
+	ksonStrs.push_back("");
+
+	// 随机拼接的片段
+	std::mt19937 rand(20241001);
+	const char* pieces[] = { "{", "}", "[", "]", "{ }", "[ ]", ":", ",", " ", "\n", "a", "b: ", "\"s\"", "1", "-", "0x1F",
+		"true", "NULL", "tru", "//c\n", "/*c*/", "\x01" };
+	for (int round = 0; round < 3000; ++round) {
+		std::string ksonStr = "{";
+		for (int i = rand() % 30; i > 0; --i) {
+			ksonStr += pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+		}
+		if (rand() % 2) ksonStr += "}";
+		ksonStrs.push_back(ksonStr);
+	}
+
+	// 结果、事件、错误信息与递归的解析相同；限制嵌套深度时两者也相同
+	for (const auto& ksonStr : ksonStrs) {
+		for (size_t maxDepth : { 0, 1, 2, 3 }) {
+			Kson kson1(ksonStr, false), kson2(ksonStr, false);
+			kson1.setMaxDepth(maxDepth);
+			kson2.setMaxDepth(maxDepth);
+			kson2.setIterative(true);
+			std::streambuf* out = std::cout.rdbuf(nullptr);
+			auto expect = kson1.parse();
+			auto ret = kson2.parse();
+			std::cout.rdbuf(out);
+
+			expectEQ(ret.first, expect.first, "");
+			expectEQ(kson2.getErrorInfo(), kson1.getErrorInfo(), "");
+			if (expect.first) {
+				expectEQ(ret.second, expect.second, "");
+			}
+		}
+	}
+
+	// handler 在各个事件上停止解析
+	std::string ksonStr = "{ a: 1, b: { c: [1, [2], { }] }, d: [ ] }";
+	for (size_t stopAt = 1; stopAt <= 16; ++stopAt) {
+		KsonTraceHandler handler1, handler2;
+		handler1.m_stopAt = handler2.m_stopAt = stopAt;
+		Kson kson1(ksonStr, false), kson2(ksonStr, false);
+		kson2.setIterative(true);
+		expectEQ(kson2.parse(handler2), kson1.parse(handler1), "");
+		expectEQ(handler2.m_trace, handler1.m_trace, "");
+		expectEQ(kson2.getErrorInfo(), kson1.getErrorInfo(), "");
+	}
+
+	// 深度嵌套：非递归的解析不受调用栈的限制，超过最大深度时报错
+	auto deep = [](size_t depth) {
+		return "{ a: " + std::string(depth, '[') + std::string(depth, ']') + " }";
+	};
+	ksonStr = deep(100000);
+	KsonTraceHandler handler;
+	Kson kson1(ksonStr, false);
+	kson1.setIterative(true);
+	expectEQ(kson1.parse(handler), true, "");
+	expectEQ(handler.m_events, size_t(200003), "");
+
+	Kson kson2(ksonStr, false);
+	kson2.setIterative(true);
+	kson2.setMaxDepth(1000);
+	expectEQ(kson2.parse(handler), false, "");
+	expectEQ(kson2.getErrorInfo().find("nesting too deep (max depth 1000)") != std::string::npos, true, "");
+
+	// 很深的文档解析为 KsonObject 后析构：释放不递归
+	std::string nested;
+	for (int i = 0; i < 50000; ++i) nested += "{ b: [";
+	for (int i = 0; i < 50000; ++i) nested += "] }";
+	for (const std::string& deepStr : { deep(200000), "{ a: " + nested + " }" }) {
+		Kson kson(deepStr, false);
+		kson.setIterative(true);
+		auto ret = kson.parse();
+		expectEQ(ret.first, true, "");
+		expectEQ(ret.second.size(), size_t(1), "");
+	}
+
+	// 大量连续的注释：跳过注释不递归（递归的解析也一样）
+	std::string comments;
+	for (int i = 0; i < 2000000; ++i) comments += i % 2 ? "/**/" : "//\n";
+	for (bool iterative : { false, true }) {
+		Kson kson("{a:1" + comments + "}", false);
+		kson.setIterative(iterative);
+		kson.setMaxDepth(64);
+		auto ret = kson.parse();
+		expectEQ(ret.first, true, "");
+		expectEQ(ret.second.at("a").getInt(), KsonInt(1), "");
+	}
+
+	// 刚好达到最大深度时成功（根 object 为第 1 层）
+	for (bool iterative : { false, true }) {
+		Kson kson3(deep(999), false), kson4(deep(1000), false);
+		kson3.setIterative(iterative);
+		kson4.setIterative(iterative);
+		kson3.setMaxDepth(1000);
+		kson4.setMaxDepth(1000);
+		expectEQ(kson3.parse().first, true, "");
+		expectEQ(kson4.parse().first, false, "");
+	}
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testError
+void KsonTest::testError() {
+	print("\n==== test: error ====\n");
+
+	auto name = [](KsonErrorCode code) { return std::string(getKsonErrorName(code)); };
+
+	// 错误码、偏移、嵌套深度、行号和列号（块注释中的 '\n' 也计入行号）
+	struct ErrorCase {
+		const char*    m_kson;
+		KsonErrorCode  m_code;
+		size_t         m_offset;
+		size_t         m_depth;
+		size_t         m_line;
+		size_t         m_column;
+	};
+	ErrorCase cases[] = {
+		{ "{ a: 1, b 2 }",               KsonErrorCode::EXPECT_COLON,     10, 1, 1, 11 },
+		{ "{\n  a: [1, 2\n  b: 3 }",     KsonErrorCode::EXPECT_COMMA,     15, 2, 3, 3 },
+		{ "{ a: \"x\x01\" }",            KsonErrorCode::UNSUPPORTED_CHAR, 7,  1, 1, 8 },
+		{ "{ a: 1 } \x01",               KsonErrorCode::UNSUPPORTED_CHAR, 9,  1, 1, 10 },
+		{ "{ a: { b: 1 \x01 } }",        KsonErrorCode::UNSUPPORTED_CHAR, 12, 2, 1, 13 },
+		{ "{ a: tru }",                  KsonErrorCode::INVALID_LITERAL,  5,  1, 1, 6 },
+		{ "{ a: 1",                      KsonErrorCode::UNEXPECTED_END,   6,  1, 1, 7 },
+		{ "{ a: [1, ",                   KsonErrorCode::UNEXPECTED_END,   9,  2, 1, 10 },
+		{ "{ a: 1e }",                   KsonErrorCode::INVALID_NUMBER,   6,  1, 1, 7 },
+		{ "[1]",                         KsonErrorCode::EXPECT_OBJECT,    0,  1, 1, 1 },
+		{ "{ a: 1, b: }",                KsonErrorCode::EXPECT_VALUE,     11, 1, 1, 12 },
+		{ "{ /* a\nb */ a: 1, 2 }",      KsonErrorCode::EXPECT_KEY,       18, 1, 2, 12 },
+		{ "{ a: 0x10000000000000000 }",  KsonErrorCode::NUMBER_OUT_OF_RANGE, 25, 1, 1, 26 },
+	};
+	for (const auto& c : cases) {
+		for (bool iterative : { false, true }) {
+			Kson kson(c.m_kson, false);
+			kson.setIterative(iterative);
+			KsonObject obj;
+			KsonError error;
+
+			// 不输出到 std::cout
+			std::ostringstream os;
+			std::streambuf* out = std::cout.rdbuf(os.rdbuf());
+			bool ret = kson.parse(obj, error);
+			std::cout.rdbuf(out);
+
+			expectEQ(ret, false, "");
+			expectEQ(os.str().empty(), true, "");
+			expectEQ(name(error.m_code), name(c.m_code), "");
+			expectEQ(error.m_offset, c.m_offset, "");
+			expectEQ(error.m_depth, c.m_depth, "");
+			KsonTextPos pos = kson.getErrorPos();
+			expectEQ(pos.m_line, c.m_line, "");
+			expectEQ(pos.m_column, c.m_column, "");
+			expectEQ(kson.getErrorInfo(), formatKsonError(error, c.m_kson) + "\n", "");
+		}
+	}
+
+	// 超过最大嵌套深度
+	Kson deep("{ a: [[[1]]] }", false);
+	deep.setMaxDepth(3);
+	KsonHandler empty;
+	KsonError error;
+	expectEQ(deep.parse(empty, error), false, "");
+	expectEQ(name(error.m_code), std::string("TOO_DEEP"), "");
+	expectEQ(error.m_offset, size_t(7), "");
+	expectEQ(error.m_depth, size_t(3), "");
+	expectEQ(deep.getErrorInfo(), std::string("line 1, column 8: TOO_DEEP (depth 3)\n"), "");
+
+	// 与错误文本的解析结果、事件相同，错误码与错误文本同时为空或不为空
+	std::vector<std::string> ksonStrs;
+	for (const char* file : { "test_case/test_all1.kson", "test_case/test_all2.kson", "test_case/test_space.kson", "test_case/test_comment.kson", "test_case/test_unsurpport.kson" }) {
+		std::ifstream in(file, std::ios::binary);
+		ksonStrs.push_back(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+	}
+	std::mt19937 rand(20241101);
+	const char* pieces[] = { "{", "}", "[", "]", ":", ",", " ", "\n", "a", "b: ", "\"s\"", "\"\x01\"", "1", "-", "1.", "2e", "0x1F",
+		"true", "NULL", "tru", "//c\n", "/*c\n*/", "/*", "\x01" };
+	for (int round = 0; round < 3000; ++round) {
+		std::string ksonStr = "{";
+		for (int i = rand() % 30; i > 0; --i) {
+			ksonStr += pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+		}
+		if (rand() % 2) ksonStr += "}";
+		ksonStrs.push_back(ksonStr);
+	}
+	for (const auto& ksonStr : ksonStrs) {
+		KsonTraceHandler handler1;
+		Kson kson1(ksonStr, false);
+		std::streambuf* out = std::cout.rdbuf(nullptr);
+		bool expect = kson1.parse(handler1);
+		std::cout.rdbuf(out);
+
+		KsonError errors[2];
+		for (bool iterative : { false, true }) {
+			KsonTraceHandler handler2;
+			Kson kson2(ksonStr, false);
+			kson2.setIterative(iterative);
+			expectEQ(kson2.parse(handler2, errors[iterative]), expect, "");
+			expectEQ(handler2.m_trace, handler1.m_trace, "");
+			expectEQ(bool(errors[iterative]), !expect, "");
+			expectEQ(kson2.getErrorInfo().empty(), kson1.getErrorInfo().empty(), "");
+		}
+		expectEQ(name(errors[1].m_code), name(errors[0].m_code), "");
+		expectEQ(errors[1].m_offset, errors[0].m_offset, "");
+		expectEQ(errors[1].m_depth, errors[0].m_depth, "");
+	}
+
+	// handler 抛出的异常转换为错误码
+	class ThrowHandler : public KsonHandler {
+	public:
+		explicit ThrowHandler(bool isBadAlloc) : m_isBadAlloc(isBadAlloc) {}
+		bool integer(KsonInt value) override {
+			if (m_isBadAlloc) throw std::bad_alloc();
+			throw std::runtime_error("integer");
+		}
+		bool m_isBadAlloc;
+	};
+	for (bool isBadAlloc : { false, true }) {
+		ThrowHandler handler(isBadAlloc);
+		Kson kson("{ a: [\"x\", 1] }", false);
+		expectEQ(kson.parse(handler, error), false, "");
+		expectEQ(name(error.m_code), std::string(isBadAlloc ? "OUT_OF_MEMORY" : "STOPPED"), "");
+		expectEQ(error.m_depth, size_t(2), "");
+	}
+
+	// 文件读取失败时保留原因
+	Kson missing("test_case/not_exist.kson");
+	expectEQ(missing.parse(empty, error), false, "");
+	expectEQ(name(error.m_code), std::string("IO_FAILED"), "");
+	expectEQ(missing.getErrorInfo().empty(), false, "");
+
+	// 成功时错误码为 NONE
+	Kson ok("{ a: [1, { b: \"x\" }] }", false);
+	KsonObject obj;
+	expectEQ(ok.parse(obj, error), true, "");
+	expectEQ(bool(error), false, "");
+	expectEQ(obj.at("a").at(1).at("b").getStr(), std::string("x"), "");
+	expectEQ(ok.getErrorInfo(), std::string(), "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testCorpus
+void KsonTest::testCorpus() {
+	print("\n==== test: corpus ====\n");
+
+	for (KsonCorpusType type : KsonCorpus::allTypes()) {
+
+		// 同一个种子生成相同的文本，不同的种子不同
+		KsonCorpus corpus1(7), corpus2(7), corpus3(8);
+		std::vector<std::string> docs = corpus1.generate(type, 16 * 1024, 64 * 1024);
+		expectEQ(docs == corpus2.generate(type, 16 * 1024, 64 * 1024), true, "");
+		expectEQ(docs == corpus3.generate(type, 16 * 1024, 64 * 1024), false, "");
+		expectEQ(docs.size() >= size_t(2), true, "");
+
+		// 名称可以找回类型
+		KsonCorpusType found = KsonCorpusType::DEEP;
+		expectEQ(KsonCorpus::findType(KsonCorpus::getName(type), found), true, "");
+		expectEQ(found == type, true, "");
+
+		// 每个文档都能解析，输出后重新解析的内容相同
+		for (const auto& doc : docs) {
+			expectEQ(doc.size() >= size_t(16 * 1024), true, "");
+			Kson kson(doc, false);
+			auto ret = kson.parse();
+			expectEQ(ret.first, true, "");
+			expectEQ(ret.second.empty(), false, "");
+
+			std::string out = toKsonStr(ret.second);
+			auto again = Kson(out, false).parse();
+			expectEQ(again.first, true, "");
+			expectEQ(again.second, ret.second, "");
+		}
+	}
+
+	KsonCorpusType type;
+	expectEQ(KsonCorpus::findType("unknown", type), false, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testBind
+void KsonTest::testBind() {
+	print("\n==== test: bind ====\n");
+
+	std::string ksonStr =
+		"{\n"
+		"    name: \"gateway\", ver: 0x10,\n"
+		"    servers: [\n"
+		"        { host: \"a.example\", port: 80, enable: true, weight: 1.5, tags: [\"x\", \"y\"], limit: { qps: 100, burst: 20 } },\n"
+		"        { host: \"b.example\", port: 65535, weight: 2, limit: null, extra: { a: [1, { b: 2 }], c: \"z\" } }\n"
+		"    ],\n"
+		"    ports: { http: 80, https: 443 },\n"
+		"    groups: { odd: [1, 3], even: [], none: [] },\n"
+		"    matrix: [[1, 2.5], [], [-3e2]],\n"
+		"    comment: \"\\\"quoted\\\"\",\n"
+		"    unknown: [{ servers: [1] }, null]\n"
+		"}\n";
+
+	BindConfig config;
+	KsonBinder binder;
+	expectEQ(binder.parse(ksonStr, config), true, "");
+	expectEQ(binder.getErrorInfo(), std::string(), "");
+
+	// 与解析后逐个复制的结果相同
+	Kson kson(ksonStr, false);
+	auto ret = kson.parse();
+	expectEQ(ret.first, true, "");
+	const KsonObject& obj = ret.second;
+	expectEQ(config.name, obj.at("name").getStr(), "");
+	expectEQ(config.version, obj.at("ver").getInt(), "");
+	expectEQ(config.servers.size(), obj.at("servers").arrayRef().size(), "");
+	for (size_t i = 0; i < config.servers.size(); ++i) {
+		const BindServer& server = config.servers[i];
+		const KsonValue& val = obj.at("servers").at(i);
+		expectEQ(server.host, val.at("host").getStr(), "");
+		expectEQ(static_cast<KsonInt>(server.port), val.at("port").getInt(), "");
+		expectEQ(server.weight == val.at("weight").getDouble(), true, "");
+	}
+	expectEQ(config.servers[0].enable, true, "");
+	expectEQ(config.servers[0].tags == std::vector<std::string>({ "x", "y" }), true, "");
+	expectEQ(config.servers[0].limit.has_value(), true, "");
+	expectEQ(config.servers[0].limit->qps, 100, "");
+	expectEQ(*config.servers[0].limit->burst, 20, "");
+	expectEQ(config.servers[1].enable, false, "");
+	expectEQ(config.servers[1].tags.empty(), true, "");
+	expectEQ(config.servers[1].limit.has_value(), false, "");
+	expectEQ(config.ports == std::map<std::string, int>({ { "http", 80 }, { "https", 443 } }), true, "");
+	expectEQ(config.groups.size(), size_t(3), "");
+	expectEQ(config.groups["odd"] == std::vector<int>({ 1, 3 }), true, "");
+	expectEQ(config.groups["none"].empty(), true, "");
+	expectEQ(config.matrix == std::vector<std::vector<double>>({ { 1, 2.5 }, {}, { -300 } }), true, "");
+	expectEQ(*config.comment, std::string("\"quoted\""), "");
+	expectEQ(config.unset, std::string("keep"), "");
+
+	// 再次解析时 vector 和 map 被清空而不是追加，没有出现的成员保持原值
+	expectEQ(binder.parse("{ servers: [{ host: \"c\" }], ports: {}, comment: null }", config), true, "");
+	expectEQ(config.servers.size(), size_t(1), "");
+	expectEQ(config.servers[0].host, std::string("c"), "");
+	expectEQ(config.ports.empty(), true, "");
+	expectEQ(config.comment.has_value(), false, "");
+	expectEQ(config.name, std::string("gateway"), "");
+	expectEQ(config.matrix.size(), size_t(3), "");
+
+	// 根 object 也可以绑定到 map
+	std::map<std::string, std::optional<double>> values;
+	expectEQ(binder.parse("{ a: 1, b: null, c: 0.5 }", values), true, "");
+	expectEQ(values.size(), size_t(3), "");
+	expectEQ(*values["a"] == 1.0 && !values["b"] && *values["c"] == 0.5, true, "");
+
+	// 类型不符、超出范围：给出位置和原因，以及解析器停止的位置
+	std::vector<std::pair<std::string, std::string>> errors = {
+		{ "{ ver: \"1\" }", "ver: expect integer, got string" },
+		{ "{ ver: 1.5 }", "ver: expect integer, got number" },
+		{ "{ name: { } }", "name: expect string, got object" },
+		{ "{ servers: { } }", "servers: expect array, got object" },
+		{ "{ servers: [{ port: 70000 }] }", "servers[0].port: integer 70000 out of range" },
+		{ "{ servers: [{ port: -1 }] }", "servers[0].port: integer -1 out of range" },
+		{ "{ servers: [{}, { tags: [\"a\", 1] }] }", "servers[1].tags[1]: expect string, got integer" },
+		{ "{ servers: [{ enable: null }] }", "servers[0].enable: expect bool, got null" },
+		{ "{ servers: [{ limit: { qps: true } }] }", "servers[0].limit.qps: expect integer, got bool" },
+		{ "{ matrix: [[1], [\"x\"]] }", "matrix[1][0]: expect number, got string" },
+		{ "{ ports: { http: [] } }", "ports.http: expect integer, got array" },
+	};
+	for (const auto& error : errors) {
+		BindConfig bad;
+		expectEQ(binder.parse(error.first, bad), false, "");
+		std::string info = binder.getErrorInfo();
+		expectEQ(info.substr(0, info.find('\n')), error.second, "");
+		expectEQ(info.find("STOPPED") != std::string::npos, true, "");
+	}
+
+	// 格式错误时只有解析器的错误信息
+	BindConfig bad;
+	expectEQ(binder.parse("{ name: \"x\" ver: 1 }", bad), false, "");
+	expectEQ(binder.getErrorInfo().find("EXPECT_COMMA") != std::string::npos, true, "");
+	expectEQ(binder.load("test_case/not_exist.kson", bad), false, "");
+	std::string loadError = binder.getErrorInfo();
+	expectEQ(loadError.empty(), false, "");
+
+	// 重复使用时只有这一次的错误信息
+	expectEQ(binder.load("test_case/not_exist.kson", bad), false, "");
+	expectEQ(binder.getErrorInfo(), loadError, "");
+
+	// 测试文件中没有声明的 key 全部被跳过
+	BindConfig empty;
+	expectEQ(binder.load("test_case/test_all1.kson", empty), true, "");
+	expectEQ(empty.unset, std::string("keep"), "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testPath
+void KsonTest::testPath() {
+	print("\n==== test: path ====\n");
+
+	std::string ksonStr =
+		"{\n"
+		"    listen: { port: 8443 },\n"
+		"    servers: [\n"
+		"        { host: \"a\", port: 80, limits: { qps: 100 } },\n"
+		"        { host: \"b\", port: 81 },\n"
+		"        { host: \"c\", port: 82, limits: { qps: 300 }, tags: [\"x\", \"y\"] },\n"
+		"        { host: \"d\", port: 83, limits: { qps: 400 } }\n"
+		"    ],\n"
+		"    special: { v1: 1, v2: 2, v3: 3, t: true }\n"
+		"}\n";
+	Kson kson(ksonStr, false);
+	auto ret = kson.parse();
+	expectEQ(ret.first, true, "");
+	KsonObject& obj = ret.second;
+
+	// kson 的 key 只能是标识符，含有 '/'、'~'、"*" 和整数的 key 另外添加
+	KsonObject special, empty;
+	special["c~d"] = obj.at("special").at("v1");
+	special["*"] = obj.at("special").at("v2");
+	special["3"] = obj.at("special").at("v3");
+	empty["x"] = obj.at("special").at("t");
+	obj["a/b"].setObject(std::move(special));
+	obj[""].setObject(std::move(empty));
+
+	std::string error;
+	auto compile = [&](const std::string& str) {
+		KsonPath path;
+		expectEQ(path.compile(str, error), true, "");
+		return path;
+	};
+
+	// 两种写法编译后相同，结果与链式 at() 相同
+	KsonPath qps = compile("/servers/3/limits/qps");
+	KsonPath dotted = compile("servers[3].limits.qps");
+	expectEQ(qps.steps() == dotted.steps(), true, "");
+	expectEQ(qps.first(obj), &obj.at("servers").at(3).at("limits").at("qps"), "");
+	expectEQ(dotted.first(obj), qps.first(obj), "");
+	expectEQ(compile("servers[2].tags[1]").first(obj)->getStr(), std::string("y"), "");
+	expectEQ(compile("/listen/port").first(obj)->getInt(), KsonInt(8443), "");
+	expectEQ(compile("/listen").first(obj)->getType() == KsonType::OBJECT, true, "");
+	expectEQ(qps.isWildcard(), false, "");
+
+	// 不存在、类型不符、下标越界
+	const char* missing[] = { "/servers/1/limits/qps", "/servers/4/port", "/servers/port", "/listen/port/x", "/listen/0", "/servers/01/port", "/nothing", "" };
+	for (const char* str : missing) {
+		expectEQ(compile(str).first(obj) == nullptr, true, "");
+		expectEQ(compile(str).count(obj), size_t(0), "");
+	}
+
+	// 转义和特殊的 key："*" 与十进制整数在 object 上都是 key
+	expectEQ(compile("/a~1b/c~0d").first(obj)->getInt(), KsonInt(1), "");
+	expectEQ(compile("/a~1b/*").first(obj)->getInt(), KsonInt(2), "");
+	expectEQ(compile("/a~1b/3").first(obj)->getInt(), KsonInt(3), "");
+	expectEQ(compile("//x").first(obj)->getBool(), true, "");
+
+	// 通配符：按文档中的顺序，func 返回 false 时停止
+	KsonPath ports = compile("servers[*].port");
+	expectEQ(ports.isWildcard(), true, "");
+	std::vector<KsonInt> found;
+	expectEQ(ports.forEach(obj, [&found](const KsonValue& val) { found.push_back(val.getInt()); return true; }), size_t(4), "");
+	expectEQ(found == std::vector<KsonInt>({ 80, 81, 82, 83 }), true, "");
+	expectEQ(ports.forEach(obj, [](const KsonValue& val) { return val.getInt() < 81; }), size_t(2), "");
+	expectEQ(compile("/servers/*/limits/qps").count(obj), size_t(3), "");
+	expectEQ(compile("/servers/*/limits/qps").first(obj)->getInt(), KsonInt(100), "");
+	expectEQ(compile("/servers/*/tags/*").count(obj), size_t(2), "");
+
+	// 以 KsonValue 为根：相对路径，"" 为根本身
+	const KsonValue& server = obj.at("servers").at(2);
+	expectEQ(compile("/limits/qps").first(server)->getInt(), KsonInt(300), "");
+	expectEQ(compile("").first(server), &server, "");
+	expectEQ(compile("/*/port").count(obj.at("servers")), size_t(4), "");
+
+	// 格式错误
+	const char* invalid[] = { "/a~2", "/a~", "a..b", "a.", ".a", "a[", "a[x]", "a[1]b", "a[]" };
+	for (const char* str : invalid) {
+		KsonPath path;
+		error.clear();
+		expectEQ(path.compile(str, error), false, "");
+		expectEQ(error.find("invalid path") == 0, true, "");
+	}
+
+	// 一组路径：结果与逐个查询相同，查询时不分配内存
+	std::vector<std::string> strs = {
+		"/listen/port", "servers[*].port", "servers[3].limits.qps", "servers[*].limits.qps", "/servers/0/host",
+		"/servers/9/host", "/nothing", "", "/a~1b/*", "servers[*].port", "/servers/*/tags/*"
+	};
+	KsonPathSet paths;
+	for (const auto& str : strs) {
+		expectEQ(paths.add(str, error), true, "");
+	}
+	expectEQ(paths.add("/a~", error), false, "");
+	expectEQ(paths.size(), strs.size(), "");
+	paths.build();
+
+	std::vector<std::vector<const KsonValue*>> each(strs.size());
+	paths.forEach(obj, [&each](size_t index, const KsonValue& val) { each[index].push_back(&val); });
+	std::vector<const KsonValue*> results;
+	paths.first(obj, results);
+	expectEQ(results.size(), strs.size(), "");
+	for (size_t i = 0; i < strs.size(); ++i) {
+		KsonPath path = compile(strs[i]);
+		std::vector<const KsonValue*> expected;
+		path.forEach(obj, [&expected](const KsonValue& val) { expected.push_back(&val); return true; });
+		expectEQ(each[i] == expected, true, "");
+		expectEQ(results[i], path.first(obj), "");
+	}
+
+	// 查询之后再添加：build() 之前新的路径没有匹配，build() 重新建立树
+	expectEQ(paths.add("/listen/port", error), true, "");
+	paths.first(obj, results);
+	expectEQ(results.size(), strs.size() + 1, "");
+	expectEQ(results.back() == nullptr, true, "");
+	paths.build();
+	paths.first(obj, results);
+	expectEQ(results.back(), results[0], "");
+
+	// 添加大量路径（同一层有大量不同的 key）之后一次建立树
+	KsonPathSet many;
+	for (int i = 0; i < 20000; ++i) {
+		std::string path = i % 2 ? "/servers/" + std::to_string(i % 5) + "/port" : "/k" + std::to_string(i);
+		expectEQ(many.add(path, error), true, "");
+	}
+	many.build();
+	std::vector<const KsonValue*> manyResults;
+	many.first(obj, manyResults);
+	expectEQ(manyResults[3], compile("/servers/3/port").first(obj), "");
+	expectEQ(manyResults[19999] == nullptr, true, "");
+	expectEQ(manyResults[0] == nullptr, true, "");
+
+	KsonAlloc::reset();
+	size_t total = 0;
+	paths.first(obj, results);
+	total += qps.first(obj)->getInt();
+	total += ports.count(obj);
+	paths.forEach(obj, [&total](size_t index, const KsonValue&) { total += index; });
+	expectEQ(KsonAlloc::stat().m_count, size_t(0), "");
+	expectEQ(total > 0, true, "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// testBuilder
+void KsonTest::testBuilder() {
+	print("\n==== test: builder ====\n");
+
+	// 构建的文档与解析的相同
+	std::string ksonStr =
+		"{ name: \"gateway\", version: 3, ratio: 0.25, enable: true, parent: null,\n"
+		"  servers: [ { host: \"a\", port: 80, tags: [\"x\", \"y\"] }, { host: \"b\", port: 81, tags: [] } ],\n"
+		"  limits: { }, empty: [] }";
+	KsonValue doc;
+	doc.reserve(8);
+	doc.set("name", KsonValue::makeStr("gateway"));
+	doc.set("version", KsonValue::makeInt(3));
+	doc.set("ratio", KsonValue::makeDouble(0.25));
+	doc.set("enable", KsonValue::makeBool(true));
+	doc.set("parent", KsonValue::makeNull());
+	KsonValue& servers = doc.set("servers", KsonValue::makeArray());
+	servers.reserve(2);
+	const char* hosts[] = { "a", "b" };
+	for (int i = 0; i < 2; ++i) {
+		KsonValue& server = servers.emplace_back();
+		server.set("host", KsonValue::makeStr(hosts[i]));
+		server.set("port", KsonValue::makeInt(80 + i));
+		KsonValue& tags = server.set("tags", KsonValue::makeArray());
+		if (i == 0) {
+			tags.push_back(KsonValue::makeStr("x"));
+			tags.push_back(KsonValue::makeStr("y"));
+		}
+	}
+	doc.emplace("limits");
+	doc.set("empty", KsonValue::makeArray());
+
+	auto ret = Kson(ksonStr, false).parse();
+	expectEQ(ret.first, true, "");
+	expectEQ(doc.objectRef(), ret.second, "");
+	expectEQ(doc.size(), size_t(8), "");
+	expectEQ(doc.at("servers").size(), size_t(2), "");
+	expectEQ(toKsonStr(doc.objectRef()), toKsonStr(ret.second), "");
+	expectEQ(doc.at("ratio").isInt(), false, "");
+
+	// 容器和字符串移入，不拷贝
+	KsonStr str(1000, 'x');
+	const char* data = str.data();
+	KsonArray arr(1000);
+	const KsonValue* elems = arr.data();
+	KsonValue moved;
+	moved.set("s", KsonValue::makeStr(std::move(str)));
+	moved.set("a", KsonValue::makeArray(std::move(arr)));
+	expectEQ(moved.at("s").strRef().data() == data, true, "");
+	expectEQ(moved.at("a").arrayRef().data() == elems, true, "");
+	KsonValue outer;
+	KsonValue& inner = outer.push_back(std::move(moved));
+	expectEQ(inner.at("s").strRef().data() == data, true, "");
+
+	// set 覆盖已有的成员，emplace 返回已有的成员
+	KsonValue obj;
+	obj.set("k", KsonValue::makeInt(1));
+	obj.set("k", KsonValue::makeStr("v"));
+	expectEQ(obj.size(), size_t(1), "");
+	expectEQ(obj.at("k").getStr(), std::string("v"), "");
+	expectEQ(&obj.emplace("k") == obj.find("k"), true, "");
+	expectEQ(obj.at("k").getStr(), std::string("v"), "");
+
+	// 插入排在前面的 key 时已有的成员后移，之前返回的引用指向另一个成员的值
+	KsonValue shifted;
+	shifted.reserve(2);
+	KsonValue* slot = &shifted.set("b", KsonValue::makeInt(2));
+	shifted.set("a", KsonValue::makeInt(1));
+	expectEQ(shifted.find("b") == slot, false, "");
+	expectEQ(slot->getInt(), KsonInt(1), "");
+	expectEQ(shifted.at("b").getInt(), KsonInt(2), "");
+
+	// 类型不符时先变为空的 object / array
+	KsonValue val = KsonValue::makeStr("s");
+	val.push_back(KsonValue::makeInt(1));
+	expectEQ(val.getType() == KsonType::ARRAY, true, "");
+	expectEQ(val.size(), size_t(1), "");
+	val.set("a", KsonValue::makeInt(2));
+	expectEQ(val.getType() == KsonType::OBJECT, true, "");
+	expectEQ(val.size(), size_t(1), "");
+
+	// erase
+	KsonValue list = KsonValue::makeArray();
+	for (int i = 0; i < 5; ++i) {
+		list.push_back(KsonValue::makeInt(i));
+	}
+	expectEQ(list.erase(1), true, "");
+	expectEQ(list.erase(4), false, "");
+	expectEQ(list.size(), size_t(4), "");
+	expectEQ(list.at(1).getInt(), KsonInt(2), "");
+	expectEQ(list.erase("a"), false, "");
+	expectEQ(val.erase("a"), true, "");
+	expectEQ(val.erase("a"), false, "");
+	expectEQ(val.size(), size_t(0), "");
+	expectEQ(val.erase(0), false, "");
+
+	// reserve 不改变内容，之后追加不再分配容器
+	KsonValue reserved = KsonValue::makeArray();
+	reserved.reserve(100);
+	expectEQ(reserved.size(), size_t(0), "");
+	const KsonValue* first = &reserved.push_back(KsonValue::makeInt(0));
+	for (int i = 1; i < 100; ++i) {
+		reserved.push_back(KsonValue::makeInt(i));
+	}
+	expectEQ(&reserved.at(0) == first, true, "");
+	KsonValue number = KsonValue::makeInt(7);
+	number.reserve(10);
+	expectEQ(number.getInt(), KsonInt(7), "");
+
+	print("[ SUCCESS! ]\n");
+}
+
+// expectLazyNode: 延迟解码的节点与 KsonValue 相同（object 按 key 查找，重复的 key 已经由 KsonObject 合并）
+void KsonTest::expectLazyNode(const KsonValue& val, const KsonLazyNode& node) {
+	expectEQ(node.isValid(), true, "");
+	expectEQ(node.getType() == val.getType(), true, "");
+	switch (val.getType()) {
+	case KsonType::OBJECT:
+		for (const auto& item : val.objectRef()) {
+			expectLazyNode(item.second, node.at(item.first));
+		}
+		break;
+	case KsonType::ARRAY: {
+		const KsonArray& arr = val.arrayRef();
+		expectEQ(node.size(), arr.size(), "");
+		KsonLazyNode elem = node.first();
+		for (size_t i = 0; i < arr.size(); ++i) {
+			expectLazyNode(arr[i], elem);
+			expectLazyNode(arr[i], node.at(i));
+			elem = elem.next();
+		}
+		expectEQ(elem.isValid(), false, "");
+		break;
+	}
+	case KsonType::STRING:
+		expectEQ(node.getStr(), val.strRef(), "");
+		expectEQ(node.size(), val.strRef().size(), "");
+		break;
+	case KsonType::NUMBER:
+		expectEQ(node.isInt(), val.isInt(), "");
+		expectEQ(node.getInt(), val.getInt(), "");
+		expectEQ(node.getDouble() == val.getDouble(), true, "");
+		break;
+	case KsonType::BOOL:
+		expectEQ(node.getBool(), val.getBool(), "");
+		break;
+	default:
+		break;
+	}
+}
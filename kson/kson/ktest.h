@@ -2,13 +2,15 @@
 #define __K_TEST_H__
 
 #include "kson.h"
+#include "kbin.h"
+#include "ktape.h"
 
 #define F (format + "    ")
 #define KSON_TEST_DEBUG_MODE false
 #define KSON_TEST_DEBUG(arg) { if (KSON_TEST_DEBUG_MODE) { std::cout<<format<<arg; }}
 
 //============================================================
-//  ksonTest: KsonĲ
+//  ksonTest: Kson解析器的测试类
 //============================================================
 
 namespace kson {
@@ -23,16 +25,93 @@ namespace kson {
 
 		void runAllTest(KsonTestType type = KsonTestType::ONLY_RESULT);
 
-		// Կӻķʽ ksonValue
+		// 以可视化的方式输出 ksonValue
 		void printVisualize(const KsonObject& obj);
 
 	private:
 		
-		// ԸļȽksonǷԤͬ
+		// 测试各种文件，比较kson解析出的内容是否与预期相同
 		void testAll1();
 		void testAll2();
 		void testSpace();
 		void testComment();
+
+		// 测试 KsonValue 的引用访问和链式查找
+		void testAccessor();
+
+		// 测试字符分类：key 中的数字、十六进制数、字符串中的可见字符
+		void testCharClass();
+
+		// 测试解析过程中没有与嵌套深度相关的额外内存分配（例如调试信息的格式化字符串）
+		void testAllocation();
+		size_t countParseAlloc(const std::string& ksonStr);
+
+		// 测试文件读取：读取失败、大小为页大小整数倍的文件、CRLF 换行、KsonBuffer 的移动
+		void testLoad();
+
+		// 测试增量解析：在每个位置把输入切成两块，以及逐字节输入，结果与 Kson::parse() 相同
+		void testPush();
+		void expectPush(const std::string& ksonStr);
+
+		// 测试事件接口：事件的顺序、回调返回 false 时停止解析
+		void testSax();
+
+		// 测试内存池文档：与 KsonObject 的内容相同、读取接口、重复使用时没有堆分配
+		void testDocument();
+
+		// 测试 in-situ 模式：key 和不含转义字符的字符串指向文档保存的 kson 文本
+		void testInSitu();
+
+		// 测试 KsonObject（KsonFlatMap）：与 std::map 的查找、插入、删除、遍历顺序相同
+		void testFlatMap();
+
+		// 测试 key 的符号表：相同的 key 只保存一份、KsonKey 查找、关闭符号表时结果相同
+		void testInternKeys();
+
+		// 测试数值：int64 边界、十六进制、负指数、超出范围，随机 double 的往返与 strtod 对比
+		void testNumber();
+
+		// 测试批量扫描：各个 SIMD 实现与逐字节实现的结果相同（包括缓冲区末尾），解析结果和错误信息相同
+		void testSimd();
+
+		// 测试输出：测试文件输出后重新解析的内容相同（紧凑和缩进两种格式）、转义、double 的往返、不能表示的内容、sink 输出
+		void testWriter();
+
+		// 测试二进制编码：编码后解码的内容相同、直接读取与 KsonObject 相同、整数宽度、截断和损坏的编码不越界
+		void testBinary();
+		void expectBinView(const KsonValue& val, const KsonBinView& view);
+
+		// 测试延迟解码的文档：转换后的内容和错误信息与 Kson::parse() 相同、读取接口与 KsonObject 相同、tape 的结构
+		void testLazy();
+		void expectLazyNode(const KsonValue& val, const KsonLazyNode& node);
+
+		// 测试结构索引解析器：各个 SIMD 实现下解析结果、事件、错误信息与 Kson::parse() 相同（包括 64 字节边界上的转义和注释）
+		void testIndex();
+
+		// 测试多线程解析：不同的段大小下结果和错误信息（包括行号）与 Kson::parse() 相同（元素中的字符串、注释、嵌套的 array）
+		void testParallel();
+
+		// 测试记录流：按输入顺序 / 完成顺序交付，每条记录的结果、错误信息、行号与单独用 Kson 解析相同（跨行的块注释、字符串中的 "/*"、空行）
+		void testStream();
+
+		// 测试非递归解析：结果、事件、错误信息（包括 handler 停止和超过最大深度）与递归的解析相同，深度嵌套时不受调用栈限制
+		void testIterative();
+
+		// 测试不抛出异常的解析：错误码、偏移、嵌套深度、行号和列号，不输出到 std::cout，结果和事件与生成错误文本的解析相同
+		void testError();
+
+		// 测试语料生成：同一个种子的结果相同，每种语料的文档都能解析，输出后重新解析的内容相同
+		void testCorpus();
+
+		// 测试绑定到结构体：结果与解析后逐个复制的相同，未声明的 key 被跳过，类型不符或超出范围时给出位置
+		void testBind();
+
+		// 测试路径查询：两种写法的结果相同，与链式 at() 的结果相同，通配符，一组路径一次遍历的结果与逐个查询相同，查询时不分配内存
+		void testPath();
+
+		// 测试构建和修改 KsonValue：结果与解析相同的文本一致，移入时不拷贝，set 覆盖、类型不符时转换、erase、reserve
+		void testBuilder();
+
 		KsonObject testTwoKson(const std::string& ksonStr, const std::string& ksonFile);
 
 		void printObject(const KsonObject& obj, const std::string& format);
@@ -40,7 +119,7 @@ namespace kson {
 		void printValue(const KsonValue& val, const std::string& format, bool fromObject);
 		void print(const std::string& info);
 
-		// ߺ
+		// 工具函数
 	private:
 
 		// expectEQ <T>
@@ -52,92 +131,100 @@ namespace kson {
 				throw 1;
 			}
 		}
+	};
 
-		// expect <bool>
-		template<>
-		void expectEQ<bool>(const bool& val1, const bool& val2, const std::string& format) const {
-			KSON_TEST_DEBUG("expectEQ <bool>\n");
-			if (val1 != val2) {
-				std::cout << (val1 ? "true" : "false") << " != " << (val2 ? "true" : "false") << std::endl;
-				throw 1;
-			}
+	// expectEQ 的特化，需要在类外（命名空间作用域）声明
+	template<> void KsonTest::expectEQ<bool>(const bool& val1, const bool& val2, const std::string& format) const;
+	template<> void KsonTest::expectEQ<KsonType>(const KsonType& val1, const KsonType& val2, const std::string& format) const;
+	template<> void KsonTest::expectEQ<KsonValue>(const KsonValue& val1, const KsonValue& val2, const std::string& format) const;
+	template<> void KsonTest::expectEQ<KsonObject>(const KsonObject& val1, const KsonObject& val2, const std::string& format) const;
+	template<> void KsonTest::expectEQ<KsonArray>(const KsonArray& val1, const KsonArray& val2, const std::string& format) const;
+	template<> void KsonTest::expectEQ<KsonNum>(const KsonNum& val1, const KsonNum& val2, const std::string& format) const;
+
+	// expect <bool>
+	template<>
+	inline void KsonTest::expectEQ<bool>(const bool& val1, const bool& val2, const std::string& format) const {
+		KSON_TEST_DEBUG("expectEQ <bool>\n");
+		if (val1 != val2) {
+			std::cout << (val1 ? "true" : "false") << " != " << (val2 ? "true" : "false") << std::endl;
+			throw 1;
 		}
-		
-		// expectEQ <KsonType>
-		template<>
-		void expectEQ<KsonType>(const KsonType& val1, const KsonType& val2, const std::string& format) const {
-			KSON_TEST_DEBUG("expectEQ <KsonType>\n");
-			auto getKsonTypeName = [=](const KsonType& v) -> std::string {
-				switch (v) {
-				case KsonType::OBJECT: return "OBJECT";
-				case KsonType::ARRAY: return "ARRAY";
-				case KsonType::STRING: return "STRING";
-				case KsonType::NUMBER: return "NUMBER";
-				case KsonType::BOOL: return "BOOL";
-				case KsonType::NUL: return "NUL";
-				}
-			};
-			if (val1 != val2) {
-				std::cout << getKsonTypeName(val1) << " != " << getKsonTypeName(val2) << std::endl;
+	}
+	
+	// expectEQ <KsonType>
+	template<>
+	inline void KsonTest::expectEQ<KsonType>(const KsonType& val1, const KsonType& val2, const std::string& format) const {
+		KSON_TEST_DEBUG("expectEQ <KsonType>\n");
+		auto getKsonTypeName = [=](const KsonType& v) -> std::string {
+			switch (v) {
+			case KsonType::OBJECT: return "OBJECT";
+			case KsonType::ARRAY: return "ARRAY";
+			case KsonType::STRING: return "STRING";
+			case KsonType::NUMBER: return "NUMBER";
+			case KsonType::BOOL: return "BOOL";
+			case KsonType::NUL: return "NUL";
 			}
+		};
+		if (val1 != val2) {
+			std::cout << getKsonTypeName(val1) << " != " << getKsonTypeName(val2) << std::endl;
 		}
-		
-		// expectEQ <KsonValue>
-		template<>
-		void expectEQ<KsonValue>(const KsonValue& val1, const KsonValue& val2, const std::string& format) const {
-			KSON_TEST_DEBUG("expectEQ <KsonValue>\n");
-			expectEQ(val1.m_type, val2.m_type, F);
-			switch (val1.m_type) {
-			case KsonType::OBJECT: expectEQ(val1.m_object, val2.m_object, F); break;
-			case KsonType::ARRAY:  expectEQ(val1.m_array, val2.m_array, F); break;
-			case KsonType::STRING: expectEQ(val1.m_str, val2.m_str, F); break;
-			case KsonType::NUMBER: expectEQ(val1.m_num, val2.m_num, F); break;
-			case KsonType::BOOL:   expectEQ(val1.m_bool, val2.m_bool, F); break;
-			case KsonType::NUL:    expectEQ(val1.m_null, val2.m_null, F); break;
-			default: throw 1;
-			}
+	}
+	
+	// expectEQ <KsonValue>
+	template<>
+	inline void KsonTest::expectEQ<KsonValue>(const KsonValue& val1, const KsonValue& val2, const std::string& format) const {
+		KSON_TEST_DEBUG("expectEQ <KsonValue>\n");
+		expectEQ(val1.m_type, val2.m_type, F);
+		switch (val1.m_type) {
+		case KsonType::OBJECT: expectEQ(val1.objectRef(), val2.objectRef(), F); break;
+		case KsonType::ARRAY:  expectEQ(val1.arrayRef(), val2.arrayRef(), F); break;
+		case KsonType::STRING: expectEQ(val1.strRef(), val2.strRef(), F); break;
+		case KsonType::NUMBER: expectEQ(val1.m_num, val2.m_num, F); break;
+		case KsonType::BOOL:   expectEQ(val1.m_bool, val2.m_bool, F); break;
+		case KsonType::NUL:    expectEQ(val1.getNull(), val2.getNull(), F); break;
+		default: throw 1;
 		}
-
-		// expectEQ <KsonObject>
-		template<>
-		void expectEQ<KsonObject>(const KsonObject& obj1, const KsonObject& obj2, const std::string& format) const {
-			KSON_TEST_DEBUG("expectEQ <KsonObject>\n");
-			expectEQ(obj1.size(), obj2.size(), F);
-			auto iter1 = obj1.begin();
-			auto iter2 = obj2.begin();
-			while (iter1 != obj1.end() && iter2 != obj2.end()) {
-				expectEQ(iter1->first, iter2->first, F);
-				expectEQ(iter1->second.m_type, iter2->second.m_type, F);
-				expectEQ(iter1->second, iter2->second, F);
-				++iter1;
-				++iter2;
-			}
+	}
+
+	// expectEQ <KsonObject>
+	template<>
+	inline void KsonTest::expectEQ<KsonObject>(const KsonObject& obj1, const KsonObject& obj2, const std::string& format) const {
+		KSON_TEST_DEBUG("expectEQ <KsonObject>\n");
+		expectEQ(obj1.size(), obj2.size(), F);
+		auto iter1 = obj1.begin();
+		auto iter2 = obj2.begin();
+		while (iter1 != obj1.end() && iter2 != obj2.end()) {
+			expectEQ(iter1->first, iter2->first, F);
+			expectEQ(iter1->second.m_type, iter2->second.m_type, F);
+			expectEQ(iter1->second, iter2->second, F);
+			++iter1;
+			++iter2;
 		}
-
-		// expectEQ <KsonArray>
-		template<>
-		void expectEQ<KsonArray>(const KsonArray& arr1, const KsonArray& arr2, const std::string& format) const {
-			KSON_TEST_DEBUG("expectEQ <KsonArray>\n");
-			size_t size = arr1.size();
-			expectEQ(size, arr2.size(), F);
-			for (size_t i = 0; i < size; ++i) {
-				expectEQ(arr1[i], arr2[i], F);
-			}
+	}
+
+	// expectEQ <KsonArray>
+	template<>
+	inline void KsonTest::expectEQ<KsonArray>(const KsonArray& arr1, const KsonArray& arr2, const std::string& format) const {
+		KSON_TEST_DEBUG("expectEQ <KsonArray>\n");
+		size_t size = arr1.size();
+		expectEQ(size, arr2.size(), F);
+		for (size_t i = 0; i < size; ++i) {
+			expectEQ(arr1[i], arr2[i], F);
 		}
-		
-		// expectEQ <KsonNum>
-		template<>
-		void expectEQ<KsonNum>(const KsonNum& num1, const KsonNum& num2, const std::string& format) const {
-			KSON_TEST_DEBUG("expectEQ <KsonNum>\n");
-			expectEQ(num1.m_isInt, num2.m_isInt, F);
-			if (num1.m_isInt) {
-				expectEQ(num1.m_int, num2.m_int, F);
-			}
-			else {
-				expectEQ(num1.m_double, num2.m_double, F);
-			}
+	}
+	
+	// expectEQ <KsonNum>
+	template<>
+	inline void KsonTest::expectEQ<KsonNum>(const KsonNum& num1, const KsonNum& num2, const std::string& format) const {
+		KSON_TEST_DEBUG("expectEQ <KsonNum>\n");
+		expectEQ(num1.m_isInt, num2.m_isInt, F);
+		if (num1.m_isInt) {
+			expectEQ(num1.m_int, num2.m_int, F);
 		}
-	};
+		else {
+			expectEQ(num1.m_double, num2.m_double, F);
+		}
+	}
 }
 
 #endif
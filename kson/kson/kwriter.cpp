@@ -0,0 +1,255 @@
+﻿#include "stdafx.h"
+#include "kwriter.h"
+#include <cmath>
+
+using namespace kson;
+
+namespace {
+
+	// 字符串中需要转义的字符对应的转义字符，0 表示不需要转义，-1 表示不能表示
+	struct KsonEscapeTable {
+		signed char m_escape[256];
+	};
+
+	constexpr KsonEscapeTable makeKsonEscapeTable() {
+		KsonEscapeTable table = {};
+		for (int c = 0; c < 256; ++c) {
+			table.m_escape[c] = (c >= ' ' && c <= '~') ? 0 : -1;
+		}
+		table.m_escape[static_cast<unsigned char>('"')] = '"';
+		table.m_escape[static_cast<unsigned char>('\\')] = '\\';
+		table.m_escape[static_cast<unsigned char>('\n')] = 'n';
+		table.m_escape[static_cast<unsigned char>('\t')] = 't';
+		return table;
+	}
+
+	constexpr KsonEscapeTable KSON_ESCAPE_TABLE = makeKsonEscapeTable();
+
+	// key 必须是标识符：字母或下划线开头，之后为字母、数字、下划线
+	bool isValidKey(const char* str, size_t len) {
+		if (len == 0 || !isCharClass(str[0], KSON_CHAR_KEY_START)) return false;
+		for (size_t i = 1; i < len; ++i) {
+			if (!isCharClass(str[i], KSON_CHAR_KEY)) return false;
+		}
+		return true;
+	}
+}
+
+//============================================================
+//  ksonWriter
+//============================================================
+
+// KsonWriter
+KsonWriter::KsonWriter(bool pretty, int indent) : m_pretty(pretty), m_indent(indent) {
+	m_stack.reserve(32);
+}
+
+// KsonWriter: sink
+KsonWriter::KsonWriter(Sink sink, bool pretty, int indent) : m_sink(std::move(sink)), m_pretty(pretty), m_indent(indent) {
+	m_stack.reserve(32);
+	m_buf.reserve(FLUSH_SIZE + 1024);
+}
+
+// write
+bool KsonWriter::write(const KsonObject& obj) {
+	if (!startObject()) return false;
+	for (const auto& member : obj) {
+		if (!key(member.first.data(), member.first.size())) return false;
+		if (!writeValue(member.second)) return false;
+	}
+	return endObject();
+}
+
+// startObject
+bool KsonWriter::startObject() {
+	startContainer(true, '{');
+	return true;
+}
+
+// key
+bool KsonWriter::key(const char* str, size_t len) {
+	if (!isValidKey(str, len)) {
+		return fail("key '" + std::string(str, len) + "' is not a valid kson key.");
+	}
+
+	beforeValue();
+	put(str, len);
+	if (m_pretty) put(": ", 2);
+	else put(':');
+	m_afterKey = true;
+	return true;
+}
+
+// endObject
+bool KsonWriter::endObject() {
+	endContainer('}');
+	return true;
+}
+
+// startArray
+bool KsonWriter::startArray() {
+	startContainer(false, '[');
+	return true;
+}
+
+// endArray
+bool KsonWriter::endArray() {
+	endContainer(']');
+	return true;
+}
+
+// string: 不需要转义的部分整段拷贝
+bool KsonWriter::string(const char* str, size_t len) {
+	beforeValue();
+	put('"');
+	size_t start = 0;
+	for (size_t i = 0; i < len; ++i) {
+		signed char escape = KSON_ESCAPE_TABLE.m_escape[static_cast<unsigned char>(str[i])];
+		if (escape == 0) continue;
+		if (escape < 0) {
+			return fail("charactor (ASCII: " + std::to_string(static_cast<unsigned char>(str[i])) + ") in string can not be written in kson.");
+		}
+
+		put(str + start, i - start);
+		put('\\');
+		put(static_cast<char>(escape));
+		start = i + 1;
+	}
+	put(str + start, len - start);
+	put('"');
+	checkFlush();
+	return true;
+}
+
+// integer
+bool KsonWriter::integer(KsonInt value) {
+	beforeValue();
+	char buf[KSON_NUM_BUF_SIZE];
+	put(buf, formatKsonInt(value, buf));
+	checkFlush();
+	return true;
+}
+
+// floating
+bool KsonWriter::floating(double value) {
+	if (!std::isfinite(value)) {
+		return fail("NaN and infinity can not be written in kson.");
+	}
+
+	beforeValue();
+	char buf[KSON_NUM_BUF_SIZE];
+	put(buf, formatKsonDouble(value, buf));
+	checkFlush();
+	return true;
+}
+
+// boolean
+bool KsonWriter::boolean(bool value) {
+	beforeValue();
+	if (value) put("true", 4);
+	else put("false", 5);
+	return true;
+}
+
+// null
+bool KsonWriter::null() {
+	beforeValue();
+	put("null", 4);
+	return true;
+}
+
+// flush
+void KsonWriter::flush() {
+	if (m_sink && !m_buf.empty()) {
+		m_sink(m_buf.data(), m_buf.size());
+		m_buf.clear();
+	}
+}
+
+// reset
+void KsonWriter::reset() {
+	m_buf.clear();
+	m_stack.clear();
+	m_afterKey = false;
+	m_error.clear();
+}
+
+// writeValue
+bool KsonWriter::writeValue(const KsonValue& val) {
+	switch (val.getType()) {
+	case KsonType::OBJECT:
+		return write(val.objectRef());
+
+	case KsonType::ARRAY:
+		if (!startArray()) return false;
+		for (const auto& elem : val.arrayRef()) {
+			if (!writeValue(elem)) return false;
+		}
+		return endArray();
+
+	case KsonType::STRING: {
+		const KsonStr& str = val.strRef();
+		return string(str.data(), str.size());
+	}
+
+	case KsonType::NUMBER:
+		return val.isInt() ? integer(val.getInt()) : floating(val.getDouble());
+
+	case KsonType::BOOL:
+		return boolean(val.getBool());
+
+	default:
+		return null();
+	}
+}
+
+// beforeValue
+void KsonWriter::beforeValue() {
+	if (m_afterKey) {
+		m_afterKey = false;
+		return;
+	}
+	if (m_stack.empty()) return;
+
+	Frame& frame = m_stack.back();
+	if (frame.m_count++ > 0) put(',');
+	if (m_pretty) newLine();
+}
+
+// startContainer
+void KsonWriter::startContainer(bool isObject, char c) {
+	beforeValue();
+	put(c);
+	m_stack.push_back({ isObject, 0 });
+}
+
+// endContainer: 空的容器输出为 {} / []
+void KsonWriter::endContainer(char c) {
+	bool isEmpty = m_stack.back().m_count == 0;
+	m_stack.pop_back();
+	if (m_pretty && !isEmpty) newLine();
+	put(c);
+
+	// 根 object 结束
+	if (m_pretty && m_stack.empty()) put('\n');
+	checkFlush();
+}
+
+// newLine
+void KsonWriter::newLine() {
+	put('\n');
+	m_buf.append(m_stack.size() * m_indent, ' ');
+}
+
+// fail
+bool KsonWriter::fail(const std::string& errInfo) {
+	m_error += errInfo + "\n";
+	return false;
+}
+
+// toKsonStr
+std::string kson::toKsonStr(const KsonObject& obj, bool pretty) {
+	KsonWriter writer(pretty);
+	if (!writer.write(obj)) return std::string();
+	return writer.str();
+}
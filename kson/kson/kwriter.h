@@ -0,0 +1,101 @@
+﻿#ifndef __K_WRITER_H__
+#define __K_WRITER_H__
+
+#include "kson.h"
+#include <functional>
+
+//============================================================
+//  ksonWriter: kson 文本输出
+//============================================================
+
+// 由事件输出 kson 文本，可以直接输出 KsonObject，也可以接收 KsonNode::accept() 或解析器的事件：
+//
+//     KsonWriter writer(true);                 // 带缩进
+//     if (writer.write(obj)) use(writer.str());
+//
+//     KsonWriter writer([&](const char* data, size_t size) { out.write(data, size); });
+//     doc.root().accept(writer);
+//     writer.flush();
+//
+// 输出的文本可以被 Kson 重新解析为相同的内容：字符串中的 '"' '\' 换行 制表符 转义，double 输出为能精确还原的最短形式
+// kson 不能表示的内容返回 false，getErrorInfo() 中给出原因：key 不是标识符、字符串含有其它不支持的字符、NaN 和无穷大
+
+namespace kson {
+
+	class KsonWriter : public KsonHandler {
+	public:
+
+		// 接收输出的数据块
+		using Sink = std::function<void(const char* data, size_t size)>;
+
+		// 输出到内部的缓冲区，由 str() 获取；pretty 为 true 时每个成员一行，每层缩进 indent 个空格
+		explicit KsonWriter(bool pretty = false, int indent = 4);
+
+		// 输出到 sink：缓冲区满时和 flush() 时写出
+		explicit KsonWriter(Sink sink, bool pretty = false, int indent = 4);
+
+		// 输出 KsonObject（作为根 object）
+		bool write(const KsonObject& obj);
+
+		bool startObject() override;
+		bool key(const char* str, size_t len) override;
+		bool endObject() override;
+		bool startArray() override;
+		bool endArray() override;
+		bool string(const char* str, size_t len) override;
+		bool integer(KsonInt value) override;
+		bool floating(double value) override;
+		bool boolean(bool value) override;
+		bool null() override;
+
+		// 没有 sink 时为输出的全部文本；有 sink 时为还未写出的部分
+		const std::string& str() const { return m_buf; }
+
+		// 把缓冲区中的数据写到 sink
+		void flush();
+
+		// 清空输出和状态（不调用 flush()）
+		void reset();
+
+		// 获取输出过程中的错误信息
+		std::string getErrorInfo() const { return m_error; }
+
+	private:
+		struct Frame {
+			bool    m_isObject;
+			size_t  m_count;     // 已输出的成员个数
+		};
+
+		bool writeValue(const KsonValue& val);
+
+		// value 之前：逗号、换行和缩进（object 中的 value 在 key 之后，不需要）
+		void beforeValue();
+		void startContainer(bool isObject, char c);
+		void endContainer(char c);
+		void newLine();
+
+		void put(char c) { m_buf.push_back(c); }
+		void put(const char* str, size_t len) { m_buf.append(str, len); }
+
+		// 缓冲区超过 FLUSH_SIZE 时写到 sink
+		void checkFlush() { if (m_sink && m_buf.size() >= FLUSH_SIZE) flush(); }
+
+		bool fail(const std::string& errInfo);
+
+	private:
+		static const size_t FLUSH_SIZE = 64 * 1024;
+
+		Sink                m_sink;
+		bool                m_pretty;
+		int                 m_indent;
+		std::string         m_buf;
+		std::vector<Frame>  m_stack;
+		bool                m_afterKey = false;   // 已输出 key，等待 value
+		std::string         m_error;
+	};
+
+	// 输出为 kson 文本，失败时返回空字符串
+	std::string toKsonStr(const KsonObject& obj, bool pretty = false);
+}
+
+#endif
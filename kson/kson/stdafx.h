@@ -5,10 +5,13 @@
 
 #pragma once
 
-#include "targetver.h"
-
 #include <stdio.h>
+
+// Windows 平台的头文件（Linux 等平台由 CMakeLists.txt 构建性能测试时不需要）
+#ifdef _WIN32
+#include "targetver.h"
 #include <tchar.h>
+#endif
 
 
 